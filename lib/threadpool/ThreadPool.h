@@ -1,70 +1,297 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
-#include <vector>
-#include <queue>
-#include <memory>
-#include <thread>
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <future>
+#include <deque>
+#include <exception>
 #include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 
+// Work-stealing thread pool.
+// Every worker owns a deque of tasks. It runs its newest task first and steals
+// the oldest tasks of the other workers when its own deque is empty.
+// Workers waiting inside the pool (parallel_for, wait) execute pending tasks
+// instead of blocking, so tasks may wait for other tasks of the same pool.
+// Background tasks wait in a separate FIFO lane. Workers start them only when
+// there are no other tasks, and at most size() - 1 of them run at once, so one
+// worker stays free for interactive tasks.
 class ThreadPool {
 public:
     ThreadPool(size_t);
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args)
         ->std::future<typename std::result_of<F(Args...)>::type>;
+    template<class F, class... Args>
+    auto enqueue_background(F&& f, Args&&... args)
+        ->std::future<typename std::result_of<F(Args...)>::type>;
     ~ThreadPool();
 
+    // Call f(*it) for every element. The range is split into chunks of at least
+    // min_chunk_size elements, which idle threads claim one by one.
+    // The calling thread processes chunks too. The first exception is rethrown
+    // after all chunks have finished.
     template<class It, class Func>
-    void parallel_for(It begin, It end, Func f);
+    void parallel_for(It begin, It end, Func f, size_t min_chunk_size = 1);
+
+    // Call f(chunk_index, chunk_begin, chunk_end) for each chunk of chunk_size
+    // indices of [0, count), the last chunk may be shorter. The chunks are
+    // numbered in the order of the range, there are chunk_count(count, chunk_size)
+    // of them. Idle threads claim chunks one by one, the calling thread
+    // processes chunks too. The first exception is rethrown after all chunks
+    // have finished.
+    template<class Func>
+    void parallel_for_chunks(size_t count, size_t chunk_size, Func f);
+
+    // Number of chunks parallel_for_chunks splits count indices into
+    static size_t chunk_count(size_t count, size_t chunk_size)
+    {
+        return (count + chunk_size - 1) / std::max<size_t>(1, chunk_size);
+    }
+
+    // Wait until the future (std::future or std::shared_future) is ready.
+    // Pool workers execute pending tasks meanwhile, but never background tasks.
+    template<class Future>
+    void wait(const Future& future);
+
+    size_t size() const { return workers.size(); }
+
 private:
+    using Task = std::function<void()>;
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // State of a single parallel_for shared by all threads working on it
+    struct Job {
+        Job(size_t chunk_count, std::function<void(size_t)> run_chunk)
+            : chunk_count(chunk_count), remaining(chunk_count), run_chunk(std::move(run_chunk)) {}
+
+        const size_t chunk_count;
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> remaining;
+        std::function<void(size_t)> run_chunk;
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
-    // the task queue
-    std::queue< std::function<void()> > tasks;
+    // one task deque per worker
+    std::vector< std::unique_ptr<WorkQueue> > queues;
+
+    // number of tasks in all deques, increased before a task is pushed
+    std::atomic<size_t> pending;
+    // number of workers waiting for a task
+    std::atomic<size_t> sleeping;
+    // deque for the next task pushed from outside of the pool
+    std::atomic<size_t> next_queue;
 
-    // synchronization
-    std::mutex queue_mutex;
+    // synchronization of sleeping workers, also guards the background lane
+    std::mutex sleep_mutex;
     std::condition_variable condition;
     bool stop;
+
+    // background lane, guarded by sleep_mutex
+    std::deque<Task> background;
+    size_t background_running;
+    const size_t background_limit;
+
+    template<class F, class... Args>
+    auto package(F&& f, Args&&... args)
+        ->std::pair<Task, std::future<typename std::result_of<F(Args...)>::type>>;
+
+    void push(Task task);
+    void push_background(Task task);
+    bool try_pop(Task& task);
+    bool try_pop_background(Task& task);
+    void finish_background();
+    bool can_start_background() const;
+    bool run_pending_task();
+    void worker_loop(size_t index);
+
+    // index of the deque owned by the calling thread, npos outside of this pool
+    size_t current_queue() const;
+
+    static void work_on(Job& job);
+
+    // run the chunks of a job on this thread and on idle workers
+    void run_job(size_t chunk_count, std::function<void(size_t)> run_chunk);
+
+    static const ThreadPool*& current_pool()
+    {
+        static thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& current_index()
+    {
+        static thread_local size_t index = 0;
+        return index;
+    }
 };
 
 // the constructor just launches some amount of workers
 inline ThreadPool::ThreadPool(size_t threads)
-    : stop(false)
+    : pending(0), sleeping(0), next_queue(0), stop(false), background_running(0),
+      background_limit(threads > 1 ? threads - 1 : 1)
 {
+    threads = std::max<size_t>(1, threads);
+    for (size_t i = 0; i < threads; ++i)
+        queues.emplace_back(new WorkQueue);
     for (size_t i = 0; i < threads; ++i)
-        workers.emplace_back(
-            [this]
+        workers.emplace_back([this, i] { worker_loop(i); });
+}
+
+inline size_t ThreadPool::current_queue() const
+{
+    return current_pool() == this ? current_index() : npos;
+}
+
+inline void ThreadPool::worker_loop(size_t index)
+{
+    current_pool() = this;
+    current_index() = index;
+
+    for (;;)
     {
-        for (;;)
+        Task task;
+        if (try_pop(task))
+        {
+            task();
+            continue;
+        }
+        if (try_pop_background(task))
         {
-            std::function<void()> task;
-
-            {
-                std::unique_lock<std::mutex> lock(this->queue_mutex);
-                this->condition.wait(lock,
-                    [this] { return this->stop || !this->tasks.empty(); });
-                if (this->stop && this->tasks.empty())
-                    return;
-                task = std::move(this->tasks.front());
-                this->tasks.pop();
-            }
-
             task();
+            finish_background();
+            continue;
         }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        ++sleeping;
+        condition.wait(lock, [this] { return stop || pending.load() > 0 || can_start_background(); });
+        --sleeping;
+        if (stop && pending.load() == 0 && background.empty())
+            return;
     }
-    );
 }
 
-// add new work item to the pool
+inline void ThreadPool::push(Task task)
+{
+    size_t index = current_queue();
+    if (index == npos)
+        index = next_queue.fetch_add(1) % queues.size();
+
+    ++pending;
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // A worker going to sleep either sees the pending task or is counted here
+    if (sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        condition.notify_one();
+    }
+}
+
+inline void ThreadPool::push_background(Task task)
+{
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    background.push_back(std::move(task));
+    condition.notify_one();
+}
+
+// requires sleep_mutex, the limit does not apply when stopping
+inline bool ThreadPool::can_start_background() const
+{
+    return !background.empty() && (stop || background_running < background_limit);
+}
+
+inline bool ThreadPool::try_pop_background(Task& task)
+{
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    if (!can_start_background())
+        return false;
+    task = std::move(background.front());
+    background.pop_front();
+    ++background_running;
+    return true;
+}
+
+inline void ThreadPool::finish_background()
+{
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    --background_running;
+    if (!background.empty())
+        condition.notify_one();
+}
+
+inline bool ThreadPool::try_pop(Task& task)
+{
+    if (pending.load() == 0)
+        return false;
+
+    // Own deque from the back, stealing from the front of the others
+    const size_t own = current_queue();
+    if (own != npos)
+    {
+        WorkQueue& queue = *queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            --pending;
+            return true;
+        }
+    }
+
+    const size_t first = own == npos ? 0 : own + 1;
+    for (size_t i = 0; i < queues.size(); ++i)
+    {
+        WorkQueue& queue = *queues[(first + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool ThreadPool::run_pending_task()
+{
+    Task task;
+    if (!try_pop(task))
+        return false;
+    task();
+    return true;
+}
+
 template<class F, class... Args>
-auto ThreadPool::enqueue(F&& f, Args&&... args)
--> std::future<typename std::result_of<F(Args...)>::type>
+auto ThreadPool::package(F&& f, Args&&... args)
+-> std::pair<Task, std::future<typename std::result_of<F(Args...)>::type>>
 {
     using return_type = typename std::result_of<F(Args...)>::type;
 
@@ -74,23 +301,41 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
 
     std::future<return_type> res = task->get_future();
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        std::unique_lock<std::mutex> lock(sleep_mutex);
 
         // don't allow enqueueing after stopping the pool
         if (stop)
             throw std::runtime_error("enqueue on stopped ThreadPool");
-
-        tasks.emplace([task]() { (*task)(); });
     }
-    condition.notify_one();
-    return res;
+
+    return {[task]() { (*task)(); }, std::move(res)};
+}
+
+// add new work item to the pool
+template<class F, class... Args>
+auto ThreadPool::enqueue(F&& f, Args&&... args)
+-> std::future<typename std::result_of<F(Args...)>::type>
+{
+    auto packaged = package(std::forward<F>(f), std::forward<Args>(args)...);
+    push(std::move(packaged.first));
+    return std::move(packaged.second);
+}
+
+// add new work item to the background lane
+template<class F, class... Args>
+auto ThreadPool::enqueue_background(F&& f, Args&&... args)
+-> std::future<typename std::result_of<F(Args...)>::type>
+{
+    auto packaged = package(std::forward<F>(f), std::forward<Args>(args)...);
+    push_background(std::move(packaged.first));
+    return std::move(packaged.second);
 }
 
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool()
 {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        std::unique_lock<std::mutex> lock(sleep_mutex);
         stop = true;
     }
     condition.notify_all();
@@ -98,16 +343,118 @@ inline ThreadPool::~ThreadPool()
         worker.join();
 }
 
+template<class Future>
+void ThreadPool::wait(const Future& future)
+{
+    if (current_queue() == npos)
+    {
+        // Threads outside of the pool do not pick up unrelated, possibly long tasks
+        future.wait();
+        return;
+    }
+
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        if (!run_pending_task())
+            future.wait_for(std::chrono::microseconds(100));
+    }
+}
+
+inline void ThreadPool::work_on(Job& job)
+{
+    for (;;)
+    {
+        const size_t chunk = job.next_chunk.fetch_add(1);
+        if (chunk >= job.chunk_count)
+            return;
+
+        try
+        {
+            job.run_chunk(chunk);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.error)
+                job.error = std::current_exception();
+        }
+
+        if (job.remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.done.notify_all();
+        }
+    }
+}
+
 template<class It, class Func>
-void ThreadPool::parallel_for(It begin, It end, Func f)
+void ThreadPool::parallel_for(It begin, It end, Func f, size_t min_chunk_size)
+{
+    const size_t count = static_cast<size_t>(std::distance(begin, end));
+    if (count == 0)
+        return;
+
+    // A few chunks per thread even out elements of different cost
+    const size_t max_chunks = 4 * (workers.size() + 1);
+    const size_t chunk_count = std::max<size_t>(1, std::min(count / std::max<size_t>(1, min_chunk_size), max_chunks));
+    if (chunk_count == 1)
+    {
+        for (It it = begin; it != end; ++it)
+            f(*it);
+        return;
+    }
+
+    using difference_type = typename std::iterator_traits<It>::difference_type;
+    run_job(chunk_count, [begin, count, chunk_count, &f](size_t chunk) {
+        It it = std::next(begin, static_cast<difference_type>(count * chunk / chunk_count));
+        const It chunk_end = std::next(begin, static_cast<difference_type>(count * (chunk + 1) / chunk_count));
+        for (; it != chunk_end; ++it)
+            f(*it);
+    });
+}
+
+template<class Func>
+void ThreadPool::parallel_for_chunks(size_t count, size_t chunk_size, Func f)
+{
+    chunk_size = std::max<size_t>(1, chunk_size);
+    const size_t chunks = chunk_count(count, chunk_size);
+    if (chunks == 0)
+        return;
+    if (chunks == 1)
+    {
+        f(size_t{0}, size_t{0}, count);
+        return;
+    }
+
+    run_job(chunks, [count, chunk_size, &f](size_t chunk) {
+        const size_t chunk_begin = chunk * chunk_size;
+        f(chunk, chunk_begin, std::min(count, chunk_begin + chunk_size));
+    });
+}
+
+inline void ThreadPool::run_job(size_t chunk_count, std::function<void(size_t)> run_chunk)
 {
-    std::vector<std::future<void>> futures;
-    for (It it = begin; it != end; ++it)
+    auto job = std::make_shared<Job>(chunk_count, std::move(run_chunk));
+
+    // Helpers that start after all chunks were claimed return without touching the chunks
+    const size_t helpers = std::min(workers.size(), chunk_count - 1);
+    for (size_t i = 0; i < helpers; ++i)
+        push([job] { work_on(*job); });
+
+    work_on(*job);
+
+    // Wait for the chunks claimed by other threads
+    const bool is_worker = current_queue() != npos;
+    while (job->remaining.load() > 0)
     {
-        futures.emplace_back(enqueue(f, *it));
+        if (is_worker && run_pending_task())
+            continue;
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->done.wait_for(lock, std::chrono::microseconds(100), [&job] { return job->remaining.load() == 0; });
     }
 
-    // Wait for all
-    std::for_each(futures.begin(), futures.end(), [](auto& f) { f.get(); });
+    if (job->error)
+        std::rethrow_exception(job->error);
 }
 #endif
@@ -0,0 +1,137 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "ThreadPool.h"
+
+TEST(ThreadPool, parallelForVisitsAll) {
+    /**
+     * Test that parallel_for calls the function exactly once for every element, for any range and chunk size
+     */
+    ::ThreadPool threadPool(3);
+    for(const size_t count : {0, 1, 2, 7, 100, 10000}) {
+        for(const size_t minChunkSize : {1, 3, 1000}) {
+            std::vector<size_t> elements(count);
+            std::iota(elements.begin(), elements.end(), 0);
+            std::vector<std::atomic<int>> visits(count);
+            for(auto& visit : visits) {
+                visit = 0;
+            }
+
+            threadPool.parallel_for(elements.begin(), elements.end(), [&visits](size_t idx) { ++visits[idx]; },
+                                    minChunkSize);
+            for(const auto& visit : visits) {
+                EXPECT_EQ(visit.load(), 1);
+            }
+        }
+    }
+}
+
+TEST(ThreadPool, parallelForException) {
+    /**
+     * Test that an exception is rethrown only after all other elements were processed
+     */
+    ::ThreadPool threadPool(2);
+    std::vector<size_t> elements(1000);
+    std::iota(elements.begin(), elements.end(), 0);
+    std::atomic<size_t> processed(0);
+
+    EXPECT_THROW(threadPool.parallel_for(elements.begin(), elements.end(),
+                                         [&processed](size_t idx) {
+                                             if(idx == 10) {
+                                                 throw std::runtime_error("Test exception");
+                                             }
+                                             ++processed;
+                                         }),
+                 std::runtime_error);
+    EXPECT_GE(processed.load(), 900u);
+}
+
+TEST(ThreadPool, parallelForChunks) {
+    /**
+     * Test that parallel_for_chunks covers the range with consecutive chunks of the chunk size, each called exactly
+     * once with its index
+     */
+    ::ThreadPool threadPool(3);
+    for(const size_t count : {0, 1, 2, 7, 100, 10000}) {
+        for(const size_t chunkSize : {1, 3, 1000}) {
+            const size_t chunkCount = ::ThreadPool::chunk_count(count, chunkSize);
+            std::vector<std::atomic<int>> visits(count);
+            for(auto& visit : visits) {
+                visit = 0;
+            }
+            std::vector<std::pair<size_t, size_t>> chunks(chunkCount);
+
+            threadPool.parallel_for_chunks(count, chunkSize, [&](size_t chunkIdx, size_t begin, size_t end) {
+                ASSERT_LT(chunkIdx, chunkCount);
+                chunks[chunkIdx] = {begin, end};
+                for(size_t idx = begin; idx < end; ++idx) {
+                    ++visits[idx];
+                }
+            });
+            for(const auto& visit : visits) {
+                EXPECT_EQ(visit.load(), 1);
+            }
+            for(size_t chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx) {
+                EXPECT_EQ(chunks[chunkIdx].first, chunkIdx * chunkSize);
+                EXPECT_EQ(chunks[chunkIdx].second, std::min(count, (chunkIdx + 1) * chunkSize));
+            }
+        }
+    }
+}
+
+TEST(ThreadPool, nestedParallelism) {
+    /**
+     * Test that tasks waiting for other tasks of the same pool do not deadlock, even with a single worker
+     */
+    ::ThreadPool threadPool(1);
+    std::vector<size_t> elements(64);
+    std::iota(elements.begin(), elements.end(), 0);
+
+    auto outer = threadPool.enqueue([&threadPool, &elements]() {
+        std::atomic<size_t> sum(0);
+        threadPool.parallel_for(elements.begin(), elements.end(), [&](size_t idx) {
+            auto inner = threadPool.enqueue([idx]() { return idx; });
+            threadPool.wait(inner);
+            sum += inner.get();
+        });
+        return sum.load();
+    });
+
+    threadPool.wait(outer);
+    EXPECT_EQ(outer.get(), 64u * 63u / 2u);
+}
+
+TEST(ThreadPool, backgroundLane) {
+    /**
+     * Test that background tasks leave a worker free for interactive tasks and run in FIFO order
+     */
+    ::ThreadPool threadPool(2);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    auto first = threadPool.enqueue_background([released]() {
+        released.wait();
+        return 1;
+    });
+    auto second = threadPool.enqueue_background([]() { return 2; });
+
+    // Only one of the two workers may run background tasks, the other one stays available
+    auto interactive = threadPool.enqueue([]() { return 3; });
+    ASSERT_EQ(interactive.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(interactive.get(), 3);
+    EXPECT_EQ(second.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+
+    release.set_value();
+    threadPool.wait(second);
+    EXPECT_EQ(first.get(), 1);
+    EXPECT_EQ(second.get(), 2);
+}
+
+#endif
@@ -22,34 +22,49 @@ class CmdPaintBrush : public CommandBase<Geometry> {
     }
 
     CmdPaintBrush(ci::Ray ray, const BrushSettings settings)
-        : CommandBase(true, true), mRays{ray}, mSettings(settings) {}
+        : CommandBase(true, true), mSweeps{{std::nullopt, ray}}, mSettings(settings) {}
+
+    CmdPaintBrush(BrushSweep sweep, const BrushSettings settings)
+        : CommandBase(true, true), mSweeps{sweep}, mSettings(settings) {}
 
    protected:
     void run(Geometry& target) const override {
         const auto start = std::chrono::high_resolution_clock::now();
 
-        for(const ci::Ray& ray : mRays) {
-            if(mSettings.spherical) {
-                target.paintAreaWithSphere(ray, mSettings);
-            } else {
-                glm::vec3 ro = ray.getOrigin();
-                glm::vec3 rd = ray.getDirection();
-                if(mSettings.alignToNormal) {
-                    auto intersection = target.intersectMesh(ray, ro);
-                    if(!intersection) {
-                        continue;
-                    }
-
-                    rd = -target.getTriangle(*intersection).getNormal();
+        // All sweeps of a joined stroke are painted at once, each triangle is cut and triangulated only once
+        if(mSettings.spherical) {
+            target.paintAreaWithSweeps(mSweeps, mSettings);
+        } else {
+            std::vector<TriangleDetail::ProjectedShape> shapes;
+            shapes.reserve(mSweeps.size());
+            for(const BrushSweep& sweep : mSweeps) {
+                const std::optional<Circle> circle = getShapeCircle(target, sweep.to);
+                if(!circle) {
+                    continue;
                 }
 
-                // Create a shape to paint with
-                const Vector3 rayDirectionVector(rd.x, rd.y, rd.z);
-                const Circle circle(Point3(ro.x, ro.y, ro.z), mSettings.size * mSettings.size, rayDirectionVector);
-                const std::vector<Point3> circlePoints = GeometryUtils::pointsOnCircle(circle, mSettings.segments);
+                const glm::vec3 projectionDirection = sweep.to.getDirection();
+                const Vector3 projectionVector(projectionDirection.x, projectionDirection.y, projectionDirection.z);
+                std::vector<Point3> shape = GeometryUtils::pointsOnCircle(*circle, mSettings.segments);
+
+                // The circle moved from the previous ray sweeps over the convex hull of both circles
+                const std::optional<Circle> fromCircle =
+                    sweep.from ? getShapeCircle(target, *sweep.from) : std::nullopt;
+                if(fromCircle && CGAL::squared_distance(fromCircle->center(), circle->center()) <=
+                                     std::pow(mSettings.size * BrushSweep::MAX_LENGTH_IN_SIZES, 2)) {
+                    std::vector<Point3> sweptPoints = GeometryUtils::pointsOnCircle(*fromCircle, mSettings.segments);
+                    sweptPoints.insert(sweptPoints.end(), shape.begin(), shape.end());
+                    std::vector<Point3> sweptShape =
+                        GeometryUtils::projectedConvexHull(sweptPoints, circle->supporting_plane(), projectionVector);
+                    if(sweptShape.size() >= 3) {
+                        shape = std::move(sweptShape);
+                    }
+                }
 
-                target.paintWithShape(ray, circlePoints, mSettings.color, mSettings.paintBackfaces);
+                shapes.push_back({std::move(shape), projectionVector});
             }
+
+            target.paintWithShapes(shapes, mSettings.color, mSettings.paintBackfaces);
         }
 
         const auto end = std::chrono::high_resolution_clock::now();
@@ -61,14 +76,32 @@ class CmdPaintBrush : public CommandBase<Geometry> {
     bool joinCommand(const CommandBase& otherBase) override {
         const auto* other = dynamic_cast<const CmdPaintBrush*>(&otherBase);
         if(other && other->mSettings == mSettings) {
-            mRays.insert(mRays.end(), other->mRays.begin(), other->mRays.end());
+            mSweeps.insert(mSweeps.end(), other->mSweeps.begin(), other->mSweeps.end());
             return true;
         } else {
             return false;
         }
     }
 
-    std::vector<ci::Ray> mRays;
+   private:
+    /// Circle of the shape brush placed at the ray, none if it has to be aligned to a normal the ray does not hit
+    std::optional<Circle> getShapeCircle(const Geometry& target, const ci::Ray& ray) const {
+        glm::vec3 ro = ray.getOrigin();
+        glm::vec3 rd = ray.getDirection();
+        if(mSettings.alignToNormal) {
+            auto intersection = target.intersectMesh(ray, ro);
+            if(!intersection) {
+                return {};
+            }
+
+            rd = -target.getTriangle(*intersection).getNormal();
+        }
+
+        const Vector3 rayDirectionVector(rd.x, rd.y, rd.z);
+        return Circle(Point3(ro.x, ro.y, ro.z), mSettings.size * mSettings.size, rayDirectionVector);
+    }
+
+    std::vector<BrushSweep> mSweeps;
     BrushSettings mSettings;
 };
 }  // namespace pepr3d
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "commands/Command.h"
+#include "geometry/DetailedTriangleSet.h"
 #include "geometry/Geometry.h"
 
 namespace pepr3d {
@@ -18,37 +19,31 @@ class CmdPaintSingleColor : public CommandBase<Geometry> {
         : CmdPaintSingleColor(DetailedTriangleId(triangleId), colorId) {}
 
     CmdPaintSingleColor(DetailedTriangleId triangleId, const size_t colorId)
-        : CommandBase(false, true), mTriangleIds{triangleId}, mColorId(colorId) {}
+        : CommandBase(false, true), mTriangles(std::vector<DetailedTriangleId>{triangleId}), mColorId(colorId) {}
 
     CmdPaintSingleColor(std::vector<DetailedTriangleId>&& triangleIds, const size_t colorId)
-        : CommandBase(false, true), mTriangleIds(triangleIds), mColorId(colorId) {}
+        : CommandBase(false, true), mTriangles(triangleIds), mColorId(colorId) {}
 
     CmdPaintSingleColor(std::vector<size_t>&& triangleIds, const size_t colorId)
-        : CommandBase(false, true), mColorId(colorId) {
-        mTriangleIds.reserve(triangleIds.size());
-        for(size_t triIdx : triangleIds) {
-            mTriangleIds.emplace_back(triIdx);
-        }
-    }
+        : CommandBase(false, true), mTriangles(std::move(triangleIds)), mColorId(colorId) {}
 
    protected:
     void run(Geometry& target) const override {
-        for(DetailedTriangleId triangleId : mTriangleIds) {
-            target.setTriangleColor(triangleId, mColorId);
-        }
+        target.setTrianglesColor(mTriangles, mColorId);
     }
 
     bool joinCommand(const CommandBase& otherBase) override {
         const auto* other = dynamic_cast<const CmdPaintSingleColor*>(&otherBase);
         if(other && other->mColorId == mColorId) {
-            mTriangleIds.insert(mTriangleIds.end(), other->mTriangleIds.begin(), other->mTriangleIds.end());
+            mTriangles.merge(other->mTriangles);
             return true;
         } else {
             return false;
         }
     }
 
-    std::vector<DetailedTriangleId> mTriangleIds;
+    /// Painted triangles in a compact form, a fill of a large model keeps a few bits per triangle in the history
+    DetailedTriangleSet mTriangles;
     size_t mColorId;
 };
-}  // namespace pepr3d
\ No newline at end of file
+}  // namespace pepr3d
@@ -1,25 +1,136 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <stdexcept>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include "commands/Command.h"
 #include "peprassert.h"
 
 namespace pepr3d {
 
+/// Limits of the snapshots a CommandManager keeps, see CommandManager::setSnapshotSettings()
+struct SnapshotSettings {
+    /// Snapshot after at most this many commands
+    size_t maxCommandsBetweenSnapshots = 10;
+
+    /// Snapshot once the commands since the last snapshot ran this long, so that an undo of recent commands replays
+    /// about this much. Older snapshots are thinned out, the allowed replay doubles with each level of age.
+    double replayTargetMs = 200.0;
+
+    /// Memory cap of all snapshots. Old snapshots are thinned out and then the oldest commands are dropped from the
+    /// history to stay under it.
+    size_t memoryBudgetBytes = size_t{512} * 1024 * 1024;
+};
+
+/// Current state of the snapshots of a CommandManager
+struct SnapshotStats {
+    size_t commandCount = 0;
+    size_t snapshotCount = 0;
+
+    /// Size of all snapshots as reported by the target, data shared between snapshots is counted once
+    size_t snapshotBytes = 0;
+
+    /// Run time of the last executed command
+    double lastCommandMs = 0.0;
+
+    /// Longest replay of commands that an undo may currently need, measured by their last run
+    double maxReplayMs = 0.0;
+
+    /// Snapshots removed to thin out old history or to fit into the memory budget
+    size_t thinnedSnapshotCount = 0;
+
+    /// Commands dropped from the start of the history to fit into the memory budget, they cannot be undone
+    size_t droppedCommandCount = 0;
+};
+
+/// Data that the saved states of a CommandManager may share, e.g. copy-on-write values. The shared parts are
+/// reference counted over all snapshots, so that each one is counted once while any snapshot holds it.
+class SharedStateParts {
+   public:
+    /// Reference a part of the state being saved, identified by its address. The size is computed only for a part that
+    /// no snapshot holds yet.
+    template <typename PartSize>
+    void add(const void* part, const PartSize& partSize) {
+        Part& entry = mParts[part];
+        if(entry.refCount++ == 0) {
+            entry.bytes = partSize();
+            mBytes += entry.bytes;
+        }
+        mAddedParts.push_back(part);
+    }
+
+    /// Size of all referenced parts
+    size_t getBytes() const {
+        return mBytes;
+    }
+
+    /// Parts added since the last call, i.e. those of the last saved state
+    std::vector<const void*> takeAddedParts() {
+        return std::move(mAddedParts);
+    }
+
+    /// Release the references of a removed state
+    void remove(const std::vector<const void*>& parts) {
+        for(const void* part : parts) {
+            auto it = mParts.find(part);
+            P_ASSERT(it != mParts.end());
+            if(--it->second.refCount == 0) {
+                P_ASSERT(mBytes >= it->second.bytes);
+                mBytes -= it->second.bytes;
+                mParts.erase(it);
+            }
+        }
+    }
+
+   private:
+    struct Part {
+        size_t refCount = 0;
+        size_t bytes = 0;
+    };
+
+    std::unordered_map<const void*, Part> mParts;
+    std::vector<const void*> mAddedParts;
+    size_t mBytes = 0;
+};
+
+namespace detail {
+/// Does the target report the size of its states via getStateSize(state, sharedParts)
+template <typename Target, typename State, typename = void>
+struct HasStateSize : std::false_type {};
+
+template <typename Target, typename State>
+struct HasStateSize<Target, State,
+                    std::void_t<decltype(std::declval<const Target>().getStateSize(
+                        std::declval<const State&>(), std::declval<SharedStateParts&>()))>> : std::true_type {};
+}  // namespace detail
+
 /// CommandManager handles all undoable operations on target in the form of commands See @see
 /// CommandBase. All commands must be executed via the CommandManager Requirements for Target: Target
-/// must have a saveState() and loadState(State) methods
+/// must have a saveState() and loadState(State) methods. It may have a getStateSize(State, SharedStateParts&) method
+/// returning the size of a state in bytes and adding the data it may share with other states to the SharedStateParts,
+/// otherwise sizeof(State) is used.
+/// Snapshots are taken based on the measured run time of the commands and kept within a memory budget, see
+/// SnapshotSettings.
 template <typename Target>
 class CommandManager {
    public:
     using CommandBaseType = CommandBase<Target>;
     using StateType = decltype(std::declval<const Target>().saveState());
 
-    /// How often snapshots of the target should be saved (at minimum)
+    /// How often snapshots of the target should be saved (at minimum) by default, see
+    /// SnapshotSettings::maxCommandsBetweenSnapshots
     static const int SNAPSHOT_FREQUENCY = 10;
 
+    /// Age of the snapshots, in multiples of the maximum commands between snapshots, after which they get thinned out
+    static const int RECENT_SNAPSHOT_AGE = 4;
+
+    /// How many times the allowed replay of its age a segment of history may get when thinning snapshots to fit into
+    /// the memory budget. Beyond this the oldest commands are dropped instead.
+    static constexpr double MAX_BUDGET_SEGMENT_LOAD = 4.0;
+
     /// Create a command manager that will be operating around a snapshottable target
     explicit CommandManager(Target& target) : mTarget(target) {}
 
@@ -50,19 +161,53 @@ class CommandManager {
         return mVersion;
     }
 
+    const SnapshotSettings& getSnapshotSettings() const {
+        return mSettings;
+    }
+
+    /// Change the snapshot limits, applied from the next executed command
+    void setSnapshotSettings(const SnapshotSettings& settings) {
+        P_ASSERT(settings.maxCommandsBetweenSnapshots > 0);
+        mSettings = settings;
+    }
+
+    /// Statistics of the snapshots for tuning the settings
+    SnapshotStats getSnapshotStats() const;
+
    private:
     Target& mTarget;
     /// Executed and possibly future commands
     std::vector<std::unique_ptr<CommandBaseType>> mCommandHistory;
 
+    /// Run time of each command in mCommandHistory, in milliseconds
+    std::vector<double> mCommandRunMs;
+
     /// Saved states of the target and commandId after them
     struct SnapshotPair {
         StateType state;
         size_t nextCommandIdx;
+
+        /// Size of the state without its shared parts
+        size_t bytes;
+
+        /// Parts of the state referenced in mSharedStateParts
+        std::vector<const void*> sharedParts;
     };
 
     std::vector<SnapshotPair> mTargetSnapshots;
 
+    /// Sum of the sizes of mTargetSnapshots without their shared parts
+    size_t mSnapshotBytes = 0;
+
+    /// Data shared by mTargetSnapshots, each part counted once
+    SharedStateParts mSharedStateParts;
+
+    SnapshotSettings mSettings;
+
+    double mLastCommandMs = 0.0;
+    size_t mThinnedSnapshotCount = 0;
+    size_t mDroppedCommandCount = 0;
+
     /// Position from end of the stack
     size_t mPosFromEnd = 0;
 
@@ -82,6 +227,32 @@ class CommandManager {
 
     size_t getNumOfCommandsSinceSnapshot() const;
 
+    /// Run the command on the target, returns its run time in milliseconds
+    double runCommand(const CommandBaseType& command);
+
+    /// Sum of the run times of commands in [beginIdx, endIdx)
+    double getReplayMs(size_t beginIdx, size_t endIdx) const;
+
+    /// Replay of the history between the snapshots relative to what is allowed at its age, 1 is the allowed maximum
+    double getSegmentLoad(size_t beginIdx, size_t endIdx) const;
+
+    /// Save a snapshot of the target at the current position, then thin out the snapshots
+    void saveSnapshot();
+
+    /// Remove the snapshots whose neighbours are close enough for their age
+    void thinSnapshots();
+
+    /// Remove snapshots and then the oldest commands until the snapshots fit into the memory budget
+    void enforceMemoryBudget();
+
+    /// Size of all snapshots, their shared parts counted once
+    size_t getSnapshotBytes() const {
+        return mSnapshotBytes + mSharedStateParts.getBytes();
+    }
+
+    void eraseSnapshots(typename std::vector<SnapshotPair>::iterator first,
+                        typename std::vector<SnapshotPair>::iterator last);
+
     CommandBaseType& getLastCommand() {
         // allow non const access for command manager
         const auto* constThis = static_cast<const decltype(this)>(this);
@@ -116,14 +287,14 @@ void CommandManager<Target>::execute(std::unique_ptr<CommandBaseType>&& command,
     if(!join || !joinWithLastCommand(*command)) {
         // Save target's state every few commands
         if(shouldSaveState()) {
-            const size_t nextCommandIdx = mCommandHistory.size() - mPosFromEnd;
-            mTargetSnapshots.push_back({mTarget.saveState(), nextCommandIdx});
+            saveSnapshot();
         }
 
-        command->run(mTarget);
+        const double runMs = runCommand(*command);
         mCommandHistory.emplace_back(std::move(command));
+        mCommandRunMs.push_back(runMs);
     } else {
-        command->run(mTarget);
+        mCommandRunMs.back() += runCommand(*command);
     }
 }
 
@@ -141,7 +312,7 @@ void CommandManager<Target>::undo() {
 
     // Execute all commands between last snapshot and desired state
     for(size_t i = prevSnapshotIt->nextCommandIdx; i < mCommandHistory.size() - mPosFromEnd; i++) {
-        mCommandHistory[i]->run(mTarget);
+        mCommandRunMs[i] = runCommand(*mCommandHistory[i]);
     }
 }
 
@@ -157,14 +328,14 @@ void CommandManager<Target>::redo() {
     if(mCommandHistory[nextCommandIdx]->isSlowCommand()) {
         // Try to restore future snapshot to avoid doing a slow command again
         auto nextSnapshotIt = std::next(getPrevSnapshotIterator());
-        if(nextSnapshotIt != mTargetSnapshots.end()) {
+        if(nextSnapshotIt != mTargetSnapshots.end() && nextSnapshotIt->nextCommandIdx == nextCommandIdx + 1) {
             mTarget.loadState(nextSnapshotIt->state);
         } else {
-            mCommandHistory[nextCommandIdx]->run(mTarget);
+            mCommandRunMs[nextCommandIdx] = runCommand(*mCommandHistory[nextCommandIdx]);
         }
 
     } else {
-        mCommandHistory[nextCommandIdx]->run(mTarget);
+        mCommandRunMs[nextCommandIdx] = runCommand(*mCommandHistory[nextCommandIdx]);
     }
 
     mPosFromEnd--;
@@ -202,10 +373,12 @@ template <typename Target>
 void CommandManager<Target>::clearFutureState() {
     if(mPosFromEnd > 0) {
         // Clear all future snapshots
-        mTargetSnapshots.erase(std::next(getPrevSnapshotIterator()), mTargetSnapshots.end());
+        const auto prevSnapshotIdx = std::distance(mTargetSnapshots.cbegin(), getPrevSnapshotIterator());
+        eraseSnapshots(mTargetSnapshots.begin() + prevSnapshotIdx + 1, mTargetSnapshots.end());
 
         // Clear all future commands
         mCommandHistory.erase(std::prev(mCommandHistory.end(), mPosFromEnd), mCommandHistory.end());
+        mCommandRunMs.resize(mCommandHistory.size());
 
         mPosFromEnd = 0;
     }
@@ -218,9 +391,14 @@ bool CommandManager<Target>::shouldSaveState() const {
     }
 
     const size_t commandsSinceSnapshot = getNumOfCommandsSinceSnapshot();
+    if(commandsSinceSnapshot == 0) {
+        return false;
+    }
 
-    return (canUndo() && getLastCommand().isSlowCommand() && commandsSinceSnapshot != 0) ||
-           commandsSinceSnapshot >= SNAPSHOT_FREQUENCY;
+    // Slow commands are not snapshotted by their flag, their measured run time decides
+    const size_t nextCommandIdx = mCommandHistory.size() - mPosFromEnd;
+    return commandsSinceSnapshot >= mSettings.maxCommandsBetweenSnapshots ||
+           getReplayMs(nextCommandIdx - commandsSinceSnapshot, nextCommandIdx) >= mSettings.replayTargetMs;
 }
 
 template <typename Target>
@@ -231,7 +409,7 @@ bool CommandManager<Target>::joinWithLastCommand(CommandBaseType& command) {
     if(getLastCommand().joinCommand(command)) {
         // If the command that got modified has a valid snapshot in front of it destroy it
         if(getNumOfCommandsSinceSnapshot() == 0) {
-            mTargetSnapshots.erase(std::prev(mTargetSnapshots.end()), mTargetSnapshots.end());
+            eraseSnapshots(std::prev(mTargetSnapshots.end()), mTargetSnapshots.end());
         }
         return true;
     } else {
@@ -242,7 +420,148 @@ bool CommandManager<Target>::joinWithLastCommand(CommandBaseType& command) {
 template <typename Target>
 size_t CommandManager<Target>::getNumOfCommandsSinceSnapshot() const {
     const size_t nextCommandIdx = mCommandHistory.size() - mPosFromEnd;
-    return nextCommandIdx - (getPrevSnapshotIterator()->nextCommandIdx - 1);
+    return nextCommandIdx - getPrevSnapshotIterator()->nextCommandIdx;
+}
+
+template <typename Target>
+double CommandManager<Target>::runCommand(const CommandBaseType& command) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    command.run(mTarget);
+    const std::chrono::duration<double, std::milli> timeMs = std::chrono::high_resolution_clock::now() - start;
+
+    mLastCommandMs = timeMs.count();
+    return mLastCommandMs;
+}
+
+template <typename Target>
+double CommandManager<Target>::getReplayMs(const size_t beginIdx, const size_t endIdx) const {
+    P_ASSERT(beginIdx <= endIdx && endIdx <= mCommandRunMs.size());
+    double replayMs = 0.0;
+    for(size_t i = beginIdx; i < endIdx; ++i) {
+        replayMs += mCommandRunMs[i];
+    }
+    return replayMs;
+}
+
+template <typename Target>
+double CommandManager<Target>::getSegmentLoad(const size_t beginIdx, const size_t endIdx) const {
+    // Segments are thinned out by levels of age, each level twice as old and allowed twice the replay
+    const size_t age = mCommandHistory.size() - mPosFromEnd - std::min(endIdx, mCommandHistory.size() - mPosFromEnd);
+    const size_t recentAge = RECENT_SNAPSHOT_AGE * mSettings.maxCommandsBetweenSnapshots;
+    double scale = 1.0;
+    for(size_t levelAge = recentAge; levelAge <= age && scale < 1e9; levelAge *= 2) {
+        scale *= 2.0;
+    }
+
+    const double commandLoad =
+        static_cast<double>(endIdx - beginIdx) / (static_cast<double>(mSettings.maxCommandsBetweenSnapshots) * scale);
+    if(mSettings.replayTargetMs <= 0.0) {
+        return commandLoad;
+    }
+    return std::max(commandLoad, getReplayMs(beginIdx, endIdx) / (mSettings.replayTargetMs * scale));
+}
+
+template <typename Target>
+void CommandManager<Target>::saveSnapshot() {
+    const size_t nextCommandIdx = mCommandHistory.size() - mPosFromEnd;
+    StateType state = mTarget.saveState();
+
+    size_t bytes = sizeof(StateType);
+    if constexpr(detail::HasStateSize<Target, StateType>::value) {
+        bytes = mTarget.getStateSize(state, mSharedStateParts);
+    }
+
+    mTargetSnapshots.push_back({std::move(state), nextCommandIdx, bytes, mSharedStateParts.takeAddedParts()});
+    mSnapshotBytes += bytes;
+
+    thinSnapshots();
+    enforceMemoryBudget();
+}
+
+template <typename Target>
+void CommandManager<Target>::thinSnapshots() {
+    // The first snapshot is the oldest reachable state and the last one the most recent, both are always kept
+    size_t snapshotIdx = 1;
+    while(snapshotIdx + 1 < mTargetSnapshots.size()) {
+        const size_t beginIdx = mTargetSnapshots[snapshotIdx - 1].nextCommandIdx;
+        const size_t endIdx = mTargetSnapshots[snapshotIdx + 1].nextCommandIdx;
+        if(getSegmentLoad(beginIdx, endIdx) <= 1.0) {
+            eraseSnapshots(mTargetSnapshots.begin() + snapshotIdx, mTargetSnapshots.begin() + snapshotIdx + 1);
+            ++mThinnedSnapshotCount;
+        } else {
+            ++snapshotIdx;
+        }
+    }
+}
+
+template <typename Target>
+void CommandManager<Target>::enforceMemoryBudget() {
+    P_ASSERT(mPosFromEnd == 0);
+
+    while(getSnapshotBytes() > mSettings.memoryBudgetBytes && mTargetSnapshots.size() > 1) {
+        // Remove the snapshot whose removal makes the least loaded segment for its age
+        size_t bestSnapshotIdx = 0;
+        double bestLoad = MAX_BUDGET_SEGMENT_LOAD;
+        for(size_t snapshotIdx = 1; snapshotIdx + 1 < mTargetSnapshots.size(); ++snapshotIdx) {
+            const double load = getSegmentLoad(mTargetSnapshots[snapshotIdx - 1].nextCommandIdx,
+                                               mTargetSnapshots[snapshotIdx + 1].nextCommandIdx);
+            if(load <= bestLoad) {
+                bestLoad = load;
+                bestSnapshotIdx = snapshotIdx;
+            }
+        }
+
+        if(bestSnapshotIdx != 0) {
+            eraseSnapshots(mTargetSnapshots.begin() + bestSnapshotIdx, mTargetSnapshots.begin() + bestSnapshotIdx + 1);
+            ++mThinnedSnapshotCount;
+            continue;
+        }
+
+        // Thinning would make undo too slow, forget the commands before the second snapshot instead
+        const size_t droppedCount = mTargetSnapshots[1].nextCommandIdx;
+        eraseSnapshots(mTargetSnapshots.begin(), mTargetSnapshots.begin() + 1);
+        mCommandHistory.erase(mCommandHistory.begin(), mCommandHistory.begin() + droppedCount);
+        mCommandRunMs.erase(mCommandRunMs.begin(), mCommandRunMs.begin() + droppedCount);
+        for(SnapshotPair& snapshot : mTargetSnapshots) {
+            snapshot.nextCommandIdx -= droppedCount;
+        }
+        mDroppedCommandCount += droppedCount;
+    }
+}
+
+template <typename Target>
+void CommandManager<Target>::eraseSnapshots(typename std::vector<SnapshotPair>::iterator first,
+                                            typename std::vector<SnapshotPair>::iterator last) {
+    // Only the parts that no other snapshot holds are freed
+    for(auto it = first; it != last; ++it) {
+        P_ASSERT(mSnapshotBytes >= it->bytes);
+        mSnapshotBytes -= it->bytes;
+        mSharedStateParts.remove(it->sharedParts);
+    }
+    mTargetSnapshots.erase(first, last);
+}
+
+template <typename Target>
+SnapshotStats CommandManager<Target>::getSnapshotStats() const {
+    SnapshotStats stats;
+    stats.commandCount = mCommandHistory.size();
+    stats.snapshotCount = mTargetSnapshots.size();
+    stats.snapshotBytes = getSnapshotBytes();
+    stats.lastCommandMs = mLastCommandMs;
+    stats.thinnedSnapshotCount = mThinnedSnapshotCount;
+    stats.droppedCommandCount = mDroppedCommandCount;
+
+    // The longest replay is from the start of a segment between snapshots to just before its end
+    for(size_t snapshotIdx = 0; snapshotIdx < mTargetSnapshots.size(); ++snapshotIdx) {
+        const size_t beginIdx = mTargetSnapshots[snapshotIdx].nextCommandIdx;
+        const size_t endIdx = snapshotIdx + 1 < mTargetSnapshots.size()
+                                  ? mTargetSnapshots[snapshotIdx + 1].nextCommandIdx
+                                  : mCommandHistory.size();
+        if(endIdx > beginIdx) {
+            stats.maxReplayMs = std::max(stats.maxReplayMs, getReplayMs(beginIdx, endIdx - 1));
+        }
+    }
+    return stats;
 }
 
 }  // namespace pepr3d
@@ -1,6 +1,7 @@
 #include "commands/CommandManager.h"
 #ifdef _TEST_
 #include <gtest/gtest.h>
+#include <memory>
 #include <vector>
 
 namespace pepr3d {
@@ -110,6 +111,80 @@ class CmdAddValueJoinableSlow : public CommandBase<MockTarget> {
     int mAddedValue;
 };
 
+/// Target made of buffers that its states share until a command edits them, like the details of a Geometry
+struct MockSharedTarget {
+    using Buffer = std::shared_ptr<const std::vector<int>>;
+    std::vector<Buffer> mBuffers;
+
+    /// Every buffer ever created, to find the ones kept alive by the snapshots
+    std::vector<std::weak_ptr<const std::vector<int>>> mCreatedBuffers;
+
+    explicit MockSharedTarget(size_t bufferCount) {
+        for(size_t i = 0; i < bufferCount; ++i) {
+            setBuffer(i, {});
+        }
+    }
+
+    std::vector<Buffer> saveState() const {
+        return mBuffers;
+    }
+
+    void loadState(const std::vector<Buffer>& state) {
+        mBuffers = state;
+    }
+
+    size_t getStateSize(const std::vector<Buffer>& state, SharedStateParts& sharedParts) const {
+        for(const Buffer& buffer : state) {
+            sharedParts.add(buffer.get(), [&buffer]() { return buffer->size() * sizeof(int); });
+        }
+        return 0;
+    }
+
+    void setBuffer(size_t bufferIdx, std::vector<int>&& values) {
+        Buffer buffer = std::make_shared<const std::vector<int>>(std::move(values));
+        mCreatedBuffers.push_back(buffer);
+        mBuffers.resize(std::max(mBuffers.size(), bufferIdx + 1));
+        mBuffers[bufferIdx] = std::move(buffer);
+    }
+
+    /// Size of the buffers that are referenced from outside of the target, i.e. owned by the snapshots
+    size_t getSnapshotOwnedBytes() const {
+        size_t bytes = 0;
+        for(const auto& createdBuffer : mCreatedBuffers) {
+            const Buffer buffer = createdBuffer.lock();
+            if(!buffer) {
+                continue;
+            }
+            const long targetUseCount = std::count(mBuffers.begin(), mBuffers.end(), buffer);
+            // Not counting the locked pointer
+            if(buffer.use_count() - 1 > targetUseCount) {
+                bytes += buffer->size() * sizeof(int);
+            }
+        }
+        return bytes;
+    }
+};
+
+class CmdAppendToBuffer : public CommandBase<MockSharedTarget> {
+   public:
+    virtual std::string_view getDescription() const override {
+        return "AppendToBuffer";
+    }
+
+    CmdAppendToBuffer(size_t bufferIdx, int value) : mBufferIdx(bufferIdx), mValue(value) {}
+
+   protected:
+    virtual void run(MockSharedTarget& target) const override {
+        // Copy on write, the saved states keep the old buffer
+        std::vector<int> values = *target.mBuffers[mBufferIdx];
+        values.push_back(mValue);
+        target.setBuffer(mBufferIdx, std::move(values));
+    }
+
+    size_t mBufferIdx;
+    int mValue;
+};
+
 TEST(CommandManager, Undo) {
     /**
      * Test that undo is available and undoes the correct command
@@ -349,5 +424,135 @@ TEST(CommandManager, JoinRemovesSnapshot) {
     EXPECT_EQ(target.mInnerValue, 11);
 }
 
+TEST(CommandManager, ThinsOldSnapshots) {
+    /**
+     * Test that old snapshots are thinned out exponentially while undo still restores every state
+     */
+
+    MockTarget target{};
+    CommandManager<MockTarget> cm(target);
+    SnapshotSettings settings;
+    settings.maxCommandsBetweenSnapshots = 2;
+    settings.replayTargetMs = 1e9;
+    cm.setSnapshotSettings(settings);
+
+    std::vector<int> valueHistory = {target.mInnerValue};
+    const int maxSteps = 1000;
+    for(int i = 0; i < maxSteps; i++) {
+        cm.execute(make_unique<CmdAddValue>(i));
+        valueHistory.push_back(target.mInnerValue);
+    }
+
+    const SnapshotStats stats = cm.getSnapshotStats();
+    EXPECT_EQ(stats.commandCount, maxSteps);
+    EXPECT_GT(stats.thinnedSnapshotCount, 0);
+    // Without thinning there would be a snapshot every two commands
+    EXPECT_LT(stats.snapshotCount, 60);
+    EXPECT_EQ(stats.droppedCommandCount, 0);
+
+    for(int i = 0; i < maxSteps; i++) {
+        ASSERT_TRUE(cm.canUndo());
+        cm.undo();
+        valueHistory.pop_back();
+        EXPECT_EQ(target.mInnerValue, valueHistory.back());
+    }
+    EXPECT_FALSE(cm.canUndo());
+}
+
+TEST(CommandManager, MemoryBudget) {
+    /**
+     * Test that the snapshots stay within the memory budget by dropping the oldest commands, and that the remaining
+     * commands can be undone
+     */
+
+    MockTarget target{};
+    CommandManager<MockTarget> cm(target);
+    SnapshotSettings settings;
+    settings.maxCommandsBetweenSnapshots = 2;
+    settings.memoryBudgetBytes = 6 * sizeof(int);
+    cm.setSnapshotSettings(settings);
+
+    std::vector<int> valueHistory = {target.mInnerValue};
+    const int maxSteps = 500;
+    for(int i = 0; i < maxSteps; i++) {
+        cm.execute(make_unique<CmdAddValue>(i));
+        valueHistory.push_back(target.mInnerValue);
+        EXPECT_LE(cm.getSnapshotStats().snapshotBytes, settings.memoryBudgetBytes);
+    }
+
+    const SnapshotStats stats = cm.getSnapshotStats();
+    EXPECT_GT(stats.droppedCommandCount, 0);
+    EXPECT_EQ(stats.commandCount + stats.droppedCommandCount, maxSteps);
+    EXPECT_LE(stats.snapshotCount, 6);
+
+    for(size_t i = 0; i < stats.commandCount; i++) {
+        ASSERT_TRUE(cm.canUndo());
+        cm.undo();
+        valueHistory.pop_back();
+        EXPECT_EQ(target.mInnerValue, valueHistory.back());
+    }
+    EXPECT_FALSE(cm.canUndo());
+    EXPECT_EQ(target.mInnerValue, valueHistory[stats.droppedCommandCount]);
+}
+
+TEST(CommandManager, SharedSnapshotBytes) {
+    /**
+     * Test that data shared between snapshots is counted once, and fully also after the target edits its copy, so
+     * that the reported size is what the snapshots really own and the memory budget caps it
+     */
+
+    MockSharedTarget target(4);
+    CommandManager<MockSharedTarget> cm(target);
+    SnapshotSettings settings;
+    settings.maxCommandsBetweenSnapshots = 2;
+    settings.memoryBudgetBytes = 400 * sizeof(int);
+    cm.setSnapshotSettings(settings);
+
+    const int maxSteps = 300;
+    for(int i = 0; i < maxSteps; i++) {
+        cm.execute(make_unique<CmdAppendToBuffer>(i % 4, i));
+        const SnapshotStats stats = cm.getSnapshotStats();
+        ASSERT_EQ(stats.snapshotBytes, target.getSnapshotOwnedBytes());
+        EXPECT_LE(stats.snapshotBytes, settings.memoryBudgetBytes);
+    }
+
+    const SnapshotStats stats = cm.getSnapshotStats();
+    EXPECT_GT(stats.droppedCommandCount, 0);
+    for(size_t i = 0; i < stats.commandCount; i++) {
+        ASSERT_TRUE(cm.canUndo());
+        cm.undo();
+    }
+    // Back to the state after the dropped commands, which appended to the buffers in turn
+    for(size_t bufferIdx = 0; bufferIdx < 4; ++bufferIdx) {
+        EXPECT_EQ(target.mBuffers[bufferIdx]->size(), (stats.droppedCommandCount + 3 - bufferIdx) / 4);
+    }
+}
+
+TEST(CommandManager, TimedSnapshotRemovedByJoin) {
+    /**
+     * Test that snapshots are taken once the commands ran for the replay target, and that joining into a command
+     * removes the snapshot after it
+     */
+
+    MockTarget target{};
+    CommandManager<MockTarget> cm(target);
+    SnapshotSettings settings;
+    settings.replayTargetMs = 0.0;
+    cm.setSnapshotSettings(settings);
+
+    cm.execute(make_unique<CmdAddValueJoinable>(1));
+    cm.execute(make_unique<CmdAddValue>(50000));  // Snapshot created before executing this
+    EXPECT_EQ(cm.getSnapshotStats().snapshotCount, 2);
+    cm.undo();
+
+    // Joined into the first command, the snapshot after it is now invalid
+    cm.execute(make_unique<CmdAddValueJoinable>(10), true);
+    EXPECT_EQ(cm.getSnapshotStats().snapshotCount, 1);
+
+    cm.execute(make_unique<CmdAddValue>(50000));
+    cm.undo();
+    EXPECT_EQ(target.mInnerValue, 11);
+}
+
 }  // namespace pepr3d
 #endif
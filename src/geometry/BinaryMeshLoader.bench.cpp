@@ -0,0 +1,120 @@
+#ifdef _BENCH_
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+
+#include "cinder/Filesystem.h"
+#include "geometry/BinaryMeshLoader.h"
+#include "geometry/ModelImporter.h"
+#include "geometry/VertexWelder.h"
+#include "peprbench.h"
+#include "ui/MainApplication.h"
+
+namespace {
+
+/// Writes a closed torus with 2 * rings * segments facets as a binary STL file
+void writeTorusStl(const std::string& path, const size_t rings, const size_t segments) {
+    const auto getVertex = [rings, segments](const size_t ring, const size_t segment) {
+        const float u = 2.f * glm::pi<float>() * static_cast<float>(ring % rings) / static_cast<float>(rings);
+        const float v = 2.f * glm::pi<float>() * static_cast<float>(segment % segments) / static_cast<float>(segments);
+        const float radius = 10.f + 3.f * std::cos(v);
+        return glm::vec3(radius * std::cos(u), radius * std::sin(u), 3.f * std::sin(v));
+    };
+    const auto writeFacet = [](std::ofstream& file, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        const float values[12] = {0.f, 0.f, 0.f, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z};
+        const uint16_t attribute = 0;
+        file.write(reinterpret_cast<const char*>(values), sizeof(values));
+        file.write(reinterpret_cast<const char*>(&attribute), sizeof(attribute));
+    };
+
+    std::ofstream file(path, std::ios::binary);
+    const std::string header(80, ' ');
+    const uint32_t facetCount = static_cast<uint32_t>(2 * rings * segments);
+    file.write(header.c_str(), header.size());
+    file.write(reinterpret_cast<const char*>(&facetCount), sizeof(facetCount));
+    for(size_t ring = 0; ring < rings; ++ring) {
+        for(size_t segment = 0; segment < segments; ++segment) {
+            const glm::vec3 a = getVertex(ring, segment);
+            const glm::vec3 b = getVertex(ring + 1, segment);
+            const glm::vec3 c = getVertex(ring + 1, segment + 1);
+            const glm::vec3 d = getVertex(ring, segment + 1);
+            writeFacet(file, a, b, c);
+            writeFacet(file, a, c, d);
+        }
+    }
+    if(!file) {
+        throw std::runtime_error("Could not write the benchmark model " + path);
+    }
+}
+
+/// Imports the file via Assimp and via BinaryMeshLoader, both with and without joining the vertices, and joins the
+/// vertices of the parsed triangles with and without a tolerance
+void compareImports(const std::string& path, const std::string& name, const size_t repetitions,
+                    pepr3d::bench::BenchmarkReport& report) {
+    ::ThreadPool& threadPool = pepr3d::MainApplication::getThreadPool();
+    const float tolerance = pepr3d::VertexWelder::DEFAULT_TOLERANCE;
+    size_t assimpVertices = 0;
+    size_t nativeVertices = 0;
+    for(size_t i = 0; i < repetitions; ++i) {
+        report.measure("import.assimp." + name, [&]() {
+            pepr3d::ModelImporter importer(path, nullptr, threadPool, tolerance, false);
+            assimpVertices = importer.isModelLoaded() ? importer.takeVertexBuffer().size() : 0;
+        });
+        report.measure("import.native." + name, [&]() {
+            pepr3d::ModelImporter importer(path, nullptr, threadPool, tolerance, true);
+            nativeVertices = importer.isModelLoaded() ? importer.takeVertexBuffer().size() : 0;
+        });
+
+        std::vector<pepr3d::DataTriangle> triangles;
+        const bool isLoaded = report.measure("parse.native." + name, [&]() {
+            return pepr3d::BinaryMeshLoader::load(path, triangles, threadPool);
+        });
+        report.setInfo(name + ".triangles", std::to_string(triangles.size()));
+        report.setInfo(name + ".nativeLoaderUsed", isLoaded ? "true" : "false");
+
+        std::vector<glm::vec3> vertices;
+        std::vector<pepr3d::IndexedTriangles::Indices> indices;
+        for(const float weldTolerance : {0.0f, tolerance}) {
+            std::vector<pepr3d::DataTriangle> weldedTriangles = triangles;
+            const std::string stage = weldTolerance > 0.0f ? "weld.tolerance." : "weld.exact.";
+            report.measure(stage + name, [&]() {
+                pepr3d::VertexWelder::weld(weldedTriangles, weldTolerance, vertices, indices, threadPool);
+            });
+        }
+    }
+
+    // Both imports have to result in the same mesh
+    report.setInfo(name + ".assimpVertices", std::to_string(assimpVertices));
+    report.setInfo(name + ".nativeVertices", std::to_string(nativeVertices));
+}
+
+}  // namespace
+
+PEPR3D_BENCHMARK(ModelImport) {
+    // Assimp takes several seconds on the largest models
+    const size_t repetitions = std::min<size_t>(options.iterations, 3);
+
+    if(!options.modelPath.empty()) {
+        compareImports(options.modelPath, "model", repetitions, report);
+    }
+
+    // Generated tori with 1M and 5M facets
+    for(const auto& size : {std::make_pair(1000, 500), std::make_pair(2500, 1000)}) {
+        const std::string name = std::to_string(2 * size.first * size.second / 1000000) + "M";
+        const cinder::fs::path path = cinder::fs::temp_directory_path() / ("pepr3d_bench_torus_" + name + ".stl");
+        writeTorusStl(path.string(), size.first, size.second);
+        try {
+            compareImports(path.string(), name, repetitions, report);
+        } catch(...) {
+            cinder::fs::remove(path);
+            throw;
+        }
+        cinder::fs::remove(path);
+    }
+}
+
+#endif
@@ -0,0 +1,467 @@
+#include "geometry/BinaryMeshLoader.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cinder/Log.h>
+
+#include "geometry/ModelImporter.h"
+#include "peprassert.h"
+
+namespace pepr3d {
+
+namespace {
+
+/// Number of triangles parsed by a single task of the thread pool
+constexpr size_t TRIANGLES_PER_CHUNK = 16 * 1024;
+
+/// Triangles with a smaller area are removed, the same limit Assimp's FindDegenerates step uses
+constexpr double MIN_TRIANGLE_AREA = 1e-6;
+
+/// Read-only memory mapping of a whole file
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+        mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(mFile == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0) {
+            return;
+        }
+        mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mMapping == nullptr) {
+            return;
+        }
+        const void* view = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+        if(view != nullptr) {
+            mData = static_cast<const unsigned char*>(view);
+            mSize = static_cast<size_t>(fileSize.QuadPart);
+        }
+#else
+        mFile = open(path.c_str(), O_RDONLY);
+        if(mFile < 0) {
+            return;
+        }
+        struct stat fileStat;
+        if(fstat(mFile, &fileStat) != 0 || fileStat.st_size == 0) {
+            return;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+        if(view != MAP_FAILED) {
+            mData = static_cast<const unsigned char*>(view);
+            mSize = static_cast<size_t>(fileStat.st_size);
+            // The chunks are read by several threads at once, let the kernel read ahead the whole file
+            madvise(view, mSize, MADV_WILLNEED);
+        }
+#endif
+    }
+
+    ~MappedFile() {
+#if defined(_WIN32)
+        if(mData != nullptr) {
+            UnmapViewOfFile(mData);
+        }
+        if(mMapping != nullptr) {
+            CloseHandle(mMapping);
+        }
+        if(mFile != INVALID_HANDLE_VALUE) {
+            CloseHandle(mFile);
+        }
+#else
+        if(mData != nullptr) {
+            munmap(const_cast<unsigned char*>(mData), mSize);
+        }
+        if(mFile >= 0) {
+            close(mFile);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const {
+        return mData != nullptr;
+    }
+
+    const unsigned char* getData() const {
+        return mData;
+    }
+
+    size_t getSize() const {
+        return mSize;
+    }
+
+   private:
+#if defined(_WIN32)
+    HANDLE mFile = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = nullptr;
+#else
+    int mFile = -1;
+#endif
+    const unsigned char* mData = nullptr;
+    size_t mSize = 0;
+};
+
+/// Positions of the three vertices of a triangle
+using TrianglePositions = std::array<glm::vec3, 3>;
+
+/// Both formats store little endian values, which are read directly
+bool isLittleEndianHost() {
+    const uint16_t one = 1;
+    unsigned char firstByte;
+    std::memcpy(&firstByte, &one, 1);
+    return firstByte == 1;
+}
+
+template <typename T>
+T readValue(const unsigned char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+glm::vec3 readVec3(const unsigned char* data) {
+    return glm::vec3(readValue<float>(data), readValue<float>(data + 4), readValue<float>(data + 8));
+}
+
+bool isDegenerate(const TrianglePositions& positions) {
+    const double doubleArea = glm::length(glm::cross(positions[1] - positions[0], positions[2] - positions[0]));
+    return ModelImporter::zeroAreaCheck(positions) || 0.5 * doubleArea < MIN_TRIANGLE_AREA;
+}
+
+/// Parses the triangles in parallel chunks. readTriangle(idx, positions) reads the idx-th triangle of the file and
+/// returns false if the file cannot be loaded by this loader.
+template <typename ReadFunc>
+bool parseTriangles(const size_t triangleCount, ReadFunc readTriangle, std::vector<DataTriangle>& triangles,
+                    ::ThreadPool& threadPool, GeometryProgress* progress) {
+    const size_t chunkCount = ::ThreadPool::chunk_count(triangleCount, TRIANGLES_PER_CHUNK);
+
+    // The first pass counts the non-degenerate triangles of each chunk, so that the second pass knows where to
+    // place them and the triangles are allocated only once
+    std::vector<size_t> offsets(chunkCount + 1, 0);
+    std::atomic<bool> isSupported{true};
+    threadPool.parallel_for_chunks(triangleCount, TRIANGLES_PER_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+        TrianglePositions positions;
+        size_t validCount = 0;
+        for(size_t triIdx = begin; triIdx < end; ++triIdx) {
+            if(!readTriangle(triIdx, positions)) {
+                isSupported = false;
+                return;
+            }
+            if(!isDegenerate(positions)) {
+                ++validCount;
+            }
+        }
+        offsets[chunk + 1] = validCount;
+    });
+    if(!isSupported) {
+        return false;
+    }
+
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    if(offsets.back() < triangleCount) {
+        CI_LOG_W("Omitted " + std::to_string(triangleCount - offsets.back()) +
+                 " triangles with zero surface area from geometry data.");
+    }
+
+    triangles.resize(offsets.back());
+    std::atomic<size_t> finishedChunks{0};
+    threadPool.parallel_for_chunks(triangleCount, TRIANGLES_PER_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+        size_t outIdx = offsets[chunk];
+        TrianglePositions positions;
+        for(size_t triIdx = begin; triIdx < end; ++triIdx) {
+            readTriangle(triIdx, positions);
+            if(isDegenerate(positions)) {
+                continue;
+            }
+
+            // Assimp generates the normals from the vertex order as well
+            const glm::vec3 normal = glm::normalize(glm::cross(positions[1] - positions[0], positions[2] - positions[0]));
+            triangles[outIdx++] = DataTriangle(positions[0], positions[1], positions[2], normal);
+        }
+        P_ASSERT(outIdx == offsets[chunk + 1]);
+
+        if(progress != nullptr) {
+            progress->importRenderPercentage =
+                static_cast<float>(++finishedChunks) / static_cast<float>(std::max<size_t>(1, chunkCount));
+        }
+    });
+    return true;
+}
+
+bool hasExtension(const std::string& path, const std::string& extension) {
+    if(path.size() < extension.size()) {
+        return false;
+    }
+    return std::equal(extension.rbegin(), extension.rend(), path.rbegin(), [](const char a, const char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
+bool loadBinaryStl(const MappedFile& file, std::vector<DataTriangle>& triangles, ::ThreadPool& threadPool,
+                   GeometryProgress* progress) {
+    // 80 bytes of header, number of triangles, then 50 bytes per triangle
+    const size_t headerSize = 84;
+    const size_t triangleSize = 50;
+    if(file.getSize() < headerSize) {
+        return false;
+    }
+
+    // ASCII files almost never match the expected size of a binary file
+    const uint64_t triangleCount = readValue<uint32_t>(file.getData() + 80);
+    if(triangleCount == 0 || file.getSize() != headerSize + triangleCount * triangleSize) {
+        return false;
+    }
+
+    // Materialise announces per face colors in the header, leave colored files to Assimp
+    const std::string header(reinterpret_cast<const char*>(file.getData()), 80);
+    if(header.find("COLOR=") != std::string::npos) {
+        return false;
+    }
+
+    const unsigned char* const data = file.getData() + headerSize;
+    const auto readTriangle = [data, triangleSize](const size_t triIdx, TrianglePositions& positions) {
+        const unsigned char* const record = data + triIdx * triangleSize;
+
+        // VisCAM and SolidView store a face color in the attribute bytes, leave colored files to Assimp
+        if((readValue<uint16_t>(record + 48) & (1u << 15)) != 0) {
+            return false;
+        }
+
+        // The stored normal is skipped, Assimp's import removes it as well
+        positions[0] = readVec3(record + 12);
+        positions[1] = readVec3(record + 24);
+        positions[2] = readVec3(record + 36);
+        return true;
+    };
+    return parseTriangles(static_cast<size_t>(triangleCount), readTriangle, triangles, threadPool, progress);
+}
+
+/// Size of a PLY scalar type in bytes, 0 if unknown
+size_t getPlyTypeSize(const std::string& type) {
+    if(type == "char" || type == "int8" || type == "uchar" || type == "uint8") {
+        return 1;
+    } else if(type == "short" || type == "int16" || type == "ushort" || type == "uint16") {
+        return 2;
+    } else if(type == "int" || type == "int32" || type == "uint" || type == "uint32" || type == "float" ||
+              type == "float32") {
+        return 4;
+    } else if(type == "double" || type == "float64") {
+        return 8;
+    }
+    return 0;
+}
+
+bool isPlyIntegerType(const std::string& type) {
+    return getPlyTypeSize(type) > 0 && type.find("float") == std::string::npos && type != "double";
+}
+
+/// Reads an integer of the PLY type, negative values are returned as -1
+int64_t readPlyInteger(const std::string& type, const unsigned char* data) {
+    if(type == "char" || type == "int8") {
+        return std::max<int64_t>(-1, readValue<int8_t>(data));
+    } else if(type == "uchar" || type == "uint8") {
+        return readValue<uint8_t>(data);
+    } else if(type == "short" || type == "int16") {
+        return std::max<int64_t>(-1, readValue<int16_t>(data));
+    } else if(type == "ushort" || type == "uint16") {
+        return readValue<uint16_t>(data);
+    } else if(type == "int" || type == "int32") {
+        return std::max<int64_t>(-1, readValue<int32_t>(data));
+    } else {
+        return readValue<uint32_t>(data);
+    }
+}
+
+struct PlyProperty {
+    std::string name;
+    std::string type;
+    bool isList = false;
+    std::string countType;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+bool loadBinaryPly(const MappedFile& file, std::vector<DataTriangle>& triangles, ::ThreadPool& threadPool,
+                   GeometryProgress* progress) {
+    const char* const text = reinterpret_cast<const char*>(file.getData());
+    const std::string headerStart(text, std::min<size_t>(file.getSize(), 64 * 1024));
+    const size_t headerEnd = headerStart.find("end_header");
+    if(headerStart.compare(0, 3, "ply") != 0 || headerEnd == std::string::npos) {
+        return false;
+    }
+    size_t dataOffset = headerStart.find('\n', headerEnd);
+    if(dataOffset == std::string::npos) {
+        return false;
+    }
+    ++dataOffset;
+
+    std::istringstream header(headerStart.substr(0, headerEnd));
+    std::string line;
+    std::vector<PlyElement> elements;
+    bool isBinaryLittleEndian = false;
+    while(std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if(keyword == "format") {
+            std::string format;
+            words >> format;
+            isBinaryLittleEndian = format == "binary_little_endian";
+        } else if(keyword == "element") {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        } else if(keyword == "property") {
+            if(elements.empty()) {
+                return false;
+            }
+            PlyProperty property;
+            words >> property.type;
+            if(property.type == "list") {
+                property.isList = true;
+                words >> property.countType >> property.type;
+            }
+            words >> property.name;
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    // Only the common layout of a vertex element followed by a face element is supported
+    if(!isBinaryLittleEndian || elements.size() < 2 || elements[0].name != "vertex" || elements[1].name != "face" ||
+       elements[0].count == 0 || elements[1].count == 0) {
+        return false;
+    }
+
+    // Vertices with fixed size, x, y, and z as floats, and no colors
+    size_t vertexSize = 0;
+    std::array<size_t, 3> coordinateOffsets;
+    std::array<bool, 3> hasCoordinate = {false, false, false};
+    for(const PlyProperty& property : elements[0].properties) {
+        const size_t size = getPlyTypeSize(property.type);
+        if(property.isList || size == 0) {
+            return false;
+        }
+        const bool isColor = property.name.find("red") != std::string::npos ||
+                             property.name.find("green") != std::string::npos ||
+                             property.name.find("blue") != std::string::npos || property.name == "r" ||
+                             property.name == "g" || property.name == "b";
+        if(isColor) {
+            return false;
+        }
+        for(int axis = 0; axis < 3; ++axis) {
+            if(property.name == std::string(1, static_cast<char>('x' + axis))) {
+                if(property.type != "float" && property.type != "float32") {
+                    return false;
+                }
+                coordinateOffsets[axis] = vertexSize;
+                hasCoordinate[axis] = true;
+            }
+        }
+        vertexSize += size;
+    }
+    if(!hasCoordinate[0] || !hasCoordinate[1] || !hasCoordinate[2]) {
+        return false;
+    }
+
+    // Faces with just the list of vertex indices
+    const std::vector<PlyProperty>& faceProperties = elements[1].properties;
+    if(faceProperties.size() != 1 || !faceProperties[0].isList ||
+       (faceProperties[0].name != "vertex_indices" && faceProperties[0].name != "vertex_index") ||
+       !isPlyIntegerType(faceProperties[0].countType) || !isPlyIntegerType(faceProperties[0].type)) {
+        return false;
+    }
+    const std::string countType = faceProperties[0].countType;
+    const std::string indexType = faceProperties[0].type;
+    const size_t countSize = getPlyTypeSize(countType);
+    const size_t indexSize = getPlyTypeSize(indexType);
+
+    // Faces have a fixed size only if all of them are triangles, which is checked while they are read
+    const size_t vertexCount = elements[0].count;
+    const size_t faceCount = elements[1].count;
+    const size_t faceSize = countSize + 3 * indexSize;
+    const uint64_t requiredSize = static_cast<uint64_t>(dataOffset) + static_cast<uint64_t>(vertexCount) * vertexSize +
+                                  static_cast<uint64_t>(faceCount) * faceSize;
+    if(requiredSize > file.getSize()) {
+        return false;
+    }
+
+    const unsigned char* const vertices = file.getData() + dataOffset;
+    const unsigned char* const faces = vertices + vertexCount * vertexSize;
+    const auto readTriangle = [&](const size_t triIdx, TrianglePositions& positions) {
+        const unsigned char* const record = faces + triIdx * faceSize;
+        if(readPlyInteger(countType, record) != 3) {
+            return false;
+        }
+
+        for(size_t i = 0; i < 3; ++i) {
+            const int64_t vertexIdx = readPlyInteger(indexType, record + countSize + i * indexSize);
+            if(vertexIdx < 0 || static_cast<uint64_t>(vertexIdx) >= vertexCount) {
+                return false;
+            }
+            const unsigned char* const vertex = vertices + static_cast<size_t>(vertexIdx) * vertexSize;
+            positions[i] = glm::vec3(readValue<float>(vertex + coordinateOffsets[0]),
+                                     readValue<float>(vertex + coordinateOffsets[1]),
+                                     readValue<float>(vertex + coordinateOffsets[2]));
+        }
+        return true;
+    };
+    return parseTriangles(faceCount, readTriangle, triangles, threadPool, progress);
+}
+
+}  // namespace
+
+bool BinaryMeshLoader::load(const std::string& path, std::vector<DataTriangle>& triangles, ::ThreadPool& threadPool,
+                            GeometryProgress* progress) {
+    triangles.clear();
+    if(!isLittleEndianHost()) {
+        return false;
+    }
+
+    const MappedFile file(path);
+    if(!file.isOpen()) {
+        return false;
+    }
+
+    bool isLoaded = false;
+    if(hasExtension(path, ".stl")) {
+        isLoaded = loadBinaryStl(file, triangles, threadPool, progress);
+    } else if(file.getSize() >= 3 && std::memcmp(file.getData(), "ply", 3) == 0) {
+        isLoaded = loadBinaryPly(file, triangles, threadPool, progress);
+    }
+
+    if(!isLoaded) {
+        triangles.clear();
+        triangles.shrink_to_fit();
+    }
+    return isLoaded;
+}
+
+}  // namespace pepr3d
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+#include "geometry/GeometryProgress.h"
+#include "geometry/Triangle.h"
+
+namespace pepr3d {
+
+/// Loads binary STL and binary little endian PLY files without Assimp.
+/// The file is memory mapped and its triangles are parsed in parallel chunks straight into DataTriangles.
+/// Files with colors, non-triangle faces or other features this loader does not handle are left to Assimp.
+class BinaryMeshLoader {
+   public:
+    /// Loads all non-degenerate triangles of the file into `triangles`, with their normals computed from the vertex
+    /// order and the default color.
+    /// Returns false if the file is not in a supported format or is malformed, `triangles` are left empty then.
+    static bool load(const std::string& path, std::vector<DataTriangle>& triangles, ::ThreadPool& threadPool,
+                     GeometryProgress* progress = nullptr);
+};
+
+}  // namespace pepr3d
@@ -0,0 +1,162 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cinder/Filesystem.h"
+#include "geometry/BinaryMeshLoader.h"
+
+namespace {
+
+using pepr3d::BinaryMeshLoader;
+using pepr3d::DataTriangle;
+
+/// Path of a temporary file removed at the end of the test
+class TemporaryFile {
+    cinder::fs::path mPath;
+
+   public:
+    explicit TemporaryFile(const std::string& name) : mPath(cinder::fs::temp_directory_path() / name) {}
+
+    ~TemporaryFile() {
+        cinder::fs::remove(mPath);
+    }
+
+    std::string getPath() const {
+        return mPath.string();
+    }
+};
+
+template <typename T>
+void writeValue(std::ofstream& file, const T value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// Triangles of a strip along the x axis, the triangle at degenerateIdx has two equal vertices
+std::vector<std::array<glm::vec3, 3>> getStrip(const size_t count, const size_t degenerateIdx) {
+    std::vector<std::array<glm::vec3, 3>> strip;
+    for(size_t i = 0; i < count; ++i) {
+        const float x = static_cast<float>(i);
+        strip.push_back({glm::vec3(x, 0.f, 0.f), glm::vec3(x + 1.f, 0.f, 0.f), glm::vec3(x, 1.f, 0.f)});
+        if(i == degenerateIdx) {
+            strip.back()[2] = strip.back()[1];
+        }
+    }
+    return strip;
+}
+
+void writeBinaryStl(const std::string& path, const std::vector<std::array<glm::vec3, 3>>& triangles,
+                    const uint16_t attribute = 0) {
+    std::ofstream file(path, std::ios::binary);
+    const std::string header = "solid but still binary";
+    file.write(header.c_str(), header.size());
+    file.write(std::string(80 - header.size(), ' ').c_str(), 80 - header.size());
+    writeValue(file, static_cast<uint32_t>(triangles.size()));
+    for(const auto& triangle : triangles) {
+        // The normal is stored pointing away on purpose, the loader computes it from the vertex order
+        writeValue(file, 0.f);
+        writeValue(file, 0.f);
+        writeValue(file, -1.f);
+        for(const glm::vec3& vertex : triangle) {
+            writeValue(file, vertex.x);
+            writeValue(file, vertex.y);
+            writeValue(file, vertex.z);
+        }
+        writeValue(file, attribute);
+    }
+}
+
+void checkStrip(const std::vector<DataTriangle>& loaded, const std::vector<std::array<glm::vec3, 3>>& strip,
+                const size_t degenerateIdx) {
+    ASSERT_EQ(loaded.size(), strip.size() - 1);
+    for(size_t i = 0, loadedIdx = 0; i < strip.size(); ++i) {
+        if(i == degenerateIdx) {
+            continue;
+        }
+        for(size_t j = 0; j < 3; ++j) {
+            EXPECT_EQ(loaded[loadedIdx].getVertex(j), strip[i][j]);
+        }
+        EXPECT_EQ(loaded[loadedIdx].getNormal(), glm::vec3(0.f, 0.f, 1.f));
+        EXPECT_EQ(loaded[loadedIdx].getColor(), 0u);
+        ++loadedIdx;
+    }
+}
+
+}  // namespace
+
+TEST(BinaryMeshLoader, binaryStl) {
+    /**
+     * Test that binary STL files spanning several chunks are loaded in order, without degenerate triangles, and that
+     * colored and ASCII files are left to Assimp
+     */
+    ::ThreadPool threadPool(2);
+    const TemporaryFile file("pepr3d_test_binary.stl");
+    const auto strip = getStrip(40000, 17000);
+    std::vector<DataTriangle> loaded;
+
+    writeBinaryStl(file.getPath(), strip);
+    ASSERT_TRUE(BinaryMeshLoader::load(file.getPath(), loaded, threadPool));
+    checkStrip(loaded, strip, 17000);
+
+    writeBinaryStl(file.getPath(), strip, 1u << 15);
+    EXPECT_FALSE(BinaryMeshLoader::load(file.getPath(), loaded, threadPool));
+    EXPECT_TRUE(loaded.empty());
+
+    {
+        std::ofstream ascii(file.getPath());
+        ascii << "solid ascii\nfacet normal 0 0 1\nouter loop\nvertex 0 0 0\nvertex 1 0 0\nvertex 0 1 0\nendloop\n"
+                 "endfacet\nendsolid ascii\n";
+    }
+    EXPECT_FALSE(BinaryMeshLoader::load(file.getPath(), loaded, threadPool));
+}
+
+TEST(BinaryMeshLoader, binaryPly) {
+    /**
+     * Test that binary PLY files with triangles are loaded, and that files with other faces are left to Assimp
+     */
+    ::ThreadPool threadPool(2);
+    const TemporaryFile file("pepr3d_test_binary.ply");
+    const auto strip = getStrip(100, 42);
+    std::vector<DataTriangle> loaded;
+
+    for(const uint8_t vertexCount : {3, 4}) {
+        {
+            std::ofstream ply(file.getPath(), std::ios::binary);
+            ply << "ply\nformat binary_little_endian 1.0\ncomment pepr3d test\nelement vertex "
+                << 3 * strip.size() + 1
+                << "\nproperty float x\nproperty float y\nproperty float z\nproperty uchar flags\nelement face "
+                << strip.size() << "\nproperty list uchar uint vertex_indices\nend_header\n";
+            for(const auto& triangle : strip) {
+                for(const glm::vec3& vertex : triangle) {
+                    writeValue(ply, vertex.x);
+                    writeValue(ply, vertex.y);
+                    writeValue(ply, vertex.z);
+                    writeValue(ply, uint8_t(0));
+                }
+            }
+            writeValue(ply, 0.f);
+            writeValue(ply, 0.f);
+            writeValue(ply, 0.f);
+            writeValue(ply, uint8_t(0));
+
+            for(uint32_t i = 0; i < strip.size(); ++i) {
+                writeValue(ply, vertexCount);
+                for(uint32_t j = 0; j < vertexCount; ++j) {
+                    writeValue(ply, j < 3 ? 3 * i + j : static_cast<uint32_t>(3 * strip.size()));
+                }
+            }
+        }
+
+        if(vertexCount == 3) {
+            ASSERT_TRUE(BinaryMeshLoader::load(file.getPath(), loaded, threadPool));
+            checkStrip(loaded, strip, 42);
+        } else {
+            EXPECT_FALSE(BinaryMeshLoader::load(file.getPath(), loaded, threadPool));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "geometry/BucketSpread.h"
+#include "peprassert.h"
+
+namespace pepr3d {
+
+/// Stopping criteria of a bucket spread that depend only on the two neighbouring triangles. The spread passes each
+/// edge in both directions alike, so it reaches the whole connected component of its start.
+struct BucketCriterion {
+    /// Stop on an edge between different colors
+    bool stopOnColor = false;
+
+    /// Stop on an edge whose neighbouring normals make a larger angle than allowed by minNormalCos
+    bool stopOnNormal = false;
+
+    /// Cosine of the largest angle between the normals of neighbours the spread passes through
+    double minNormalCos = -1.0;
+
+    bool operator==(const BucketCriterion& other) const {
+        return stopOnColor == other.stopOnColor && stopOnNormal == other.stopOnNormal &&
+               (!stopOnNormal || minNormalCos == other.minNormalCos);
+    }
+
+    bool operator!=(const BucketCriterion& other) const {
+        return !(*this == other);
+    }
+};
+
+/// Connected components of a graph of triangles under a BucketCriterion, labelled by union-find over all edges.
+/// A bucket spread from a triangle reaches exactly its component, so repeated spreads become a lookup.
+/// Changes of the graph or of the criterion inputs mark only the touched components as out of date. An out of date
+/// triangle is spread from again when it is looked up, the rest of its old component waits for its own lookup.
+class BucketComponents {
+    /// Label of a triangle that belongs to no component yet
+    static constexpr uint32_t NO_COMPONENT = std::numeric_limits<uint32_t>::max();
+
+    /// Component of each triangle
+    std::vector<uint32_t> mLabels;
+
+    /// Triangles of each component, empty if the component is out of date
+    std::vector<std::vector<size_t>> mComponents;
+
+   public:
+    /// No components, build() has to be called before lookups
+    bool empty() const {
+        return mLabels.empty();
+    }
+
+    void clear() {
+        mLabels.clear();
+        mComponents.clear();
+    }
+
+    /// Label all triangles, replacing the previous components.
+    /// @param canPass (triangle, neighbourIdx) -> true if a spread passes from the triangle to its neighbour
+    ///                at adjacency[triangle][neighbourIdx]. Has to be symmetric, each edge is tested in one direction.
+    template <typename PassFunc>
+    void build(const BucketSpread::Adjacency& adjacency, const PassFunc& canPass);
+
+    /// Triangles of the component of the triangle, nullptr if the component is out of date
+    const std::vector<size_t>* findComponent(const size_t triangle) const {
+        P_ASSERT(triangle < mLabels.size());
+        const uint32_t label = mLabels[triangle];
+        if(label == NO_COMPONENT || mComponents[label].empty()) {
+            return nullptr;
+        }
+        return &mComponents[label];
+    }
+
+    /// Store a component found by spreading from an out of date triangle
+    void setComponent(std::vector<size_t> triangles) {
+        P_ASSERT(!triangles.empty());
+
+        // Out of date components keep their labels, start over once there are too many of them
+        if(mComponents.size() >= std::numeric_limits<uint32_t>::max() - 1 ||
+           mComponents.size() > 2 * mLabels.size() + 64) {
+            mComponents.clear();
+            std::fill(mLabels.begin(), mLabels.end(), NO_COMPONENT);
+        }
+
+        const uint32_t label = static_cast<uint32_t>(mComponents.size());
+        for(const size_t triangle : triangles) {
+            P_ASSERT(triangle < mLabels.size());
+            mLabels[triangle] = label;
+        }
+        mComponents.push_back(std::move(triangles));
+    }
+
+    /// Mark the components of the triangles and of their neighbours out of date. Used when the triangles changed
+    /// either their edges or the data the criterion compares. Triangles added to the adjacency get no component.
+    void invalidate(const std::vector<size_t>& triangles, const BucketSpread::Adjacency& adjacency) {
+        if(empty()) {
+            return;
+        }
+        if(adjacency.size() < mLabels.size()) {
+            // Triangles were dropped from the end, their components cannot be trusted anymore
+            clear();
+            return;
+        }
+        mLabels.resize(adjacency.size(), NO_COMPONENT);
+
+        const auto invalidateLabel = [this](const size_t triangle) {
+            const uint32_t label = mLabels[triangle];
+            if(label != NO_COMPONENT) {
+                std::vector<size_t>().swap(mComponents[label]);
+            }
+        };
+        for(const size_t triangle : triangles) {
+            P_ASSERT(triangle < adjacency.size());
+            invalidateLabel(triangle);
+            for(const int neighbour : adjacency[triangle]) {
+                if(neighbour >= 0) {
+                    invalidateLabel(static_cast<size_t>(neighbour));
+                }
+            }
+        }
+    }
+
+    /// Number of components including the out of date ones
+    size_t getComponentCount() const {
+        return mComponents.size();
+    }
+};
+
+template <typename PassFunc>
+void BucketComponents::build(const BucketSpread::Adjacency& adjacency, const PassFunc& canPass) {
+    P_ASSERT(adjacency.size() < NO_COMPONENT);
+    const uint32_t triangleCount = static_cast<uint32_t>(adjacency.size());
+
+    // Union-find with path halving and union by size
+    std::vector<uint32_t> parents(triangleCount);
+    std::iota(parents.begin(), parents.end(), 0);
+    std::vector<uint32_t> sizes(triangleCount, 1);
+    const auto findRoot = [&parents](uint32_t triangle) {
+        while(parents[triangle] != triangle) {
+            parents[triangle] = parents[parents[triangle]];
+            triangle = parents[triangle];
+        }
+        return triangle;
+    };
+
+    for(uint32_t triangle = 0; triangle < triangleCount; ++triangle) {
+        for(int neighbourIdx = 0; neighbourIdx < 3; ++neighbourIdx) {
+            const int neighbour = adjacency[triangle][neighbourIdx];
+            // Each edge is tested from its lower triangle only
+            if(neighbour <= static_cast<int>(triangle) || !canPass(static_cast<size_t>(triangle), neighbourIdx)) {
+                continue;
+            }
+
+            uint32_t rootA = findRoot(triangle);
+            uint32_t rootB = findRoot(static_cast<uint32_t>(neighbour));
+            if(rootA == rootB) {
+                continue;
+            }
+            if(sizes[rootA] < sizes[rootB]) {
+                std::swap(rootA, rootB);
+            }
+            parents[rootB] = rootA;
+            sizes[rootA] += sizes[rootB];
+        }
+    }
+
+    // Number the roots in the order of their lowest triangle, each component is then sorted
+    mLabels.assign(triangleCount, NO_COMPONENT);
+    mComponents.clear();
+    for(uint32_t triangle = 0; triangle < triangleCount; ++triangle) {
+        const uint32_t root = findRoot(triangle);
+        if(mLabels[root] == NO_COMPONENT) {
+            mLabels[root] = static_cast<uint32_t>(mComponents.size());
+            mComponents.emplace_back();
+            mComponents.back().reserve(sizes[root]);
+        }
+        const uint32_t label = mLabels[root];
+        mLabels[triangle] = label;
+        mComponents[label].push_back(triangle);
+    }
+}
+
+}  // namespace pepr3d
@@ -0,0 +1,119 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "geometry/BucketComponents.h"
+
+namespace {
+
+using pepr3d::BucketComponents;
+using pepr3d::BucketSpread;
+
+/// Adjacency of a regular grid of width x height quads, each split into two triangles
+BucketSpread::Adjacency getGridAdjacency(const int width, const int height) {
+    BucketSpread::Adjacency adjacency(2 * width * height, {-1, -1, -1});
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x) {
+            const int lower = 2 * (y * width + x);
+            const int upper = lower + 1;
+            adjacency[lower] = {upper, y > 0 ? 2 * ((y - 1) * width + x) + 1 : -1,
+                                x > 0 ? 2 * (y * width + x - 1) + 1 : -1};
+            adjacency[upper] = {lower, y + 1 < height ? 2 * ((y + 1) * width + x) : -1,
+                                x + 1 < width ? 2 * (y * width + x + 1) : -1};
+        }
+    }
+    return adjacency;
+}
+
+/// Sorted triangles reached by the bucket spread that stops on a different color
+std::vector<size_t> spreadColor(const BucketSpread::Adjacency& adjacency, const std::vector<size_t>& colors,
+                                const size_t startTriangle, ::ThreadPool& threadPool) {
+    BucketSpread::Marks marks;
+    const auto colorStopping = [&colors](const size_t a, const size_t b) { return colors[a] == colors[b]; };
+    std::vector<size_t> reached = BucketSpread::spread(adjacency, marks, {startTriangle}, colorStopping, threadPool);
+    std::sort(reached.begin(), reached.end());
+    return reached;
+}
+
+/// Label the components that stop on a different color
+void buildColorComponents(BucketComponents& components, const BucketSpread::Adjacency& adjacency,
+                          const std::vector<size_t>& colors) {
+    components.build(adjacency, [&adjacency, &colors](const size_t triangle, const int neighbourIdx) {
+        return colors[triangle] == colors[adjacency[triangle][neighbourIdx]];
+    });
+}
+
+}  // namespace
+
+TEST(BucketComponents, matchesSpread) {
+    /**
+     * Test that the component of each triangle holds the same triangles as the spread from it
+     */
+    ::ThreadPool threadPool(2);
+    const BucketSpread::Adjacency adjacency = getGridAdjacency(30, 20);
+    std::mt19937 generator(5);
+    std::bernoulli_distribution isObstacle(0.3);
+    std::vector<size_t> colors(adjacency.size());
+    for(size_t& color : colors) {
+        color = isObstacle(generator) ? 1 : 0;
+    }
+
+    BucketComponents components;
+    EXPECT_TRUE(components.empty());
+    buildColorComponents(components, adjacency, colors);
+    EXPECT_FALSE(components.empty());
+
+    size_t componentTriangles = 0;
+    for(size_t triangle = 0; triangle < adjacency.size(); ++triangle) {
+        const std::vector<size_t>* component = components.findComponent(triangle);
+        ASSERT_NE(component, nullptr);
+        EXPECT_EQ(*component, spreadColor(adjacency, colors, triangle, threadPool));
+        componentTriangles += component->front() == triangle ? component->size() : 0;
+    }
+
+    // Each triangle is in exactly one component
+    EXPECT_EQ(componentTriangles, adjacency.size());
+}
+
+TEST(BucketComponents, invalidateChanged) {
+    /**
+     * Test that after a color change the components away from it stay valid, the touched ones are respread and all
+     * of them match the spread over the new colors
+     */
+    ::ThreadPool threadPool(2);
+    const BucketSpread::Adjacency adjacency = getGridAdjacency(20, 20);
+
+    // Left and right half of the grid in two colors
+    std::vector<size_t> colors(adjacency.size());
+    for(size_t triangle = 0; triangle < adjacency.size(); ++triangle) {
+        colors[triangle] = (triangle / 2) % 20 < 10 ? 0 : 1;
+    }
+    BucketComponents components;
+    buildColorComponents(components, adjacency, colors);
+    EXPECT_EQ(components.getComponentCount(), 2);
+
+    // Paint a small island into the left half
+    const std::vector<size_t> island = {2 * (5 * 20 + 3), 2 * (5 * 20 + 3) + 1};
+    for(const size_t triangle : island) {
+        colors[triangle] = 2;
+    }
+    components.invalidate(island, adjacency);
+
+    const size_t rightTriangle = 2 * (10 * 20 + 15);
+    ASSERT_NE(components.findComponent(rightTriangle), nullptr);
+    EXPECT_EQ(*components.findComponent(rightTriangle), spreadColor(adjacency, colors, rightTriangle, threadPool));
+    EXPECT_EQ(components.findComponent(0), nullptr);
+    EXPECT_EQ(components.findComponent(island[0]), nullptr);
+
+    for(size_t triangle = 0; triangle < adjacency.size(); ++triangle) {
+        if(components.findComponent(triangle) == nullptr) {
+            components.setComponent(spreadColor(adjacency, colors, triangle, threadPool));
+        }
+        ASSERT_NE(components.findComponent(triangle), nullptr);
+        EXPECT_EQ(*components.findComponent(triangle), spreadColor(adjacency, colors, triangle, threadPool));
+    }
+    EXPECT_EQ(components.findComponent(island[0])->size(), 2);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifdef _BENCH_
+
+#include <random>
+
+#include "geometry/BucketComponents.h"
+#include "geometry/BucketSpread.h"
+#include "peprbench.h"
+#include "ui/MainApplication.h"
+
+namespace {
+
+using pepr3d::BucketSpread;
+
+/// Size of the synthetic grid, 2 * 710 * 710 is a little over 1M triangles
+constexpr int GRID_SIZE = 710;
+
+/// Number of starting triangles of the multi-seed spread
+constexpr size_t SEED_COUNT = 256;
+
+/// Adjacency of a regular grid of size x size quads, each split into two triangles
+BucketSpread::Adjacency getGridAdjacency(const int size) {
+    BucketSpread::Adjacency adjacency(2 * size * size, {-1, -1, -1});
+    for(int y = 0; y < size; ++y) {
+        for(int x = 0; x < size; ++x) {
+            const int lower = 2 * (y * size + x);
+            const int upper = lower + 1;
+            adjacency[lower] = {upper, y > 0 ? 2 * ((y - 1) * size + x) + 1 : -1,
+                                x > 0 ? 2 * (y * size + x - 1) + 1 : -1};
+            adjacency[upper] = {lower, y + 1 < size ? 2 * ((y + 1) * size + x) : -1,
+                                x + 1 < size ? 2 * (y * size + x + 1) : -1};
+        }
+    }
+    return adjacency;
+}
+
+}  // namespace
+
+PEPR3D_BENCHMARK(BucketSpread) {
+    const BucketSpread::Adjacency adjacency = getGridAdjacency(GRID_SIZE);
+    report.setInfo("triangles", std::to_string(adjacency.size()));
+
+    // Two colors in large patches, so that the color stopping floods most, but not all of the grid
+    std::mt19937 generator(options.seed);
+    std::bernoulli_distribution isObstacle(0.1);
+    std::vector<size_t> colors(adjacency.size(), 0);
+    for(size_t& color : colors) {
+        color = isObstacle(generator) ? 1 : 0;
+    }
+
+    const auto doNotStop = [](size_t, size_t) { return true; };
+    const auto colorStopping = [&colors](const size_t a, const size_t b) { return colors[a] == colors[b]; };
+
+    ::ThreadPool& threadPool = pepr3d::MainApplication::getThreadPool();
+    std::uniform_int_distribution<size_t> triangleDistribution(0, adjacency.size() - 1);
+    BucketSpread::Marks marks;
+
+    // Components under the color stopping, a repeated fill is then a lookup
+    pepr3d::BucketComponents colorComponents;
+    report.measure("components.build", [&]() {
+        colorComponents.build(adjacency, [&adjacency, &colors](const size_t triangle, const int neighbourIdx) {
+            return colors[triangle] == colors[adjacency[triangle][neighbourIdx]];
+        });
+    });
+    report.setInfo("colorComponents", std::to_string(colorComponents.getComponentCount()));
+
+    for(size_t i = 0; i < options.iterations; ++i) {
+        size_t startTriangle = triangleDistribution(generator);
+        while(colors[startTriangle] != 0) {
+            startTriangle = triangleDistribution(generator);
+        }
+
+        const auto serialWhole = report.measure("whole.serial", [&]() {
+            return BucketSpread::spread(adjacency, marks, {startTriangle}, doNotStop, threadPool,
+                                        std::numeric_limits<size_t>::max());
+        });
+        const auto parallelWhole = report.measure("whole.parallel", [&]() {
+            return BucketSpread::spread(adjacency, marks, {startTriangle}, doNotStop, threadPool);
+        });
+
+        const auto serialColor = report.measure("color.serial", [&]() {
+            return BucketSpread::spread(adjacency, marks, {startTriangle}, colorStopping, threadPool,
+                                        std::numeric_limits<size_t>::max());
+        });
+        const auto parallelColor = report.measure("color.parallel", [&]() {
+            return BucketSpread::spread(adjacency, marks, {startTriangle}, colorStopping, threadPool);
+        });
+        const size_t componentSize = report.measure(
+            "color.component", [&]() { return colorComponents.findComponent(startTriangle)->size(); });
+
+        // Many starting triangles, the same as semi-automatic segmentation, make the frontier wide from the start
+        std::vector<size_t> seeds(SEED_COUNT);
+        for(size_t& seed : seeds) {
+            seed = triangleDistribution(generator);
+        }
+        const auto serialSeeds = report.measure("seeds.serial", [&]() {
+            return BucketSpread::spread(adjacency, marks, seeds, doNotStop, threadPool,
+                                        std::numeric_limits<size_t>::max());
+        });
+        const auto parallelSeeds = report.measure("seeds.parallel", [&]() {
+            return BucketSpread::spread(adjacency, marks, seeds, doNotStop, threadPool);
+        });
+
+        if(serialWhole != parallelWhole || serialColor != parallelColor || serialSeeds != parallelSeeds) {
+            throw std::logic_error("Parallel bucket spread differs from the serial one.");
+        }
+        if(componentSize != serialColor.size()) {
+            throw std::logic_error("Bucket component differs from the bucket spread.");
+        }
+        report.setInfo("colorFilledTriangles", std::to_string(serialColor.size()));
+    }
+}
+
+#endif
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "peprassert.h"
+
+namespace pepr3d {
+
+/// Breadth-first spread over a graph of triangles with up to three neighbours each, used by bucket painting.
+/// Levels of the BFS with a large frontier are expanded in parallel on the thread pool. The result is the same as
+/// that of the serial BFS, including the order of the reached triangles.
+class BucketSpread {
+   private:
+    // Prevent this util class from being constructed
+    BucketSpread() {}
+
+    /// Key of a triangle that was not reached yet
+    static constexpr uint64_t NOT_REACHED = std::numeric_limits<uint64_t>::max();
+
+    /// Smallest number of triangles of the frontier processed by one task
+    static constexpr size_t MIN_CHUNK_SIZE = 512;
+
+   public:
+    /// IDs of the neighbours of each triangle across its three edges, -1 if there is no neighbour
+    using Adjacency = std::vector<std::array<int, 3>>;
+
+    /// Size of a BFS level from which the rest of the BFS runs in parallel
+    static constexpr size_t PARALLEL_FRONTIER_THRESHOLD = 2 * 1024;
+
+    /// Marks of the triangles used by the spreads over one adjacency, all cleared before and after each spread.
+    /// Kept by the caller, so that the spreads do not allocate and clear a mark for each triangle every time.
+    class Marks {
+       public:
+        /// True if no triangle is marked, as between the spreads
+        bool isCleared() const {
+            for(size_t triangle = 0; triangle < mReachedBySize; ++triangle) {
+                if(mReachedBy[triangle].load(std::memory_order_relaxed) != NOT_REACHED) {
+                    return false;
+                }
+            }
+            return std::none_of(mVisited.begin(), mVisited.end(), [](bool flag) { return flag; });
+        }
+
+       private:
+        friend class BucketSpread;
+
+        /// Visited flag of each triangle in the serial levels
+        std::vector<bool> mVisited;
+
+        /// Lowest key of an edge that reached each triangle in the parallel levels, NOT_REACHED when cleared
+        std::unique_ptr<std::atomic<uint64_t>[]> mReachedBy;
+        size_t mReachedBySize = 0;
+    };
+
+    /// Spread from the starting triangles to wherever the stopping condition allows.
+    /// @param marks Marks of the triangles, kept by the caller between the spreads over the same adjacency.
+    /// @param stopFunctor (neighbour, current) -> true if the BFS can continue from current to neighbour.
+    ///                    Called concurrently from several threads in the parallel levels.
+    /// @return Reached triangles in the order of visiting, each starting triangle only once
+    template <typename StoppingCondition>
+    static std::vector<size_t> spread(const Adjacency& adjacency, Marks& marks,
+                                      const std::vector<size_t>& startTriangles, const StoppingCondition& stopFunctor,
+                                      ::ThreadPool& threadPool,
+                                      size_t parallelThreshold = PARALLEL_FRONTIER_THRESHOLD);
+
+   private:
+    /// Continue the BFS from the level starting at levelBegin using the thread pool.
+    /// The edges of one level compete for their neighbour with an atomic minimum of the edge keys,
+    /// the edge with the lowest key is the one the serial BFS would reach the neighbour through.
+    template <typename StoppingCondition>
+    static void spreadParallel(const Adjacency& adjacency, Marks& marks, std::vector<size_t>& visitQueue,
+                               size_t levelBegin,
+                               const StoppingCondition& stopFunctor, ::ThreadPool& threadPool,
+                               size_t parallelThreshold);
+
+    /// Expand the levels of spreadParallel until the queue stops growing, reachedBy holds the key of each triangle
+    template <typename StoppingCondition>
+    static void spreadParallelLevels(const Adjacency& adjacency, std::atomic<uint64_t>* reachedBy,
+                                     std::vector<size_t>& visitQueue, size_t levelBegin,
+                                     const StoppingCondition& stopFunctor, ::ThreadPool& threadPool,
+                                     size_t parallelThreshold);
+
+    /// Key of the edge from the triangle at queuePosition to its neighbour. Keys grow with the position in the queue,
+    /// the key 0 is reserved for triangles that were in the queue before the parallel levels.
+    static uint64_t getEdgeKey(const size_t queuePosition, const int neighbourIdx) {
+        return (static_cast<uint64_t>(queuePosition) + 1) * 3 + static_cast<uint64_t>(neighbourIdx);
+    }
+
+    /// Size of the chunks count triangles are split into, at least minChunkSize and a few chunks per thread of the pool
+    static size_t getChunkSize(const size_t count, const size_t minChunkSize, const ::ThreadPool& threadPool) {
+        const size_t maxChunks = 4 * (threadPool.size() + 1);
+        return std::max<size_t>({minChunkSize, (count + maxChunks - 1) / maxChunks, 1});
+    }
+};
+
+template <typename StoppingCondition>
+std::vector<size_t> BucketSpread::spread(const Adjacency& adjacency, Marks& marks,
+                                         const std::vector<size_t>& startTriangles,
+                                         const StoppingCondition& stopFunctor, ::ThreadPool& threadPool,
+                                         size_t parallelThreshold) {
+    std::vector<bool>& visited = marks.mVisited;
+    if(visited.size() != adjacency.size()) {
+        visited.assign(adjacency.size(), false);
+    }
+
+    // Each triangle gets into the queue only once and in the order of visiting, so the queue is also the result
+    std::vector<size_t> visitQueue;
+    visitQueue.reserve(startTriangles.size());
+    for(const size_t startTriangle : startTriangles) {
+        P_ASSERT(startTriangle < adjacency.size());
+        if(!visited[startTriangle]) {
+            visited[startTriangle] = true;
+            visitQueue.push_back(startTriangle);
+        }
+    }
+
+    // Only the flags of the queued triangles are reset, which keeps small spreads independent of the mesh size
+    const auto resetVisited = [&visited, &visitQueue]() {
+        for(const size_t triangle : visitQueue) {
+            visited[triangle] = false;
+        }
+    };
+
+    try {
+        size_t levelBegin = 0;
+        while(levelBegin < visitQueue.size()) {
+            const size_t levelEnd = visitQueue.size();
+            if(levelEnd - levelBegin >= parallelThreshold) {
+                spreadParallel(adjacency, marks, visitQueue, levelBegin, stopFunctor, threadPool, parallelThreshold);
+                break;
+            }
+
+            for(size_t queueHead = levelBegin; queueHead < levelEnd; ++queueHead) {
+                const size_t currentTriangle = visitQueue[queueHead];
+                P_ASSERT(visited[currentTriangle]);
+
+                for(const int neighbour : adjacency[currentTriangle]) {
+                    if(neighbour < 0 || visited[neighbour]) {
+                        continue;
+                    }
+
+                    // New triangle -> visit it.
+                    if(stopFunctor(static_cast<size_t>(neighbour), currentTriangle)) {
+                        visited[neighbour] = true;
+                        visitQueue.push_back(static_cast<size_t>(neighbour));
+                    }
+                }
+            }
+            levelBegin = levelEnd;
+        }
+    } catch(...) {
+        resetVisited();
+        throw;
+    }
+
+    resetVisited();
+    return visitQueue;
+}
+
+template <typename StoppingCondition>
+void BucketSpread::spreadParallel(const Adjacency& adjacency, Marks& marks, std::vector<size_t>& visitQueue,
+                                  size_t levelBegin, const StoppingCondition& stopFunctor, ::ThreadPool& threadPool,
+                                  size_t parallelThreshold) {
+    // Lowest key of an edge that reached each triangle. Keys lower than the first key of the current level
+    // belong to the triangles of the previous levels, which are already visited.
+    // The keys are allocated and cleared once for the adjacency, each spread clears only the keys it set.
+    if(marks.mReachedBySize != adjacency.size()) {
+        marks.mReachedBy.reset(new std::atomic<uint64_t>[adjacency.size()]);
+        marks.mReachedBySize = adjacency.size();
+        std::atomic<uint64_t>* keys = marks.mReachedBy.get();
+        threadPool.parallel_for_chunks(adjacency.size(), 64 * MIN_CHUNK_SIZE, [keys](size_t, size_t begin, size_t end) {
+            for(size_t triangle = begin; triangle < end; ++triangle) {
+                keys[triangle].store(NOT_REACHED, std::memory_order_relaxed);
+            }
+        });
+    }
+    std::atomic<uint64_t>* reachedBy = marks.mReachedBy.get();
+    for(const size_t triangle : visitQueue) {
+        reachedBy[triangle].store(0, std::memory_order_relaxed);
+    }
+
+    try {
+        spreadParallelLevels(adjacency, reachedBy, visitQueue, levelBegin, stopFunctor, threadPool,
+                             parallelThreshold);
+    } catch(...) {
+        // Keys of the unfinished level may be set outside of the queue, clear all of them in the next spread
+        marks.mReachedBySize = 0;
+        throw;
+    }
+
+    // Every key lowered by an edge belongs to a triangle in the queue, the one whose edge kept the lowest key
+    threadPool.parallel_for_chunks(visitQueue.size(), 64 * MIN_CHUNK_SIZE,
+                                   [reachedBy, &visitQueue](size_t, size_t begin, size_t end) {
+                                       for(size_t queuePos = begin; queuePos < end; ++queuePos) {
+                                           reachedBy[visitQueue[queuePos]].store(NOT_REACHED,
+                                                                                 std::memory_order_relaxed);
+                                       }
+                                   });
+}
+
+template <typename StoppingCondition>
+void BucketSpread::spreadParallelLevels(const Adjacency& adjacency, std::atomic<uint64_t>* reachedBy,
+                                        std::vector<size_t>& visitQueue, size_t levelBegin,
+                                        const StoppingCondition& stopFunctor, ::ThreadPool& threadPool,
+                                        size_t parallelThreshold) {
+
+    // Small levels are processed as a single chunk on this thread
+    const auto getMinChunkSize = [parallelThreshold](const size_t levelSize) {
+        return levelSize < parallelThreshold ? levelSize : std::min(MIN_CHUNK_SIZE, parallelThreshold);
+    };
+
+    // Edges of each chunk that lowered the key of their neighbour, as pairs of the key and the neighbour
+    std::vector<std::vector<std::pair<uint64_t, size_t>>> candidatesPerChunk;
+    while(levelBegin < visitQueue.size()) {
+        const size_t levelEnd = visitQueue.size();
+        const size_t levelSize = levelEnd - levelBegin;
+        const size_t chunkSize = getChunkSize(levelSize, getMinChunkSize(levelSize), threadPool);
+        candidatesPerChunk.resize(::ThreadPool::chunk_count(levelSize, chunkSize));
+
+        // Every edge allowed by the stopping condition competes for its neighbour
+        threadPool.parallel_for_chunks(levelSize, chunkSize, [&](size_t chunkIdx, size_t begin, size_t end) {
+            std::vector<std::pair<uint64_t, size_t>>& candidates = candidatesPerChunk[chunkIdx];
+            candidates.clear();
+            for(size_t queuePos = levelBegin + begin; queuePos < levelBegin + end; ++queuePos) {
+                const size_t currentTriangle = visitQueue[queuePos];
+                for(int i = 0; i < 3; ++i) {
+                    const int neighbour = adjacency[currentTriangle][i];
+                    if(neighbour < 0) {
+                        continue;
+                    }
+
+                    // Skip visited triangles and triangles that an earlier edge of this level already reached
+                    const uint64_t key = getEdgeKey(queuePos, i);
+                    std::atomic<uint64_t>& neighbourKey = reachedBy[neighbour];
+                    uint64_t currentKey = neighbourKey.load(std::memory_order_relaxed);
+                    if(currentKey <= key || !stopFunctor(static_cast<size_t>(neighbour), currentTriangle)) {
+                        continue;
+                    }
+
+                    while(key < currentKey &&
+                          !neighbourKey.compare_exchange_weak(currentKey, key, std::memory_order_relaxed)) {
+                    }
+                    if(key < currentKey) {
+                        candidates.emplace_back(key, static_cast<size_t>(neighbour));
+                    }
+                }
+            }
+        });
+
+        // Candidates that kept the lowest key form the next level. Keys grow within a chunk and chunks are
+        // in the order of the queue, so the next level is in the same order as in the serial BFS.
+        for(const auto& candidates : candidatesPerChunk) {
+            for(const auto& candidate : candidates) {
+                if(reachedBy[candidate.second].load(std::memory_order_relaxed) == candidate.first) {
+                    visitQueue.push_back(candidate.second);
+                }
+            }
+        }
+        levelBegin = levelEnd;
+    }
+}
+
+}  // namespace pepr3d
@@ -0,0 +1,92 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "geometry/BucketSpread.h"
+
+namespace {
+
+using pepr3d::BucketSpread;
+
+/// Adjacency of a regular grid of width x height quads, each split into two triangles
+BucketSpread::Adjacency getGridAdjacency(const int width, const int height) {
+    BucketSpread::Adjacency adjacency(2 * width * height, {-1, -1, -1});
+    for(int y = 0; y < height; ++y) {
+        for(int x = 0; x < width; ++x) {
+            const int lower = 2 * (y * width + x);
+            const int upper = lower + 1;
+
+            // The diagonal of the quad
+            adjacency[lower][0] = upper;
+            adjacency[upper][0] = lower;
+
+            // Bottom and left edges of the lower triangle, top and right edges of the upper triangle
+            adjacency[lower][1] = y > 0 ? 2 * ((y - 1) * width + x) + 1 : -1;
+            adjacency[lower][2] = x > 0 ? 2 * (y * width + x - 1) + 1 : -1;
+            adjacency[upper][1] = y + 1 < height ? 2 * ((y + 1) * width + x) : -1;
+            adjacency[upper][2] = x + 1 < width ? 2 * (y * width + x + 1) : -1;
+        }
+    }
+    return adjacency;
+}
+
+}  // namespace
+
+TEST(BucketSpread, reachesWholeGrid) {
+    /**
+     * Test that spreading without stopping reaches each triangle exactly once
+     */
+    ::ThreadPool threadPool(3);
+    const BucketSpread::Adjacency adjacency = getGridAdjacency(40, 30);
+    BucketSpread::Marks marks;
+
+    const auto doNotStop = [](size_t, size_t) { return true; };
+    std::vector<size_t> reached = BucketSpread::spread(adjacency, marks, {17}, doNotStop, threadPool);
+
+    EXPECT_EQ(reached.size(), adjacency.size());
+    EXPECT_EQ(reached.front(), 17);
+    std::sort(reached.begin(), reached.end());
+    EXPECT_TRUE(std::adjacent_find(reached.begin(), reached.end()) == reached.end());
+    EXPECT_TRUE(marks.isCleared());
+}
+
+TEST(BucketSpread, parallelSameAsSerial) {
+    /**
+     * Test that the parallel levels give the same triangles in the same order as the serial BFS,
+     * with a stopping condition that depends on the direction of the spread, and that the marks kept between the
+     * spreads are cleared after each of them
+     */
+    ::ThreadPool threadPool(3);
+    const BucketSpread::Adjacency adjacency = getGridAdjacency(200, 150);
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> colorDistribution(0, 3);
+    std::vector<int> colors(adjacency.size());
+    for(int& color : colors) {
+        color = colorDistribution(generator);
+    }
+
+    const auto colorStopping = [&colors](const size_t neighbour, const size_t current) {
+        return colors[neighbour] != 0 && colors[neighbour] >= colors[current] - 1;
+    };
+    const auto doNotStop = [](size_t, size_t) { return true; };
+
+    const std::vector<std::vector<size_t>> startTriangleSets = {{0}, {12345}, {5, 29999, 5, 777}};
+    BucketSpread::Marks marks;
+    for(const auto& startTriangles : startTriangleSets) {
+        const auto serialColor = BucketSpread::spread(adjacency, marks, startTriangles, colorStopping, threadPool,
+                                                      std::numeric_limits<size_t>::max());
+        const auto parallelColor = BucketSpread::spread(adjacency, marks, startTriangles, colorStopping, threadPool, 1);
+        EXPECT_EQ(serialColor, parallelColor);
+
+        const auto serialWhole = BucketSpread::spread(adjacency, marks, startTriangles, doNotStop, threadPool,
+                                                      std::numeric_limits<size_t>::max());
+        const auto parallelWhole = BucketSpread::spread(adjacency, marks, startTriangles, doNotStop, threadPool, 1);
+        EXPECT_EQ(serialWhole, parallelWhole);
+        EXPECT_EQ(parallelWhole.size(), adjacency.size());
+        EXPECT_TRUE(marks.isCleared());
+    }
+}
+
+#endif
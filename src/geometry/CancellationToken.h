@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+
+namespace pepr3d {
+
+/// Exception thrown from a long computation when its CancellationToken was cancelled
+class OperationCancelledException : public std::runtime_error {
+   public:
+    OperationCancelledException() : std::runtime_error("The operation was cancelled.") {}
+};
+
+/// Cooperative cancellation of a long running operation.
+/// The operation makes its token current for the thread it runs on (see Scope) and the long loops it calls check it
+/// via checkCurrent(). Parallel loop bodies must not check the token, only the thread running the operation does.
+class CancellationToken {
+   public:
+    /// Requests the operation to stop at the next check
+    void cancel() {
+        mIsCancelled = true;
+    }
+
+    bool isCancelled() const {
+        return mIsCancelled.load();
+    }
+
+    /// Throws OperationCancelledException if the token was cancelled
+    void throwIfCancelled() const {
+        if(isCancelled()) {
+            throw OperationCancelledException();
+        }
+    }
+
+    /// Returns true if the operation running on the calling thread was cancelled.
+    /// Returns false when no operation with a token is running on this thread.
+    static bool isCurrentCancelled() {
+        return current() != nullptr && current()->isCancelled();
+    }
+
+    /// Throws OperationCancelledException if the operation running on the calling thread was cancelled
+    static void checkCurrent() {
+        if(isCurrentCancelled()) {
+            throw OperationCancelledException();
+        }
+    }
+
+    /// Makes a token current for the calling thread during the lifetime of the scope
+    class Scope {
+       public:
+        explicit Scope(const CancellationToken* token) : mPrevious(current()) {
+            current() = token;
+        }
+
+        ~Scope() {
+            current() = mPrevious;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        const CancellationToken* mPrevious;
+    };
+
+   private:
+    std::atomic<bool> mIsCancelled{false};
+
+    static const CancellationToken*& current() {
+        static thread_local const CancellationToken* token = nullptr;
+        return token;
+    }
+};
+
+}  // namespace pepr3d
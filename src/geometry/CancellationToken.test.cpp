@@ -0,0 +1,37 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "geometry/CancellationToken.h"
+
+TEST(CancellationToken, checkCurrent) {
+    /**
+     * Test that only the token of the current scope is checked and that scopes restore the previous token
+     */
+    pepr3d::CancellationToken outer;
+    pepr3d::CancellationToken inner;
+    EXPECT_NO_THROW(pepr3d::CancellationToken::checkCurrent());
+
+    pepr3d::CancellationToken::Scope outerScope(&outer);
+    inner.cancel();
+    EXPECT_TRUE(inner.isCancelled());
+    EXPECT_NO_THROW(pepr3d::CancellationToken::checkCurrent());
+    {
+        pepr3d::CancellationToken::Scope innerScope(&inner);
+        EXPECT_TRUE(pepr3d::CancellationToken::isCurrentCancelled());
+        EXPECT_THROW(pepr3d::CancellationToken::checkCurrent(), pepr3d::OperationCancelledException);
+    }
+    EXPECT_FALSE(pepr3d::CancellationToken::isCurrentCancelled());
+
+    // Other threads do not see the token of this thread
+    outer.cancel();
+    EXPECT_THROW(pepr3d::CancellationToken::checkCurrent(), pepr3d::OperationCancelledException);
+    bool isCancelledInThread = true;
+    std::thread([&isCancelledInThread]() {
+        isCancelledInThread = pepr3d::CancellationToken::isCurrentCancelled();
+    }).join();
+    EXPECT_FALSE(isCancelledInThread);
+}
+
+#endif
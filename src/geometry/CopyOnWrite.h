@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "peprassert.h"
+
+namespace pepr3d {
+
+/// Value held by a shared immutable pointer. Copies share the value, it is cloned only when a shared value is
+/// edited. Copying a container of these (e.g. for an undo snapshot) copies pointers instead of the values.
+/// Not thread-safe: a value must not be edited while another thread copies it.
+template <typename T>
+class CopyOnWrite {
+    /// Never modified while shared
+    std::shared_ptr<T> mValue;
+
+   public:
+    /// Empty, only to be loaded into
+    CopyOnWrite() = default;
+
+    template <typename... Args>
+    explicit CopyOnWrite(std::in_place_t, Args&&... args)
+        : mValue(std::make_shared<T>(std::forward<Args>(args)...)) {}
+
+    const T& get() const {
+        P_ASSERT(mValue);
+        return *mValue;
+    }
+
+    const T* operator->() const {
+        return &get();
+    }
+
+    /// Mutable access to the value, clones it first if it is shared with another copy
+    T& edit() {
+        P_ASSERT(mValue);
+        if(mValue.use_count() > 1) {
+            mValue = std::make_shared<T>(*mValue);
+        }
+        return *mValue;
+    }
+
+    /// True if both copies share the same value
+    bool isSameValue(const CopyOnWrite& other) const {
+        return mValue == other.mValue;
+    }
+
+    /// Serialized as the value itself
+    template <class Archive>
+    void save(Archive& saveArchive) const {
+        saveArchive(get());
+    }
+
+    template <class Archive>
+    void load(Archive& loadArchive) {
+        auto value = std::make_shared<T>();
+        loadArchive(*value);
+        mValue = std::move(value);
+    }
+};
+
+}  // namespace pepr3d
@@ -0,0 +1,30 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "geometry/CopyOnWrite.h"
+
+TEST(CopyOnWrite, cloneOnEdit) {
+    /**
+     * Test that copies share the value until one of them is edited, and that editing a value that is not shared
+     * does not clone it
+     */
+    pepr3d::CopyOnWrite<std::vector<int>> original(std::in_place, 3, 7);
+    pepr3d::CopyOnWrite<std::vector<int>> copy = original;
+    EXPECT_TRUE(copy.isSameValue(original));
+    EXPECT_EQ(&copy.get(), &original.get());
+
+    copy.edit()[0] = 1;
+    EXPECT_FALSE(copy.isSameValue(original));
+    EXPECT_EQ(copy.get(), (std::vector<int>{1, 7, 7}));
+    EXPECT_EQ(original.get(), (std::vector<int>{7, 7, 7}));
+
+    const std::vector<int>* editedValue = &copy.get();
+    copy.edit().push_back(2);
+    EXPECT_EQ(&copy.get(), editedValue);
+    EXPECT_EQ(copy->size(), 4);
+}
+
+#endif
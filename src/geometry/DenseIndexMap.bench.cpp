@@ -0,0 +1,97 @@
+#ifdef _BENCH_
+
+#include <map>
+#include <random>
+
+#include "geometry/DenseIndexMap.h"
+#include "peprbench.h"
+
+namespace {
+
+/// Stand-in for TriangleDetail, only the size matters for the cache behaviour
+struct FakeDetail {
+    size_t value;
+    char padding[248];
+};
+
+/// Triangle count of a large model
+constexpr size_t TRIANGLE_COUNT = 2'000'000;
+
+/// Fraction of the triangles with detail, painting with a brush rarely subdivides more
+constexpr double DETAIL_FRACTION = 0.05;
+
+/// Loops of Geometry over all triangles, asking for each whether it has detail and touching the detail if it has
+template <typename MapType, typename LookupFunc>
+size_t lookupAll(const MapType& map, LookupFunc lookup) {
+    size_t sum = 0;
+    for(size_t triangleIdx = 0; triangleIdx < TRIANGLE_COUNT; ++triangleIdx) {
+        sum += lookup(map, triangleIdx);
+    }
+    return sum;
+}
+
+template <typename MapType>
+size_t iterateAll(const MapType& map) {
+    size_t sum = 0;
+    for(const auto& entry : map) {
+        sum += entry.first + entry.second.value;
+    }
+    return sum;
+}
+
+}  // namespace
+
+PEPR3D_BENCHMARK(DenseIndexMap) {
+    std::mt19937 generator(options.seed);
+    std::bernoulli_distribution hasDetail(DETAIL_FRACTION);
+
+    std::vector<size_t> detailedTriangles;
+    for(size_t triangleIdx = 0; triangleIdx < TRIANGLE_COUNT; ++triangleIdx) {
+        if(hasDetail(generator)) {
+            detailedTriangles.push_back(triangleIdx);
+        }
+    }
+    report.setInfo("triangles", std::to_string(TRIANGLE_COUNT));
+    report.setInfo("detailedTriangles", std::to_string(detailedTriangles.size()));
+
+    const auto mapLookup = [](const std::map<size_t, FakeDetail>& map, size_t idx) -> size_t {
+        const auto it = map.find(idx);
+        return it == map.end() ? 0 : it->second.value;
+    };
+    const auto denseLookup = [](const pepr3d::DenseIndexMap<FakeDetail>& map, size_t idx) -> size_t {
+        const FakeDetail* detail = map.find(idx);
+        return detail == nullptr ? 0 : detail->value;
+    };
+
+    size_t checksum = 0;
+    for(size_t i = 0; i < options.iterations; ++i) {
+        std::map<size_t, FakeDetail> stdMap;
+        pepr3d::DenseIndexMap<FakeDetail> denseMap;
+
+        report.measure("std::map.insert", [&]() {
+            for(const size_t idx : detailedTriangles) {
+                stdMap.emplace(idx, FakeDetail{idx, {}});
+            }
+        });
+        report.measure("dense.insert", [&]() {
+            for(const size_t idx : detailedTriangles) {
+                denseMap.emplace(idx, FakeDetail{idx, {}});
+            }
+        });
+
+        const size_t mapLookupSum = report.measure("std::map.lookup", [&]() { return lookupAll(stdMap, mapLookup); });
+        const size_t denseLookupSum =
+            report.measure("dense.lookup", [&]() { return lookupAll(denseMap, denseLookup); });
+
+        const size_t mapIterateSum = report.measure("std::map.iterate", [&]() { return iterateAll(stdMap); });
+        const size_t denseIterateSum = report.measure("dense.iterate", [&]() { return iterateAll(denseMap); });
+
+        if(mapLookupSum != denseLookupSum || mapIterateSum != denseIterateSum) {
+            throw std::logic_error("DenseIndexMap and std::map disagree.");
+        }
+        checksum += denseLookupSum + denseIterateSum;
+    }
+    report.setInfo("checksum", std::to_string(checksum));
+}
+
+#endif
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <cereal/cereal.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace pepr3d {
+
+/// Map from a dense range of indices (e.g. triangle IDs) to values, with O(1) lookup.
+/// A bitset marks the used indices so that iteration skips empty ranges quickly and always goes in ascending
+/// order of the indices, the same as std::map. Values are stored in a slab with stable addresses, pointers to
+/// values stay valid until the value is erased.
+template <typename T>
+class DenseIndexMap {
+    static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+    /// Index -> slot of the value in mSlab, NO_SLOT if the index has no value
+    std::vector<uint32_t> mSlotOfIndex;
+
+    /// One bit for each index, set if the index has a value
+    std::vector<uint64_t> mUsedBits;
+
+    /// Storage of the values, deque does not move the elements when it grows
+    std::deque<std::optional<T>> mSlab;
+
+    /// Slots of erased values that can be reused
+    std::vector<uint32_t> mFreeSlots;
+
+    size_t mSize = 0;
+
+   public:
+    /// Pair of an index and its value, mimicking std::map's value_type
+    template <typename Value>
+    struct Entry {
+        size_t first;
+        Value& second;
+    };
+
+    template <typename MapType, typename Value>
+    class Iterator {
+        MapType* mMap;
+        size_t mIndex;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry<Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Entry<Value>;
+
+        Iterator(MapType* map, size_t index) : mMap(map), mIndex(index) {}
+
+        Entry<Value> operator*() const {
+            return Entry<Value>{mIndex, *mMap->mSlab[mMap->mSlotOfIndex[mIndex]]};
+        }
+
+        Iterator& operator++() {
+            mIndex = mMap->findNextUsed(mIndex + 1);
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return mIndex == other.mIndex;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return mIndex != other.mIndex;
+        }
+    };
+
+    using iterator = Iterator<DenseIndexMap<T>, T>;
+    using const_iterator = Iterator<const DenseIndexMap<T>, const T>;
+
+    iterator begin() {
+        return iterator(this, findNextUsed(0));
+    }
+
+    iterator end() {
+        return iterator(this, mSlotOfIndex.size());
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, findNextUsed(0));
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, mSlotOfIndex.size());
+    }
+
+    size_t size() const {
+        return mSize;
+    }
+
+    bool empty() const {
+        return mSize == 0;
+    }
+
+    bool contains(const size_t index) const {
+        return index < mSlotOfIndex.size() && mSlotOfIndex[index] != NO_SLOT;
+    }
+
+    /// Returns the value of the index or nullptr if there is none
+    T* find(const size_t index) {
+        return contains(index) ? &*mSlab[mSlotOfIndex[index]] : nullptr;
+    }
+
+    /// Returns the value of the index or nullptr if there is none
+    const T* find(const size_t index) const {
+        return contains(index) ? &*mSlab[mSlotOfIndex[index]] : nullptr;
+    }
+
+    /// Returns the value of the index, throws std::out_of_range if there is none
+    T& at(const size_t index) {
+        T* value = find(index);
+        if(value == nullptr) {
+            throw std::out_of_range("DenseIndexMap has no value at index " + std::to_string(index));
+        }
+        return *value;
+    }
+
+    /// Returns the value of the index, throws std::out_of_range if there is none
+    const T& at(const size_t index) const {
+        const T* value = find(index);
+        if(value == nullptr) {
+            throw std::out_of_range("DenseIndexMap has no value at index " + std::to_string(index));
+        }
+        return *value;
+    }
+
+    /// Constructs a value at the index if there is none.
+    /// @return The value at the index and true if it was inserted, the same as std::map::emplace
+    template <typename... Args>
+    std::pair<T*, bool> emplace(const size_t index, Args&&... args) {
+        if(T* existing = find(index)) {
+            return {existing, false};
+        }
+
+        if(index >= mSlotOfIndex.size()) {
+            // Grow geometrically, so that inserting indices in ascending order is amortized O(1)
+            const size_t newSize = std::max(index + 1, mSlotOfIndex.size() + mSlotOfIndex.size() / 2);
+            mSlotOfIndex.resize(newSize, NO_SLOT);
+            mUsedBits.resize((newSize + 63) / 64, 0);
+        }
+
+        uint32_t slot;
+        if(!mFreeSlots.empty()) {
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            mSlab[slot].emplace(std::forward<Args>(args)...);
+        } else {
+            slot = static_cast<uint32_t>(mSlab.size());
+            mSlab.emplace_back(std::in_place, std::forward<Args>(args)...);
+        }
+
+        mSlotOfIndex[index] = slot;
+        mUsedBits[index / 64] |= uint64_t{1} << (index % 64);
+        ++mSize;
+        return {&*mSlab[slot], true};
+    }
+
+    /// Removes the value at the index
+    /// @return Number of removed values, the same as std::map::erase
+    size_t erase(const size_t index) {
+        if(!contains(index)) {
+            return 0;
+        }
+
+        const uint32_t slot = mSlotOfIndex[index];
+        mSlab[slot].reset();
+        mFreeSlots.push_back(slot);
+
+        mSlotOfIndex[index] = NO_SLOT;
+        mUsedBits[index / 64] &= ~(uint64_t{1} << (index % 64));
+        --mSize;
+        return 1;
+    }
+
+    void clear() {
+        mSlotOfIndex.clear();
+        mUsedBits.clear();
+        mSlab.clear();
+        mFreeSlots.clear();
+        mSize = 0;
+    }
+
+    /// Serialized in the same format as std::map<size_t, T>, so that saved projects stay compatible
+    template <class Archive>
+    void save(Archive& saveArchive) const {
+        saveArchive(cereal::make_size_tag(static_cast<cereal::size_type>(mSize)));
+        for(const auto& entry : *this) {
+            saveArchive(cereal::make_map_item(entry.first, entry.second));
+        }
+    }
+
+    template <class Archive>
+    void load(Archive& loadArchive) {
+        cereal::size_type size;
+        loadArchive(cereal::make_size_tag(size));
+
+        clear();
+        for(cereal::size_type i = 0; i < size; ++i) {
+            size_t index;
+            T value;
+            loadArchive(cereal::make_map_item(index, value));
+            emplace(index, std::move(value));
+        }
+    }
+
+   private:
+    /// Returns the first used index that is not lower than from, or the end index
+    size_t findNextUsed(const size_t from) const {
+        size_t wordIdx = from / 64;
+        if(wordIdx >= mUsedBits.size()) {
+            return mSlotOfIndex.size();
+        }
+
+        // Mask out the bits before from in the first word
+        uint64_t word = mUsedBits[wordIdx] & (~uint64_t{0} << (from % 64));
+        while(word == 0) {
+            ++wordIdx;
+            if(wordIdx >= mUsedBits.size()) {
+                return mSlotOfIndex.size();
+            }
+            word = mUsedBits[wordIdx];
+        }
+
+        return wordIdx * 64 + countTrailingZeros(word);
+    }
+
+    static size_t countTrailingZeros(const uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long result;
+        _BitScanForward64(&result, word);
+        return result;
+#else
+        return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+    }
+};
+
+}  // namespace pepr3d
@@ -0,0 +1,90 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "geometry/DenseIndexMap.h"
+
+TEST(DenseIndexMap, emplace_find_erase) {
+    /**
+     * Test the basic operations of the DenseIndexMap
+     */
+
+    pepr3d::DenseIndexMap<std::string> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(5), nullptr);
+
+    auto inserted = map.emplace(5, "five");
+    EXPECT_TRUE(inserted.second);
+    EXPECT_EQ(*inserted.first, "five");
+
+    auto notInserted = map.emplace(5, "other");
+    EXPECT_FALSE(notInserted.second);
+    EXPECT_EQ(notInserted.first, inserted.first);
+
+    map.emplace(1000, "thousand");
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_TRUE(map.contains(1000));
+    EXPECT_FALSE(map.contains(999));
+    EXPECT_EQ(map.at(1000), "thousand");
+    EXPECT_THROW(map.at(4), std::out_of_range);
+
+    EXPECT_EQ(map.erase(5), 1);
+    EXPECT_EQ(map.erase(5), 0);
+    EXPECT_EQ(map.find(5), nullptr);
+    EXPECT_EQ(map.size(), 1);
+}
+
+TEST(DenseIndexMap, stable_addresses) {
+    /**
+     * Test that pointers to values stay valid when other values are inserted
+     */
+
+    pepr3d::DenseIndexMap<std::string> map;
+    const std::string* first = map.emplace(0, "first").first;
+    for(size_t i = 1; i < 10000; ++i) {
+        map.emplace(i, std::to_string(i));
+    }
+    EXPECT_EQ(first, map.find(0));
+    EXPECT_EQ(*first, "first");
+}
+
+TEST(DenseIndexMap, same_as_std_map) {
+    /**
+     * Test random operations against std::map, including the iteration order
+     */
+
+    pepr3d::DenseIndexMap<size_t> map;
+    std::map<size_t, size_t> reference;
+    std::mt19937 generator(42);
+
+    for(int i = 0; i < 100000; ++i) {
+        const size_t index = generator() % 3000;
+        switch(generator() % 3) {
+        case 0: EXPECT_EQ(map.emplace(index, index * 2).second, reference.emplace(index, index * 2).second); break;
+        case 1: EXPECT_EQ(map.erase(index), reference.erase(index)); break;
+        default: EXPECT_EQ(map.contains(index), reference.count(index) > 0); break;
+        }
+    }
+
+    ASSERT_EQ(map.size(), reference.size());
+    auto referenceIt = reference.begin();
+    for(const auto& entry : map) {
+        ASSERT_NE(referenceIt, reference.end());
+        EXPECT_EQ(entry.first, referenceIt->first);
+        EXPECT_EQ(entry.second, referenceIt->second);
+        ++referenceIt;
+    }
+    EXPECT_EQ(referenceIt, reference.end());
+
+    // Copies are independent
+    pepr3d::DenseIndexMap<size_t> copy = map;
+    copy.clear();
+    EXPECT_TRUE(copy.empty());
+    EXPECT_EQ(map.size(), reference.size());
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifdef _BENCH_
+
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "geometry/DetailedTriangleMap.h"
+#include "peprbench.h"
+
+namespace {
+
+using pepr3d::DetailedTriangleId;
+
+/// Triangle count of a large model
+constexpr size_t TRIANGLE_COUNT = 1'000'000;
+
+/// Fraction of the triangles with detail, a heavily painted model with many brush strokes
+constexpr double DETAIL_FRACTION = 0.3;
+
+/// Detail triangles of a detailed triangle, a brush stroke over a large triangle cuts it into many pieces
+constexpr size_t MAX_DETAIL_COUNT = 24;
+
+/// The previous hash of DetailedTriangleId, XOR of the hashes of both IDs. Identity hashes of small integers make
+/// (a, b) and (b, a) collide and put all detail triangles of nearby base triangles into a handful of buckets.
+struct XorHash {
+    size_t operator()(const DetailedTriangleId& id) const {
+        return std::hash<size_t>{}(id.getBaseId()) ^ std::hash<std::optional<size_t>>{}(id.getDetailId());
+    }
+};
+
+/// Faces of a detailed mesh in the order a bucket fill reaches them: base triangles are visited in spatially coherent
+/// runs, detail triangles of a base triangle right after each other
+std::vector<DetailedTriangleId> getDetailedIds(std::mt19937& generator) {
+    std::bernoulli_distribution hasDetail(DETAIL_FRACTION);
+    std::uniform_int_distribution<size_t> detailCount(2, MAX_DETAIL_COUNT);
+
+    std::vector<DetailedTriangleId> ids;
+    for(size_t triangleIdx = 0; triangleIdx < TRIANGLE_COUNT; ++triangleIdx) {
+        if(!hasDetail(generator)) {
+            ids.emplace_back(triangleIdx);
+            continue;
+        }
+        const size_t count = detailCount(generator);
+        for(size_t detailIdx = 0; detailIdx < count; ++detailIdx) {
+            ids.emplace_back(triangleIdx, detailIdx);
+        }
+    }
+    return ids;
+}
+
+/// Marks all IDs as visited the way a bucket fill over the IDs does, returns the number of newly visited IDs
+template <typename SetType>
+size_t fillVisited(const std::vector<DetailedTriangleId>& ids) {
+    SetType visited;
+    size_t inserted = 0;
+    for(const DetailedTriangleId id : ids) {
+        inserted += visited.insert(id).second ? 1 : 0;
+    }
+    // A fill checks the neighbours of each face, most of them already visited
+    for(const DetailedTriangleId id : ids) {
+        inserted += visited.count(id) == 0 ? 1 : 0;
+    }
+    return inserted;
+}
+
+template <typename MapType, typename LookupFunc>
+size_t lookupAll(const MapType& map, const std::vector<DetailedTriangleId>& ids, LookupFunc lookup) {
+    size_t sum = 0;
+    for(const DetailedTriangleId id : ids) {
+        sum += lookup(map, id);
+    }
+    return sum;
+}
+
+}  // namespace
+
+PEPR3D_BENCHMARK(DetailedTriangleMap) {
+    std::mt19937 generator(options.seed);
+    const std::vector<DetailedTriangleId> ids = getDetailedIds(generator);
+    report.setInfo("triangles", std::to_string(TRIANGLE_COUNT));
+    report.setInfo("detailedIds", std::to_string(ids.size()));
+
+    using XorMap = std::unordered_map<DetailedTriangleId, size_t, XorHash>;
+    using HashMap = std::unordered_map<DetailedTriangleId, size_t>;
+    using DenseMap = pepr3d::DetailedTriangleMap<size_t>;
+
+    const auto hashLookup = [](const auto& map, const DetailedTriangleId id) -> size_t {
+        const auto it = map.find(id);
+        return it == map.end() ? 0 : it->second;
+    };
+    const auto denseLookup = [](const DenseMap& map, const DetailedTriangleId id) -> size_t {
+        const size_t* value = map.find(id);
+        return value == nullptr ? 0 : *value;
+    };
+
+    size_t checksum = 0;
+    for(size_t i = 0; i < options.iterations; ++i) {
+        const size_t xorFilled = report.measure(
+            "visited.xorHash", [&]() { return fillVisited<std::unordered_set<DetailedTriangleId, XorHash>>(ids); });
+        const size_t hashFilled = report.measure(
+            "visited.packedHash", [&]() { return fillVisited<std::unordered_set<DetailedTriangleId>>(ids); });
+
+        XorMap xorMap;
+        HashMap hashMap;
+        DenseMap denseMap;
+        report.measure("faceDescs.xorHash.insert", [&]() {
+            for(size_t idx = 0; idx < ids.size(); ++idx) {
+                xorMap[ids[idx]] = idx + 1;
+            }
+        });
+        report.measure("faceDescs.packedHash.insert", [&]() {
+            for(size_t idx = 0; idx < ids.size(); ++idx) {
+                hashMap[ids[idx]] = idx + 1;
+            }
+        });
+        report.measure("faceDescs.dense.insert", [&]() {
+            denseMap.reserve(TRIANGLE_COUNT);
+            for(size_t idx = 0; idx < ids.size(); ++idx) {
+                denseMap.set(ids[idx], idx + 1);
+            }
+        });
+
+        const size_t xorSum =
+            report.measure("faceDescs.xorHash.lookup", [&]() { return lookupAll(xorMap, ids, hashLookup); });
+        const size_t hashSum =
+            report.measure("faceDescs.packedHash.lookup", [&]() { return lookupAll(hashMap, ids, hashLookup); });
+        const size_t denseSum =
+            report.measure("faceDescs.dense.lookup", [&]() { return lookupAll(denseMap, ids, denseLookup); });
+
+        if(xorFilled != hashFilled || xorSum != hashSum || hashSum != denseSum || denseMap.size() != ids.size()) {
+            throw std::logic_error("DetailedTriangleMap and std::unordered_map disagree.");
+        }
+        checksum += denseSum;
+    }
+    report.setInfo("checksum", std::to_string(checksum));
+}
+
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "geometry/DenseIndexMap.h"
+#include "geometry/TrianglePrimitive.h"
+#include "peprassert.h"
+
+namespace pepr3d {
+
+/// Map from DetailedTriangleId to values, backed by dense arrays instead of a hash table.
+/// Values of base triangles are stored in an array indexed by the base ID, values of detail triangles in an array
+/// indexed by the detail ID, one for each base triangle that has details. Lookup is two array accesses and no hashing.
+template <typename T>
+class DetailedTriangleMap {
+    /// Base ID -> value of the base triangle without details
+    std::vector<std::optional<T>> mBaseValues;
+
+    /// Base ID -> detail ID -> value of the detail triangle
+    DenseIndexMap<std::vector<std::optional<T>>> mDetailValues;
+
+    size_t mSize = 0;
+
+   public:
+    /// Value of the triangle, nullptr if it has none
+    const T* find(const DetailedTriangleId id) const {
+        const std::optional<T>* value = findSlot(id);
+        return value && *value ? &**value : nullptr;
+    }
+
+    bool contains(const DetailedTriangleId id) const {
+        return find(id) != nullptr;
+    }
+
+    /// Set the value of the triangle, replacing the previous one
+    void set(const DetailedTriangleId id, const T& value) {
+        std::optional<T>& slot = getSlot(id);
+        if(!slot) {
+            ++mSize;
+        }
+        slot = value;
+    }
+
+    /// Removes the value of the triangle
+    /// @return Number of removed values, the same as std::map::erase
+    size_t erase(const DetailedTriangleId id) {
+        const std::optional<size_t> detailId = id.getDetailId();
+        if(!detailId) {
+            if(id.getBaseId() >= mBaseValues.size() || !mBaseValues[id.getBaseId()]) {
+                return 0;
+            }
+            mBaseValues[id.getBaseId()].reset();
+            --mSize;
+            return 1;
+        }
+
+        std::vector<std::optional<T>>* details = mDetailValues.find(id.getBaseId());
+        if(details == nullptr || *detailId >= details->size() || !(*details)[*detailId]) {
+            return 0;
+        }
+        (*details)[*detailId].reset();
+        --mSize;
+
+        // Keep only the details that still have values, so that re-detailed triangles start from scratch
+        while(!details->empty() && !details->back()) {
+            details->pop_back();
+        }
+        if(details->empty()) {
+            mDetailValues.erase(id.getBaseId());
+        }
+        return 1;
+    }
+
+    void clear() {
+        mBaseValues.clear();
+        mDetailValues.clear();
+        mSize = 0;
+    }
+
+    /// Reserve the base triangle array for the number of base triangles
+    void reserve(const size_t baseTriangleCount) {
+        mBaseValues.reserve(baseTriangleCount);
+    }
+
+    size_t size() const {
+        return mSize;
+    }
+
+    bool empty() const {
+        return mSize == 0;
+    }
+
+   private:
+    const std::optional<T>* findSlot(const DetailedTriangleId id) const {
+        const std::optional<size_t> detailId = id.getDetailId();
+        if(!detailId) {
+            return id.getBaseId() < mBaseValues.size() ? &mBaseValues[id.getBaseId()] : nullptr;
+        }
+
+        const std::vector<std::optional<T>>* details = mDetailValues.find(id.getBaseId());
+        if(details == nullptr || *detailId >= details->size()) {
+            return nullptr;
+        }
+        return &(*details)[*detailId];
+    }
+
+    std::optional<T>& getSlot(const DetailedTriangleId id) {
+        const std::optional<size_t> detailId = id.getDetailId();
+        if(!detailId) {
+            if(id.getBaseId() >= mBaseValues.size()) {
+                mBaseValues.resize(id.getBaseId() + 1);
+            }
+            return mBaseValues[id.getBaseId()];
+        }
+
+        std::vector<std::optional<T>>& details = *mDetailValues.emplace(id.getBaseId()).first;
+        if(*detailId >= details.size()) {
+            details.resize(*detailId + 1);
+        }
+        return details[*detailId];
+    }
+};
+
+}  // namespace pepr3d
@@ -0,0 +1,83 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <unordered_map>
+
+#include "geometry/DetailedTriangleMap.h"
+
+using pepr3d::DetailedTriangleId;
+using pepr3d::DetailedTriangleMap;
+
+TEST(DetailedTriangleMap, set_find_erase) {
+    /**
+     * Test the basic operations on base triangles and detail triangles of the same base triangle
+     */
+    DetailedTriangleMap<int> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(DetailedTriangleId(3)), nullptr);
+    EXPECT_EQ(map.find(DetailedTriangleId(3, 1)), nullptr);
+
+    map.set(DetailedTriangleId(3), 30);
+    map.set(DetailedTriangleId(3, 1), 31);
+    EXPECT_EQ(map.size(), 2);
+    ASSERT_NE(map.find(DetailedTriangleId(3)), nullptr);
+    EXPECT_EQ(*map.find(DetailedTriangleId(3)), 30);
+    EXPECT_EQ(*map.find(DetailedTriangleId(3, 1)), 31);
+    EXPECT_FALSE(map.contains(DetailedTriangleId(3, 0)));
+    EXPECT_FALSE(map.contains(DetailedTriangleId(1, 3)));
+
+    map.set(DetailedTriangleId(3, 1), 41);
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_EQ(*map.find(DetailedTriangleId(3, 1)), 41);
+
+    EXPECT_EQ(map.erase(DetailedTriangleId(3, 1)), 1);
+    EXPECT_EQ(map.erase(DetailedTriangleId(3, 1)), 0);
+    EXPECT_EQ(map.erase(DetailedTriangleId(8, 2)), 0);
+    EXPECT_EQ(map.find(DetailedTriangleId(3, 1)), nullptr);
+    EXPECT_EQ(map.size(), 1);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(DetailedTriangleId(3)), nullptr);
+}
+
+TEST(DetailedTriangleMap, matchesUnorderedMap) {
+    /**
+     * Test random sets and erases of detailed IDs against std::unordered_map
+     */
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<size_t> baseDistribution(0, 200);
+    std::uniform_int_distribution<int> detailDistribution(-1, 15);
+    std::bernoulli_distribution eraseDistribution(0.3);
+
+    DetailedTriangleMap<size_t> map;
+    std::unordered_map<DetailedTriangleId, size_t> expected;
+    for(size_t i = 0; i < 20000; ++i) {
+        const int detail = detailDistribution(generator);
+        const DetailedTriangleId id = detail < 0 ? DetailedTriangleId(baseDistribution(generator))
+                                                 : DetailedTriangleId(baseDistribution(generator), detail);
+        if(eraseDistribution(generator)) {
+            EXPECT_EQ(map.erase(id), expected.erase(id));
+        } else {
+            map.set(id, i);
+            expected[id] = i;
+        }
+    }
+
+    EXPECT_EQ(map.size(), expected.size());
+    for(size_t baseId = 0; baseId <= 200; ++baseId) {
+        for(int detail = -1; detail <= 15; ++detail) {
+            const DetailedTriangleId id = detail < 0 ? DetailedTriangleId(baseId) : DetailedTriangleId(baseId, detail);
+            const auto it = expected.find(id);
+            const size_t* value = map.find(id);
+            ASSERT_EQ(value != nullptr, it != expected.end());
+            if(value != nullptr) {
+                EXPECT_EQ(*value, it->second);
+            }
+        }
+    }
+}
+
+#endif
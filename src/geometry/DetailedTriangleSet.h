@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "geometry/TrianglePrimitive.h"
+#include "peprassert.h"
+
+namespace pepr3d {
+
+/// Compact set of DetailedTriangleIds, e.g. the triangles painted by a single command.
+/// Base triangle IDs are split into chunks of 2^16 IDs by their upper bits. A chunk stores the lower 16 bits of its IDs
+/// in a sorted array, or in a bitmap once it is dense enough for the bitmap to be smaller, like a roaring bitmap.
+/// IDs of detail triangles are kept in a sorted list, there are few of them compared to base triangles. A detail ID is
+/// dropped if the set contains its base triangle, painting the base triangle replaces all of its details anyway.
+class DetailedTriangleSet {
+    static constexpr size_t CHUNK_BITS = 16;
+    static constexpr size_t CHUNK_SIZE = size_t{1} << CHUNK_BITS;
+    static constexpr size_t BITMAP_WORDS = CHUNK_SIZE / 64;
+
+    /// Chunks with more IDs than this are stored as bitmaps, which then take less memory than the array
+    static constexpr size_t MAX_ARRAY_SIZE = CHUNK_SIZE / 16;
+
+    struct Chunk {
+        /// Upper bits of the IDs in this chunk
+        uint32_t key;
+
+        /// Number of IDs in this chunk
+        uint32_t count;
+
+        /// Sorted lower bits of the IDs, empty if the chunk is a bitmap
+        std::vector<uint16_t> values;
+
+        /// One bit for each ID of the chunk, empty if the chunk is an array
+        std::vector<uint64_t> bitmap;
+
+        bool isBitmap() const {
+            return !bitmap.empty();
+        }
+
+        bool contains(const uint16_t value) const {
+            if(isBitmap()) {
+                return (bitmap[value / 64] >> (value % 64)) & 1;
+            }
+            return std::binary_search(values.begin(), values.end(), value);
+        }
+
+        void convertToBitmap() {
+            if(isBitmap()) {
+                return;
+            }
+            bitmap.assign(BITMAP_WORDS, 0);
+            for(const uint16_t value : values) {
+                bitmap[value / 64] |= uint64_t{1} << (value % 64);
+            }
+            values.clear();
+            values.shrink_to_fit();
+        }
+    };
+
+    /// Chunks sorted by their key
+    std::vector<Chunk> mChunks;
+
+    /// Sorted IDs of detail triangles whose base triangle is not in the set
+    std::vector<DetailedTriangleId> mDetailIds;
+
+    size_t mBaseCount = 0;
+
+   public:
+    DetailedTriangleSet() = default;
+
+    /// Set of base triangles
+    explicit DetailedTriangleSet(std::vector<size_t> baseIds) {
+        std::sort(baseIds.begin(), baseIds.end());
+        baseIds.erase(std::unique(baseIds.begin(), baseIds.end()), baseIds.end());
+        buildChunks(baseIds);
+    }
+
+    /// Set of both base and detail triangles
+    explicit DetailedTriangleSet(const std::vector<DetailedTriangleId>& ids) {
+        std::vector<size_t> baseIds;
+        for(const DetailedTriangleId id : ids) {
+            if(id.getDetailId()) {
+                mDetailIds.push_back(id);
+            } else {
+                baseIds.push_back(id.getBaseId());
+            }
+        }
+
+        std::sort(baseIds.begin(), baseIds.end());
+        baseIds.erase(std::unique(baseIds.begin(), baseIds.end()), baseIds.end());
+        buildChunks(baseIds);
+        normalizeDetailIds();
+    }
+
+    /// Number of base and detail triangles in the set
+    size_t size() const {
+        return mBaseCount + mDetailIds.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /// Number of base triangles in the set
+    size_t getBaseCount() const {
+        return mBaseCount;
+    }
+
+    /// Sorted IDs of detail triangles whose base triangle is not in the set
+    const std::vector<DetailedTriangleId>& getDetailIds() const {
+        return mDetailIds;
+    }
+
+    bool containsBase(const size_t baseId) const {
+        const Chunk* chunk = findChunk(static_cast<uint32_t>(baseId >> CHUNK_BITS));
+        return chunk != nullptr && chunk->contains(static_cast<uint16_t>(baseId));
+    }
+
+    bool contains(const DetailedTriangleId id) const {
+        if(!id.getDetailId()) {
+            return containsBase(id.getBaseId());
+        }
+        return std::binary_search(mDetailIds.begin(), mDetailIds.end(), id, isLess);
+    }
+
+    /// Call func(size_t baseId) for each base triangle in ascending order
+    template <typename Func>
+    void forEachBaseId(Func&& func) const {
+        for(const Chunk& chunk : mChunks) {
+            const size_t chunkStart = static_cast<size_t>(chunk.key) << CHUNK_BITS;
+            if(!chunk.isBitmap()) {
+                for(const uint16_t value : chunk.values) {
+                    func(chunkStart + value);
+                }
+                continue;
+            }
+
+            for(size_t wordIdx = 0; wordIdx < BITMAP_WORDS; ++wordIdx) {
+                uint64_t word = chunk.bitmap[wordIdx];
+                for(size_t bit = 0; word != 0; ++bit, word >>= 1) {
+                    if(word & 1) {
+                        func(chunkStart + 64 * wordIdx + bit);
+                    }
+                }
+            }
+        }
+    }
+
+    /// Call func(size_t begin, size_t end) for each maximal range [begin, end) of consecutive base triangles, in
+    /// ascending order
+    template <typename Func>
+    void forEachBaseRange(Func&& func) const {
+        bool hasRange = false;
+        size_t rangeBegin = 0;
+        size_t rangeEnd = 0;
+        forEachBaseId([&](const size_t baseId) {
+            if(hasRange && baseId == rangeEnd) {
+                ++rangeEnd;
+                return;
+            }
+            if(hasRange) {
+                func(rangeBegin, rangeEnd);
+            }
+            hasRange = true;
+            rangeBegin = baseId;
+            rangeEnd = baseId + 1;
+        });
+        if(hasRange) {
+            func(rangeBegin, rangeEnd);
+        }
+    }
+
+    /// Add all triangles of the other set
+    void merge(const DetailedTriangleSet& other) {
+        std::vector<Chunk> chunks;
+        chunks.reserve(mChunks.size() + other.mChunks.size());
+        auto thisIt = mChunks.begin();
+        auto otherIt = other.mChunks.begin();
+        while(thisIt != mChunks.end() || otherIt != other.mChunks.end()) {
+            if(otherIt == other.mChunks.end() || (thisIt != mChunks.end() && thisIt->key < otherIt->key)) {
+                chunks.push_back(std::move(*thisIt++));
+            } else if(thisIt == mChunks.end() || otherIt->key < thisIt->key) {
+                chunks.push_back(*otherIt++);
+            } else {
+                chunks.push_back(mergeChunks(std::move(*thisIt++), *otherIt++));
+            }
+        }
+        mChunks = std::move(chunks);
+
+        mBaseCount = 0;
+        for(const Chunk& chunk : mChunks) {
+            mBaseCount += chunk.count;
+        }
+
+        std::vector<DetailedTriangleId> detailIds;
+        detailIds.reserve(mDetailIds.size() + other.mDetailIds.size());
+        std::merge(mDetailIds.begin(), mDetailIds.end(), other.mDetailIds.begin(), other.mDetailIds.end(),
+                   std::back_inserter(detailIds), isLess);
+        mDetailIds = std::move(detailIds);
+        normalizeDetailIds();
+    }
+
+    /// Approximate memory taken by the set in bytes
+    size_t getMemoryUsage() const {
+        size_t bytes = sizeof(DetailedTriangleSet) + mDetailIds.capacity() * sizeof(DetailedTriangleId);
+        for(const Chunk& chunk : mChunks) {
+            bytes += sizeof(Chunk) + chunk.values.capacity() * sizeof(uint16_t) +
+                     chunk.bitmap.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+   private:
+    static bool isLess(const DetailedTriangleId a, const DetailedTriangleId b) {
+        return a.getPacked() < b.getPacked();
+    }
+
+    const Chunk* findChunk(const uint32_t key) const {
+        const auto it = std::lower_bound(mChunks.begin(), mChunks.end(), key,
+                                         [](const Chunk& chunk, const uint32_t value) { return chunk.key < value; });
+        return it != mChunks.end() && it->key == key ? &*it : nullptr;
+    }
+
+    /// Build the chunks from sorted unique base IDs
+    void buildChunks(const std::vector<size_t>& sortedBaseIds) {
+        mChunks.clear();
+        for(const size_t baseId : sortedBaseIds) {
+            P_ASSERT(baseId < std::numeric_limits<uint32_t>::max());
+            const uint32_t key = static_cast<uint32_t>(baseId >> CHUNK_BITS);
+            if(mChunks.empty() || mChunks.back().key != key) {
+                mChunks.push_back(Chunk{key, 0, {}, {}});
+            }
+            Chunk& chunk = mChunks.back();
+            chunk.values.push_back(static_cast<uint16_t>(baseId));
+            ++chunk.count;
+        }
+
+        for(Chunk& chunk : mChunks) {
+            if(chunk.count > MAX_ARRAY_SIZE) {
+                chunk.convertToBitmap();
+            } else {
+                chunk.values.shrink_to_fit();
+            }
+        }
+        mBaseCount = sortedBaseIds.size();
+    }
+
+    static Chunk mergeChunks(Chunk&& chunk, const Chunk& other) {
+        P_ASSERT(chunk.key == other.key);
+        if(!chunk.isBitmap() && !other.isBitmap() && chunk.count + other.count <= MAX_ARRAY_SIZE) {
+            std::vector<uint16_t> values;
+            values.reserve(chunk.count + other.count);
+            std::set_union(chunk.values.begin(), chunk.values.end(), other.values.begin(), other.values.end(),
+                           std::back_inserter(values));
+            chunk.values = std::move(values);
+            chunk.count = static_cast<uint32_t>(chunk.values.size());
+            return std::move(chunk);
+        }
+
+        chunk.convertToBitmap();
+        if(other.isBitmap()) {
+            for(size_t wordIdx = 0; wordIdx < BITMAP_WORDS; ++wordIdx) {
+                chunk.bitmap[wordIdx] |= other.bitmap[wordIdx];
+            }
+        } else {
+            for(const uint16_t value : other.values) {
+                chunk.bitmap[value / 64] |= uint64_t{1} << (value % 64);
+            }
+        }
+
+        chunk.count = 0;
+        for(const uint64_t word : chunk.bitmap) {
+            for(uint64_t bits = word; bits != 0; bits &= bits - 1) {
+                ++chunk.count;
+            }
+        }
+        return std::move(chunk);
+    }
+
+    /// Sort and deduplicate the detail IDs and drop the ones whose base triangle is in the set
+    void normalizeDetailIds() {
+        std::sort(mDetailIds.begin(), mDetailIds.end(), isLess);
+        mDetailIds.erase(std::unique(mDetailIds.begin(), mDetailIds.end()), mDetailIds.end());
+        mDetailIds.erase(std::remove_if(mDetailIds.begin(), mDetailIds.end(),
+                                        [this](const DetailedTriangleId id) { return containsBase(id.getBaseId()); }),
+                         mDetailIds.end());
+        mDetailIds.shrink_to_fit();
+    }
+};
+
+}  // namespace pepr3d
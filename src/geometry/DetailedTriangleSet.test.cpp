@@ -0,0 +1,77 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+
+#include "geometry/DetailedTriangleSet.h"
+
+using pepr3d::DetailedTriangleId;
+using pepr3d::DetailedTriangleSet;
+
+namespace {
+
+/// Base IDs of the set in the order they are visited
+std::vector<size_t> getBaseIds(const DetailedTriangleSet& set) {
+    std::vector<size_t> baseIds;
+    set.forEachBaseId([&baseIds](const size_t baseId) { baseIds.push_back(baseId); });
+    return baseIds;
+}
+
+}  // namespace
+
+TEST(DetailedTriangleSet, baseAndDetailIds) {
+    /**
+     * Test that base IDs are sorted and deduplicated, and that details of base triangles in the set are dropped
+     */
+    const DetailedTriangleSet set({DetailedTriangleId(7), DetailedTriangleId(3, 2), DetailedTriangleId(7, 1),
+                                   DetailedTriangleId(2), DetailedTriangleId(3, 0), DetailedTriangleId(7),
+                                   DetailedTriangleId(3, 2), DetailedTriangleId(100000)});
+
+    EXPECT_EQ(getBaseIds(set), (std::vector<size_t>{2, 7, 100000}));
+    const std::vector<DetailedTriangleId> expectedDetails{DetailedTriangleId(3, 0), DetailedTriangleId(3, 2)};
+    EXPECT_EQ(set.getDetailIds(), expectedDetails);
+    EXPECT_EQ(set.size(), 5);
+    EXPECT_TRUE(set.contains(DetailedTriangleId(100000)));
+    EXPECT_TRUE(set.contains(DetailedTriangleId(3, 2)));
+    EXPECT_FALSE(set.contains(DetailedTriangleId(3)));
+    EXPECT_FALSE(set.contains(DetailedTriangleId(7, 1)));
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    DetailedTriangleSet(std::vector<size_t>{5, 1, 2, 3, 9, 6}).forEachBaseRange([&ranges](size_t begin, size_t end) {
+        ranges.emplace_back(begin, end);
+    });
+    EXPECT_EQ(ranges, (std::vector<std::pair<size_t, size_t>>{{1, 4}, {5, 7}, {9, 10}}));
+}
+
+TEST(DetailedTriangleSet, mergeMatchesStdSet) {
+    /**
+     * Test merging sparse and dense sets of base IDs against std::set, and that dense sets take little memory
+     */
+    std::mt19937 generator(3);
+    std::set<size_t> expected;
+    DetailedTriangleSet set;
+
+    for(const size_t step : {1000, 3, 1, 50}) {
+        std::uniform_int_distribution<size_t> startDistribution(0, 300000);
+        std::vector<size_t> baseIds;
+        const size_t start = startDistribution(generator);
+        for(size_t i = 0; i < 20000; ++i) {
+            baseIds.push_back(start + i * step);
+        }
+        expected.insert(baseIds.begin(), baseIds.end());
+
+        set.merge(DetailedTriangleSet(std::move(baseIds)));
+        EXPECT_EQ(set.getBaseCount(), expected.size());
+        EXPECT_EQ(getBaseIds(set), std::vector<size_t>(expected.begin(), expected.end()));
+    }
+
+    // A dense set takes much less than a vector of IDs
+    EXPECT_LT(set.getMemoryUsage(), expected.size() * sizeof(uint32_t));
+
+    set.merge(DetailedTriangleSet({DetailedTriangleId(*expected.begin(), 4), DetailedTriangleId(1u << 31, 4)}));
+    EXPECT_EQ(set.getDetailIds(), std::vector<DetailedTriangleId>{DetailedTriangleId(1u << 31, 4)});
+}
+
+#endif
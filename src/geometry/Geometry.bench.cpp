@@ -0,0 +1,240 @@
+#ifdef _BENCH_
+
+#include <glm/gtc/constants.hpp>
+#include <random>
+
+#include "geometry/Geometry.h"
+#include "geometry/GeometryUtils.h"
+#include "geometry/ModelExporter.h"
+#include "peprbench.h"
+
+namespace {
+
+using pepr3d::DetailedTriangleId;
+using pepr3d::Geometry;
+
+/// A brush stroke made of rays, each ray being one dab of the brush
+using Stroke = std::vector<ci::Ray>;
+
+/// Generate reproducible strokes. Each stroke starts above a random triangle and moves along its tangent plane.
+std::vector<Stroke> generateStrokes(const Geometry& geometry, std::mt19937& generator, size_t strokeCount,
+                                    size_t dabsPerStroke, float dabSpacing) {
+    const glm::vec3 bbMin = geometry.getBoundingBoxMin();
+    const glm::vec3 bbMax = geometry.getBoundingBoxMax();
+    const float diagonal = glm::length(bbMax - bbMin);
+
+    std::uniform_int_distribution<size_t> triangleDistribution(0, geometry.getTriangleCount() - 1);
+    std::uniform_real_distribution<float> angleDistribution(0.f, 2.f * glm::pi<float>());
+
+    std::vector<Stroke> strokes;
+    strokes.reserve(strokeCount);
+    for(size_t strokeIdx = 0; strokeIdx < strokeCount; ++strokeIdx) {
+        const pepr3d::DataTriangle& tri = geometry.getTriangle(triangleDistribution(generator));
+        const glm::vec3 normal = glm::normalize(tri.getNormal());
+        const glm::vec3 center = (tri.getVertex(0) + tri.getVertex(1) + tri.getVertex(2)) / 3.f;
+
+        // Pick a random direction of the stroke in the tangent plane of the starting triangle
+        const glm::vec3 edge = glm::normalize(tri.getVertex(1) - tri.getVertex(0));
+        const glm::vec3 bitangent = glm::cross(normal, edge);
+        const float angle = angleDistribution(generator);
+        const glm::vec3 strokeDirection = std::cos(angle) * edge + std::sin(angle) * bitangent;
+
+        Stroke stroke;
+        stroke.reserve(dabsPerStroke);
+        for(size_t dabIdx = 0; dabIdx < dabsPerStroke; ++dabIdx) {
+            const glm::vec3 target = center + strokeDirection * (dabSpacing * static_cast<float>(dabIdx));
+            stroke.emplace_back(target + normal * diagonal, -normal);
+        }
+        strokes.push_back(std::move(stroke));
+    }
+    return strokes;
+}
+
+/// Paint color used for the stroke, never the first color, which is usually the color of the whole model
+size_t strokeColor(const Geometry& geometry, size_t strokeIdx) {
+    const size_t colorCount = geometry.getColorManager().size();
+    return colorCount > 1 ? 1 + strokeIdx % (colorCount - 1) : 0;
+}
+
+/// Upload is emulated by regenerating the buffers, the same way ModelView does before each frame
+void updateBuffers(Geometry& geometry, pepr3d::bench::BenchmarkReport& report) {
+    const Geometry::OpenGlData& glData = geometry.getOpenGlData();
+    if(glData.needsUpdate()) {
+        report.measure("buffers.update", [&]() { geometry.updateOpenGlBuffers(); });
+    }
+
+    // Everything was uploaded, ModelView clears the flags after each frame too
+    glData.info.unsetUpdatedRanges();
+    glData.info.unsetColorFlag();
+    glData.info.unsetHighlightFlag();
+}
+
+}  // namespace
+
+PEPR3D_BENCHMARK(GeometryPipeline) {
+    if(options.modelPath.empty()) {
+        throw std::invalid_argument("No model file given.");
+    }
+
+    Geometry geometry;
+    report.measure("load", [&]() { geometry.loadNewGeometry(options.modelPath); });
+    report.setInfo("triangles", std::to_string(geometry.getTriangleCount()));
+    report.setInfo("vertices", std::to_string(geometry.polyVertCount()));
+    report.setInfo("polyhedronValid", geometry.polyhedronValid() ? "true" : "false");
+    report.setInfo("weldTimeMs", std::to_string(geometry.getProgress().weldTimeMs));
+    updateBuffers(geometry, report);
+
+    if(geometry.getTriangleCount() == 0) {
+        throw std::runtime_error("The model has no triangles.");
+    }
+
+    const float diagonal = glm::length(geometry.getBoundingBoxMax() - geometry.getBoundingBoxMin());
+    pepr3d::BrushSettings settings;
+    settings.size = options.relativeBrushSize * diagonal;
+    settings.spherical = true;
+
+    std::mt19937 generator(options.seed);
+    const std::vector<Stroke> strokes =
+        generateStrokes(geometry, generator, options.iterations, options.dabsPerStroke, settings.size * 0.5f);
+
+    // Brush range queries on their own, the same query the flat brush and text do for each dab
+    size_t trianglesInRadius = 0;
+    for(const Stroke& stroke : strokes) {
+        for(const ci::Ray& ray : stroke) {
+            const glm::vec3 ro = ray.getOrigin();
+            const glm::vec3 rd = ray.getDirection();
+            const Geometry::Line3 line(Geometry::Point3(ro.x, ro.y, ro.z), Geometry::Vector3(rd.x, rd.y, rd.z));
+            trianglesInRadius +=
+                report.measure("radius.line", [&]() { return geometry.getTrianglesInRadius(line, settings.size); })
+                    .size();
+        }
+    }
+    report.setInfo("trianglesInRadius", std::to_string(trianglesInRadius));
+
+    // Picking of the triangle under the cursor, done by the tools on every mouse move
+    size_t pickedTriangles = 0;
+    for(const Stroke& stroke : strokes) {
+        for(const ci::Ray& ray : stroke) {
+            if(report.measure("pick.ray", [&]() { return geometry.intersectMesh(ray); })) {
+                ++pickedTriangles;
+            }
+        }
+    }
+    report.setInfo("pickedTriangles", std::to_string(pickedTriangles));
+
+    // Spherical brush, the detailed data is updated after each stroke the same way the first bucket click would
+    for(size_t strokeIdx = 0; strokeIdx < strokes.size(); ++strokeIdx) {
+        settings.color = strokeColor(geometry, strokeIdx);
+        for(const ci::Ray& ray : strokes[strokeIdx]) {
+            report.measure("brush.sphere.dab", [&]() { geometry.paintAreaWithSphere(ray, settings); });
+            updateBuffers(geometry, report);
+        }
+
+        if(geometry.polyhedronValid()) {
+            report.measure("detailed.update", [&]() { geometry.updateTemporaryDetailedData(); });
+        }
+    }
+
+    // The same strokes in another color painted at once, the way a joined brush command is replayed by undo
+    for(size_t strokeIdx = 0; strokeIdx < strokes.size(); ++strokeIdx) {
+        settings.color = strokeColor(geometry, strokeIdx + 1);
+        report.measure("brush.sphere.stroke", [&]() { geometry.paintAreaWithSpheres(strokes[strokeIdx], settings); });
+        updateBuffers(geometry, report);
+    }
+
+    // The same strokes swept between their rays the way the Brush tool paints them, in yet another color
+    for(size_t strokeIdx = 0; strokeIdx < strokes.size(); ++strokeIdx) {
+        settings.color = strokeColor(geometry, strokeIdx + 2);
+        std::vector<pepr3d::BrushSweep> sweeps;
+        for(size_t rayIdx = 0; rayIdx < strokes[strokeIdx].size(); ++rayIdx) {
+            const std::optional<ci::Ray> from =
+                rayIdx > 0 ? std::optional<ci::Ray>(strokes[strokeIdx][rayIdx - 1]) : std::nullopt;
+            sweeps.push_back({from, strokes[strokeIdx][rayIdx]});
+        }
+        report.measure("brush.sphere.sweep", [&]() { geometry.paintAreaWithSweeps(sweeps, settings); });
+        updateBuffers(geometry, report);
+    }
+
+    // Shape brush, painting with a circle the same way CmdPaintBrush does
+    const std::vector<Stroke> shapeStrokes =
+        generateStrokes(geometry, generator, options.iterations, options.dabsPerStroke, settings.size * 0.5f);
+    for(size_t strokeIdx = 0; strokeIdx < shapeStrokes.size(); ++strokeIdx) {
+        const size_t color = strokeColor(geometry, strokeIdx);
+        for(const ci::Ray& ray : shapeStrokes[strokeIdx]) {
+            const glm::vec3 ro = ray.getOrigin();
+            const glm::vec3 rd = ray.getDirection();
+            const Geometry::Circle circle(Geometry::Point3(ro.x, ro.y, ro.z), settings.size * settings.size,
+                                          Geometry::Vector3(rd.x, rd.y, rd.z));
+            const std::vector<Geometry::Point3> circlePoints =
+                pepr3d::GeometryUtils::pointsOnCircle(circle, settings.segments);
+
+            report.measure("brush.shape.dab", [&]() { geometry.paintWithShape(ray, circlePoints, color, false); });
+            updateBuffers(geometry, report);
+        }
+    }
+
+    if(!geometry.polyhedronValid()) {
+        // Bucket and polyhedron based exports need a valid polyhedron
+        return;
+    }
+
+    report.measure("detailed.update", [&]() { geometry.updateTemporaryDetailedData(); });
+
+    // Bucket fills stopping on a different color, both over the original and the detailed mesh
+    std::uniform_int_distribution<size_t> triangleDistribution(0, geometry.getTriangleCount() - 1);
+    const auto baseColorStopping = [&geometry](const size_t a, const size_t b) {
+        return geometry.getTriangleColor(a) == geometry.getTriangleColor(b);
+    };
+    const auto detailedColorStopping = [&geometry](const DetailedTriangleId a, const DetailedTriangleId b) {
+        return geometry.getTriangleColor(a) == geometry.getTriangleColor(b);
+    };
+    const auto doNotStop = [](const size_t, const size_t) { return true; };
+
+    size_t bucketFilled = 0;
+    for(size_t i = 0; i < options.iterations; ++i) {
+        const size_t startTriangle = triangleDistribution(generator);
+        const DetailedTriangleId startDetailed = geometry.isSimpleTriangle(startTriangle)
+                                                     ? DetailedTriangleId(startTriangle)
+                                                     : DetailedTriangleId(startTriangle, 0);
+
+        const auto base =
+            report.measure("bucket.base", [&]() { return geometry.bucket(startTriangle, baseColorStopping); });
+        const auto detailed =
+            report.measure("bucket.detailed", [&]() { return geometry.bucket(startDetailed, detailedColorStopping); });
+        const auto whole =
+            report.measure("bucket.whole", [&]() { return geometry.bucket(startTriangle, doNotStop); });
+        bucketFilled += base.size() + detailed.size() + whole.size();
+    }
+    report.setInfo("bucketFilledTriangles", std::to_string(bucketFilled));
+
+    // Export scene creation, without writing the files
+    pepr3d::ModelExporter exporter(&geometry, nullptr);
+    exporter.setExtrusionCoef(std::vector<float>(geometry.getColorManager().size(), 0.5f));
+
+    const std::vector<std::pair<std::string, pepr3d::ExportType>> exportTypes = {
+        {"Surface", pepr3d::ExportType::Surface},
+        {"NonPolySurface", pepr3d::ExportType::NonPolySurface},
+        {"NonPolyExtrusion", pepr3d::ExportType::NonPolyExtrusion},
+        {"PolyExtrusion", pepr3d::ExportType::PolyExtrusion}};
+    for(const auto& exportType : exportTypes) {
+        report.measure("export." + exportType.first, [&]() { exporter.createScenes(exportType.second); });
+    }
+
+    if(options.runSdf) {
+        report.measure("sdf", [&]() { geometry.computeSdfValues(); });
+        report.measure("export.PolyExtrusionWithSDF",
+                       [&]() { exporter.createScenes(pepr3d::ExportType::PolyExtrusionWithSDF); });
+    }
+
+    // Payload of a fill of the whole model as stored by CmdPaintSingleColor, and applying it at once
+    std::vector<size_t> wholeModel = geometry.bucket(0, doNotStop);
+    report.setInfo("paintVectorBytes", std::to_string(wholeModel.size() * sizeof(DetailedTriangleId)));
+    const pepr3d::DetailedTriangleSet paintSet =
+        report.measure("paint.set.build", [&]() { return pepr3d::DetailedTriangleSet(std::move(wholeModel)); });
+    report.setInfo("paintSetBytes", std::to_string(paintSet.getMemoryUsage()));
+    for(size_t i = 0; i < options.iterations; ++i) {
+        report.measure("paint.set.apply", [&]() { geometry.setTrianglesColor(paintSet, i % 2); });
+    }
+}
+
+#endif
@@ -5,31 +5,70 @@
 
 #include <CGAL/Sphere_3.h>
 #include <CGAL/Spherical_kernel_3.h>
+#include <CGAL/boost/graph/Euler_operations.h>
+#include <algorithm>
 #include <functional>
+#include <numeric>
 #include <set>
 #include <unordered_map>
+#include "geometry/CancellationToken.h"
 #include "geometry/SdfValuesException.h"
+#include "geometry/SurfaceMeshBuilder.h"
 
 namespace pepr3d {
 
-/* -------------------- Commands -------------------- */
+namespace {
+/// SDF property map that checks for cancellation of the current operation whenever CGAL stores a value
+struct CancellableSdfMap {
+    using key_type = PolyhedronData::face_descriptor;
+    using value_type = double;
+    using reference = double;
+    using category = boost::read_write_property_map_tag;
 
-Geometry::GeometryState Geometry::saveState() const {
-    // Save only necessary data to keep snapshot size low
-    std::vector<size_t> triangleColors;
-    triangleColors.reserve(mTriangles.size());
-    for(const DataTriangle& tri : mTriangles) {
-        triangleColors.push_back(tri.getColor());
+    mutable PolyhedronData::Mesh::Property_map<PolyhedronData::face_descriptor, double> map;
+
+    friend value_type get(const CancellableSdfMap& sdfMap, const key_type& face) {
+        return sdfMap.map[face];
     }
 
-    return GeometryState{triangleColors, mTriangleDetails, ColorManager::ColorMap(mColorManager.getColorMap())};
+    friend void put(const CancellableSdfMap& sdfMap, const key_type& face, const value_type value) {
+        CancellationToken::checkCurrent();
+        sdfMap.map[face] = value;
+    }
+};
+}  // namespace
+
+/* -------------------- Commands -------------------- */
+
+Geometry::GeometryState Geometry::saveState() const {
+    // Save only necessary data to keep snapshot size low, the details are shared until they are edited
+    return GeometryState{mTriangles.getColors(), mTriangleDetails,
+                         ColorManager::ColorMap(mColorManager.getColorMap())};
 }
 
 void Geometry::loadState(const GeometryState& state) {
     // mTriangles only possibly changes color
     P_ASSERT(mTriangles.size() == state.triangleColors.size());
-    for(size_t triIdx = 0; triIdx < mTriangles.size(); triIdx++) {
-        mTriangles[triIdx].setColor(state.triangleColors[triIdx]);
+    const std::vector<uint8_t>& colors = mTriangles.getColors();
+    for(size_t triangleIdx = 0; triangleIdx < colors.size(); ++triangleIdx) {
+        if(colors[triangleIdx] != state.triangleColors[triangleIdx]) {
+            markBucketColorChanged(triangleIdx);
+        }
+    }
+    mTriangles.setColors(state.triangleColors);
+
+    // Only triangles whose detail was replaced, created or removed since the snapshot need their detailed data updated
+    std::vector<size_t> changedDetails;
+    for(const auto& it : mTriangleDetails) {
+        const CopyOnWrite<TriangleDetail>* savedDetail = state.triangleDetails.find(it.first);
+        if(savedDetail == nullptr || !savedDetail->isSameValue(it.second)) {
+            changedDetails.push_back(it.first);
+        }
+    }
+    for(const auto& it : state.triangleDetails) {
+        if(!mTriangleDetails.contains(it.first)) {
+            changedDetails.push_back(it.first);
+        }
     }
     mTriangleDetails = state.triangleDetails;
 
@@ -41,8 +80,10 @@ void Geometry::loadState(const GeometryState& state) {
     mOgl.isDirty = true;
 
     // Tree is built from the original geometry, that is the same
-    P_ASSERT(mTree->size() == mTriangles.size());
-    invalidateTemporaryDetailedData();
+    P_ASSERT(mTree.size() == mTriangles.size());
+    for(const size_t triangleIdx : changedDetails) {
+        invalidateTemporaryDetailedData(triangleIdx);
+    }
 }
 
 /* -------------------- Mesh loading -------------------- */
@@ -55,22 +96,16 @@ void Geometry::recomputeFromData() {
 
     /// Async build the polyhedron data structure
     auto buildPolyhedronFuture = threadPool.enqueue([this]() {
-        P_ASSERT(!mPolyhedronData.vertices.empty());
-        P_ASSERT(!mPolyhedronData.indices.empty());
+        P_ASSERT(!mTriangles.empty());
         buildPolyhedron();
     });
 
-    /// Async build the AABB tree
+    /// Async build the tree for picking and brush queries, which also gives the new bounding box
     auto buildTreeFuture = threadPool.enqueue([this]() {
         mProgress->aabbTreePercentage = 0.0f;
 
         buildTree();
-        P_ASSERT(mTree->size() == mTriangles.size());
-
-        /// Get the new bounding box
-        if(!mTree->empty()) {
-            mBoundingBox = std::make_unique<BoundingBox>(mTree->bbox());
-        }
+        P_ASSERT(mTree.size() == mTriangles.size());
 
         mProgress->aabbTreePercentage = 1.0f;
     });
@@ -96,18 +131,21 @@ void Geometry::recomputeFromData() {
     generateTriangleBounds();
 
     /// Wait for building the polyhedron and tree
+    threadPool.wait(buildTreeFuture);
+    threadPool.wait(buildPolyhedronFuture);
     buildTreeFuture.get();
     buildPolyhedronFuture.get();
 }
 
 void Geometry::buildTree() {
-    mTree = std::make_unique<Tree>();
-
-    for(size_t triIdx = 0; triIdx < mTriangles.size(); triIdx++) {
-        mTree->insert(DataTriangleAABBPrimitive(this, DetailedTriangleId(triIdx)));
+    std::vector<TriangleBvh::Triangle> triangles;
+    triangles.reserve(mTriangles.size());
+    for(size_t triIdx = 0; triIdx < mTriangles.size(); ++triIdx) {
+        triangles.push_back(
+            {mTriangles.getVertex(triIdx, 0), mTriangles.getVertex(triIdx, 1), mTriangles.getVertex(triIdx, 2)});
     }
 
-    mTree->build();
+    mTree.build(triangles, &getThreadPool());
 }
 
 void Geometry::loadNewGeometry(const std::string& fileName) {
@@ -115,17 +153,13 @@ void Geometry::loadNewGeometry(const std::string& fileName) {
     mProgress->resetLoad();
 
     /// Import the object via Assimp
-    ModelImporter modelImporter(fileName, mProgress.get(), MainApplication::getThreadPool());  // only first mesh [0]
+    ModelImporter modelImporter(fileName, mProgress.get(), MainApplication::getThreadPool(),
+                                mVertexWeldTolerance);  // only first mesh [0]
 
     if(modelImporter.isModelLoaded()) {
-        /// Fill triangle data to compute AABB
-        mTriangles = modelImporter.getTriangles();
-
-        /// Fill Polyhedron data to compute SurfaceMesh
-        mPolyhedronData.vertices.clear();
-        mPolyhedronData.indices.clear();
-        mPolyhedronData.vertices = modelImporter.getVertexBuffer();
-        mPolyhedronData.indices = modelImporter.getIndexBuffer();
+        /// Index the triangles by the joined vertices, the triangle soup is only needed for the normals and colors
+        mTriangles = IndexedTriangles(modelImporter.takeVertexBuffer(), modelImporter.takeIndexBuffer(),
+                                      modelImporter.takeTriangles());
 
         /// Get the generated color palette of the model, replace the current one
         mColorManager = modelImporter.getColorManager();
@@ -139,17 +173,226 @@ void Geometry::loadNewGeometry(const std::string& fileName) {
     }
 }
 
+namespace {
+/// Minimal number of triangles in a detail slot
+const size_t DETAIL_SLOT_MIN_CAPACITY = 4;
+
+/// Minimal number of vertices added to the buffers when they run out of space for detail slots
+const size_t DETAIL_SLOTS_MIN_GROWTH = 3 * 1024;
+
+/// Updated ranges closer than this number of vertices are uploaded as a single range
+const size_t UPDATED_RANGES_MERGE_DISTANCE = 3 * 64;
+
+/// Batched color changes touching more ranges than this upload the whole color buffer instead
+const size_t MAX_COLOR_UPDATE_RANGES = 256;
+
+/// Number of bucket criteria whose components are cached, e.g. while trying out thresholds of the normal stopping
+const size_t MAX_BUCKET_CRITERIA = 4;
+
+/// Slot capacities are powers of two, so that freed slots can be reused by details of similar size
+size_t getDetailSlotCapacity(size_t triangleCount) {
+    size_t capacity = DETAIL_SLOT_MIN_CAPACITY;
+    while(capacity < triangleCount) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/// Faces across the three edges of the face, null_face on a border
+std::array<PolyhedronData::face_descriptor, 3> getNeighbourFaces(const PolyhedronData::Mesh& mesh,
+                                                                 const PolyhedronData::face_descriptor face) {
+    std::array<PolyhedronData::face_descriptor, 3> neighbours;
+    const auto edge = mesh.halfedge(face);
+    auto itEdge = edge;
+
+    for(int i = 0; i < 3; ++i) {
+        const auto oppositeEdge = mesh.opposite(itEdge);
+        if(oppositeEdge.is_valid() && !mesh.is_border(oppositeEdge)) {
+            neighbours[i] = mesh.face(oppositeEdge);
+        } else {
+            neighbours[i] = PolyhedronData::Mesh::null_face();
+        }
+
+        itEdge = mesh.next(itEdge);
+    }
+    P_ASSERT(edge == itEdge);
+
+    return neighbours;
+}
+}  // namespace
+
+void Geometry::updateOpenGlBuffers() {
+    P_ASSERT(mOgl.needsUpdate());  // Called unnecessarily. Most likely by error.
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    if(mOgl.isDirty) {
+        generateVertexBuffer();
+        generateIndexBuffer();
+        generateColorBuffer();
+        generateNormalBuffer();
+        generateHighlightBuffer();
+
+        mOgl.isDirty = false;
+        mOgl.dirtyTriangles.clear();
+        mOgl.info.didColorUpdate = false;
+        mOgl.info.didHighlightUpdate = false;
+        mOgl.info.updatedRanges.clear();
+        mOgl.info.didResize = true;
+    } else {
+        updateDirtyTriangleBuffers();
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> timeMs = end - start;
+
+    CI_LOG_I("Generating buffers took " + std::to_string(timeMs.count()) + " ms");
+}
+
+void Geometry::allocateDetailSlots() {
+    mTriangleDetailSlots.clear();
+    mFreeDetailSlots.clear();
+    mDetailSlotsEnd = 3 * mTriangles.size();
+
+    for(const auto& it : mTriangleDetails) {
+        const size_t capacity = getDetailSlotCapacity(it.second->getTriangles().size());
+        mTriangleDetailSlots.emplace(it.first, DetailSlot{mDetailSlotsEnd, capacity});
+        mDetailSlotsEnd += 3 * capacity;
+    }
+}
+
+Geometry::DetailSlot Geometry::allocateDetailSlot(const size_t triangleCount) {
+    const size_t capacity = getDetailSlotCapacity(triangleCount);
+
+    auto freeIt = mFreeDetailSlots.find(capacity);
+    if(freeIt != mFreeDetailSlots.end() && !freeIt->second.empty()) {
+        const DetailSlot slot{freeIt->second.back(), capacity};
+        freeIt->second.pop_back();
+        return slot;
+    }
+
+    const DetailSlot slot{mDetailSlotsEnd, capacity};
+    mDetailSlotsEnd += 3 * capacity;
+
+    if(mDetailSlotsEnd > mOgl.vertexBuffer.size()) {
+        // Grow geometrically to avoid re-creating the whole OpenGL buffers on each new slot
+        const size_t detailRegionSize = mDetailSlotsEnd - 3 * mTriangles.size();
+        resizeBuffers(mDetailSlotsEnd + std::max(DETAIL_SLOTS_MIN_GROWTH, detailRegionSize / 2));
+    }
+
+    return slot;
+}
+
+void Geometry::resizeBuffers(const size_t vertexCount) {
+    P_ASSERT(vertexCount >= mOgl.vertexBuffer.size());
+
+    mOgl.vertexBuffer.resize(vertexCount, glm::vec3{0, 0, 0});
+    mOgl.colorBuffer.resize(vertexCount, 0);
+    mOgl.normalBuffer.resize(vertexCount, glm::vec3{0, 0, 0});
+    mOgl.highlightMask.resize(vertexCount, 0);
+    generateIndexBuffer();
+
+    mOgl.info.didResize = true;
+}
+
+void Geometry::writeTriangleBuffers(const size_t triangleIdx) {
+    const glm::vec3 normal = mTriangles.getNormal(triangleIdx);
+    const GLint highlight = getHighlightValue(triangleIdx);
+    const size_t basePosition = 3 * triangleIdx;
+    const bool isSimple = isSimpleTriangle(triangleIdx);
+
+    for(size_t i = 0; i < 3; ++i) {
+        // Pass dummy triangle for triangles with detail to keep triangleIdx consistent with array position
+        mOgl.vertexBuffer[basePosition + i] = isSimple ? mTriangles.getVertex(triangleIdx, i) : glm::vec3{0, 0, 0};
+        mOgl.colorBuffer[basePosition + i] = static_cast<ColorIndex>(mTriangles.getColor(triangleIdx));
+        mOgl.normalBuffer[basePosition + i] = normal;
+        mOgl.highlightMask[basePosition + i] = highlight;
+    }
+
+    if(isSimple) {
+        return;
+    }
+
+    const DetailSlot& slot = mTriangleDetailSlots.at(triangleIdx);
+    const auto& detailTriangles = mTriangleDetails.at(triangleIdx)->getTriangles();
+    P_ASSERT(detailTriangles.size() <= slot.capacity);
+
+    for(size_t detailIdx = 0; detailIdx < slot.capacity; ++detailIdx) {
+        const size_t position = slot.start + 3 * detailIdx;
+        const bool isUsed = detailIdx < detailTriangles.size();
+        for(int i = 0; i < 3; ++i) {
+            mOgl.vertexBuffer[position + i] = isUsed ? detailTriangles[detailIdx].getVertex(i) : glm::vec3{0, 0, 0};
+            mOgl.colorBuffer[position + i] =
+                isUsed ? static_cast<ColorIndex>(detailTriangles[detailIdx].getColor()) : ColorIndex{0};
+            mOgl.normalBuffer[position + i] = normal;
+            mOgl.highlightMask[position + i] = highlight;
+        }
+    }
+}
+
+void Geometry::updateDirtyTriangleBuffers() {
+    P_ASSERT(mOgl.highlightMask.size() == mOgl.vertexBuffer.size());
+    std::vector<OpenGlData::VertexRange>& ranges = mOgl.info.updatedRanges;
+
+    for(const size_t triangleIdx : mOgl.dirtyTriangles) {
+        P_ASSERT(triangleIdx < mTriangles.size());
+        ranges.push_back({3 * triangleIdx, 3 * triangleIdx + 3});
+
+        const size_t detailCount = getTriangleDetailCount(triangleIdx);
+        const DetailSlot* currentSlot = mTriangleDetailSlots.find(triangleIdx);
+
+        // Release the slot if the detail was removed or does not fit anymore
+        if(currentSlot != nullptr && (detailCount == 0 || currentSlot->capacity < detailCount)) {
+            const DetailSlot slot = *currentSlot;
+            const size_t slotEnd = slot.start + 3 * slot.capacity;
+            std::fill(mOgl.vertexBuffer.begin() + slot.start, mOgl.vertexBuffer.begin() + slotEnd, glm::vec3{0, 0, 0});
+            ranges.push_back({slot.start, slotEnd});
+
+            mFreeDetailSlots[slot.capacity].push_back(slot.start);
+            mTriangleDetailSlots.erase(triangleIdx);
+            currentSlot = nullptr;
+        }
+
+        if(detailCount > 0) {
+            if(currentSlot == nullptr) {
+                currentSlot = mTriangleDetailSlots.emplace(triangleIdx, allocateDetailSlot(detailCount)).first;
+            }
+            ranges.push_back({currentSlot->start, currentSlot->start + 3 * currentSlot->capacity});
+        }
+
+        writeTriangleBuffers(triangleIdx);
+    }
+    mOgl.dirtyTriangles.clear();
+    mergeVertexRanges(ranges);
+}
+
+void Geometry::mergeVertexRanges(std::vector<OpenGlData::VertexRange>& ranges) {
+    // Sort and merge close ranges to upload them with as few calls as possible
+    std::sort(ranges.begin(), ranges.end(),
+              [](const OpenGlData::VertexRange& a, const OpenGlData::VertexRange& b) { return a.begin < b.begin; });
+    std::vector<OpenGlData::VertexRange> mergedRanges;
+    for(const OpenGlData::VertexRange& range : ranges) {
+        if(!mergedRanges.empty() && range.begin <= mergedRanges.back().end + UPDATED_RANGES_MERGE_DISTANCE) {
+            mergedRanges.back().end = std::max(mergedRanges.back().end, range.end);
+        } else {
+            mergedRanges.push_back(range);
+        }
+    }
+    ranges = std::move(mergedRanges);
+}
+
 void Geometry::generateVertexBuffer() {
+    // Vertex buffer defines the layout of all the other buffers
+    allocateDetailSlots();
+
     mOgl.vertexBuffer.clear();
-    mOgl.vertexBuffer.reserve(3 * mTriangles.size());
+    mOgl.vertexBuffer.reserve(mDetailSlotsEnd);
 
     for(size_t idx = 0; idx < mTriangles.size(); ++idx) {
-        const auto& triangle = mTriangles[idx];
-
         if(isSimpleTriangle(idx)) {
-            mOgl.vertexBuffer.push_back(triangle.getVertex(0));
-            mOgl.vertexBuffer.push_back(triangle.getVertex(1));
-            mOgl.vertexBuffer.push_back(triangle.getVertex(2));
+            mOgl.vertexBuffer.push_back(mTriangles.getVertex(idx, 0));
+            mOgl.vertexBuffer.push_back(mTriangles.getVertex(idx, 1));
+            mOgl.vertexBuffer.push_back(mTriangles.getVertex(idx, 2));
         } else {
             // Pass dummy triangle to keep triangleIdx consistent with array position
             mOgl.vertexBuffer.push_back(glm::vec3{0, 0, 0});
@@ -158,13 +401,16 @@ void Geometry::generateVertexBuffer() {
         }
     }
 
-    for(auto& it : mTriangleDetails) {
-        const auto& detailTriangles = it.second.getTriangles();
+    // Unused space of the slots is filled with degenerate triangles
+    mOgl.vertexBuffer.resize(mDetailSlotsEnd, glm::vec3{0, 0, 0});
+    for(const auto& it : mTriangleDetails) {
+        const auto& detailTriangles = it.second->getTriangles();
+        size_t position = mTriangleDetailSlots.at(it.first).start;
 
         for(const auto& triangle : detailTriangles) {
-            mOgl.vertexBuffer.push_back(triangle.getVertex(0));
-            mOgl.vertexBuffer.push_back(triangle.getVertex(1));
-            mOgl.vertexBuffer.push_back(triangle.getVertex(2));
+            mOgl.vertexBuffer[position++] = triangle.getVertex(0);
+            mOgl.vertexBuffer[position++] = triangle.getVertex(1);
+            mOgl.vertexBuffer[position++] = triangle.getVertex(2);
         }
     }
 }
@@ -181,25 +427,24 @@ void Geometry::generateIndexBuffer() {
 void Geometry::generateColorBuffer() {
     mOgl.colorBuffer.clear();
     mOgl.colorBuffer.reserve(mOgl.vertexBuffer.size());
-    mTriangleDetailColorBufferStart.clear();
 
     for(size_t idx = 0; idx < mTriangles.size(); ++idx) {
-        const auto& triangle = mTriangles[idx];
-        const ColorIndex triColorIndex = static_cast<ColorIndex>(triangle.getColor());
+        const ColorIndex triColorIndex = static_cast<ColorIndex>(mTriangles.getColor(idx));
         mOgl.colorBuffer.push_back(triColorIndex);
         mOgl.colorBuffer.push_back(triColorIndex);
         mOgl.colorBuffer.push_back(triColorIndex);
     }
 
-    for(auto& it : mTriangleDetails) {
-        const auto& detailTriangles = it.second.getTriangles();
+    mOgl.colorBuffer.resize(mOgl.vertexBuffer.size(), 0);
+    for(const auto& it : mTriangleDetails) {
+        const auto& detailTriangles = it.second->getTriangles();
+        size_t position = mTriangleDetailSlots.at(it.first).start;
 
-        mTriangleDetailColorBufferStart[it.first] = mOgl.colorBuffer.size();
         for(const auto& triangle : detailTriangles) {
             const ColorIndex triColorIndex = static_cast<ColorIndex>(triangle.getColor());
-            mOgl.colorBuffer.push_back(triColorIndex);
-            mOgl.colorBuffer.push_back(triColorIndex);
-            mOgl.colorBuffer.push_back(triColorIndex);
+            mOgl.colorBuffer[position++] = triColorIndex;
+            mOgl.colorBuffer[position++] = triColorIndex;
+            mOgl.colorBuffer[position++] = triColorIndex;
         }
     }
 
@@ -210,64 +455,39 @@ void Geometry::generateNormalBuffer() {
     mOgl.normalBuffer.clear();
     mOgl.normalBuffer.reserve(mOgl.vertexBuffer.size());
     for(size_t idx = 0; idx < mTriangles.size(); ++idx) {
-        const auto& triangle = mTriangles[idx];
-        mOgl.normalBuffer.push_back(triangle.getNormal());
-        mOgl.normalBuffer.push_back(triangle.getNormal());
-        mOgl.normalBuffer.push_back(triangle.getNormal());
+        const glm::vec3 normal = mTriangles.getNormal(idx);
+        mOgl.normalBuffer.push_back(normal);
+        mOgl.normalBuffer.push_back(normal);
+        mOgl.normalBuffer.push_back(normal);
     }
 
-    for(auto& it : mTriangleDetails) {
-        const auto& detailTriangles = it.second.getTriangles();
-        glm::vec3 normal = it.second.getOriginal().getNormal();
-
-        for(const auto& triangle : detailTriangles) {
-            mOgl.normalBuffer.push_back(normal);
-            mOgl.normalBuffer.push_back(normal);
-            mOgl.normalBuffer.push_back(normal);
-        }
+    mOgl.normalBuffer.resize(mOgl.vertexBuffer.size(), glm::vec3{0, 0, 0});
+    for(const auto& it : mTriangleDetailSlots) {
+        const glm::vec3 normal = mTriangles.getNormal(it.first);
+        const size_t slotEnd = it.second.start + 3 * it.second.capacity;
+        std::fill(mOgl.normalBuffer.begin() + it.second.start, mOgl.normalBuffer.begin() + slotEnd, normal);
     }
     P_ASSERT(mOgl.normalBuffer.size() == mOgl.vertexBuffer.size());
 }
 
 void Geometry::generateHighlightBuffer() {
-    std::set<size_t>& paintSet = mAreaHighlight.triangles;
-    const BrushSettings& settings = mAreaHighlight.settings;
-
     mOgl.highlightMask.clear();
     // Mark all triangles with attribute assigned to vertex
-    mOgl.highlightMask.reserve(mTriangles.size() * 3);
+    mOgl.highlightMask.reserve(mOgl.vertexBuffer.size());
     for(size_t triangleIdx = 0; triangleIdx < mTriangles.size(); triangleIdx++) {
         // Fill 3 vertices of a triangle
-        if(settings.continuous && paintSet.find(triangleIdx) == paintSet.end()) {
-            mOgl.highlightMask.emplace_back(0);
-            mOgl.highlightMask.emplace_back(0);
-            mOgl.highlightMask.emplace_back(0);
-
-        } else {
-            mOgl.highlightMask.emplace_back(1);
-            mOgl.highlightMask.emplace_back(1);
-            mOgl.highlightMask.emplace_back(1);
-        }
+        const GLint highlight = getHighlightValue(triangleIdx);
+        mOgl.highlightMask.emplace_back(highlight);
+        mOgl.highlightMask.emplace_back(highlight);
+        mOgl.highlightMask.emplace_back(highlight);
     }
 
     // If the original triangle has highlight enabled also enable for detail
-    for(auto& it : mTriangleDetails) {
-        const size_t triangleIdx = it.first;
-        const auto& detailTriangles = it.second.getTriangles();
-
-        const bool enableHighlight = !settings.continuous || paintSet.find(triangleIdx) != paintSet.end();
-
-        for(const auto& triangle : detailTriangles) {
-            if(enableHighlight) {
-                mOgl.highlightMask.emplace_back(1);
-                mOgl.highlightMask.emplace_back(1);
-                mOgl.highlightMask.emplace_back(1);
-            } else {
-                mOgl.highlightMask.emplace_back(0);
-                mOgl.highlightMask.emplace_back(0);
-                mOgl.highlightMask.emplace_back(0);
-            }
-        }
+    mOgl.highlightMask.resize(mOgl.vertexBuffer.size(), 0);
+    for(const auto& it : mTriangleDetailSlots) {
+        const size_t slotEnd = it.second.start + 3 * it.second.capacity;
+        std::fill(mOgl.highlightMask.begin() + it.second.start, mOgl.highlightMask.begin() + slotEnd,
+                  getHighlightValue(it.first));
     }
 
     P_ASSERT(mOgl.highlightMask.size() == mOgl.vertexBuffer.size());
@@ -276,125 +496,148 @@ void Geometry::generateHighlightBuffer() {
 }
 
 void Geometry::generateTriangleBounds() {
-    mTriangleBounds.clear();
-    for(const DataTriangle& dataTri : mTriangles) {
-        const auto& tri = dataTri.getTri();
-        mTriangleBounds.push_back(GeometryUtils::getBoundingSphere(tri));
+    std::vector<glm::dvec3> centers;
+    std::vector<double> radii;
+    centers.reserve(mTriangles.size());
+    radii.reserve(mTriangles.size());
+    for(size_t idx = 0; idx < mTriangles.size(); ++idx) {
+        const std::pair<Point3, double> bound = GeometryUtils::getBoundingSphere(mTriangles.getTriangle(idx).getTri());
+        centers.emplace_back(bound.first.x(), bound.first.y(), bound.first.z());
+        radii.push_back(bound.second);
     }
-}
 
-/* -------------------- Tool support -------------------- */
+    mTriangleBounds.assign(centers, radii);
+}
 
-std::optional<size_t> Geometry::intersectMesh(const ci::Ray& ray) const {
-    if(mTree->empty()) {
-        return {};
-    }
+SphereBounds::Query Geometry::makeBoundsQuery(const Point3& point, double radius) const {
+    return mTriangleBounds.makePointQuery(glm::dvec3(point.x(), point.y(), point.z()), radius);
+}
 
-    const glm::vec3 source = ray.getOrigin();
-    const glm::vec3 direction = ray.getDirection();
+SphereBounds::Query Geometry::makeBoundsQuery(const Line3& line, double radius) const {
+    const Point3 linePoint = line.point();
+    const Vector3 lineDirection = line.to_vector();
+    return mTriangleBounds.makeLineQuery(glm::dvec3(linePoint.x(), linePoint.y(), linePoint.z()),
+                                         glm::dvec3(lineDirection.x(), lineDirection.y(), lineDirection.z()), radius);
+}
 
-    const pepr3d::Geometry::Ray rayQuery(pepr3d::DataTriangle::Point(source.x, source.y, source.z),
-                                         pepr3d::Geometry::Direction(direction.x, direction.y, direction.z));
+std::vector<size_t> Geometry::queryTree(const Point3& point, double radius) const {
+    const glm::vec3 center(static_cast<float>(point.x()), static_cast<float>(point.y()), static_cast<float>(point.z()));
+    return mTree.querySphere(center, static_cast<float>(radius));
+}
 
-    // Find the two intersection parameters - place and triangle
-    Ray_intersection intersection = mTree->first_intersection(rayQuery);
-    if(intersection) {
-        // The intersected triangle
-        const DetailedTriangleId triangleId = boost::get<DataTriangleAABBPrimitive::Id>(intersection->second).second;
+std::vector<size_t> Geometry::queryTree(const Line3& line, double radius) const {
+    const Point3 linePoint = line.point();
+    const Vector3 lineDirection = line.to_vector();
+    return mTree.queryLine(glm::dvec3(linePoint.x(), linePoint.y(), linePoint.z()),
+                           glm::dvec3(lineDirection.x(), lineDirection.y(), lineDirection.z()),
+                           static_cast<float>(radius));
+}
 
-        P_ASSERT(triangleId.getBaseId() < mTriangles.size());
-        P_ASSERT(!triangleId.getDetailId());  // We are intersecting base mesh, there should be no detail
+/* -------------------- Tool support -------------------- */
 
-        return triangleId.getBaseId();
+std::optional<size_t> Geometry::intersectMesh(const ci::Ray& ray) const {
+    const std::optional<TriangleBvh::Hit> hit = mTree.firstIntersection(ray.getOrigin(), ray.getDirection());
+    if(!hit) {
+        /// No intersection detected.
+        return {};
     }
 
-    /// No intersection detected.
-    return {};
+    P_ASSERT(hit->triangle < mTriangles.size());
+    return hit->triangle;
 }
 
 std::optional<size_t> Geometry::intersectMesh(const ci::Ray& ray, glm::vec3& outPos) const {
-    auto intersection = intersectMesh(ray);
-
-    if(intersection) {
-        // Calculate intersection point of the ray with the triangle
-        const DataTriangle& tri = getTriangle(*intersection);
-
-        auto intersectionPoint = GeometryUtils::triangleRayIntersection(tri, ray);
-
-        if(intersectionPoint)
-            outPos = *intersectionPoint;
+    const std::optional<TriangleBvh::Hit> hit = mTree.firstIntersection(ray.getOrigin(), ray.getDirection());
+    if(!hit) {
+        return {};
     }
 
-    return intersection;
+    P_ASSERT(hit->triangle < mTriangles.size());
+    outPos = ray.calcPosition(hit->distance);
+    return hit->triangle;
 }
 
 std::optional<DetailedTriangleId> Geometry::intersectDetailedMesh(const ci::Ray& ray) {
-    if(mTree->empty()) {
+    if(mTree.empty()) {
         return {};
     }
 
+    // Detail IDs have to match the detailed mesh, which corrects the shared vertices of details
     if(!isTemporaryDetailedDataValid()) {
         updateTemporaryDetailedData();
-        P_ASSERT(mTreeDetailed);
     }
 
-    const glm::vec3 source = ray.getOrigin();
+    const glm::vec3 origin = ray.getOrigin();
     const glm::vec3 direction = ray.getDirection();
 
-    const pepr3d::Geometry::Ray rayQuery(pepr3d::DataTriangle::Point(source.x, source.y, source.z),
-                                         pepr3d::Geometry::Direction(direction.x, direction.y, direction.z));
-
-    // Find the two intersection parameters - place and triangle
-    Ray_intersection intersection = mTreeDetailed->first_intersection(rayQuery);
-    if(intersection) {
-        // The intersected triangle
-        const DetailedTriangleId triangleId = boost::get<DataTriangleAABBPrimitive::Id>(intersection->second).second;
-
-        P_ASSERT(triangleId.getBaseId() < mTriangles.size());
-        P_ASSERT(!(triangleId.getDetailId() && isSimpleTriangle(triangleId.getBaseId())));
+    // Find the base triangle first, its details cover exactly the same area
+    const std::optional<TriangleBvh::Hit> hit = mTree.firstIntersection(origin, direction);
+    if(!hit) {
+        /// No intersection detected.
+        return {};
+    }
 
-        if(!isSimpleTriangle(triangleId.getBaseId())) {
-            P_ASSERT(triangleId.getDetailId());
-            P_ASSERT(triangleId.getDetailId() < getTriangleDetailCount(triangleId.getBaseId()));
-        }
+    const size_t baseId = hit->triangle;
+    P_ASSERT(baseId < mTriangles.size());
+    if(isSimpleTriangle(baseId)) {
+        return DetailedTriangleId(baseId);
+    }
 
-        return triangleId;
+    const TriangleBvh& detailTree = getDetailTree(baseId);
+    size_t detailId;
+    const std::optional<TriangleBvh::Hit> detailHit = detailTree.firstIntersection(origin, direction);
+    if(detailHit) {
+        detailId = detailHit->triangle;
+    } else {
+        // The ray passed through a rounding gap between the details, take the detail closest to the base hit
+        detailId = detailTree.findClosest(ray.calcPosition(hit->distance));
     }
 
-    /// No intersection detected.
-    return {};
+    P_ASSERT(detailId < getTriangleDetailCount(baseId));
+    return DetailedTriangleId(baseId, detailId);
 }
 
 std::vector<size_t> Geometry::getTrianglesUnderBrush(const glm::vec3& originPoint, const glm::vec3& insideDirection,
                                                      size_t startTriangle, const struct BrushSettings& settings) {
+    return getTrianglesUnderBrush(originPoint, originPoint, insideDirection, {startTriangle}, settings);
+}
+
+std::vector<size_t> Geometry::getTrianglesUnderBrush(const glm::vec3& start, const glm::vec3& end,
+                                                     const glm::vec3& insideDirection,
+                                                     const std::vector<size_t>& startTriangles,
+                                                     const struct BrushSettings& settings) {
     const double sizeSquared = settings.size * settings.size;
 
+    // Sphere around the whole swept brush
+    const glm::vec3 center = (start + end) * 0.5f;
+    const float boundsRadius = settings.size + glm::distance(start, end) * 0.5f;
+    const SphereBounds::Query brushQuery = makeBoundsQuery(Point3(center.x, center.y, center.z), boundsRadius);
+
     /// Stop when the triangle has no intersection with the area highlight
-    auto stoppingCriterionSingleTri = [this, originPoint, sizeSquared, insideDirection, startTriangle,
-                                       settings](const size_t triId) -> bool {
-        // Always accept the first triangle
-        if(triId == startTriangle)
+    auto stoppingCriterionSingleTri = [this, start, end, sizeSquared, insideDirection, &startTriangles, settings,
+                                       &brushQuery](const size_t triId) -> bool {
+        // Always accept the first triangles
+        if(std::find(startTriangles.begin(), startTriangles.end(), triId) != startTriangles.end())
             return true;
 
-        const auto& tri = getTriangle(triId);
-        const auto a = tri.getVertex(0);
-        const auto b = tri.getVertex(1);
-        const auto c = tri.getVertex(2);
+        const auto a = mTriangles.getVertex(triId, 0);
+        const auto b = mTriangles.getVertex(triId, 1);
+        const auto c = mTriangles.getVertex(triId, 2);
 
-        if(!settings.paintBackfaces && glm::dot(tri.getNormal(), insideDirection) > 0.f)
+        if(!settings.paintBackfaces && glm::dot(mTriangles.getNormal(triId), insideDirection) > 0.f)
             return false;  // stop on triangles facing away from the ray
 
         // If triangle's bounding sphere is out of range no need to test further
-        if(!isTriangleInRadius(Point3(originPoint.x, originPoint.y, originPoint.z), settings.size, triId)) {
+        if(!mTriangleBounds.test(brushQuery, triId)) {
             return false;
         }
 
         // If any side has intersection with the brush keep the triangle
-        if(GeometryUtils::segmentPointDistanceSquared(a, b, originPoint) < sizeSquared)
+        if(GeometryUtils::segmentsDistanceSquared(a, b, start, end) < sizeSquared)
             return true;
-        if(GeometryUtils::segmentPointDistanceSquared(b, c, originPoint) < sizeSquared)
+        if(GeometryUtils::segmentsDistanceSquared(b, c, start, end) < sizeSquared)
             return true;
-        if(GeometryUtils::segmentPointDistanceSquared(c, a, originPoint) < sizeSquared)
+        if(GeometryUtils::segmentsDistanceSquared(c, a, start, end) < sizeSquared)
             return true;
 
         return false;
@@ -405,10 +648,9 @@ std::vector<size_t> Geometry::getTrianglesUnderBrush(const glm::vec3& originPoin
     };
 
     if(settings.continuous) {
-        return bucket(startTriangle, stoppingCriterion);
+        return bucket(startTriangles, stoppingCriterion);
     } else {
-        std::vector<size_t> trianglesInRadius =
-            getTrianglesInRadius(Point3(originPoint.x, originPoint.y, originPoint.z), settings.size);
+        std::vector<size_t> trianglesInRadius = mTree.querySphere(center, boundsRadius);
 
         std::vector<size_t> result;
         std::copy_if(trianglesInRadius.begin(), trianglesInRadius.end(), std::back_inserter(result),
@@ -454,41 +696,50 @@ void Geometry::highlightArea(const ci::Ray& ray, const BrushSettings& settings)
 }
 
 void Geometry::paintWithShape(const ci::Ray& ray, const std::vector<Point3>& shape, size_t color, bool paintBackfaces) {
-    const std::pair<Point3, double> shapeBounds = GeometryUtils::getBoundingSphere(shape);
     const auto rd = ray.getDirection();
-    const Line3 rayLine(shapeBounds.first, Vector3(rd.x, rd.y, rd.z));
-
-    std::vector<size_t> trianglesInCylinder = getTrianglesInRadius(rayLine, shapeBounds.second);
+    paintWithShapes({TriangleDetail::ProjectedShape{shape, Vector3(rd.x, rd.y, rd.z)}}, color, paintBackfaces);
+}
 
-    // Gather all the TriangleDetails that we want to update
-    std::vector<size_t> detailsToUpdate;
-    for(size_t triIdx : trianglesInCylinder) {
-        const auto& cgalTri = getTriangle(triIdx).getTri();
+void Geometry::paintWithShapes(const std::vector<TriangleDetail::ProjectedShape>& shapes, size_t color,
+                               bool paintBackfaces) {
+    // Shapes over each TriangleDetail that we want to update, in the order of the stroke
+    std::map<size_t, std::vector<const TriangleDetail::ProjectedShape*>> shapesOfTriangles;
+    for(const TriangleDetail::ProjectedShape& shape : shapes) {
+        const std::pair<Point3, double> shapeBounds = GeometryUtils::getBoundingSphere(shape.shape);
+        const Line3 rayLine(shapeBounds.first, shape.direction);
+        const glm::vec3 rd(shape.direction.x(), shape.direction.y(), shape.direction.z());
+
+        for(size_t triIdx : getTrianglesInRadius(rayLine, shapeBounds.second)) {
+            if(glm::dot(rd, mTriangles.getNormal(triIdx)) > 0 && !paintBackfaces) {
+                continue;  // Skip triangles facing away
+            }
 
-        if(glm::dot(rd, getTriangle(triIdx).getNormal()) > 0 && !paintBackfaces) {
-            continue;  // Skip triangles facing away
-        }
+            if(isSimpleTriangle(triIdx) && getTriangleColor(triIdx) == color) {
+                continue;  // Do not paint simple triangles of the same color
+            }
 
-        if(isSimpleTriangle(triIdx) && getTriangleColor(triIdx) == color) {
-            continue;  // Do not paint simple triangles of the same color
+            shapesOfTriangles[triIdx].push_back(&shape);
         }
-
-        detailsToUpdate.emplace_back(triIdx);
-        getTriangleDetail(triIdx);  // Make sure triangle detail is created
     }
 
-    if(!detailsToUpdate.empty()) {
-        invalidateTemporaryDetailedData();
+    std::vector<size_t> detailsToUpdate;
+    detailsToUpdate.reserve(shapesOfTriangles.size());
+    for(const auto& it : shapesOfTriangles) {
+        detailsToUpdate.emplace_back(it.first);
+        getTriangleDetail(it.first);  // Make sure triangle detail is created
     }
 
     // Update in parallel
     auto& threadPool = MainApplication::getThreadPool();
     threadPool.parallel_for(detailsToUpdate.begin(), detailsToUpdate.end(),
-                            [this, &shape, color, &rayLine](size_t triIdx) {
-                                getTriangleDetail(triIdx)->paintShape(shape, rayLine.direction().vector(), color);
+                            [this, &shapesOfTriangles, color](size_t triIdx) {
+                                getTriangleDetail(triIdx)->paintShapes(shapesOfTriangles.at(triIdx), color);
                             });
 
-    mOgl.isDirty = true;
+    for(const size_t triIdx : detailsToUpdate) {
+        markTriangleBuffersDirty(triIdx);
+        invalidateTemporaryDetailedData(triIdx);
+    }
 }
 
 void Geometry::paintWithShape(const ci::Ray& ray, const std::vector<DataTriangle::Triangle>& triangles, size_t color) {
@@ -507,9 +758,7 @@ void Geometry::paintWithShape(const ci::Ray& ray, const std::vector<DataTriangle
     // Gather all the TriangleDetails that we want to update
     std::vector<size_t> detailsToUpdate;
     for(size_t triIdx : trianglesInCylinder) {
-        const auto& cgalTri = getTriangle(triIdx).getTri();
-
-        if(glm::dot(rd, getTriangle(triIdx).getNormal()) >= 0) {
+        if(glm::dot(rd, mTriangles.getNormal(triIdx)) >= 0) {
             continue;  // Skip triangles facing away
         }
 
@@ -521,10 +770,6 @@ void Geometry::paintWithShape(const ci::Ray& ray, const std::vector<DataTriangle
         getTriangleDetail(triIdx);  // Make sure triangle detail is created
     }
     CI_LOG_I(std::string("Triangles to paint: ") + std::to_string(detailsToUpdate.size()));
-    if(!detailsToUpdate.empty()) {
-        invalidateTemporaryDetailedData();
-    }
-
     // Update in parallel
     try {
         auto& threadPool = MainApplication::getThreadPool();
@@ -538,76 +783,115 @@ void Geometry::paintWithShape(const ci::Ray& ray, const std::vector<DataTriangle
         throw;
     }
 
-    mOgl.isDirty = true;
+    for(const size_t triIdx : detailsToUpdate) {
+        markTriangleBuffersDirty(triIdx);
+        invalidateTemporaryDetailedData(triIdx);
+    }
 }
 
 void Geometry::paintAreaWithSphere(const ci::Ray& ray, const BrushSettings& settings) {
-    glm::vec3 intersectionPoint{};
-    auto intersectedTri = intersectMesh(ray, intersectionPoint);
+    paintAreaWithSpheres({ray}, settings);
+}
 
-    if(!intersectedTri) {
-        return;
+void Geometry::paintAreaWithSpheres(const std::vector<ci::Ray>& rays, const BrushSettings& settings) {
+    std::vector<BrushSweep> dabs;
+    dabs.reserve(rays.size());
+    for(const ci::Ray& ray : rays) {
+        dabs.push_back({std::nullopt, ray});
     }
+    paintAreaWithSweeps(dabs, settings);
+}
 
-    const auto trisInBrush = getTrianglesUnderBrush(intersectionPoint, ray.getDirection(), *intersectedTri, settings);
+void Geometry::paintAreaWithSweeps(const std::vector<BrushSweep>& sweeps, const BrushSettings& settings) {
+    // Capsules over each TriangleDetail that we want to update, in the order of the stroke
+    std::map<size_t, std::vector<TriangleDetail::Capsule>> capsulesOfTriangles;
 
-    std::vector<size_t> detailsToUpdate;
+    for(const BrushSweep& sweep : sweeps) {
+        glm::vec3 end{};
+        auto endTri = intersectMesh(sweep.to, end);
 
-    for(const size_t triangleIdx : trisInBrush) {
-        const auto& cgalTri = getTriangle(triangleIdx).getTri();
+        if(!endTri) {
+            continue;
+        }
 
-        if(GeometryUtils::isFullyInsideASphere(cgalTri, intersectionPoint, settings.size)) {
-            // Triangles fully inside are colored whole
-            setTriangleColor(triangleIdx, settings.color);
-        } else {
-            if(settings.respectOriginalTriangles) {
-                if(settings.paintOuterRing) {
-                    setTriangleColor(triangleIdx, settings.color);
+        // Sweep from the previous hit if it is close enough, otherwise paint a dab
+        glm::vec3 start = end;
+        std::vector<size_t> startTriangles{*endTri};
+        if(sweep.from) {
+            glm::vec3 fromPoint{};
+            auto fromTri = intersectMesh(*sweep.from, fromPoint);
+            if(fromTri && glm::distance(fromPoint, end) <= settings.size * BrushSweep::MAX_LENGTH_IN_SIZES) {
+                start = fromPoint;
+                if(*fromTri != *endTri) {
+                    startTriangles.push_back(*fromTri);
                 }
+            }
+        }
+
+        const auto trisInBrush = getTrianglesUnderBrush(start, end, sweep.to.getDirection(), startTriangles, settings);
+        const TriangleDetail::Capsule brushShape{Point3(start.x, start.y, start.z), Point3(end.x, end.y, end.z),
+                                                 settings.size};
+
+        for(const size_t triangleIdx : trisInBrush) {
+            const auto& cgalTri = getTriangle(triangleIdx).getTri();
 
+            if(GeometryUtils::isFullyInsideACapsule(cgalTri, start, end, settings.size)) {
+                // Triangles fully inside are colored whole, which replaces the capsules painted onto them so far
+                capsulesOfTriangles.erase(triangleIdx);
+                setTriangleColor(triangleIdx, settings.color);
             } else {
-                // Do not paint triangles that are already the same color
-                if(!isSimpleTriangle(triangleIdx) || getTriangle(triangleIdx).getColor() != settings.color) {
-                    detailsToUpdate.emplace_back(triangleIdx);
-                    getTriangleDetail(triangleIdx);  // Create triangle detail so that we dont modify
+                if(settings.respectOriginalTriangles) {
+                    if(settings.paintOuterRing) {
+                        setTriangleColor(triangleIdx, settings.color);
+                    }
+
+                } else {
+                    // Do not paint triangles that are already the same color
+                    if(!isSimpleTriangle(triangleIdx) || getTriangleColor(triangleIdx) != settings.color) {
+                        capsulesOfTriangles[triangleIdx].push_back(brushShape);
+                    }
                 }
             }
         }
     }
 
-    if(!detailsToUpdate.empty()) {
-        invalidateTemporaryDetailedData();
+    std::vector<size_t> detailsToUpdate;
+    detailsToUpdate.reserve(capsulesOfTriangles.size());
+    for(const auto& it : capsulesOfTriangles) {
+        detailsToUpdate.emplace_back(it.first);
+        getTriangleDetail(it.first);  // Create triangle detail so that we dont modify
     }
 
-    const Sphere brushShape(Point3(intersectionPoint.x, intersectionPoint.y, intersectionPoint.z),
-                            settings.size * settings.size);
-
     try {
         auto& threadPool = MainApplication::getThreadPool();
         threadPool.parallel_for(
-            detailsToUpdate.begin(), detailsToUpdate.end(), [this, &brushShape, &settings](size_t triIdx) {
-                getTriangleDetail(triIdx)->paintSphere(brushShape, settings.segments, settings.color);
+            detailsToUpdate.begin(), detailsToUpdate.end(), [this, &capsulesOfTriangles, &settings](size_t triIdx) {
+                getTriangleDetail(triIdx)->paintCapsules(capsulesOfTriangles.at(triIdx), settings.segments,
+                                                         settings.color);
             });
     } catch(const std::exception& e) {
         CI_LOG_E(e.what());
         throw;
     }
 
-    mOgl.isDirty = true;
+    for(const size_t triIdx : detailsToUpdate) {
+        markTriangleBuffersDirty(triIdx);
+        invalidateTemporaryDetailedData(triIdx);
+    }
 }
 
 TriangleDetail* Geometry::createTriangleDetail(size_t triangleIdx) {
-    auto result = mTriangleDetails.emplace(triangleIdx, TriangleDetail(getTriangle(triangleIdx)));
+    auto result = mTriangleDetails.emplace(triangleIdx, std::in_place, getTriangle(triangleIdx));
+    markTriangleBuffersDirty(triangleIdx);
+    invalidateTemporaryDetailedData(triangleIdx);
 
-    return &(result.first->second);
+    return &result.first->edit();
 }
 
 void Geometry::removeTriangleDetail(const size_t triangleIndex) {
-    mOgl.isDirty = true;
+    markTriangleBuffersDirty(triangleIndex);
+    invalidateTemporaryDetailedData(triangleIndex);
     mTriangleDetails.erase(triangleIndex);
-
-    // Chaning triangle detail invalidates detailed tree and mesh
-    invalidateTemporaryDetailedData();
 }
 
 void Geometry::setTriangleColor(const size_t triangleIndex, const size_t newColor) {
@@ -630,9 +914,10 @@ void Geometry::setTriangleColor(const size_t triangleIndex, const size_t newColo
         removeTriangleDetail(triangleIndex);
     }
 
-    /// Change it in the triangle soup
+    /// Change it in the original triangles
     P_ASSERT(triangleIndex < mTriangles.size());
-    mTriangles[triangleIndex].setColor(newColor);
+    mTriangles.setColor(triangleIndex, newColor);
+    markBucketColorChanged(triangleIndex);
 }
 
 void Geometry::setTriangleColor(const DetailedTriangleId triangleId, const size_t newColor) {
@@ -646,10 +931,11 @@ void Geometry::setTriangleColor(const DetailedTriangleId triangleId, const size_
 
         TriangleDetail* detail = getTriangleDetail(baseId);
         detail->setColor(detailId, newColor);
+        markBucketColorChanged(baseId);
 
-        if(!mOgl.isDirty) {
-            const size_t vertexPosition =
-                mTriangleDetailColorBufferStart[triangleId.getBaseId()] + 3 * (*triangleId.getDetailId());
+        // Dirty triangles will have their whole slot rewritten on the next update
+        if(!mOgl.isDirty && mOgl.dirtyTriangles.find(baseId) == mOgl.dirtyTriangles.end()) {
+            const size_t vertexPosition = mTriangleDetailSlots.at(baseId).start + 3 * detailId;
             ColorIndex newColorIndex = static_cast<ColorIndex>(newColor);
             mOgl.colorBuffer[vertexPosition] = newColorIndex;
             mOgl.colorBuffer[vertexPosition + 1] = newColorIndex;
@@ -662,6 +948,79 @@ void Geometry::setTriangleColor(const DetailedTriangleId triangleId, const size_
     }
 }
 
+void Geometry::setTrianglesColor(const DetailedTriangleSet& triangles, const size_t newColor) {
+    const ColorIndex newColorIndex = static_cast<ColorIndex>(newColor);
+    std::vector<OpenGlData::VertexRange> colorRanges;
+
+    // Base triangles, detailed ones lose their detail and get rewritten with the dirty triangles
+    triangles.forEachBaseRange([&](const size_t begin, const size_t end) {
+        P_ASSERT(end <= mTriangles.size());
+        for(size_t triangleIdx = begin; triangleIdx < end; ++triangleIdx) {
+            if(!isSimpleTriangle(triangleIdx)) {
+                removeTriangleDetail(triangleIdx);
+            }
+            mTriangles.setColor(triangleIdx, newColor);
+            markBucketColorChanged(triangleIdx);
+        }
+
+        if(!mOgl.isDirty) {
+            P_ASSERT(3 * end <= mOgl.colorBuffer.size());
+            std::fill(mOgl.colorBuffer.begin() + 3 * begin, mOgl.colorBuffer.begin() + 3 * end, newColorIndex);
+            colorRanges.push_back({3 * begin, 3 * end});
+        }
+    });
+
+    // Detail triangles, sorted so that the triangles of one detail are next to each other
+    const std::vector<DetailedTriangleId>& detailIds = triangles.getDetailIds();
+    for(size_t groupBegin = 0; groupBegin < detailIds.size();) {
+        const size_t baseId = detailIds[groupBegin].getBaseId();
+        size_t groupEnd = groupBegin + 1;
+        while(groupEnd < detailIds.size() && detailIds[groupEnd].getBaseId() == baseId) {
+            ++groupEnd;
+        }
+
+        P_ASSERT(!isSimpleTriangle(baseId));
+        const std::vector<DataTriangle>& detailTriangles = mTriangleDetails.at(baseId)->getTriangles();
+        const bool isChanged = std::any_of(detailIds.begin() + groupBegin, detailIds.begin() + groupEnd,
+                                           [&detailTriangles, newColor](const DetailedTriangleId id) {
+                                               P_ASSERT(*id.getDetailId() < detailTriangles.size());
+                                               return detailTriangles[*id.getDetailId()].getColor() != newColor;
+                                           });
+
+        // Editing a detail shared with an undo snapshot clones it, do not clone the ones that do not change
+        if(isChanged) {
+            TriangleDetail* detail = getTriangleDetail(baseId);
+            markBucketColorChanged(baseId);
+            const bool isInBuffers = !mOgl.isDirty && mOgl.dirtyTriangles.find(baseId) == mOgl.dirtyTriangles.end();
+            for(size_t idIdx = groupBegin; idIdx < groupEnd; ++idIdx) {
+                const size_t detailId = *detailIds[idIdx].getDetailId();
+                detail->setColor(detailId, newColor);
+
+                if(isInBuffers) {
+                    const size_t vertexPosition = mTriangleDetailSlots.at(baseId).start + 3 * detailId;
+                    std::fill(mOgl.colorBuffer.begin() + vertexPosition, mOgl.colorBuffer.begin() + vertexPosition + 3,
+                              newColorIndex);
+                    colorRanges.push_back({vertexPosition, vertexPosition + 3});
+                }
+            }
+        }
+        groupBegin = groupEnd;
+    }
+
+    if(colorRanges.empty()) {
+        return;
+    }
+
+    // Upload only the changed ranges, unless there are so many that uploading the whole color buffer is cheaper
+    mergeVertexRanges(colorRanges);
+    if(colorRanges.size() > MAX_COLOR_UPDATE_RANGES) {
+        mOgl.info.didColorUpdate = true;
+    } else {
+        mOgl.info.updatedRanges.insert(mOgl.info.updatedRanges.end(), colorRanges.begin(), colorRanges.end());
+        mergeVertexRanges(mOgl.info.updatedRanges);
+    }
+}
+
 void Geometry::buildPolyhedron() {
     mProgress->polyhedronPercentage = 0.0f;
     mPolyhedronData.mMesh.clear();
@@ -670,39 +1029,25 @@ void Geometry::buildPolyhedron() {
     mPolyhedronData.isSdfComputed = false;
     mPolyhedronData.valid = false;
     mPolyhedronData.mFaceDescs.clear();
-
-    std::vector<PolyhedronData::vertex_descriptor> vertDescs;
-    vertDescs.reserve(mPolyhedronData.vertices.size());
-    mPolyhedronData.mMesh.reserve(static_cast<PolyhedronData::Mesh::size_type>(mPolyhedronData.vertices.size()),
-                                  static_cast<PolyhedronData::Mesh::size_type>(mPolyhedronData.indices.size() * 3 / 2),
-                                  static_cast<PolyhedronData::Mesh::size_type>(mPolyhedronData.indices.size()));
-
-    for(const auto& vertex : mPolyhedronData.vertices) {
-        PolyhedronData::vertex_descriptor v =
-            mPolyhedronData.mMesh.add_vertex(DataTriangle::Point(vertex.x, vertex.y, vertex.z));
-        vertDescs.push_back(v);
-    }
-
-    mPolyhedronData.mFaceDescs.reserve(mPolyhedronData.indices.size());
-    bool meshHasNull = false;
-    for(const auto& tri : mPolyhedronData.indices) {
-        auto f = mPolyhedronData.mMesh.add_face(vertDescs[tri[0]], vertDescs[tri[1]], vertDescs[tri[2]]);
-        if(f == PolyhedronData::Mesh::null_face()) {
-            // Adding a non-valid face, the model is wrong and we stop.
-            meshHasNull = true;
-            break;
-        } else {
-            P_ASSERT(f != PolyhedronData::Mesh::null_face());
-            mPolyhedronData.mFaceDescs.push_back(f);
+    mPolyhedronData.adjacency.clear();
+
+    // The bulk build handles all consistently oriented manifold meshes, add_face copes with some other meshes as well
+    if(SurfaceMeshBuilder::build(mTriangles.getVertices(), mTriangles.getIndices(), mPolyhedronData.mMesh,
+                                 MainApplication::getThreadPool())) {
+        mPolyhedronData.mFaceDescs.resize(mTriangles.size());
+        for(size_t faceIdx = 0; faceIdx < mPolyhedronData.mFaceDescs.size(); ++faceIdx) {
+            mPolyhedronData.mFaceDescs[faceIdx] =
+                PolyhedronData::face_descriptor(static_cast<PolyhedronData::Mesh::size_type>(faceIdx));
         }
-    }
-    // If the build failed, clear, set invalid and exit;
-    if(meshHasNull) {
+    } else if(!addPolyhedronFaces()) {
+        // If the build failed, clear, set invalid and exit;
         mPolyhedronData.mMesh.clear();
+        mPolyhedronData.mFaceDescs.clear();
         mPolyhedronData.valid = false;
         mProgress->polyhedronPercentage = -1.0f;
         return;
     }
+    mProgress->polyhedronPercentage = 0.5f;
 
     bool created;
     boost::tie(mPolyhedronData.mIdMap, created) =
@@ -716,31 +1061,73 @@ void Geometry::buildPolyhedron() {
         mPolyhedronData.mIdMap[face] = i;
         ++i;
     }
-    CI_LOG_I("Polyhedral mesh built, vertices: " + std::to_string(mPolyhedronData.vertices.size()) +
-             ", faces: " + std::to_string(mPolyhedronData.indices.size()));
+    buildFaceAdjacency();
+
+    CI_LOG_I("Polyhedral mesh built, vertices: " + std::to_string(mTriangles.getVertices().size()) +
+             ", faces: " + std::to_string(mTriangles.size()));
     mPolyhedronData.valid = true;
     mProgress->polyhedronPercentage = 1.0f;
 }
 
-void Geometry::buildDetailedTree() {
-    mTreeDetailed = std::make_unique<Tree>();
+bool Geometry::addPolyhedronFaces() {
+    CI_LOG_W("The model is not a consistently oriented manifold mesh, adding the polyhedron faces one by one.");
+    const std::vector<glm::vec3>& vertices = mTriangles.getVertices();
+    std::vector<PolyhedronData::vertex_descriptor> vertDescs;
+    vertDescs.reserve(vertices.size());
+    mPolyhedronData.mMesh.reserve(static_cast<PolyhedronData::Mesh::size_type>(vertices.size()),
+                                  static_cast<PolyhedronData::Mesh::size_type>(mTriangles.size() * 3 / 2),
+                                  static_cast<PolyhedronData::Mesh::size_type>(mTriangles.size()));
 
-    for(size_t triangleIdx = 0; triangleIdx < mTriangles.size(); triangleIdx++) {
-        if(isSimpleTriangle(triangleIdx)) {
-            // Insert Original triangle
-            mTreeDetailed->insert(DataTriangleAABBPrimitive(this, DetailedTriangleId(triangleIdx)));
-        } else {
-            // Insert all detail triangles for this tri
-            const TriangleDetail* detail = getTriangleDetail(triangleIdx);
-            P_ASSERT(detail);
-            const auto& detailTriangles = detail->getTriangles();
-            for(size_t detailIdx = 0; detailIdx < detailTriangles.size(); detailIdx++) {
-                mTreeDetailed->insert(DataTriangleAABBPrimitive(this, DetailedTriangleId(triangleIdx, detailIdx)));
+    for(const auto& vertex : vertices) {
+        PolyhedronData::vertex_descriptor v =
+            mPolyhedronData.mMesh.add_vertex(DataTriangle::Point(vertex.x, vertex.y, vertex.z));
+        vertDescs.push_back(v);
+    }
+
+    mPolyhedronData.mFaceDescs.reserve(mTriangles.size());
+    for(const auto& tri : mTriangles.getIndices()) {
+        auto f = mPolyhedronData.mMesh.add_face(vertDescs[tri[0]], vertDescs[tri[1]], vertDescs[tri[2]]);
+        if(f == PolyhedronData::Mesh::null_face()) {
+            // Adding a non-valid face, the model is wrong and we stop.
+            return false;
+        }
+        mPolyhedronData.mFaceDescs.push_back(f);
+    }
+    return true;
+}
+
+void Geometry::buildFaceAdjacency() {
+    const auto& mesh = mPolyhedronData.mMesh;
+    auto& adjacency = mPolyhedronData.adjacency;
+    adjacency.resize(mPolyhedronData.mFaceDescs.size());
+
+    for(size_t triIndex = 0; triIndex < mPolyhedronData.mFaceDescs.size(); ++triIndex) {
+        const auto neighbourFaces = getNeighbourFaces(mesh, mPolyhedronData.mFaceDescs[triIndex]);
+        for(int i = 0; i < 3; ++i) {
+            if(neighbourFaces[i] == PolyhedronData::Mesh::null_face()) {
+                adjacency[triIndex][i] = -1;
+            } else {
+                const size_t neighbourFaceId = mPolyhedronData.mIdMap[neighbourFaces[i]];
+                P_ASSERT(neighbourFaceId < adjacency.size());
+                adjacency[triIndex][i] = static_cast<int>(neighbourFaceId);
             }
         }
     }
+}
 
-    mTreeDetailed->build();
+const TriangleBvh& Geometry::getDetailTree(const size_t triangleIdx) {
+    P_ASSERT(!isSimpleTriangle(triangleIdx));
+    TriangleBvh& detailTree = mDetailTrees[triangleIdx];
+    if(detailTree.empty()) {
+        const auto& detailTriangles = mTriangleDetails.at(triangleIdx)->getTriangles();
+        std::vector<TriangleBvh::Triangle> triangles;
+        triangles.reserve(detailTriangles.size());
+        for(const DataTriangle& tri : detailTriangles) {
+            triangles.push_back(tri.getVertices());
+        }
+        detailTree.build(triangles);
+    }
+    return detailTree;
 }
 
 void Geometry::buildDetailedMesh() {
@@ -749,96 +1136,322 @@ void Geometry::buildDetailedMesh() {
         return;
     }
 
-    mMeshDetailed = std::make_unique<PolyhedronData::Mesh>();
-    mMeshDetailedFaceDescs.clear();
-    mMeshDetailedIdMap.reset();
-    bool created;
-    boost::tie(mMeshDetailedIdMap, created) =
-        mMeshDetailed->add_property_map<PolyhedronData::face_descriptor, DetailedTriangleId>("f:idOfEachTriangle",
-                                                                                             DetailedTriangleId());
-    /**
-     *  Yes, we are about to hash floating point values.
-     *  These values come from CGAL exact kernel, so they should be bit-equal and safe to hash.
-     *  There is no betters way to get indices before this, as different color parts are stored in different polygons.
-     */
-    auto hashFunc = [](const glm::vec3& vec) {
-        return std::hash<float>{}(vec.x) ^ std::hash<float>{}(vec.y) ^ std::hash<float>{}(vec.z);
-    };
-
-    std::unordered_map<glm::vec3, PolyhedronData::vertex_descriptor, decltype(hashFunc)> ptToVertexDesc(
-        3 * mTriangles.size(), hashFunc);
+    std::vector<size_t> changedTriangles;
+    std::vector<PolyhedronData::face_descriptor> changedFaces;
+    const bool isPatch = mMeshDetailed != nullptr;
+    if(isPatch) {
+        // Patch only the faces of triangles that changed since the last update
+        changedTriangles.assign(mMeshDetailedDirtyTriangles.begin(), mMeshDetailedDirtyTriangles.end());
+        for(const size_t triangleIdx : changedTriangles) {
+            removeDetailedMeshFaces(triangleIdx, changedFaces);
+        }
+    } else {
+        mMeshDetailed = std::make_unique<PolyhedronData::Mesh>();
+        mMeshDetailedFaceDescs.clear();
+        mMeshDetailedFaceDescs.reserve(mTriangles.size());
+        mMeshDetailedVertices.clear();
+        mMeshDetailedVertices.reserve(mTriangles.getVertices().size());
+        mMeshDetailedDetailCounts.assign(mTriangles.size(), 0);
+        mMeshDetailedAdjacency.clear();
+        mMeshDetailedEdgeCosines.clear();
+        mBucketComponents.clear();
+        mBucketColorChangedTriangles.clear();
+        mMeshDetailedIdMap.reset();
+        bool created;
+        boost::tie(mMeshDetailedIdMap, created) =
+            mMeshDetailed->add_property_map<PolyhedronData::face_descriptor, DetailedTriangleId>(
+                "f:idOfEachTriangle", DetailedTriangleId());
+        P_ASSERT(created);
+
+        changedTriangles.resize(mTriangles.size());
+        std::iota(changedTriangles.begin(), changedTriangles.end(), 0);
+    }
+    mMeshDetailedDirtyTriangles.clear();
+
+    std::vector<PolyhedronData::face_descriptor> addedFaces;
+    for(const size_t triangleIdx : changedTriangles) {
+        // Only a full build may stop in the middle, its partial mesh is dropped and built again next time
+        if(!isPatch && CancellationToken::isCurrentCancelled()) {
+            mMeshDetailed.reset();
+            mMeshDetailedFaceDescs.clear();
+            mMeshDetailedVertices.clear();
+            throw OperationCancelledException();
+        }
 
-    P_ASSERT(created);
-    std::vector<PolyhedronData::vertex_descriptor> vertDescs;
-    vertDescs.reserve(mPolyhedronData.vertices.size());
+        if(!addDetailedMeshFaces(triangleIdx, addedFaces)) {
+            // Adding a non-valid face, the model is wrong and we stop.
+            invalidateTemporaryDetailedData();
+            return;
+        }
+    }
 
-    // Add original vertices
-    for(const auto& vertex : mPolyhedronData.vertices) {
-        PolyhedronData::vertex_descriptor v =
-            mMeshDetailed->add_vertex(DataTriangle::Point(vertex.x, vertex.y, vertex.z));
-        ptToVertexDesc[vertex] = v;
-        vertDescs.push_back(v);
+    // Faces around the patched area get new neighbours too
+    if(isPatch) {
+        for(const PolyhedronData::face_descriptor face : addedFaces) {
+            for(const PolyhedronData::face_descriptor neighbour : getNeighbourFaces(*mMeshDetailed, face)) {
+                if(neighbour != PolyhedronData::Mesh::null_face()) {
+                    changedFaces.push_back(neighbour);
+                }
+            }
+        }
     }
+    changedFaces.insert(changedFaces.end(), addedFaces.begin(), addedFaces.end());
+    updateDetailedMeshAdjacency(changedFaces);
+
+    // Cached bucket components are spread again where the faces or their neighbours changed
+    if(isPatch && !mBucketComponents.empty()) {
+        std::vector<size_t> changedFaceIndices(changedFaces.begin(), changedFaces.end());
+        for(auto& entry : mBucketComponents) {
+            entry.second.invalidate(changedFaceIndices, mMeshDetailedAdjacency);
+        }
+    }
+}
 
-    // Add original simple faces
-    for(size_t i = 0; i < mPolyhedronData.indices.size(); i++) {
-        const auto& tri = mPolyhedronData.indices[i];
+bool Geometry::addDetailedMeshFaces(const size_t triangleIdx,
+                                    std::vector<PolyhedronData::face_descriptor>& addedFaces) {
+    P_ASSERT(triangleIdx < mMeshDetailedDetailCounts.size());
 
-        if(isSimpleTriangle(i)) {
-            auto f = mMeshDetailed->add_face(vertDescs[tri[0]], vertDescs[tri[1]], vertDescs[tri[2]]);
-            if(f == PolyhedronData::Mesh::null_face()) {
-                // Adding a non-valid face, the model is wrong and we stop.
-                mMeshDetailed.reset();
-                return;
-            } else {
-                P_ASSERT(f != PolyhedronData::Mesh::null_face());
-                mMeshDetailedFaceDescs[DetailedTriangleId(i)] = f;
-                mMeshDetailedIdMap[f] = DetailedTriangleId(i);
-            }
+    if(isSimpleTriangle(triangleIdx)) {
+        const auto f = mMeshDetailed->add_face(getDetailedMeshVertex(mTriangles.getVertex(triangleIdx, 0)),
+                                               getDetailedMeshVertex(mTriangles.getVertex(triangleIdx, 1)),
+                                               getDetailedMeshVertex(mTriangles.getVertex(triangleIdx, 2)));
+        if(f == PolyhedronData::Mesh::null_face()) {
+            return false;
         }
+
+        mMeshDetailedFaceDescs.set(DetailedTriangleId(triangleIdx), f);
+        mMeshDetailedIdMap[f] = DetailedTriangleId(triangleIdx);
+        mMeshDetailedDetailCounts[triangleIdx] = 0;
+        addedFaces.push_back(f);
+        return true;
     }
 
-    // Add detailed faces
-    for(const auto& triDetailIt : mTriangleDetails) {
-        const size_t triangleId = triDetailIt.first;
-        const auto& detailTriangles = triDetailIt.second.getTriangles();
+    // Add detail triangles while combining common vertices
+    const auto& detailTriangles = mTriangleDetails.at(triangleIdx)->getTriangles();
+    for(size_t detailTriangleIdx = 0; detailTriangleIdx < detailTriangles.size(); detailTriangleIdx++) {
+        const DataTriangle& detail = detailTriangles[detailTriangleIdx];
+
+        P_ASSERT(!detail.getTri().is_degenerate());
+
+        const auto faceDesc = mMeshDetailed->add_face(getDetailedMeshVertex(detail.getVertex(0)),
+                                                      getDetailedMeshVertex(detail.getVertex(1)),
+                                                      getDetailedMeshVertex(detail.getVertex(2)));
+        P_ASSERT(faceDesc != PolyhedronData::Mesh::null_face());
+        if(faceDesc == PolyhedronData::Mesh::null_face()) {
+            const double sqrdArea = detail.getTri().squared_area();
+            CI_LOG_E("A null face was generated in the detailed mesh. This should not happen");
+            CI_LOG_E(std::to_string(sqrdArea));
+            return false;
+        }
 
-        // Add detail triangles while combining common vertices
-        for(size_t detailTriangleIdx = 0; detailTriangleIdx < detailTriangles.size(); detailTriangleIdx++) {
-            const DataTriangle& detail = detailTriangles[detailTriangleIdx];
+        mMeshDetailedFaceDescs.set(DetailedTriangleId(triangleIdx, detailTriangleIdx), faceDesc);
+        mMeshDetailedIdMap[faceDesc] = DetailedTriangleId(triangleIdx, detailTriangleIdx);
+        addedFaces.push_back(faceDesc);
+    }
+    mMeshDetailedDetailCounts[triangleIdx] = detailTriangles.size();
+    return true;
+}
 
-            P_ASSERT(!detail.getTri().is_degenerate());
+void Geometry::removeDetailedMeshFaces(const size_t triangleIdx,
+                                       std::vector<PolyhedronData::face_descriptor>& neighbourFaces) {
+    P_ASSERT(triangleIdx < mMeshDetailedDetailCounts.size());
 
-            // Vertex descriptors of current detail triangle
-            std::array<PolyhedronData::vertex_descriptor, 3> vertDescriptors;
+    std::vector<DetailedTriangleId> faceIds;
+    if(mMeshDetailedDetailCounts[triangleIdx] == 0) {
+        faceIds.emplace_back(triangleIdx);
+    } else {
+        for(size_t detailIdx = 0; detailIdx < mMeshDetailedDetailCounts[triangleIdx]; ++detailIdx) {
+            faceIds.emplace_back(triangleIdx, detailIdx);
+        }
+    }
 
-            for(int i = 0; i < 3; i++) {
-                // Get iterator to vertex ID for current vertex
-                auto it = ptToVertexDesc.find(detail.getVertex(i));
-                if(it == ptToVertexDesc.end()) {
-                    auto vertexDesc = mMeshDetailed->add_vertex(detail.getTri().vertex(i));
-                    P_ASSERT(vertexDesc != PolyhedronData::Mesh::null_vertex());
-                    it = ptToVertexDesc.insert(std::make_pair(detail.getVertex(i), vertexDesc)).first;
-                }
+    for(const DetailedTriangleId& faceId : faceIds) {
+        const PolyhedronData::face_descriptor* facePtr = mMeshDetailedFaceDescs.find(faceId);
+        P_ASSERT(facePtr != nullptr);
+        const PolyhedronData::face_descriptor face = *facePtr;
+        mMeshDetailedFaceDescs.erase(faceId);
 
-                vertDescriptors[i] = it->second;
+        // The neighbours lose an adjacent face
+        for(const PolyhedronData::face_descriptor neighbour : getNeighbourFaces(*mMeshDetailed, face)) {
+            if(neighbour != PolyhedronData::Mesh::null_face()) {
+                neighbourFaces.push_back(neighbour);
             }
+        }
+
+        std::array<glm::vec3, 3> facePositions;
+        std::array<PolyhedronData::vertex_descriptor, 3> faceVertices;
+        auto halfedge = mMeshDetailed->halfedge(face);
+        for(int i = 0; i < 3; ++i) {
+            faceVertices[i] = mMeshDetailed->target(halfedge);
+            const DataTriangle::Point& point = mMeshDetailed->point(faceVertices[i]);
+            facePositions[i] = glm::vec3(point.x(), point.y(), point.z());
+            halfedge = mMeshDetailed->next(halfedge);
+        }
+
+        // Also removes edges and vertices that are no longer used by any face
+        CGAL::Euler::remove_face(mMeshDetailed->halfedge(face), *mMeshDetailed);
+        mMeshDetailedAdjacency[face] = {-1, -1, -1};
+
+        for(int i = 0; i < 3; ++i) {
+            if(mMeshDetailed->is_removed(faceVertices[i])) {
+                mMeshDetailedVertices.erase(facePositions[i]);
+            }
+        }
+    }
+}
+
+PolyhedronData::vertex_descriptor Geometry::getDetailedMeshVertex(const glm::vec3& position) {
+    auto it = mMeshDetailedVertices.find(position);
+    if(it == mMeshDetailedVertices.end()) {
+        const auto vertexDesc = mMeshDetailed->add_vertex(DataTriangle::Point(position.x, position.y, position.z));
+        P_ASSERT(vertexDesc != PolyhedronData::Mesh::null_vertex());
+        it = mMeshDetailedVertices.emplace(position, vertexDesc).first;
+    }
+    return it->second;
+}
+
+void Geometry::updateDetailedMeshAdjacency(const std::vector<PolyhedronData::face_descriptor>& faces) {
+    // Removed faces may get reused by the added ones, so the indices stay within num_faces()
+    mMeshDetailedAdjacency.resize(mMeshDetailed->num_faces(), {-1, -1, -1});
+    mMeshDetailedEdgeCosines.resize(mMeshDetailedAdjacency.size(), {1.0f, 1.0f, 1.0f});
+    for(const PolyhedronData::face_descriptor face : faces) {
+        if(mMeshDetailed->is_removed(face)) {
+            continue;
+        }
+
+        const auto neighbourFaces = getNeighbourFaces(*mMeshDetailed, face);
+        for(int i = 0; i < 3; ++i) {
+            mMeshDetailedAdjacency[face][i] = neighbourFaces[i] == PolyhedronData::Mesh::null_face()
+                                                  ? -1
+                                                  : static_cast<int>(static_cast<size_t>(neighbourFaces[i]));
+        }
 
-            auto faceDesc = mMeshDetailed->add_face(vertDescriptors);
-            P_ASSERT(faceDesc != PolyhedronData::Mesh::null_face());
-            if(faceDesc != PolyhedronData::Mesh::null_face()) {
-                mMeshDetailedFaceDescs.insert(
-                    std::make_pair(DetailedTriangleId(triangleId, detailTriangleIdx), faceDesc));
-                mMeshDetailedIdMap[faceDesc] = DetailedTriangleId(triangleId, detailTriangleIdx);
+        // Computed the same way as the normal stopping of the paint bucket, so that the cached components match it
+        const glm::vec3 normal = glm::normalize(getDetailedFaceNormal(face));
+        for(int i = 0; i < 3; ++i) {
+            const int neighbour = mMeshDetailedAdjacency[face][i];
+            if(neighbour < 0 || getDetailedFaceId(face).getBaseId() ==
+                                    getDetailedFaceId(static_cast<size_t>(neighbour)).getBaseId()) {
+                mMeshDetailedEdgeCosines[face][i] = 1.0f;
             } else {
-                const double sqrdArea = detail.getTri().squared_area();
-                CI_LOG_E("A null face was generated in the detailed mesh. This should not happen");
-                CI_LOG_E(std::to_string(sqrdArea));
-                mMeshDetailed.reset();
-                return;
+                mMeshDetailedEdgeCosines[face][i] =
+                    glm::dot(glm::normalize(getDetailedFaceNormal(static_cast<size_t>(neighbour))), normal);
+            }
+        }
+    }
+}
+
+BucketComponents& Geometry::getBucketComponents(const BucketCriterion& criterion) {
+    P_ASSERT(mMeshDetailed);
+    P_ASSERT(mMeshDetailedEdgeCosines.size() == mMeshDetailedAdjacency.size());
+
+    // Faces of the triangles that changed color and their neighbours are spread again on their next lookup
+    if(!mBucketColorChangedTriangles.empty()) {
+        std::vector<size_t> changedFaces;
+        for(const size_t triangleIdx : mBucketColorChangedTriangles) {
+            const size_t detailCount = mMeshDetailedDetailCounts[triangleIdx];
+            for(size_t detailIdx = 0; detailIdx < std::max<size_t>(detailCount, 1); ++detailIdx) {
+                const DetailedTriangleId id =
+                    detailCount == 0 ? DetailedTriangleId(triangleIdx) : DetailedTriangleId(triangleIdx, detailIdx);
+                const PolyhedronData::face_descriptor* face = mMeshDetailedFaceDescs.find(id);
+                if(face != nullptr) {
+                    changedFaces.push_back(static_cast<size_t>(*face));
+                }
+            }
+        }
+        for(auto& entry : mBucketComponents) {
+            if(entry.first.stopOnColor) {
+                entry.second.invalidate(changedFaces, mMeshDetailedAdjacency);
             }
         }
+        mBucketColorChangedTriangles.clear();
+    }
+
+    auto it = std::find_if(mBucketComponents.begin(), mBucketComponents.end(),
+                           [&criterion](const auto& entry) { return entry.first == criterion; });
+    if(it == mBucketComponents.end()) {
+        if(mBucketComponents.size() >= MAX_BUCKET_CRITERIA) {
+            mBucketComponents.pop_back();
+        }
+        mBucketComponents.emplace_back(criterion, BucketComponents());
+        it = mBucketComponents.end() - 1;
+    }
+    std::rotate(mBucketComponents.begin(), it, it + 1);
+
+    BucketComponents& components = mBucketComponents.front().second;
+    if(components.empty()) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        components.build(mMeshDetailedAdjacency, [this, &criterion](const size_t face, const int neighbourIdx) {
+            return canBucketPass(criterion, face, neighbourIdx);
+        });
+        const auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> timeMs = end - start;
+        CI_LOG_I("Labelling " + std::to_string(components.getComponentCount()) + " bucket components took " +
+                 std::to_string(timeMs.count()) + " ms");
+    }
+    return components;
+}
+
+void Geometry::markBucketColorChanged(const size_t triangleIdx) {
+    const bool hasColorComponents =
+        std::any_of(mBucketComponents.begin(), mBucketComponents.end(),
+                    [](const auto& entry) { return entry.first.stopOnColor; });
+    if(!hasColorComponents) {
+        return;
+    }
+
+    // Once a large part of the model changed, labelling it again is cheaper than spreading over the changes
+    if(mBucketColorChangedTriangles.size() >= mTriangles.size() / 4) {
+        dropColorBucketComponents();
+        return;
+    }
+    mBucketColorChangedTriangles.push_back(triangleIdx);
+}
+
+void Geometry::dropColorBucketComponents() {
+    mBucketComponents.erase(std::remove_if(mBucketComponents.begin(), mBucketComponents.end(),
+                                           [](const auto& entry) { return entry.first.stopOnColor; }),
+                            mBucketComponents.end());
+    mBucketColorChangedTriangles.clear();
+}
+
+std::vector<DetailedTriangleId> Geometry::bucketComponent(const DetailedTriangleId startTriangle,
+                                                          const BucketCriterion& criterion) {
+    if(mPolyhedronData.mMesh.is_empty()) {
+        return {};
+    }
+
+    if(!isTemporaryDetailedDataValid()) {
+        updateTemporaryDetailedData();
+        P_ASSERT(mMeshDetailed);
+    }
+
+    const PolyhedronData::face_descriptor* startFace = mMeshDetailedFaceDescs.find(startTriangle);
+    P_ASSERT(startFace != nullptr);
+    P_ASSERT(mMeshDetailedAdjacency.size() == mMeshDetailed->num_faces());
+
+    BucketComponents& components = getBucketComponents(criterion);
+    const std::vector<size_t>* component = components.findComponent(static_cast<size_t>(*startFace));
+    if(component == nullptr) {
+        // The component changed since it was labelled, spreading over it gives the current one
+        const auto faceStopping = [this, &criterion](const size_t neighbourFace, const size_t currentFace) -> bool {
+            const auto& neighbours = mMeshDetailedAdjacency[currentFace];
+            const auto neighbourIt = std::find(neighbours.begin(), neighbours.end(), static_cast<int>(neighbourFace));
+            P_ASSERT(neighbourIt != neighbours.end());
+            return canBucketPass(criterion, currentFace, static_cast<int>(neighbourIt - neighbours.begin()));
+        };
+        components.setComponent(bucketSpread(mMeshDetailedAdjacency, mDetailedBucketMarks,
+                                             {static_cast<size_t>(*startFace)}, faceStopping));
+        component = components.findComponent(static_cast<size_t>(*startFace));
+        P_ASSERT(component != nullptr);
+    }
+
+    std::vector<DetailedTriangleId> result;
+    result.reserve(component->size());
+    for(const size_t face : *component) {
+        result.push_back(getDetailedFaceId(face));
     }
+    return result;
 }
 
 void Geometry::correctSharedVertices() {
@@ -849,72 +1462,114 @@ void Geometry::correctSharedVertices() {
 
     auto startTime = std::chrono::high_resolution_clock::now();
 
-    // We must fix every edge that connects from a TriangleDetail to other triangle
+    // We must fix every edge that connects from a TriangleDetail to other triangle.
+    // Edges that do not touch any detail changed since the last correction are already fixed.
+    P_ASSERT(mPolyhedronData.adjacency.size() == mTriangles.size());
+    std::set<std::pair<size_t, size_t>> edgesToCorrect;
+    for(const size_t triIdx : mSharedVerticesDirtyTriangles) {
+        for(const int neighbour : mPolyhedronData.adjacency[triIdx]) {
+            if(neighbour < 0) {
+                continue;
+            }
 
-    // Array of details that will need to be converted back to triangles
-    // This can be done in parallel
-    std::set<size_t> detailsToTriangulate;
+            const size_t neighbourIdx = static_cast<size_t>(neighbour);
+            if(!isSimpleTriangle(triIdx) || !isSimpleTriangle(neighbourIdx)) {
+                edgesToCorrect.emplace(std::min(triIdx, neighbourIdx), std::max(triIdx, neighbourIdx));
+            }
+        }
+    }
 
-    const auto& mesh = mPolyhedronData.mMesh;
+    // Nothing was modified yet, so this is the last point where the correction can stop
+    CancellationToken::checkCurrent();
 
-    for(const PolyhedronData::edge_descriptor edge : mesh.edges()) {
-        const auto firstHalfEdge = mesh.halfedge(edge, 0);
-        const auto secondHalfEdge = mesh.halfedge(edge, 1);
+    // Create the missing details before the parallel phase, which must not modify mTriangleDetails
+    for(const auto& edge : edgesToCorrect) {
+        getTriangleDetail(edge.first);
+        getTriangleDetail(edge.second);
+    }
 
-        if(firstHalfEdge == PolyhedronData::Mesh::null_halfedge() ||
-           secondHalfEdge == PolyhedronData::Mesh::null_halfedge()) {
-            continue;
+    struct EdgeCorrection {
+        size_t firstIdx;
+        size_t secondIdx;
+        TriangleDetail* first;
+        TriangleDetail* second;
+        std::pair<bool, bool> didAdd;
+    };
+
+    // Split the edges into rounds where each detail is used at most once, so that a round can be corrected in
+    // parallel. Each triangle has three edges, so the first free round is always found within the first five.
+    std::vector<std::vector<EdgeCorrection>> rounds;
+    std::unordered_map<size_t, uint32_t> usedRounds;
+    for(const auto& edge : edgesToCorrect) {
+        uint32_t& firstUsed = usedRounds[edge.first];
+        uint32_t& secondUsed = usedRounds[edge.second];
+        size_t round = 0;
+        while(((firstUsed | secondUsed) & (1u << round)) != 0) {
+            ++round;
         }
+        firstUsed |= 1u << round;
+        secondUsed |= 1u << round;
 
-        const auto firstFace = mesh.face(firstHalfEdge);
-        const auto secondFace = mesh.face(secondHalfEdge);
-        if(firstFace == PolyhedronData::Mesh::null_face() || secondFace == PolyhedronData::Mesh::null_face()) {
-            continue;
+        if(round >= rounds.size()) {
+            rounds.resize(round + 1);
         }
+        rounds[round].push_back(EdgeCorrection{edge.first, edge.second, getTriangleDetail(edge.first),
+                                               getTriangleDetail(edge.second), {false, false}});
+    }
 
-        const size_t firstTriIdx = mPolyhedronData.mIdMap[firstFace];
-        const size_t secondTriIdx = mPolyhedronData.mIdMap[secondFace];
+    // Array of details that will need to be converted back to triangles
+    // This can be done in parallel
+    std::set<size_t> detailsToTriangulate;
+    ThreadPool& threadPool = MainApplication::getThreadPool();
 
-        if(!isSimpleTriangle(firstTriIdx) || !isSimpleTriangle(secondTriIdx)) {
-            std::pair<bool, bool> didAdd =
-                getTriangleDetail(firstTriIdx)->correctSharedVertices(*getTriangleDetail(secondTriIdx));
+    for(auto& roundEdges : rounds) {
+        threadPool.parallel_for(roundEdges.begin(), roundEdges.end(), [](EdgeCorrection& edge) {
+            edge.didAdd = edge.first->correctSharedVertices(*edge.second);
+        });
 
+        for(const EdgeCorrection& edge : roundEdges) {
             // Mark to triangulate later if any points added
-            if(didAdd.first) {
-                detailsToTriangulate.insert(firstTriIdx);
+            if(edge.didAdd.first) {
+                detailsToTriangulate.insert(edge.firstIdx);
             }
 
-            if(didAdd.second) {
-                detailsToTriangulate.insert(secondTriIdx);
+            if(edge.didAdd.second) {
+                detailsToTriangulate.insert(edge.secondIdx);
             }
         }
     }
 
     // Triangulate details in parallel
-    std::vector<std::future<void>> tasks;
-    ThreadPool& threadPool = MainApplication::getThreadPool();
+    std::vector<TriangleDetail*> triangulatedDetails;
+    triangulatedDetails.reserve(detailsToTriangulate.size());
     for(size_t triIdx : detailsToTriangulate) {
-        tasks.emplace_back(threadPool.enqueue([](TriangleDetail* detail) { detail->updateTrianglesFromPolygons(); },
-                                              getTriangleDetail(triIdx)));
+        triangulatedDetails.push_back(getTriangleDetail(triIdx));
     }
-
-    std::for_each(tasks.begin(), tasks.end(), [](auto& t) { t.get(); });
+    threadPool.parallel_for(triangulatedDetails.begin(), triangulatedDetails.end(),
+                            [](TriangleDetail* detail) { detail->updateTrianglesFromPolygons(); });
 
     const auto endTime = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> timeMs = endTime - startTime;
 
-    mOgl.isDirty = true;
-    CI_LOG_I("Correcting shared vertices took " + std::to_string(timeMs.count()) + " ms");
+    for(const size_t triIdx : detailsToTriangulate) {
+        markTriangleBuffersDirty(triIdx);
+        invalidateTemporaryDetailedData(triIdx);
+    }
+
+    // Added points only lie on the corrected edges, so all edges of the changed details match now
+    mSharedVerticesDirtyTriangles.clear();
+    CI_LOG_I("Correcting shared vertices of " + std::to_string(edgesToCorrect.size()) + " edges took " +
+             std::to_string(timeMs.count()) + " ms");
 }
 
 void Geometry::updateTemporaryDetailedData() {
     const auto start = std::chrono::high_resolution_clock::now();
 
     correctSharedVertices();
+    CancellationToken::checkCurrent();
     // Important! Do this in a single thread. Epeck kernel used by TriangleDetail
     // is not thread safe even for read-only access
     buildDetailedMesh();
-    buildDetailedTree();
 
     const auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> timeMs = end - start;
@@ -922,58 +1577,23 @@ void Geometry::updateTemporaryDetailedData() {
 }
 
 void Geometry::invalidateTemporaryDetailedData() {
-    mTreeDetailed.reset();
-    mMeshDetailed.reset();
-}
-
-std::array<int, 3> Geometry::gatherNeighbours(const size_t triIndex) const {
-    const auto& faceDescriptors = mPolyhedronData.mFaceDescs;
-    const auto& mesh = mPolyhedronData.mMesh;
-    P_ASSERT(triIndex < faceDescriptors.size());
-    std::array<int, 3> returnValue = {-1, -1, -1};
-    const PolyhedronData::face_descriptor face = faceDescriptors[triIndex];
-    const auto edge = mesh.halfedge(face);
-    auto itEdge = edge;
-
-    for(int i = 0; i < 3; ++i) {
-        const auto oppositeEdge = mesh.opposite(itEdge);
-        if(oppositeEdge.is_valid() && !mesh.is_border(oppositeEdge)) {
-            const PolyhedronData::Mesh::Face_index neighbourFace = mesh.face(oppositeEdge);
-            const size_t neighbourFaceId = mPolyhedronData.mIdMap[neighbourFace];
-            P_ASSERT(neighbourFaceId < mTriangles.size());
-            returnValue[i] = static_cast<int>(neighbourFaceId);
-        }
-
-        itEdge = mesh.next(itEdge);
+    // Details may have been replaced, all of their edges have to be corrected again
+    for(const auto& detail : mTriangleDetails) {
+        mSharedVerticesDirtyTriangles.insert(detail.first);
     }
-    P_ASSERT(edge == itEdge);
 
-    return returnValue;
+    mDetailTrees.clear();
+    mMeshDetailed.reset();
+    mMeshDetailedAdjacency.clear();
+    mMeshDetailedEdgeCosines.clear();
+    mBucketComponents.clear();
+    mBucketColorChangedTriangles.clear();
+    mMeshDetailedVertices.clear();
+    mMeshDetailedDirtyTriangles.clear();
 }
-std::array<std::optional<DetailedTriangleId>, 3> Geometry::gatherNeighbours(const DetailedTriangleId triId) const {
-    P_ASSERT(mMeshDetailed);
 
-    const auto& faceDescriptors = mMeshDetailedFaceDescs;
-    const auto& mesh = *mMeshDetailed;
-    P_ASSERT(faceDescriptors.find(triId) != faceDescriptors.end());
-    std::array<std::optional<DetailedTriangleId>, 3> returnValue = {};
-    const PolyhedronData::face_descriptor face = faceDescriptors.find(triId)->second;
-    const auto edge = mesh.halfedge(face);
-    auto itEdge = edge;
-
-    for(int i = 0; i < 3; ++i) {
-        const auto oppositeEdge = mesh.opposite(itEdge);
-        if(oppositeEdge.is_valid() && !mesh.is_border(oppositeEdge)) {
-            const PolyhedronData::Mesh::Face_index neighbourFace = mesh.face(oppositeEdge);
-            const DetailedTriangleId neighbourFaceId = mMeshDetailedIdMap[neighbourFace];
-            returnValue[i] = neighbourFaceId;
-        }
-
-        itEdge = mesh.next(itEdge);
-    }
-    P_ASSERT(edge == itEdge);
-
-    return returnValue;
+::ThreadPool& Geometry::getThreadPool() {
+    return MainApplication::getThreadPool();
 }
 
 void Geometry::computeSdf() {
@@ -989,8 +1609,12 @@ void Geometry::computeSdf() {
     if(created) {
         std::pair<double, double> minMaxSdf;
         try {
-            minMaxSdf = CGAL::sdf_values(mPolyhedronData.mMesh, mPolyhedronData.sdf_property_map, 2.0 / 3.0 * CGAL_PI,
-                                         25, true);
+            minMaxSdf = CGAL::sdf_values(mPolyhedronData.mMesh, CancellableSdfMap{mPolyhedronData.sdf_property_map},
+                                         2.0 / 3.0 * CGAL_PI, 25, true);
+        } catch(const OperationCancelledException&) {
+            mProgress->resetSdf();
+            CI_LOG_I("SDF computation cancelled.");
+            throw;
         } catch(...) {
             mPolyhedronData.sdfValuesValid = false;
             mProgress->resetSdf();
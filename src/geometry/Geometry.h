@@ -1,10 +1,9 @@
 #pragma once
 
-#include <CGAL/AABB_traits.h>
-#include <CGAL/AABB_tree.h>
 #include <CGAL/Surface_mesh.h>
 #include <CGAL/exceptions.h>
 #include <CGAL/mesh_segmentation.h>
+#include <boost/functional/hash.hpp>
 #include <cinder/Ray.h>
 #include <cinder/gl/gl.h>
 #include <cereal/types/array.hpp>
@@ -12,19 +11,31 @@
 #include <cereal/types/vector.hpp>
 #include "cinder/Log.h"
 
+#include <algorithm>
 #include <map>
 #include <optional>
+#include <set>
 #include <unordered_map>
 #include <vector>
 
+#include "geometry/BucketComponents.h"
+#include "geometry/BucketSpread.h"
 #include "geometry/ColorManager.h"
+#include "geometry/CopyOnWrite.h"
+#include "geometry/DenseIndexMap.h"
+#include "geometry/DetailedTriangleMap.h"
+#include "geometry/DetailedTriangleSet.h"
 #include "geometry/GeometryProgress.h"
 #include "geometry/GlmSerialization.h"
+#include "geometry/IndexedTriangles.h"
 #include "geometry/ModelImporter.h"
 #include "geometry/PolyhedronData.h"
+#include "geometry/SphereBounds.h"
 #include "geometry/Triangle.h"
+#include "geometry/TriangleBvh.h"
 #include "geometry/TriangleDetail.h"
 #include "geometry/TrianglePrimitive.h"
+#include "geometry/VertexWelder.h"
 #include "peprassert.h"
 #include "tools/Brush.h"
 
@@ -41,10 +52,6 @@ class Geometry {
     using Point3 = pepr3d::DataTriangle::K::Point_3;
     using Ft = pepr3d::DataTriangle::K::FT;
     using Ray = pepr3d::DataTriangle::K::Ray_3;
-    using My_AABB_traits = CGAL::AABB_traits<pepr3d::DataTriangle::K, DataTriangleAABBPrimitive>;
-    using Tree = CGAL::AABB_tree<My_AABB_traits>;
-    using Ray_intersection = boost::optional<Tree::Intersection_and_primitive_id<Ray>::Type>;
-    using BoundingBox = My_AABB_traits::Bounding_box;
     using ColorIndex = GLuint;
 
     /// A highlight of a part of the Geometry
@@ -83,8 +90,24 @@ class Geometry {
         /// Used to limit the highlight to continuous surface
         std::vector<GLint> highlightMask;  // Possibly needs to be GLint, had problems getting GLbyte through cinder
 
+        /// All buffers need to be generated again
         bool isDirty{true};
 
+        /// Base triangles whose part of the buffers needs to be rewritten, used when the buffers are not dirty as a
+        /// whole. Painting a few triangles then does not regenerate the buffers of the whole mesh.
+        std::set<size_t> dirtyTriangles;
+
+        /// Are there any changes that were not written into the buffers yet
+        bool needsUpdate() const {
+            return isDirty || !dirtyTriangles.empty();
+        }
+
+        /// Range of vertices [begin, end) in the buffers
+        struct VertexRange {
+            size_t begin;
+            size_t end;
+        };
+
         /// Always editable struct that keeps track of changes since last frame
         /// Updates to color/highlight buffer set this flag to true
         /// ModelView resets the flag to false when it updates OpenGl data
@@ -92,6 +115,12 @@ class Geometry {
             mutable bool didColorUpdate{false};
             mutable bool didHighlightUpdate{false};
 
+            /// Size of the buffers changed, they have to be uploaded whole
+            mutable bool didResize{false};
+
+            /// Sorted ranges of vertices whose data (positions, normals, colors and highlight) changed
+            mutable std::vector<VertexRange> updatedRanges;
+
             void unsetColorFlag() const {
                 didColorUpdate = false;
             }
@@ -99,23 +128,45 @@ class Geometry {
             void unsetHighlightFlag() const {
                 didHighlightUpdate = false;
             }
+
+            void unsetUpdatedRanges() const {
+                didResize = false;
+                updatedRanges.clear();
+            }
         } info;
     };
 
    private:
-    /// Triangle soup of the original model mesh, containing CGAL::Triangle_3 data for AABB tree.
-    std::vector<DataTriangle> mTriangles;
+    /// Triangles of the original model mesh, sharing their vertices
+    IndexedTriangles mTriangles;
 
     /// Stores a rough collision sphere for each triangle
     /// in a form of a center point + radius.
     /// Used to speed up capsule/cylinder querries on original triangles.
-    std::vector<std::pair<Point3, double>> mTriangleBounds;
+    SphereBounds mTriangleBounds;
 
     /// Map of triangle details. (Detailed triangles that replace the original)
-    std::map<size_t, TriangleDetail> mTriangleDetails;
+    /// Details are shared with the undo snapshots and cloned only when they are edited.
+    DenseIndexMap<CopyOnWrite<TriangleDetail>> mTriangleDetails;
 
-    /// Map of baseTriangleId -> Index of first detail triangle color in mOgl.colorBuffer
-    std::map<size_t, size_t> mTriangleDetailColorBufferStart;
+    /// Part of the OpenGL buffers reserved for the detail triangles of one base triangle.
+    /// Unused triangles of the slot are degenerate, so that the slot can be reused when the detail changes.
+    struct DetailSlot {
+        /// Index of the first vertex of the slot
+        size_t start;
+
+        /// Number of triangles that fit into the slot
+        size_t capacity;
+    };
+
+    /// Map of baseTriangleId -> Slot of its detail triangles in the mOgl buffers
+    DenseIndexMap<DetailSlot> mTriangleDetailSlots;
+
+    /// Map of slot capacity -> Starts of unused slots of that capacity
+    std::map<size_t, std::vector<size_t>> mFreeDetailSlots;
+
+    /// Index of the first vertex after the last allocated detail slot
+    size_t mDetailSlotsEnd = 0;
 
     /// All open GL buffers
     OpenGlData mOgl;
@@ -123,27 +174,69 @@ class Geometry {
     /// Polyhedron structure
     PolyhedronData mPolyhedronData;
 
-    /// AABB tree from the CGAL library, to find intersections with rays generated by user mouse clicks and the mesh.
-    std::unique_ptr<Tree> mTree;
+    /// Marks of each triangle used by bucket BFS, all cleared between the bucket calls
+    BucketSpread::Marks mBucketMarks;
 
-    /// AABB tree built over all triangles, including details. This tree is invalidated on every operation that changes
-    /// triangleDetail topology.
-    std::unique_ptr<Tree> mTreeDetailed;
+    /// Hierarchy over the original triangles, to find intersections with rays generated by user mouse clicks and the
+    /// triangles near a brush
+    TriangleBvh mTree;
+
+    /// Hierarchies over the triangles of each TriangleDetail, built on demand. Together with mTree over the base
+    /// triangles they form a two-level tree over the detailed mesh. A tree is dropped when its detail changes.
+    std::unordered_map<size_t, TriangleBvh> mDetailTrees;
 
     // ----- Detailed Mesh Data ------
 
     /// Surface mesh with detail triangles included
     std::unique_ptr<PolyhedronData::Mesh> mMeshDetailed;
 
-    std::unordered_map<DetailedTriangleId, PolyhedronData::face_descriptor> mMeshDetailedFaceDescs;
+    /// Map converting an ID into a face_descriptor
+    DetailedTriangleMap<PolyhedronData::face_descriptor> mMeshDetailedFaceDescs;
 
     /// Map converting a face_descriptor into an ID
     PolyhedronData::Mesh::Property_map<PolyhedronData::face_descriptor, DetailedTriangleId> mMeshDetailedIdMap;
 
-    // ----- END of Detailed Mesh Data ------
+    /// Hash of a vertex position combining all of its coordinates
+    struct VertexPositionHash {
+        size_t operator()(const glm::vec3& position) const {
+            size_t seed = 0;
+            boost::hash_combine(seed, position.x);
+            boost::hash_combine(seed, position.y);
+            boost::hash_combine(seed, position.z);
+            return seed;
+        }
+    };
 
-    /// AABB of the whole mesh
-    std::unique_ptr<BoundingBox> mBoundingBox;
+    /// Vertex of the detailed mesh at each position, shared by all faces touching it.
+    /// Positions come from the exact kernel of TriangleDetail, so shared vertices are bit-equal.
+    std::unordered_map<glm::vec3, PolyhedronData::vertex_descriptor, VertexPositionHash> mMeshDetailedVertices;
+
+    /// Number of detail faces of each base triangle in the detailed mesh, 0 for a simple triangle
+    std::vector<size_t> mMeshDetailedDetailCounts;
+
+    /// Base triangles whose faces in the detailed mesh are out of date
+    std::set<size_t> mMeshDetailedDirtyTriangles;
+
+    /// Triangles whose TriangleDetail changed since correctSharedVertices() last ran
+    std::set<size_t> mSharedVerticesDirtyTriangles;
+
+    /// Neighbours of each face of the detailed mesh, indexed by face_descriptor. Removed faces have no neighbours.
+    BucketSpread::Adjacency mMeshDetailedAdjacency;
+
+    /// Marks of each face of the detailed mesh used by bucket BFS
+    BucketSpread::Marks mDetailedBucketMarks;
+
+    /// Cosine of the angle between the normals of each face of the detailed mesh and its neighbours, indexed like
+    /// mMeshDetailedAdjacency. Faces of the same base triangle have the same normal.
+    std::vector<std::array<float, 3>> mMeshDetailedEdgeCosines;
+
+    /// Components of the detailed mesh for the recently used bucket criteria, the most recent first
+    std::vector<std::pair<BucketCriterion, BucketComponents>> mBucketComponents;
+
+    /// Base triangles whose color changed since the color dependent mBucketComponents were invalidated
+    std::vector<size_t> mBucketColorChangedTriangles;
+
+    // ----- END of Detailed Mesh Data ------
 
     /// A vector based map mapping size_t into ci::ColorA
     ColorManager mColorManager;
@@ -154,9 +247,12 @@ class Geometry {
     /// Current progress of import, tree, polyhedron building, export, etc.
     std::unique_ptr<GeometryProgress> mProgress;
 
+    /// Vertices of a loaded model closer than this fraction of its bounding box diagonal are joined
+    float mVertexWeldTolerance = VertexWelder::DEFAULT_TOLERANCE;
+
     struct GeometryState {
-        std::vector<size_t> triangleColors;
-        std::map<size_t, TriangleDetail> triangleDetails;
+        std::vector<uint8_t> triangleColors;
+        DenseIndexMap<CopyOnWrite<TriangleDetail>> triangleDetails;
         ColorManager::ColorMap colorMap;
     };
 
@@ -164,10 +260,14 @@ class Geometry {
 
    public:
     /// Empty constructor
-    Geometry() : mTree(std::make_unique<Tree>()), mProgress(std::make_unique<GeometryProgress>()) {}
+    Geometry() : mProgress(std::make_unique<GeometryProgress>()) {}
+
+    Geometry(std::vector<DataTriangle>&& triangles) : mProgress(std::make_unique<GeometryProgress>()) {
+        std::vector<glm::vec3> vertices;
+        std::vector<IndexedTriangles::Indices> indices;
+        VertexWelder::weld(triangles, 0.0f, vertices, indices, getThreadPool());
+        mTriangles = IndexedTriangles(std::move(vertices), std::move(indices), triangles);
 
-    Geometry(std::vector<DataTriangle>&& triangles)
-        : mTriangles(std::move(triangles)), mProgress(std::make_unique<GeometryProgress>()) {
         generateVertexBuffer();
         generateTriangleBounds();
         generateIndexBuffer();
@@ -175,12 +275,7 @@ class Geometry {
         generateNormalBuffer();
         P_ASSERT(mOgl.indexBuffer.size() == mOgl.vertexBuffer.size());
         buildTree();
-        buildDetailedTree();
-
-        P_ASSERT(mTree->size() == mTriangles.size());
-        if(!mTree->empty()) {
-            mBoundingBox = std::make_unique<BoundingBox>(mTree->bbox());
-        }
+        P_ASSERT(mTree.size() == mTriangles.size());
     }
 
     std::vector<glm::vec3>& getVertexBuffer() {
@@ -192,7 +287,7 @@ class Geometry {
     }
 
     size_t polyVertCount() const {
-        return mPolyhedronData.vertices.size();
+        return mTriangles.getVertices().size();
     }
 
     const OpenGlData& getOpenGlData() const {
@@ -205,48 +300,30 @@ class Geometry {
         return mOgl;
     }
 
-    /// Update buffers used by openGl. Should only be called when they are dirty
-    void updateOpenGlBuffers() {
-        P_ASSERT(mOgl.isDirty);  // Called unnecessarily. Most likely by error.
-
-        const auto start = std::chrono::high_resolution_clock::now();
+    /// Update buffers used by openGl. Should only be called when they need an update.
+    /// Regenerates all buffers when they are dirty, otherwise rewrites only the dirty triangles.
+    void updateOpenGlBuffers();
 
-        generateVertexBuffer();
-        generateIndexBuffer();
-        generateColorBuffer();
-        generateNormalBuffer();
-        generateHighlightBuffer();
-
-        mOgl.isDirty = false;
-        mOgl.info.didColorUpdate = false;
-        mOgl.info.didHighlightUpdate = false;
-
-        const auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double, std::milli> timeMs = end - start;
-
-        CI_LOG_I("Generating buffers took " + std::to_string(timeMs.count()) + " ms");
-    }
-
-    /// Update temporary detailed data like detailed AABB tree and detailed Mesh
+    /// Update temporary detailed data like detailed Mesh
     /// This is a slow operation
     void updateTemporaryDetailedData();
 
     bool isTemporaryDetailedDataValid() const {
-        return mMeshDetailed && mTreeDetailed;
+        return mMeshDetailed && mMeshDetailedDirtyTriangles.empty();
     }
 
     glm::vec3 getBoundingBoxMin() const {
-        if(!mBoundingBox) {
+        if(mTree.empty()) {
             return glm::vec3(0);
         }
-        return glm::vec3(mBoundingBox->xmin(), mBoundingBox->ymin(), mBoundingBox->zmin());
+        return mTree.getBoxMin();
     }
 
     glm::vec3 getBoundingBoxMax() const {
-        if(!mBoundingBox) {
+        if(mTree.empty()) {
             return glm::vec3(0);
         }
-        return glm::vec3(mBoundingBox->xmax(), mBoundingBox->ymax(), mBoundingBox->zmax());
+        return mTree.getBoxMax();
     }
 
     const Geometry::AreaHighlight& getAreaHighlight() const {
@@ -257,12 +334,13 @@ class Geometry {
         mAreaHighlight.enabled = false;
     }
 
-    const DataTriangle& getTriangle(const size_t triangleIndex) const {
+    /// Copy of the original triangle, built from the shared vertices
+    DataTriangle getTriangle(const size_t triangleIndex) const {
         P_ASSERT(triangleIndex < mTriangles.size());
-        return mTriangles[triangleIndex];
+        return mTriangles.getTriangle(triangleIndex);
     }
 
-    const DataTriangle& getTriangle(const DetailedTriangleId triangleId) const {
+    DataTriangle getTriangle(const DetailedTriangleId triangleId) const {
         const size_t baseId = triangleId.getBaseId();
         const std::optional<size_t> detailId = triangleId.getDetailId();
 
@@ -270,14 +348,14 @@ class Geometry {
         if(detailId) {
             P_ASSERT(!isSimpleTriangle(baseId));
             P_ASSERT(*detailId < getTriangleDetailCount(baseId));
-            return mTriangleDetails.at(baseId).getTriangles()[*detailId];
+            return mTriangleDetails.at(baseId)->getTriangles()[*detailId];
         } else {
-            return mTriangles[baseId];
+            return mTriangles.getTriangle(baseId);
         }
     }
 
     size_t getTriangleColor(const size_t triangleIndex) const {
-        return getTriangle(triangleIndex).getColor();
+        return mTriangles.getColor(triangleIndex);
     }
 
     size_t getTriangleColor(const DetailedTriangleId triangleId) const {
@@ -299,8 +377,7 @@ class Geometry {
 
     bool isSimpleTriangle(size_t triangleIdx) const {
         // Triangle is single color when it has no detail triangles
-        auto it = mTriangleDetails.find(triangleIdx);
-        return it == mTriangleDetails.end();
+        return !mTriangleDetails.contains(triangleIdx);
     }
 
     const GeometryProgress& getProgress() const {
@@ -317,7 +394,7 @@ class Geometry {
         return mMeshDetailed.get();
     }
 
-    const std::unordered_map<DetailedTriangleId, PolyhedronData::face_descriptor>& getMeshDetailedFaceDescs() const {
+    const DetailedTriangleMap<PolyhedronData::face_descriptor>& getMeshDetailedFaceDescs() const {
         return mMeshDetailedFaceDescs;
     }
 
@@ -326,15 +403,35 @@ class Geometry {
         return mMeshDetailedIdMap;
     }
 
+    /// Neighbours of each face of the detailed mesh, indexed by face_descriptor. Removed faces have no neighbours.
+    const BucketSpread::Adjacency& getMeshDetailedAdjacency() const {
+        return mMeshDetailedAdjacency;
+    }
+
     /// Loads new geometry into the private data, rebuilds the buffers and other data structures automatically.
     void loadNewGeometry(const std::string& fileName);
 
+    /// Tolerance of joining the vertices of loaded models, relative to their bounding box diagonal
+    float getVertexWeldTolerance() const {
+        return mVertexWeldTolerance;
+    }
+
+    /// Set the tolerance of joining the vertices of models loaded from now on, 0 joins only equal positions
+    void setVertexWeldTolerance(const float tolerance) {
+        P_ASSERT(tolerance >= 0.0f);
+        mVertexWeldTolerance = tolerance;
+    }
+
     /// Set new triangle color.
     void setTriangleColor(const size_t triangleIndex, const size_t newColor);
 
     /// Set new triangle color.
     void setTriangleColor(const DetailedTriangleId triangleId, const size_t newColor);
 
+    /// Set the same color to a whole set of triangles at once. Details are edited once per base triangle and only the
+    /// changed ranges of the color buffer are marked for upload.
+    void setTrianglesColor(const DetailedTriangleSet& triangles, const size_t newColor);
+
     /// Intersects the mesh with the given ray and returns the index of the triangle intersected, if it exists.
     /// Example use: generate ray based on a mouse click, call this method, then call setTriangleColor.
     std::optional<size_t> intersectMesh(const ci::Ray& ray) const;
@@ -357,6 +454,11 @@ class Geometry {
     void paintWithShape(const ci::Ray& ray, const std::vector<Point3>& shape, size_t color,
                         bool paintBackfaces = false);
 
+    /// Paint all shapes of a brush stroke, the same as paintWithShape for each of them in order.
+    /// The shapes over each triangle are joined first, so that its detail is cut and triangulated only once.
+    void paintWithShapes(const std::vector<TriangleDetail::ProjectedShape>& shapes, size_t color,
+                         bool paintBackfaces = false);
+
     /// Paint area with a shaped brush
     /// @param ray Ray along which to project the shape, using orthogonal projection
     /// @param triangles Triangles in world space representing the shape
@@ -365,26 +467,40 @@ class Geometry {
     /// Paint continuous spherical area with a brush of specified size
     void paintAreaWithSphere(const ci::Ray& ray, const BrushSettings& settings);
 
+    /// Paint the spherical areas of all rays of a brush stroke, the same as paintAreaWithSphere for each of them in
+    /// order. The spheres over each triangle are joined first, so that its detail is cut and triangulated only once.
+    void paintAreaWithSpheres(const std::vector<ci::Ray>& rays, const BrushSettings& settings);
+
+    /// Paint the capsules swept by a spherical brush along the parts of a stroke. A part is painted as a single dab
+    /// when it has no previous ray, when the previous ray misses or when the hits are too far apart to be swept over.
+    /// The capsules over each triangle are joined first, so that its detail is cut and triangulated only once.
+    void paintAreaWithSweeps(const std::vector<BrushSweep>& sweeps, const BrushSettings& settings);
+
     /// Change all color ID's from one to another
     /// @param ColorFunc functor of type size_t func(size_t originalColor), that returns the new color ID
     template <typename ColorFunc>
     void changeColorIds(const ColorFunc& colorFunc) {
         for(size_t i = 0; i < getTriangleCount(); ++i) {
             if(isSimpleTriangle(i)) {
-                const auto& triangle = getTriangle(i);
-                setTriangleColor(i, colorFunc(triangle.getColor()));
+                setTriangleColor(i, colorFunc(getTriangleColor(i)));
             } else {
                 TriangleDetail* triDetail = getTriangleDetail(i);
                 triDetail->changeColorIds(colorFunc);
             }
         }
 
+        dropColorBucketComponents();
         mOgl.isDirty = true;
     }
 
     /// Save current state into a struct so that it can be restored later (CommandManager target requirement)
     GeometryState saveState() const;
 
+    /// Approximate memory of a saved state in bytes without its details (CommandManager target option). The details
+    /// are added to sharedParts, other states may share them.
+    template <typename SharedParts>
+    size_t getStateSize(const GeometryState& state, SharedParts& sharedParts) const;
+
     /// Load previous state from a struct (CommandManager target requirement)
     void loadState(const GeometryState&);
 
@@ -398,6 +514,12 @@ class Geometry {
     template <typename StoppingCondition>
     std::vector<size_t> bucket(const size_t startTriangle, const StoppingCondition& stopFunctor);
 
+    /// Triangles reached by a bucket spread from startTriangle, the same ones as bucket() with an equivalent functor.
+    /// The components of the detailed mesh are cached for the recent criteria and updated after color changes, so
+    /// repeated fills are a lookup instead of a spread.
+    std::vector<DetailedTriangleId> bucketComponent(const DetailedTriangleId startTriangle,
+                                                    const BucketCriterion& criterion);
+
     template <typename StoppingCondition>
     std::vector<size_t> bucket(const std::vector<size_t>& startTriangles, const StoppingCondition& stopFunctor);
 
@@ -405,41 +527,29 @@ class Geometry {
     std::vector<size_t> getTrianglesUnderBrush(const glm::vec3& originPoint, const glm::vec3& insideDirection,
                                                size_t startTriangle, const struct BrushSettings& settings);
 
-    /// Get all triangles that are closer to the object than radius
-    /// This function operates on spherical bounds of triangles and may therefore return false positives
-    /// @param object CGAL Object - point, line, etc
+    /// Spread as BFS from starting triangles, until the limits of a brush swept from start to end are reached
+    std::vector<size_t> getTrianglesUnderBrush(const glm::vec3& start, const glm::vec3& end,
+                                               const glm::vec3& insideDirection,
+                                               const std::vector<size_t>& startTriangles,
+                                               const struct BrushSettings& settings);
+
+    /// Get all triangles that are closer to the object than radius, in ascending order
+    /// Triangles that are only a rounding error further than radius may be returned too
+    /// @param object CGAL Point3 or Line3
     template <typename Object>
     std::vector<size_t> getTrianglesInRadius(const Object& object, double radius) const {
-        P_ASSERT(mTriangleBounds.size() == mTriangles.size());
-        std::vector<size_t> result;
-
-        for(size_t triIdx = 0; triIdx < mTriangleBounds.size(); ++triIdx) {
-            if(isTriangleInRadius(object, radius, triIdx))
-                result.push_back(triIdx);
-        }
-
-        return result;
+        P_ASSERT(mTree.size() == mTriangles.size());
+        return queryTree(object, radius);
     }
 
     /// Test if distance from object to spherical boundary of a triangle is closer than radius
-    /// @param object CGAL Object - point, line, etc
+    /// @param object CGAL Point3 or Line3
     /// @return true, object is closer than radius to the triangle bound shpere
     template <typename Object>
     bool isTriangleInRadius(const Object& object, double radius, size_t triangleIdx) const {
         P_ASSERT(triangleIdx < mTriangleBounds.size());
         P_ASSERT(mTriangleBounds.size() == mTriangles.size());
-
-        const Point3& sphereCenter = mTriangleBounds[triangleIdx].first;
-        const double sphereRadius = mTriangleBounds[triangleIdx].second;
-
-        // Any sphere in contact with the cylinder is going to have this max squared distance
-        const double distanceLimitSquared = (radius + sphereRadius) * (radius + sphereRadius);
-
-        if(CGAL::squared_distance(object, sphereCenter) <= distanceLimitSquared) {
-            return true;
-        } else {
-            return false;
-        }
+        return mTriangleBounds.test(makeBoundsQuery(object, radius), triangleIdx);
     }
 
     /// Segmentation is CPU heavy because it needs to calculate a lot of data.
@@ -453,8 +563,8 @@ class Geometry {
         if(mPolyhedronData.sdf_property_map == nullptr) {
             return false;
         } else {
-            P_ASSERT(mPolyhedronData.indices.size() == static_cast<size_t>(mPolyhedronData.sdf_property_map.end() -
-                                                                           mPolyhedronData.sdf_property_map.begin()));
+            P_ASSERT(mTriangles.size() == static_cast<size_t>(mPolyhedronData.sdf_property_map.end() -
+                                                              mPolyhedronData.sdf_property_map.begin()));
             return mPolyhedronData.isSdfComputed;
         }
     }
@@ -482,11 +592,11 @@ class Geometry {
 
     /// Get number of detailed triangles for this baseId
     size_t getTriangleDetailCount(const size_t triangleIndex) const {
-        auto it = mTriangleDetails.find(triangleIndex);
-        if(it == mTriangleDetails.end()) {
+        const CopyOnWrite<TriangleDetail>* detail = mTriangleDetails.find(triangleIndex);
+        if(detail == nullptr) {
             return 0;
         } else {
-            return it->second.getTriangles().size();
+            return (*detail)->getTriangles().size();
         }
     }
 
@@ -512,59 +622,159 @@ class Geometry {
     /// Generate a buffer of highlight information. Saves per-triangle data to each vertex
     void generateHighlightBuffer();
 
-    /// Generate spherical bounds for each original triangle. Used to speed up capsule querries.
+    /// Assign a slot in the buffers to each triangle detail, placing them right after the base triangles
+    void allocateDetailSlots();
+
+    /// Find or create an unused slot for the given number of detail triangles, growing the buffers if necessary
+    DetailSlot allocateDetailSlot(size_t triangleCount);
+
+    /// Rewrite buffers of the triangles in mOgl.dirtyTriangles and record the changed ranges
+    void updateDirtyTriangleBuffers();
+
+    /// Sort the vertex ranges and merge the close ones
+    static void mergeVertexRanges(std::vector<OpenGlData::VertexRange>& ranges);
+
+    /// Write all buffer data of a base triangle, including its detail slot
+    void writeTriangleBuffers(size_t triangleIdx);
+
+    /// Resize all buffers to hold the given number of vertices, new vertices form degenerate triangles
+    void resizeBuffers(size_t vertexCount);
+
+    /// Value of the highlight mask of a base triangle and all its detail triangles
+    GLint getHighlightValue(size_t triangleIdx) const {
+        return !mAreaHighlight.settings.continuous ||
+               mAreaHighlight.triangles.find(triangleIdx) != mAreaHighlight.triangles.end();
+    }
+
+    /// Mark a triangle to be rewritten in the buffers on the next update
+    void markTriangleBuffersDirty(size_t triangleIdx) {
+        mOgl.dirtyTriangles.insert(triangleIdx);
+    }
+
+    /// Generate spherical bounds for each original triangle.
+    /// Used to speed up capsule querries.
     void generateTriangleBounds();
 
+    /// Query of the triangle bounds closer than radius to the point
+    SphereBounds::Query makeBoundsQuery(const Point3& point, double radius) const;
+
+    /// Query of the triangle bounds closer than radius to the line
+    SphereBounds::Query makeBoundsQuery(const Line3& line, double radius) const;
+
+    /// Triangles closer than radius to the point
+    std::vector<size_t> queryTree(const Point3& point, double radius) const;
+
+    /// Triangles closer than radius to the line
+    std::vector<size_t> queryTree(const Line3& line, double radius) const;
+
     /// Build the CGAL Polyhedron construct in mPolyhedronData. Takes a bit of time to rebuild.
     void buildPolyhedron();
 
-    /// Builds AABB tree over the original mesh
+    /// Build the polyhedron by adding its faces one by one, used when the bulk build fails
+    /// @return false if a face could not be added because the model is not valid
+    bool addPolyhedronFaces();
+
+    /// Fill mPolyhedronData.adjacency from the halfedges of the built polyhedron
+    void buildFaceAdjacency();
+
+    /// Builds the hierarchy over the original mesh
     void buildTree();
 
-    /// Build AABB Tree over all triangles including details.
-    void buildDetailedTree();
+    /// Hierarchy over the triangles of a TriangleDetail, built if it does not exist yet
+    const TriangleBvh& getDetailTree(size_t triangleIdx);
 
-    /// Build a CGAL mesh over detailed triangles
+    /// Build a CGAL mesh over detailed triangles, or update the faces of the changed triangles if it exists
     void buildDetailedMesh();
 
+    /// Add the faces of a base triangle to the detailed mesh
+    /// @return false if the faces could not be added because the model is not valid
+    bool addDetailedMeshFaces(size_t triangleIdx, std::vector<PolyhedronData::face_descriptor>& addedFaces);
+
+    /// Remove the faces of a base triangle from the detailed mesh, with the vertices only they used
+    void removeDetailedMeshFaces(size_t triangleIdx, std::vector<PolyhedronData::face_descriptor>& neighbourFaces);
+
+    /// Vertex of the detailed mesh at the position, added if it does not exist yet
+    PolyhedronData::vertex_descriptor getDetailedMeshVertex(const glm::vec3& position);
+
+    /// Recompute mMeshDetailedAdjacency of the given faces
+    void updateDetailedMeshAdjacency(const std::vector<PolyhedronData::face_descriptor>& faces);
+
     /// Fixes T-junctions and unmatched vertices on edges of TriangleDetails
-    /// by creating a matching vertex on the neighbouring triangle
+    /// by creating a matching vertex on the neighbouring triangle.
+    /// Only edges of triangles changed since the previous correction are processed.
     void correctSharedVertices();
 
-    /// Invalidate temporary detailed data like detailed AABB tree and mesh.
+    /// Invalidate temporary detailed data like detailed mesh.
     void invalidateTemporaryDetailedData();
 
+    /// Invalidate temporary detailed data of a triangle whose TriangleDetail changed.
+    /// Only this triangle gets updated in the detailed mesh.
+    void invalidateTemporaryDetailedData(const size_t triangleIdx) {
+        mDetailTrees.erase(triangleIdx);
+        mSharedVerticesDirtyTriangles.insert(triangleIdx);
+        if(mMeshDetailed) {
+            mMeshDetailedDirtyTriangles.insert(triangleIdx);
+        }
+    }
+
     TriangleDetail* createTriangleDetail(size_t triangleIdx);
 
+    /// Detail of the triangle for editing, created if the triangle has none and cloned if a snapshot shares it
     TriangleDetail* getTriangleDetail(const size_t triangleIndex) {
-        auto it = mTriangleDetails.find(triangleIndex);
-        if(it == mTriangleDetails.end()) {
+        CopyOnWrite<TriangleDetail>* detail = mTriangleDetails.find(triangleIndex);
+        if(detail == nullptr) {
             return createTriangleDetail(triangleIndex);
         } else {
-            return &(it->second);
+            return &detail->edit();
         }
     }
 
     void removeTriangleDetail(size_t triangleIndex);
 
-    /// Used by BFS in bucket painting. Aggregates the neighbours of the triangle at triIndex by looking
-    /// into the CGAL Polyhedron construct.
-    std::array<int, 3> gatherNeighbours(const size_t triIndex) const;
+    /// ID of the triangle of the detailed mesh face with the given index
+    DetailedTriangleId getDetailedFaceId(const size_t faceIdx) const {
+        P_ASSERT(mMeshDetailed);
+        const auto face = PolyhedronData::face_descriptor(static_cast<PolyhedronData::Mesh::size_type>(faceIdx));
+        return mMeshDetailedIdMap[face];
+    }
 
-    /// Used by BFS in bucket painting. Aggregates the neighbours of the triangle at triIndex by looking
-    /// into the CGAL Polyhedron construct.
-    std::array<std::optional<DetailedTriangleId>, 3> gatherNeighbours(const DetailedTriangleId triIndex) const;
+    /// Color of the triangle of the detailed mesh face, without copying the triangle
+    size_t getDetailedFaceColor(const size_t faceIdx) const {
+        const DetailedTriangleId id = getDetailedFaceId(faceIdx);
+        if(id.getDetailId()) {
+            return mTriangleDetails.at(id.getBaseId())->getTriangles()[*id.getDetailId()].getColor();
+        }
+        return mTriangles.getColor(id.getBaseId());
+    }
 
-    /// Used by BFS in bucket painting. Manages the queue used to search through the graph.
-    template <typename StoppingCondition>
-    void addNeighboursToQueue(const size_t currentVertex, std::unordered_set<size_t>& alreadyVisited,
-                              std::deque<size_t>& toVisit, const StoppingCondition& stopFunctor) const;
+    /// Normal of the triangle of the detailed mesh face, without copying the triangle
+    glm::vec3 getDetailedFaceNormal(const size_t faceIdx) const {
+        const DetailedTriangleId id = getDetailedFaceId(faceIdx);
+        if(id.getDetailId()) {
+            return mTriangleDetails.at(id.getBaseId())->getTriangles()[*id.getDetailId()].getNormal();
+        }
+        return mTriangles.getNormal(id.getBaseId());
+    }
 
-    /// Used by BFS in bucket painting. Manages the queue used to search through the graph.
-    template <typename StoppingCondition>
-    void addNeighboursToQueue(const DetailedTriangleId currentVertex,
-                              std::unordered_set<DetailedTriangleId>& alreadyVisited,
-                              std::deque<DetailedTriangleId>& toVisit, const StoppingCondition& stopFunctor) const;
+    /// True if a bucket spread with the criterion passes from the face to its neighbour at the neighbourIdx
+    bool canBucketPass(const BucketCriterion& criterion, const size_t faceIdx, const int neighbourIdx) const {
+        const int neighbour = mMeshDetailedAdjacency[faceIdx][neighbourIdx];
+        P_ASSERT(neighbour >= 0);
+        if(criterion.stopOnNormal && mMeshDetailedEdgeCosines[faceIdx][neighbourIdx] < criterion.minNormalCos) {
+            return false;
+        }
+        return !criterion.stopOnColor ||
+               getDetailedFaceColor(faceIdx) == getDetailedFaceColor(static_cast<size_t>(neighbour));
+    }
+
+    /// Components of the detailed mesh for the criterion, taken from the cache or built
+    BucketComponents& getBucketComponents(const BucketCriterion& criterion);
+
+    /// Record a color change of a base triangle for the color dependent bucket components
+    void markBucketColorChanged(size_t triangleIdx);
+
+    /// Drop the cached bucket components that depend on colors, e.g. when all colors change
+    void dropColorBucketComponents();
 
     void computeSdf();
 
@@ -580,73 +790,26 @@ class Geometry {
     template <class Archive>
     void load(Archive& loadArchive);
 
+    /// Used by BFS in bucket painting. Spreads over the adjacency table from the starting triangles.
     template <typename StoppingCondition>
-    std::vector<size_t> bucketSpread(const StoppingCondition& stopFunctor, std::deque<size_t>& toVisit,
-                                     std::unordered_set<size_t>& alreadyVisited);
+    std::vector<size_t> bucketSpread(const BucketSpread::Adjacency& adjacency, BucketSpread::Marks& marks,
+                                     const std::vector<size_t>& startTriangles, const StoppingCondition& stopFunctor);
 
-    template <typename StoppingCondition>
-    std::vector<DetailedTriangleId> bucketSpread(const StoppingCondition& stopFunctor,
-                                                 std::deque<DetailedTriangleId>& toVisit,
-                                                 std::unordered_set<DetailedTriangleId>& alreadyVisited);
+    /// Returns the thread pool of the application, used by the parallel bucket spread
+    static ::ThreadPool& getThreadPool();
 };
 
 template <typename StoppingCondition>
-std::vector<size_t> Geometry::bucketSpread(const StoppingCondition& stopFunctor, std::deque<size_t>& toVisit,
-                                           std::unordered_set<size_t>& alreadyVisited) {
-    std::vector<size_t> trianglesToColor;
-    P_ASSERT(mPolyhedronData.indices.size() == mTriangles.size());
-
-    while(!toVisit.empty()) {
-        // Remove yourself from queue and mark visited
-        const size_t currentVertex = toVisit.front();
-        toVisit.pop_front();
-        P_ASSERT(alreadyVisited.find(currentVertex) != alreadyVisited.end());
-        P_ASSERT(currentVertex < mTriangles.size());
-        P_ASSERT(toVisit.size() < mTriangles.size());
-
-        // Catching because of unpredictable CGAL errors
-        try {
-            // Manage neighbours and grow the queue
-            addNeighboursToQueue(currentVertex, alreadyVisited, toVisit, stopFunctor);
-        } catch(CGAL::Assertion_exception& excp) {
-            CI_LOG_E("Exception caught. Returning immediately. " + excp.expression() + " " + excp.message());
-            throw std::runtime_error("Bucket spread failed inside the CGAL library.");
-        }
-
-        // Add the triangle to the list
-        trianglesToColor.push_back(currentVertex);
+std::vector<size_t> Geometry::bucketSpread(const BucketSpread::Adjacency& adjacency, BucketSpread::Marks& marks,
+                                           const std::vector<size_t>& startTriangles,
+                                           const StoppingCondition& stopFunctor) {
+    // Catching because of unpredictable CGAL errors
+    try {
+        return BucketSpread::spread(adjacency, marks, startTriangles, stopFunctor, getThreadPool());
+    } catch(CGAL::Assertion_exception& excp) {
+        CI_LOG_E("Exception caught. Returning immediately. " + excp.expression() + " " + excp.message());
+        throw std::runtime_error("Bucket spread failed inside the CGAL library.");
     }
-    return trianglesToColor;
-}
-
-template <typename StoppingCondition>
-std::vector<DetailedTriangleId> Geometry::bucketSpread(const StoppingCondition& stopFunctor,
-                                                       std::deque<DetailedTriangleId>& toVisit,
-                                                       std::unordered_set<DetailedTriangleId>& alreadyVisited) {
-    P_ASSERT(mMeshDetailed);
-    std::vector<DetailedTriangleId> trianglesToColor;
-
-    while(!toVisit.empty()) {
-        // Remove yourself from queue and mark visited
-        const DetailedTriangleId currentVertex = toVisit.front();
-        toVisit.pop_front();
-        P_ASSERT(alreadyVisited.find(currentVertex) != alreadyVisited.end());
-        P_ASSERT(currentVertex.getBaseId() < mTriangles.size());
-        P_ASSERT(currentVertex.getDetailId() < getTriangleDetailCount(currentVertex));
-
-        // Catching because of unpredictable CGAL errors
-        try {
-            // Manage neighbours and grow the queue
-            addNeighboursToQueue(currentVertex, alreadyVisited, toVisit, stopFunctor);
-        } catch(CGAL::Assertion_exception* excp) {
-            throw std::runtime_error("Exception caught. Returning immediately. " + excp->expression() + " " +
-                                     excp->message());
-        }
-
-        // Add the triangle to the list
-        trianglesToColor.push_back(currentVertex);
-    }
-    return trianglesToColor;
 }
 
 template <typename StoppingCondition>
@@ -661,30 +824,29 @@ std::vector<DetailedTriangleId> Geometry::bucket(const DetailedTriangleId startT
         P_ASSERT(mMeshDetailed);
     }
 
-    std::deque<DetailedTriangleId> toVisit;
-    const DetailedTriangleId startingFace = startTriangle;
-    toVisit.push_back(startingFace);
+    // Spread over the faces of the detailed mesh and convert them to triangle IDs only at the end
+    const PolyhedronData::face_descriptor* startFace = mMeshDetailedFaceDescs.find(startTriangle);
+    P_ASSERT(startFace != nullptr);
+    P_ASSERT(mMeshDetailedAdjacency.size() == mMeshDetailed->num_faces());
 
-    std::unordered_set<DetailedTriangleId> alreadyVisited;
-    alreadyVisited.insert(startingFace);
+    const auto faceStopping = [this, &stopFunctor](const size_t neighbourFace, const size_t currentFace) -> bool {
+        return stopFunctor(getDetailedFaceId(neighbourFace), getDetailedFaceId(currentFace));
+    };
+    const std::vector<size_t> reachedFaces =
+        bucketSpread(mMeshDetailedAdjacency, mDetailedBucketMarks, {static_cast<size_t>(*startFace)},
+                     faceStopping);
 
-    return bucketSpread(stopFunctor, toVisit, alreadyVisited);
+    std::vector<DetailedTriangleId> result;
+    result.reserve(reachedFaces.size());
+    for(const size_t face : reachedFaces) {
+        result.push_back(getDetailedFaceId(face));
+    }
+    return result;
 }
 
 template <typename StoppingCondition>
 std::vector<size_t> Geometry::bucket(const size_t startTriangle, const StoppingCondition& stopFunctor) {
-    if(mPolyhedronData.mMesh.is_empty()) {
-        return {};
-    }
-
-    std::deque<size_t> toVisit;
-    const size_t startingFace = startTriangle;
-    toVisit.push_back(startingFace);
-
-    std::unordered_set<size_t> alreadyVisited;
-    alreadyVisited.insert(startingFace);
-
-    return bucketSpread(stopFunctor, toVisit, alreadyVisited);
+    return bucket(std::vector<size_t>{startTriangle}, stopFunctor);
 }
 
 template <typename StoppingCondition>
@@ -694,55 +856,22 @@ std::vector<size_t> Geometry::bucket(const std::vector<size_t>& startingTriangle
         return {};
     }
 
-    std::deque<size_t> toVisit;
-    std::unordered_set<size_t> alreadyVisited;
-
-    for(const size_t startTriangle : startingTriangles) {
-        toVisit.push_back(startTriangle);
-        alreadyVisited.insert(startTriangle);
-    }
-
-    return bucketSpread(stopFunctor, toVisit, alreadyVisited);
-}
-
-template <typename StoppingCondition>
-void Geometry::addNeighboursToQueue(const size_t currentVertex, std::unordered_set<size_t>& alreadyVisited,
-                                    std::deque<size_t>& toVisit, const StoppingCondition& stopFunctor) const {
-    const std::array<int, 3> neighbours = gatherNeighbours(currentVertex);
-    for(int i = 0; i < 3; ++i) {
-        if(neighbours[i] == -1) {
-            continue;
-        } else {
-            if(alreadyVisited.find(neighbours[i]) == alreadyVisited.end()) {
-                // New vertex -> visit it.
-                if(stopFunctor(neighbours[i], currentVertex)) {
-                    toVisit.push_back(neighbours[i]);
-                    alreadyVisited.insert(neighbours[i]);
-                }
-            }
-        }
-    }
+    P_ASSERT(mPolyhedronData.adjacency.size() == mTriangles.size());
+    return bucketSpread(mPolyhedronData.adjacency, mBucketMarks, startingTriangles, stopFunctor);
 }
 
-template <typename StoppingCondition>
-void Geometry::addNeighboursToQueue(const DetailedTriangleId currentVertex,
-                                    std::unordered_set<DetailedTriangleId>& alreadyVisited,
-                                    std::deque<DetailedTriangleId>& toVisit,
-                                    const StoppingCondition& stopFunctor) const {
-    std::array<std::optional<DetailedTriangleId>, 3> neighbours = gatherNeighbours(currentVertex);
-    for(int i = 0; i < 3; ++i) {
-        if(!neighbours[i]) {
-            continue;
-        } else {
-            if(alreadyVisited.find(*neighbours[i]) == alreadyVisited.end()) {
-                // New vertex -> visit it.
-                if(stopFunctor(*neighbours[i], currentVertex)) {
-                    toVisit.push_back(*neighbours[i]);
-                    alreadyVisited.insert(*neighbours[i]);
-                }
-            }
-        }
-    }
+template <typename SharedParts>
+size_t Geometry::getStateSize(const GeometryState& state, SharedParts& sharedParts) const {
+    size_t bytes = sizeof(GeometryState);
+    bytes += state.triangleColors.capacity() * sizeof(uint8_t);
+    bytes += state.colorMap.size() * sizeof(ColorManager::ColorMap::value_type);
+    // Index array of the detail map, up to one slot for each triangle
+    bytes += mTriangles.size() * sizeof(uint32_t);
+    for(const auto& detail : state.triangleDetails) {
+        const TriangleDetail& triangleDetail = detail.second.get();
+        sharedParts.add(&triangleDetail, [&triangleDetail]() { return triangleDetail.getMemoryEstimate(); });
+    }
+    return bytes;
 }
 
 /* -------------------- Serialization -------------------- */
@@ -750,19 +879,17 @@ void Geometry::addNeighboursToQueue(const DetailedTriangleId currentVertex,
 template <class Archive>
 void Geometry::save(Archive& saveArchive) const {
     saveArchive(mColorManager);
-    saveArchive(mTriangles);
+    mTriangles.saveTriangles(saveArchive);
     saveArchive(mTriangleDetails);
-    saveArchive(mPolyhedronData.vertices);
-    saveArchive(mPolyhedronData.indices);
+    mTriangles.saveVertices(saveArchive);
 }
 
 template <class Archive>
 void Geometry::load(Archive& loadArchive) {
     loadArchive(mColorManager);
-    loadArchive(mTriangles);
+    mTriangles.loadTriangles(loadArchive);
     loadArchive(mTriangleDetails);
-    loadArchive(mPolyhedronData.vertices);
-    loadArchive(mPolyhedronData.indices);
+    mTriangles.loadVertices(loadArchive);
 
     // Reset progress
     mProgress->resetLoad();
@@ -771,12 +898,12 @@ void Geometry::load(Archive& loadArchive) {
     mProgress->importRenderPercentage = 1.0f;
     mProgress->importComputePercentage = 1.0f;
 
+    invalidateTemporaryDetailedData();
     updateTemporaryDetailedData();
 
     P_ASSERT(!mTriangles.empty());
     P_ASSERT(!mColorManager.empty());
-    P_ASSERT(!mPolyhedronData.vertices.empty());
-    P_ASSERT(!mPolyhedronData.indices.empty());
+    P_ASSERT(!mTriangles.getVertices().empty());
 }
 
 }  // namespace pepr3d
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include <gtest/gtest.h>
 
+#include "commands/CommandManager.h"
 #include "geometry/Geometry.h"
+#include "geometry/GeometryUtils.h"
 
 /// Return a simple testing geometry of a cube
 pepr3d::Geometry getGeometryWithCube() {
@@ -44,6 +46,8 @@ TEST(Geometry, initialize) {
     geo.updateOpenGlBuffers();
 
     EXPECT_EQ(geo.getTriangleCount(), 12);
+    // The triangles share the corners of the cube
+    EXPECT_EQ(geo.polyVertCount(), 8);
 
     const auto vertexBuffer = geo.getVertexBuffer();
     EXPECT_EQ(vertexBuffer.size(), 36);
@@ -107,4 +111,569 @@ TEST(Geometry, setColor) {
         EXPECT_EQ(colorBuffer.at(i), colorIndex);
     }
 }
-#endif
\ No newline at end of file
+/// Return all non-degenerate triangles in the OpenGL buffers as sorted (vertices, color) tuples
+std::vector<std::array<float, 10>> getBufferTriangles(const pepr3d::Geometry::OpenGlData& glData) {
+    std::vector<std::array<float, 10>> result;
+    for(size_t i = 0; i + 2 < glData.vertexBuffer.size(); i += 3) {
+        const glm::vec3& a = glData.vertexBuffer[i];
+        const glm::vec3& b = glData.vertexBuffer[i + 1];
+        const glm::vec3& c = glData.vertexBuffer[i + 2];
+        if(a == b && b == c) {
+            continue;  // Unused space
+        }
+        result.push_back({a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z, static_cast<float>(glData.colorBuffer[i])});
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+TEST(Geometry, incrementalBufferUpdate) {
+    /**
+     * Test that updating only the painted triangles gives the same buffers as generating them from scratch
+     */
+
+    pepr3d::Geometry geo(getGeometryWithCube());
+    geo.updateOpenGlBuffers();
+
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.3f;
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0)), settings);
+
+    // Only the top triangles were painted
+    ASSERT_TRUE(geo.getOpenGlData().needsUpdate());
+    EXPECT_FALSE(geo.getOpenGlData().isDirty);
+    EXPECT_EQ(geo.getOpenGlData().dirtyTriangles, std::set<size_t>({0, 1}));
+    geo.updateOpenGlBuffers();
+    EXPECT_FALSE(geo.getOpenGlData().needsUpdate());
+    EXPECT_TRUE(geo.getOpenGlData().info.didResize || !geo.getOpenGlData().info.updatedRanges.empty());
+
+    const auto incrementalTriangles = getBufferTriangles(geo.getOpenGlData());
+    EXPECT_GT(incrementalTriangles.size(), 12);
+
+    // Identity color change forces generating all buffers again
+    geo.changeColorIds([](size_t color) { return color; });
+    geo.updateOpenGlBuffers();
+    EXPECT_EQ(incrementalTriangles, getBufferTriangles(geo.getOpenGlData()));
+
+    // Removing the detail frees its slot, the buffer size stays the same
+    const size_t bufferSize = geo.getOpenGlData().vertexBuffer.size();
+    geo.setTriangleColor(0, 2);
+    geo.setTriangleColor(1, 2);
+    geo.updateOpenGlBuffers();
+    EXPECT_EQ(geo.getOpenGlData().vertexBuffer.size(), bufferSize);
+    EXPECT_EQ(getBufferTriangles(geo.getOpenGlData()).size(), 12);
+}
+
+TEST(Geometry, setTrianglesColor) {
+    /**
+     * Test that coloring a set of triangles at once gives the same triangles and buffers as coloring them one by one
+     */
+
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.3f;
+    const ci::Ray ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0));
+
+    pepr3d::Geometry batched(getGeometryWithCube());
+    pepr3d::Geometry single(getGeometryWithCube());
+    for(pepr3d::Geometry* geo : {&batched, &single}) {
+        geo->updateOpenGlBuffers();
+        geo->paintAreaWithSphere(ray, settings);
+        geo->updateOpenGlBuffers();
+    }
+    ASSERT_FALSE(batched.isSimpleTriangle(0));
+    ASSERT_GE(batched.getTriangleDetailCount(0), 2);
+
+    // Two details of a detailed triangle, a detailed triangle as a whole and a run of simple triangles
+    const std::vector<pepr3d::DetailedTriangleId> ids = {
+        pepr3d::DetailedTriangleId(0, 1), pepr3d::DetailedTriangleId(0, 0), pepr3d::DetailedTriangleId(1),
+        pepr3d::DetailedTriangleId(4), pepr3d::DetailedTriangleId(5), pepr3d::DetailedTriangleId(6)};
+    batched.setTrianglesColor(pepr3d::DetailedTriangleSet(ids), 2);
+    for(const pepr3d::DetailedTriangleId id : ids) {
+        single.setTriangleColor(id, 2);
+    }
+
+    EXPECT_TRUE(batched.isSimpleTriangle(1));
+    EXPECT_EQ(batched.getTriangleColor(pepr3d::DetailedTriangleId(0, 1)), 2);
+    for(size_t triangleIdx = 4; triangleIdx <= 6; ++triangleIdx) {
+        EXPECT_EQ(batched.getTriangleColor(triangleIdx), 2);
+    }
+    EXPECT_TRUE(batched.getOpenGlData().info.didColorUpdate || !batched.getOpenGlData().info.updatedRanges.empty());
+
+    batched.updateOpenGlBuffers();
+    single.updateOpenGlBuffers();
+    EXPECT_EQ(getBufferTriangles(batched.getOpenGlData()), getBufferTriangles(single.getOpenGlData()));
+}
+
+/// Area of each color over a base triangle
+std::map<size_t, double> getColorAreas(const pepr3d::Geometry& geo, const size_t triangleIdx) {
+    std::map<size_t, double> areas;
+    const size_t detailCount = std::max<size_t>(geo.getTriangleDetailCount(triangleIdx), 1);
+    for(size_t detailIdx = 0; detailIdx < detailCount; ++detailIdx) {
+        const pepr3d::DetailedTriangleId id = geo.isSimpleTriangle(triangleIdx)
+                                                  ? pepr3d::DetailedTriangleId(triangleIdx)
+                                                  : pepr3d::DetailedTriangleId(triangleIdx, detailIdx);
+        const pepr3d::DataTriangle triangle = geo.getTriangle(id);
+        areas[triangle.getColor()] += std::sqrt(triangle.getTri().squared_area());
+    }
+    return areas;
+}
+
+TEST(Geometry, paintStroke) {
+    /**
+     * Test that painting a whole stroke at once covers the same area of each color as painting its dabs one by one
+     */
+
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.15f;
+    std::vector<ci::Ray> stroke;
+    for(float x = -0.4f; x < 0.4f; x += 0.05f) {
+        stroke.emplace_back(glm::vec3(x, 2, 0.1f * x), glm::vec3(0, -1, 0));
+    }
+
+    pepr3d::Geometry batched(getGeometryWithCube());
+    pepr3d::Geometry single(getGeometryWithCube());
+    batched.paintAreaWithSpheres(stroke, settings);
+    for(const ci::Ray& ray : stroke) {
+        single.paintAreaWithSphere(ray, settings);
+    }
+
+    ASSERT_FALSE(batched.isSimpleTriangle(0));
+    for(size_t triangleIdx = 0; triangleIdx < batched.getTriangleCount(); ++triangleIdx) {
+        EXPECT_EQ(batched.isSimpleTriangle(triangleIdx), single.isSimpleTriangle(triangleIdx));
+        const std::map<size_t, double> batchedAreas = getColorAreas(batched, triangleIdx);
+        const std::map<size_t, double> singleAreas = getColorAreas(single, triangleIdx);
+        ASSERT_EQ(batchedAreas.size(), singleAreas.size());
+        for(const auto& area : batchedAreas) {
+            ASSERT_EQ(singleAreas.count(area.first), 1);
+            EXPECT_NEAR(area.second, singleAreas.at(area.first), 1e-5);
+        }
+    }
+}
+
+TEST(Geometry, paintSweep) {
+    /**
+     * Test that a brush swept between two hits paints the whole capsule between them, and that a sweep too long to
+     * be on one surface paints only a dab at its end
+     */
+
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.1f;
+    const ci::Ray from(glm::vec3(-0.25f, 2, -0.05f), glm::vec3(0, -1, 0));
+    const ci::Ray to(glm::vec3(0.25f, 2, 0.05f), glm::vec3(0, -1, 0));
+
+    // Area painted over the whole cube
+    const auto getPaintedArea = [&settings](const pepr3d::Geometry& geo) {
+        double area = 0.0;
+        for(size_t triangleIdx = 0; triangleIdx < geo.getTriangleCount(); ++triangleIdx) {
+            const std::map<size_t, double> colorAreas = getColorAreas(geo, triangleIdx);
+            if(colorAreas.count(settings.color) > 0) {
+                EXPECT_LE(triangleIdx, 1);  // Only the top face is painted
+                area += colorAreas.at(settings.color);
+            }
+        }
+        return area;
+    };
+
+    // The circles are polygons inscribed into them, a bit smaller than the exact area
+    const double size = settings.size;
+    const double sweepArea =
+        glm::pi<double>() * size * size + 2.0 * size * glm::distance(from.getOrigin(), to.getOrigin());
+
+    pepr3d::Geometry swept(getGeometryWithCube());
+    swept.paintAreaWithSweeps({pepr3d::BrushSweep{from, to}}, settings);
+    ASSERT_FALSE(swept.isSimpleTriangle(0));
+    ASSERT_FALSE(swept.isSimpleTriangle(1));
+    EXPECT_LE(getPaintedArea(swept), sweepArea);
+    EXPECT_GE(getPaintedArea(swept), 0.95 * sweepArea);
+
+    // The sweep between the hits is painted, away from both of them
+    const auto sweptTriangle = swept.intersectDetailedMesh(ci::Ray(glm::vec3(-0.1f, 2, -0.02f), glm::vec3(0, -1, 0)));
+    ASSERT_TRUE(sweptTriangle);
+    EXPECT_EQ(swept.getTriangleColor(*sweptTriangle), settings.color);
+
+    settings.size = 0.05f;
+    const double dabArea = glm::pi<double>() * settings.size * settings.size;
+
+    pepr3d::Geometry dab(getGeometryWithCube());
+    dab.paintAreaWithSweeps({pepr3d::BrushSweep{from, to}}, settings);
+    EXPECT_TRUE(dab.isSimpleTriangle(0));
+    EXPECT_LE(getPaintedArea(dab), dabArea);
+    EXPECT_GE(getPaintedArea(dab), 0.95 * dabArea);
+}
+
+TEST(Geometry, trianglesInRadius) {
+    /**
+     * Test that the triangles in radius and the float triangle bounds agree with the exact distances to the triangles
+     * and to their bounding spheres
+     */
+
+    using Point3 = pepr3d::Geometry::Point3;
+    using Line3 = pepr3d::Geometry::Line3;
+    using Segment3 = pepr3d::DataTriangle::K::Segment_3;
+    pepr3d::Geometry geo(getGeometryWithCube());
+
+    std::vector<std::pair<Point3, double>> bounds;
+    for(size_t i = 0; i < geo.getTriangleCount(); ++i) {
+        bounds.push_back(pepr3d::GeometryUtils::getBoundingSphere(geo.getTriangle(i).getTri()));
+    }
+
+    // Triangles whose bound is closer than radius, computed by CGAL
+    const auto getExpected = [&bounds](const auto& object, const double radius) {
+        std::vector<size_t> expected;
+        for(size_t i = 0; i < bounds.size(); ++i) {
+            const double limit = radius + bounds[i].second;
+            if(CGAL::squared_distance(object, bounds[i].first) <= limit * limit) {
+                expected.push_back(i);
+            }
+        }
+        return expected;
+    };
+
+    // Triangles closer than radius, the distance to a line is reached at an edge unless the line crosses the triangle
+    const auto getSquaredDistance = [&geo](const auto& object, const size_t triIdx) {
+        const auto& tri = geo.getTriangle(triIdx).getTri();
+        if constexpr(std::is_same_v<std::decay_t<decltype(object)>, Line3>) {
+            if(CGAL::do_intersect(object, tri)) {
+                return 0.0;
+            }
+            return CGAL::to_double(std::min({CGAL::squared_distance(object, Segment3(tri.vertex(0), tri.vertex(1))),
+                                             CGAL::squared_distance(object, Segment3(tri.vertex(1), tri.vertex(2))),
+                                             CGAL::squared_distance(object, Segment3(tri.vertex(2), tri.vertex(0)))}));
+        } else {
+            return CGAL::to_double(CGAL::squared_distance(object, tri));
+        }
+    };
+    const auto getExpectedTriangles = [&geo, &getSquaredDistance](const auto& object, const double radius) {
+        std::vector<size_t> expected;
+        for(size_t i = 0; i < geo.getTriangleCount(); ++i) {
+            if(getSquaredDistance(object, i) <= radius * radius) {
+                expected.push_back(i);
+            }
+        }
+        return expected;
+    };
+
+    const auto check = [&](const auto& object, const double radius) {
+        const std::vector<size_t> actual = geo.getTrianglesInRadius(object, radius);
+        const std::vector<size_t> expectedTriangles = getExpectedTriangles(object, radius);
+        const std::vector<size_t> expectedTrianglesTolerated = getExpectedTriangles(object, radius * 1.001 + 1e-4);
+        EXPECT_TRUE(std::includes(actual.begin(), actual.end(), expectedTriangles.begin(), expectedTriangles.end()));
+        EXPECT_TRUE(std::includes(expectedTrianglesTolerated.begin(), expectedTrianglesTolerated.end(), actual.begin(),
+                                  actual.end()));
+
+        const std::vector<size_t> expected = getExpected(object, radius);
+        const std::vector<size_t> expectedTolerated = getExpected(object, radius * 1.001 + 1e-4);
+        for(size_t i = 0; i < bounds.size(); ++i) {
+            const bool isExpected = std::binary_search(expected.begin(), expected.end(), i);
+            const bool isTolerated = std::binary_search(expectedTolerated.begin(), expectedTolerated.end(), i);
+            const bool isInRadius = geo.isTriangleInRadius(object, radius, i);
+            EXPECT_TRUE(isInRadius || !isExpected);
+            EXPECT_TRUE(isTolerated || !isInRadius);
+        }
+    };
+
+    for(const double radius : {0.0, 0.05, 0.2, 0.5, 1.0}) {
+        check(Point3(0, 2, 0), radius);
+        check(Point3(0.25, 0.5, -0.1), radius);
+        check(Point3(-3, 0.4, 0.4), radius);
+        check(Line3(Point3(0, 2, 0), Point3(0, 1, 0)), radius);
+        check(Line3(Point3(1.5, 0, 0), Point3(0, 1, 1.3)), radius);
+    }
+}
+
+TEST(Geometry, undoSharesDetails) {
+    /**
+     * Test that a saved state keeps its details when they are painted over later, and that loading it restores
+     * the details and the detailed mesh
+     */
+
+    pepr3d::Geometry geo(getGeometryWithCube());
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.3f;
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0)), settings);
+    ASSERT_FALSE(geo.isSimpleTriangle(0));
+    geo.updateTemporaryDetailedData();
+
+    const auto getDetailColors = [&geo](const size_t triangleIdx) {
+        std::vector<size_t> colors;
+        for(size_t detailIdx = 0; detailIdx < geo.getTriangleDetailCount(triangleIdx); ++detailIdx) {
+            colors.push_back(geo.getTriangleColor(pepr3d::DetailedTriangleId(triangleIdx, detailIdx)));
+        }
+        return colors;
+    };
+    const std::vector<size_t> savedColors = getDetailColors(0);
+    const auto state = geo.saveState();
+
+    // Paint over the saved detail and detail another side of the cube
+    settings.color = 2;
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0)), settings);
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(2, 0, 0), glm::vec3(-1, 0, 0)), settings);
+    ASSERT_FALSE(geo.isSimpleTriangle(4));
+    EXPECT_NE(getDetailColors(0), savedColors);
+    geo.updateTemporaryDetailedData();
+
+    geo.loadState(state);
+    EXPECT_EQ(getDetailColors(0), savedColors);
+    EXPECT_TRUE(geo.isSimpleTriangle(4));
+    EXPECT_TRUE(geo.isSimpleTriangle(5));
+
+    geo.updateTemporaryDetailedData();
+    size_t detailedFaceCount = 0;
+    for(size_t triangleIdx = 0; triangleIdx < geo.getTriangleCount(); ++triangleIdx) {
+        detailedFaceCount += geo.isSimpleTriangle(triangleIdx) ? 1 : geo.getTriangleDetailCount(triangleIdx);
+    }
+    ASSERT_NE(geo.getMeshDetailed(), nullptr);
+    EXPECT_EQ(geo.getMeshDetailed()->number_of_faces(), detailedFaceCount);
+}
+
+TEST(Geometry, stateSizeSharesDetails) {
+    /**
+     * Test that saved states report their details as shared parts, so that a detail shared by several states is
+     * counted once and a detail painted over after saving stays counted for the states that keep it
+     */
+
+    pepr3d::Geometry geo(getGeometryWithCube());
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.3f;
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0)), settings);
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(2, 0, 0), glm::vec3(-1, 0, 0)), settings);
+    ASSERT_FALSE(geo.isSimpleTriangle(0));
+    ASSERT_FALSE(geo.isSimpleTriangle(4));
+
+    const auto getDetailBytes = [](const auto& state) {
+        size_t bytes = 0;
+        for(const auto& detail : state.triangleDetails) {
+            bytes += detail.second->getMemoryEstimate();
+        }
+        return bytes;
+    };
+
+    pepr3d::SharedStateParts sharedParts;
+    const auto first = geo.saveState();
+    const size_t firstBytes = geo.getStateSize(first, sharedParts);
+    const std::vector<const void*> firstParts = sharedParts.takeAddedParts();
+    EXPECT_EQ(firstParts.size(), first.triangleDetails.size());
+    EXPECT_EQ(sharedParts.getBytes(), getDetailBytes(first));
+
+    // The second state shares all details of the first one
+    const auto second = geo.saveState();
+    EXPECT_EQ(geo.getStateSize(second, sharedParts), firstBytes);
+    const std::vector<const void*> secondParts = sharedParts.takeAddedParts();
+    EXPECT_EQ(sharedParts.getBytes(), getDetailBytes(first));
+
+    // Painting over the top clones its details, the saved states keep the old ones
+    settings.color = 2;
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0)), settings);
+    const auto third = geo.saveState();
+    geo.getStateSize(third, sharedParts);
+    const std::vector<const void*> thirdParts = sharedParts.takeAddedParts();
+    size_t paintedDetailBytes = 0;
+    size_t sharedDetailCount = 0;
+    for(const auto& detail : third.triangleDetails) {
+        const auto* firstDetail = first.triangleDetails.find(detail.first);
+        if(firstDetail != nullptr && firstDetail->isSameValue(detail.second)) {
+            ++sharedDetailCount;
+        } else {
+            paintedDetailBytes += detail.second->getMemoryEstimate();
+        }
+    }
+    EXPECT_GT(sharedDetailCount, 0);
+    ASSERT_GT(paintedDetailBytes, 0);
+    EXPECT_EQ(sharedParts.getBytes(), getDetailBytes(first) + paintedDetailBytes);
+
+    // Without the older states only the details of the third one are left
+    sharedParts.remove(firstParts);
+    EXPECT_EQ(sharedParts.getBytes(), getDetailBytes(first) + paintedDetailBytes);
+    sharedParts.remove(secondParts);
+    EXPECT_EQ(sharedParts.getBytes(), getDetailBytes(third));
+    sharedParts.remove(thirdParts);
+    EXPECT_EQ(sharedParts.getBytes(), 0);
+}
+
+TEST(Geometry, intersectDetailedMesh) {
+    /**
+     * Test that the two-level tree finds the detail triangle hit by the ray, also after the detail changes
+     */
+
+    pepr3d::Geometry geo(getGeometryWithCube());
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.2f;
+
+    const auto checkHits = [&geo]() {
+        for(float x = -0.43f; x < 0.5f; x += 0.1f) {
+            for(float z = -0.46f; z < 0.5f; z += 0.1f) {
+                const ci::Ray ray(glm::vec3(x, 2, z), glm::vec3(0, -1, 0));
+                const std::optional<pepr3d::DetailedTriangleId> hit = geo.intersectDetailedMesh(ray);
+                ASSERT_TRUE(hit);
+                EXPECT_EQ(hit->getBaseId(), *geo.intersectMesh(ray));
+                EXPECT_EQ(static_cast<bool>(hit->getDetailId()), !geo.isSimpleTriangle(hit->getBaseId()));
+
+                const pepr3d::Geometry::Ray rayQuery(pepr3d::Geometry::Point3(x, 2, z),
+                                                     pepr3d::Geometry::Direction(0, -1, 0));
+                EXPECT_TRUE(CGAL::do_intersect(rayQuery, geo.getTriangle(*hit).getTri()));
+            }
+        }
+    };
+
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0, 2, 0), glm::vec3(0, -1, 0)), settings);
+    ASSERT_FALSE(geo.isSimpleTriangle(0));
+    checkHits();
+
+    // Painting again changes the details, their trees have to be rebuilt
+    settings.color = 2;
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0.3f, 2, 0.2f), glm::vec3(0, -1, 0)), settings);
+    checkHits();
+}
+
+/// Neighbours of each face of the detailed mesh by their packed triangle IDs, independent of the order of the faces
+std::map<uint64_t, std::multiset<uint64_t>> getDetailedNeighbours(const pepr3d::Geometry& geo) {
+    const pepr3d::PolyhedronData::Mesh& mesh = *geo.getMeshDetailed();
+    const auto& idMap = geo.getMeshDetailedIdMap();
+    const pepr3d::BucketSpread::Adjacency& adjacency = geo.getMeshDetailedAdjacency();
+    std::map<uint64_t, std::multiset<uint64_t>> neighbours;
+    for(const pepr3d::PolyhedronData::face_descriptor face : mesh.faces()) {
+        std::multiset<uint64_t>& faceNeighbours = neighbours[idMap[face].getPacked()];
+        for(const int neighbour : adjacency[static_cast<size_t>(face)]) {
+            if(neighbour >= 0) {
+                const auto neighbourFace = pepr3d::PolyhedronData::face_descriptor(
+                    static_cast<pepr3d::PolyhedronData::Mesh::size_type>(neighbour));
+                faceNeighbours.insert(idMap[neighbourFace].getPacked());
+            }
+        }
+    }
+    return neighbours;
+}
+
+/// Packed IDs of the triangles reached by a detailed bucket spread of one color
+std::vector<uint64_t> getColorBucket(pepr3d::Geometry& geo, const pepr3d::DetailedTriangleId start) {
+    const auto colorStopping = [&geo](const pepr3d::DetailedTriangleId a, const pepr3d::DetailedTriangleId b) {
+        return geo.getTriangleColor(a) == geo.getTriangleColor(b);
+    };
+    std::vector<uint64_t> reached;
+    for(const pepr3d::DetailedTriangleId id : geo.bucket(start, colorStopping)) {
+        reached.push_back(id.getPacked());
+    }
+    std::sort(reached.begin(), reached.end());
+    return reached;
+}
+
+TEST(Geometry, patchDetailedMesh) {
+    /**
+     * Test that the detailed mesh patched after each of several overlapping strokes is the same as the one built at
+     * once for the final state
+     */
+
+    pepr3d::Geometry patched(getGeometryWithCube());
+    patched.updateTemporaryDetailedData();
+    ASSERT_NE(patched.getMeshDetailed(), nullptr);
+
+    pepr3d::BrushSettings settings;
+    settings.size = 0.15f;
+    // Strokes in different directions through the middle of the top side, crossing each other
+    for(int strokeIdx = 0; strokeIdx < 4; ++strokeIdx) {
+        settings.color = strokeIdx % 2 + 1;
+        const float angle = static_cast<float>(strokeIdx) * glm::pi<float>() / 4.0f;
+        std::vector<ci::Ray> stroke;
+        for(float t = -0.4f; t < 0.4f; t += 0.05f) {
+            stroke.emplace_back(glm::vec3(t * std::cos(angle), 2, t * std::sin(angle)), glm::vec3(0, -1, 0));
+        }
+        patched.paintAreaWithSpheres(stroke, settings);
+        patched.updateTemporaryDetailedData();
+        ASSERT_TRUE(patched.isTemporaryDetailedDataValid());
+    }
+    ASSERT_FALSE(patched.isSimpleTriangle(0));
+    ASSERT_FALSE(patched.isSimpleTriangle(1));
+
+    pepr3d::Geometry fresh(getGeometryWithCube());
+    fresh.loadState(patched.saveState());
+    fresh.updateTemporaryDetailedData();
+    ASSERT_NE(fresh.getMeshDetailed(), nullptr);
+
+    const pepr3d::PolyhedronData::Mesh& patchedMesh = *patched.getMeshDetailed();
+    const pepr3d::PolyhedronData::Mesh& freshMesh = *fresh.getMeshDetailed();
+    EXPECT_TRUE(patchedMesh.is_valid());
+    EXPECT_EQ(patchedMesh.number_of_faces(), freshMesh.number_of_faces());
+    EXPECT_EQ(patchedMesh.number_of_vertices(), freshMesh.number_of_vertices());
+    EXPECT_EQ(getDetailedNeighbours(patched), getDetailedNeighbours(fresh));
+
+    for(size_t detailIdx = 0; detailIdx < patched.getTriangleDetailCount(0); ++detailIdx) {
+        const pepr3d::DetailedTriangleId start(0, detailIdx);
+        EXPECT_EQ(getColorBucket(patched, start), getColorBucket(fresh, start));
+    }
+}
+
+TEST(Geometry, strokeOverSharedEdge) {
+    /**
+     * Test that a stroke over the edge between two detailed triangles leaves matching vertices on both sides of the
+     * edge, so that the patched detailed mesh has a face for each triangle and stays closed
+     */
+
+    pepr3d::Geometry geo(getGeometryWithCube());
+    pepr3d::BrushSettings settings;
+    settings.color = 1;
+    settings.size = 0.1f;
+    // Detail both triangles of the top side away from their shared diagonal
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(-0.3f, 2, -0.3f), glm::vec3(0, -1, 0)), settings);
+    geo.paintAreaWithSphere(ci::Ray(glm::vec3(0.3f, 2, 0.3f), glm::vec3(0, -1, 0)), settings);
+    ASSERT_FALSE(geo.isSimpleTriangle(0));
+    ASSERT_FALSE(geo.isSimpleTriangle(1));
+    geo.updateTemporaryDetailedData();
+
+    settings.color = 2;
+    std::vector<ci::Ray> stroke;
+    for(float t = -0.3f; t < 0.3f; t += 0.05f) {
+        stroke.emplace_back(glm::vec3(t, 2, t), glm::vec3(0, -1, 0));
+    }
+    geo.paintAreaWithSpheres(stroke, settings);
+    geo.updateTemporaryDetailedData();
+    ASSERT_TRUE(geo.isTemporaryDetailedDataValid());
+
+    const pepr3d::PolyhedronData::Mesh& mesh = *geo.getMeshDetailed();
+    size_t detailedFaceCount = 0;
+    for(size_t triangleIdx = 0; triangleIdx < geo.getTriangleCount(); ++triangleIdx) {
+        const size_t detailCount = std::max<size_t>(geo.getTriangleDetailCount(triangleIdx), 1);
+        for(size_t detailIdx = 0; detailIdx < detailCount; ++detailIdx) {
+            const pepr3d::DetailedTriangleId id = geo.isSimpleTriangle(triangleIdx)
+                                                      ? pepr3d::DetailedTriangleId(triangleIdx)
+                                                      : pepr3d::DetailedTriangleId(triangleIdx, detailIdx);
+            const pepr3d::PolyhedronData::face_descriptor* face = geo.getMeshDetailedFaceDescs().find(id);
+            ASSERT_NE(face, nullptr);
+            EXPECT_NE(*face, pepr3d::PolyhedronData::Mesh::null_face());
+        }
+        detailedFaceCount += detailCount;
+    }
+    EXPECT_EQ(mesh.number_of_faces(), detailedFaceCount);
+
+    // The cube is closed, an unmatched vertex on an edge would leave border halfedges around it
+    EXPECT_TRUE(mesh.is_valid());
+    for(const pepr3d::PolyhedronData::halfedge_descriptor halfedge : mesh.halfedges()) {
+        EXPECT_FALSE(mesh.is_border(halfedge));
+    }
+
+    // Vertices of each side on the diagonal x = -z of the top
+    const auto getDiagonalVertices = [&geo](const size_t triangleIdx) {
+        std::set<std::tuple<float, float, float>> vertices;
+        for(size_t detailIdx = 0; detailIdx < geo.getTriangleDetailCount(triangleIdx); ++detailIdx) {
+            const pepr3d::DataTriangle triangle = geo.getTriangle(pepr3d::DetailedTriangleId(triangleIdx, detailIdx));
+            for(size_t i = 0; i < 3; ++i) {
+                const glm::vec3 vertex = triangle.getVertex(i);
+                if(std::abs(vertex.x + vertex.z) < 1e-5f) {
+                    vertices.emplace(vertex.x, vertex.y, vertex.z);
+                }
+            }
+        }
+        return vertices;
+    };
+    const std::set<std::tuple<float, float, float>> diagonalVertices = getDiagonalVertices(0);
+    EXPECT_GT(diagonalVertices.size(), 2);
+    EXPECT_EQ(diagonalVertices, getDiagonalVertices(1));
+}
+
+#endif
@@ -12,12 +12,16 @@ struct GeometryProgress {
     std::atomic<float> aabbTreePercentage{-1.0f};
     std::atomic<float> polyhedronPercentage{-1.0f};
 
+    /// Duration of joining the vertices of the imported model in milliseconds
+    std::atomic<float> weldTimeMs{-1.0f};
+
     void resetLoad() {
         importRenderPercentage = -1.0f;
         importComputePercentage = -1.0f;
         buffersPercentage = -1.0f;
         aabbTreePercentage = -1.0f;
         polyhedronPercentage = -1.0f;
+        weldTimeMs = -1.0f;
     }
 
     std::atomic<float> createScenePercentage{-1.0f};
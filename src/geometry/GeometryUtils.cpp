@@ -5,6 +5,7 @@
 #include <CGAL/Aff_transformation_3.h>
 #include <CGAL/Min_sphere_of_points_d_traits_3.h>
 #include <CGAL/Min_sphere_of_spheres_d.h>
+#include <CGAL/convex_hull_2.h>
 
 namespace pepr3d {
 
@@ -19,6 +20,27 @@ float GeometryUtils::segmentPointDistanceSquared(const glm::vec3 &start, const g
     return static_cast<float>(CGAL::squared_distance(segment, cgPoint));
 }
 
+float GeometryUtils::segmentsDistanceSquared(const glm::vec3 &firstStart, const glm::vec3 &firstEnd,
+                                             const glm::vec3 &secondStart, const glm::vec3 &secondEnd) {
+    using K = CGAL::Simple_cartesian<double>;
+    using Point = K::Point_3;
+    using Segment = K::Segment_3;
+
+    // Degenerate segments are points, CGAL does not handle them as segments
+    if(firstStart == firstEnd) {
+        return segmentPointDistanceSquared(secondStart, secondEnd, firstStart);
+    }
+    if(secondStart == secondEnd) {
+        return segmentPointDistanceSquared(firstStart, firstEnd, secondStart);
+    }
+
+    const Segment first(Point(firstStart.x, firstStart.y, firstStart.z), Point(firstEnd.x, firstEnd.y, firstEnd.z));
+    const Segment second(Point(secondStart.x, secondStart.y, secondStart.z),
+                         Point(secondEnd.x, secondEnd.y, secondEnd.z));
+
+    return static_cast<float>(CGAL::squared_distance(first, second));
+}
+
 std::optional<glm::vec3> GeometryUtils::triangleRayIntersection(const DataTriangle &tri, ci::Ray ray) {
     const glm::vec3 source = ray.getOrigin();
     const glm::vec3 direction = ray.getDirection();
@@ -46,6 +68,57 @@ bool GeometryUtils::isFullyInsideASphere(const DataTriangle::K::Triangle_3 &tri,
     return dist0 <= radiusSquared && dist1 <= radiusSquared && dist2 <= radiusSquared;
 }
 
+bool GeometryUtils::isFullyInsideACapsule(const DataTriangle::K::Triangle_3 &tri, const glm::vec3 &start,
+                                          const glm::vec3 &end, double radius) {
+    if(start == end) {
+        return isFullyInsideASphere(tri, start, radius);
+    }
+
+    // All three points must be closer to the segment than the radius
+    const double radiusSquared = radius * radius;
+    for(int i = 0; i < 3; ++i) {
+        const auto &vertex = tri.vertex(i);
+        const glm::vec3 point(static_cast<float>(vertex.x()), static_cast<float>(vertex.y()),
+                              static_cast<float>(vertex.z()));
+        if(segmentPointDistanceSquared(start, end, point) > radiusSquared) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<DataTriangle::K::Point_3> GeometryUtils::projectedConvexHull(
+    const std::vector<DataTriangle::K::Point_3> &points, const DataTriangle::K::Plane_3 &plane,
+    const DataTriangle::K::Vector_3 &direction) {
+    using K = DataTriangle::K;
+
+    const K::Vector_3 normal = plane.orthogonal_vector();
+    const double directionDot = CGAL::to_double(normal * direction);
+    if(std::abs(directionDot) < std::numeric_limits<double>::epsilon()) {
+        return {};  // The projection is parallel to the plane
+    }
+
+    // Project along the direction, the plane-space points are then hulled in 2D
+    std::vector<K::Point_2> projected;
+    projected.reserve(points.size());
+    for(const K::Point_3 &point : points) {
+        const double t = -CGAL::to_double(plane.a() * point.x() + plane.b() * point.y() + plane.c() * point.z() +
+                                          plane.d()) /
+                         directionDot;
+        projected.push_back(plane.to_2d(point + direction * t));
+    }
+
+    std::vector<K::Point_2> hull;
+    CGAL::convex_hull_2(projected.begin(), projected.end(), std::back_inserter(hull));
+
+    std::vector<K::Point_3> result;
+    result.reserve(hull.size());
+    for(const K::Point_2 &point : hull) {
+        result.push_back(plane.to_3d(point));
+    }
+    return result;
+}
+
 std::pair<DataTriangle::K::Point_3, double> GeometryUtils::getBoundingSphere(
     const std::vector<DataTriangle::K::Point_3> &shape) {
     using K = DataTriangle::K;
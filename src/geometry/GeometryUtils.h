@@ -182,6 +182,10 @@ class GeometryUtils {
     /// Find squared distance between a line segment and a point in 3D space
     static float segmentPointDistanceSquared(const glm::vec3& start, const glm::vec3& end, const glm::vec3& point);
 
+    /// Find squared distance between two line segments in 3D space, either of them may be a single point
+    static float segmentsDistanceSquared(const glm::vec3& firstStart, const glm::vec3& firstEnd,
+                                         const glm::vec3& secondStart, const glm::vec3& secondEnd);
+
     /// Find intersection point of a ray and a single triangle
     /// If the intersection is a segment return one of the edge points
     static std::optional<glm::vec3> triangleRayIntersection(const class DataTriangle& tri, ci::Ray ray);
@@ -192,6 +196,18 @@ class GeometryUtils {
     static bool isFullyInsideASphere(const DataTriangle::K::Triangle_3& tri, const glm::vec3& origin, double radius) {
         return isFullyInsideASphere(tri, DataTriangle::K::Point_3(origin.x, origin.y, origin.z), radius);
     }
+
+    /// Is the triangle inside a capsule, i.e. are all its points closer than the radius to the segment
+    static bool isFullyInsideACapsule(const DataTriangle::K::Triangle_3& tri, const glm::vec3& start,
+                                      const glm::vec3& end, double radius);
+
+    /// Convex hull of the points projected onto the plane along the direction, e.g. the area swept by moving a
+    /// convex shape from one place to another.
+    /// @return Points of the hull in the plane, counterclockwise in its 2D space. Empty if the direction is parallel
+    /// to the plane.
+    static std::vector<DataTriangle::K::Point_3> projectedConvexHull(
+        const std::vector<DataTriangle::K::Point_3>& points, const DataTriangle::K::Plane_3& plane,
+        const DataTriangle::K::Vector_3& direction);
 };
 
 }  // namespace pepr3d
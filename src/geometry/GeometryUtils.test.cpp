@@ -28,6 +28,31 @@ TEST(GeometryUtils, segmentPointDistanceSquared) {
     EXPECT_FLOAT_EQ(dist, 0.f);
 }
 
+TEST(GeometryUtils, segmentsDistanceSquared) {
+    /**
+     * Test calculating the distance between two segments, also when one of them is a single point
+     */
+
+    const vec3 start(0, 0, 0);
+    const vec3 end(10, 0, 0);
+
+    auto dist = pepr3d::GeometryUtils::segmentsDistanceSquared(start, end, vec3(5, 2, -1), vec3(5, 2, 1));
+    EXPECT_FLOAT_EQ(dist, 4.f);
+
+    dist = pepr3d::GeometryUtils::segmentsDistanceSquared(start, end, vec3(12, 1, 0), vec3(12, -1, 0));
+    EXPECT_FLOAT_EQ(dist, 4.f);
+
+    dist = pepr3d::GeometryUtils::segmentsDistanceSquared(start, end, vec3(5, -1, 0), vec3(5, 1, 0));
+    EXPECT_FLOAT_EQ(dist, 0.f);
+
+    // Degenerate segments are the same as a point
+    const vec3 point(-1, 0, 0);
+    dist = pepr3d::GeometryUtils::segmentsDistanceSquared(start, end, point, point);
+    EXPECT_FLOAT_EQ(dist, pepr3d::GeometryUtils::segmentPointDistanceSquared(start, end, point));
+    dist = pepr3d::GeometryUtils::segmentsDistanceSquared(point, point, start, end);
+    EXPECT_FLOAT_EQ(dist, 1.f);
+}
+
 TEST(GeometryUtils, ShoelaceOrientationTest) {
     /**
      * Test orienting the vertices in polygons, setting it to either COUNTERCLOCKWISE or CLOCKWISE
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/vector.hpp>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "geometry/GlmSerialization.h"
+#include "geometry/Triangle.h"
+#include "peprassert.h"
+
+namespace pepr3d {
+
+/// Triangles of the original model in structure-of-arrays form. All triangles index a single array of vertex
+/// positions with 32-bit indices, their normals and 8-bit colors are kept in separate arrays.
+/// A DataTriangle or a CGAL triangle is built only when a single triangle is requested.
+class IndexedTriangles {
+   public:
+    /// Indices of the three vertices of a triangle, in CCW order
+    using Indices = std::array<uint32_t, 3>;
+
+   private:
+    /// Vertex positions shared by all triangles
+    std::vector<glm::vec3> mVertices;
+
+    /// Vertices of each triangle
+    std::vector<Indices> mIndices;
+
+    /// Normal of each triangle
+    std::vector<glm::vec3> mNormals;
+
+    /// Color of each triangle
+    std::vector<uint8_t> mColors;
+
+   public:
+    IndexedTriangles() = default;
+
+    /// Triangles of the vertices and indices, the i-th triangle takes its normal and color from the i-th DataTriangle.
+    /// The positions of the DataTriangles are not used, they are expected to be the same as the indexed ones.
+    IndexedTriangles(std::vector<glm::vec3>&& vertices, std::vector<Indices>&& indices,
+                     const std::vector<DataTriangle>& triangles)
+        : mVertices(std::move(vertices)), mIndices(std::move(indices)) {
+        P_ASSERT(mIndices.size() == triangles.size());
+        P_ASSERT(mVertices.size() <= std::numeric_limits<uint32_t>::max());
+
+        mNormals.reserve(triangles.size());
+        mColors.reserve(triangles.size());
+        for(const DataTriangle& triangle : triangles) {
+            mNormals.push_back(triangle.getNormal());
+            mColors.push_back(static_cast<uint8_t>(triangle.getColor()));
+        }
+    }
+
+    /// Number of triangles
+    size_t size() const {
+        return mIndices.size();
+    }
+
+    bool empty() const {
+        return mIndices.empty();
+    }
+
+    void clear() {
+        mVertices.clear();
+        mIndices.clear();
+        mNormals.clear();
+        mColors.clear();
+    }
+
+    const std::vector<glm::vec3>& getVertices() const {
+        return mVertices;
+    }
+
+    const std::vector<Indices>& getIndices() const {
+        return mIndices;
+    }
+
+    const std::vector<uint8_t>& getColors() const {
+        return mColors;
+    }
+
+    /// Position of the i-th vertex of the triangle
+    glm::vec3 getVertex(const size_t triangleIdx, const size_t i) const {
+        P_ASSERT(triangleIdx < mIndices.size());
+        P_ASSERT(i < 3);
+        return mVertices[mIndices[triangleIdx][i]];
+    }
+
+    glm::vec3 getNormal(const size_t triangleIdx) const {
+        P_ASSERT(triangleIdx < mNormals.size());
+        return mNormals[triangleIdx];
+    }
+
+    size_t getColor(const size_t triangleIdx) const {
+        P_ASSERT(triangleIdx < mColors.size());
+        return mColors[triangleIdx];
+    }
+
+    void setColor(const size_t triangleIdx, const size_t newColor) {
+        P_ASSERT(triangleIdx < mColors.size());
+        P_ASSERT(newColor <= std::numeric_limits<uint8_t>::max());
+        mColors[triangleIdx] = static_cast<uint8_t>(newColor);
+    }
+
+    /// Replace the colors of all triangles
+    void setColors(const std::vector<uint8_t>& colors) {
+        P_ASSERT(colors.size() == mColors.size());
+        mColors = colors;
+    }
+
+    /// Copy of the triangle with all its data
+    DataTriangle getTriangle(const size_t triangleIdx) const {
+        return DataTriangle(getVertex(triangleIdx, 0), getVertex(triangleIdx, 1), getVertex(triangleIdx, 2),
+                            getNormal(triangleIdx), getColor(triangleIdx));
+    }
+
+    /* -------------------- Serialization -------------------- */
+    // Binary project files store the triangles as a vector of DataTriangles, followed by other data and then the
+    // vertices and size_t indices. The triangles and the vertices are therefore written and read by two separate calls.
+
+    /// Write the triangles in the binary layout of a std::vector<DataTriangle>
+    template <class Archive>
+    void saveTriangles(Archive& archive) const {
+        archive(cereal::make_size_tag(static_cast<cereal::size_type>(size())));
+        for(size_t triangleIdx = 0; triangleIdx < size(); ++triangleIdx) {
+            archive(getTriangle(triangleIdx));
+        }
+    }
+
+    /// Read the normals and colors of triangles written by saveTriangles, loadVertices has to follow
+    template <class Archive>
+    void loadTriangles(Archive& archive) {
+        clear();
+
+        cereal::size_type triangleCount;
+        archive(cereal::make_size_tag(triangleCount));
+        mNormals.reserve(static_cast<size_t>(triangleCount));
+        mColors.reserve(static_cast<size_t>(triangleCount));
+        for(cereal::size_type triangleIdx = 0; triangleIdx < triangleCount; ++triangleIdx) {
+            DataTriangle triangle;
+            archive(triangle);
+            mNormals.push_back(triangle.getNormal());
+            mColors.push_back(static_cast<uint8_t>(triangle.getColor()));
+        }
+    }
+
+    /// Write the vertices and the indices as std::array<size_t, 3>
+    template <class Archive>
+    void saveVertices(Archive& archive) const {
+        archive(mVertices);
+        archive(cereal::make_size_tag(static_cast<cereal::size_type>(mIndices.size())));
+        for(const Indices& indices : mIndices) {
+            archive(std::array<size_t, 3>{indices[0], indices[1], indices[2]});
+        }
+    }
+
+    /// Read the vertices and indices written by saveVertices
+    template <class Archive>
+    void loadVertices(Archive& archive) {
+        archive(mVertices);
+        P_ASSERT(mVertices.size() <= std::numeric_limits<uint32_t>::max());
+
+        cereal::size_type triangleCount;
+        archive(cereal::make_size_tag(triangleCount));
+        P_ASSERT(static_cast<size_t>(triangleCount) == mNormals.size());
+        mIndices.resize(static_cast<size_t>(triangleCount));
+        for(Indices& indices : mIndices) {
+            std::array<size_t, 3> values;
+            archive(values);
+            for(size_t i = 0; i < 3; ++i) {
+                P_ASSERT(values[i] < mVertices.size());
+                indices[i] = static_cast<uint32_t>(values[i]);
+            }
+        }
+    }
+};
+
+}  // namespace pepr3d
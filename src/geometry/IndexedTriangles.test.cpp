@@ -0,0 +1,79 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "geometry/IndexedTriangles.h"
+#include "geometry/VertexWelder.h"
+
+namespace {
+
+using pepr3d::DataTriangle;
+using pepr3d::IndexedTriangles;
+
+/// Two quads of two triangles each, sharing an edge
+std::vector<DataTriangle> getQuadsSoup() {
+    const glm::vec3 up(0.f, 0.f, 1.f);
+    const std::vector<glm::vec3> points = {{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {1.f, 1.f, 0.f},
+                                           {0.f, 1.f, 0.f}, {2.f, 0.f, 0.f}, {2.f, 1.f, 0.f}};
+    return {DataTriangle(points[0], points[1], points[2], up, 0), DataTriangle(points[0], points[2], points[3], up, 1),
+            DataTriangle(points[1], points[4], points[5], up, 2), DataTriangle(points[1], points[5], points[2], up, 3)};
+}
+
+}  // namespace
+
+TEST(IndexedTriangles, sharedVertices) {
+    /**
+     * Test that the triangles built from the welded vertices equal the triangle soup and share their vertices
+     */
+    const std::vector<DataTriangle> soup = getQuadsSoup();
+    std::vector<DataTriangle> triangles = soup;
+    std::vector<glm::vec3> vertices;
+    std::vector<IndexedTriangles::Indices> indices;
+    ::ThreadPool threadPool(2);
+    pepr3d::VertexWelder::weld(triangles, 0.f, vertices, indices, threadPool);
+
+    const IndexedTriangles indexed(std::move(vertices), std::move(indices), triangles);
+    ASSERT_EQ(indexed.size(), soup.size());
+    EXPECT_EQ(indexed.getVertices().size(), 6);
+
+    for(size_t triIdx = 0; triIdx < soup.size(); ++triIdx) {
+        const DataTriangle triangle = indexed.getTriangle(triIdx);
+        for(size_t i = 0; i < 3; ++i) {
+            EXPECT_EQ(indexed.getVertex(triIdx, i), soup[triIdx].getVertex(i));
+            EXPECT_EQ(triangle.getVertex(i), soup[triIdx].getVertex(i));
+        }
+        EXPECT_EQ(triangle.getNormal(), soup[triIdx].getNormal());
+        EXPECT_EQ(triangle.getColor(), soup[triIdx].getColor());
+        EXPECT_EQ(indexed.getColor(triIdx), soup[triIdx].getColor());
+    }
+
+    // The shared edge of the quads references the same vertices
+    EXPECT_EQ(indexed.getIndices()[0][1], indexed.getIndices()[2][0]);
+    EXPECT_EQ(indexed.getIndices()[0][2], indexed.getIndices()[3][2]);
+}
+
+TEST(IndexedTriangles, colors) {
+    /**
+     * Test setting the colors of single triangles and of all triangles at once
+     */
+    std::vector<DataTriangle> triangles = getQuadsSoup();
+    std::vector<glm::vec3> vertices;
+    std::vector<IndexedTriangles::Indices> indices;
+    ::ThreadPool threadPool(1);
+    pepr3d::VertexWelder::weld(triangles, 0.f, vertices, indices, threadPool);
+    IndexedTriangles indexed(std::move(vertices), std::move(indices), triangles);
+
+    indexed.setColor(1, 15);
+    EXPECT_EQ(indexed.getColor(1), 15);
+    EXPECT_EQ(indexed.getTriangle(1).getColor(), 15);
+    EXPECT_EQ(indexed.getColors(), (std::vector<uint8_t>{0, 15, 2, 3}));
+
+    const std::vector<uint8_t> saved = indexed.getColors();
+    indexed.setColors({5, 5, 5, 5});
+    EXPECT_EQ(indexed.getColor(3), 5);
+    indexed.setColors(saved);
+    EXPECT_EQ(indexed.getColors(), saved);
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "geometry/AssimpProgress.h"
+#include "geometry/CancellationToken.h"
 #include "geometry/ExportType.h"
 #include "geometry/Geometry.h"
 #include "geometry/GeometryProgress.h"
@@ -33,6 +34,7 @@ class ModelExporter {
     ModelExporter(const Geometry *geometry, GeometryProgress *progress) : mGeometry(geometry), mProgress(progress) {}
 
     /// Returns a map where each color index has a corresponding exported Assimp scene.
+    /// Throws OperationCancelledException when the operation running on this thread is cancelled.
     std::map<colorIndex, std::unique_ptr<aiScene>> createScenes(ExportType exportType) {
         switch(exportType) {
         case ExportType::Surface: return createPolySurfaceScenes(); break;
@@ -68,6 +70,7 @@ class ModelExporter {
 
         int sceneCounter = 0;
         for(auto &scene : scenes) {
+            CancellationToken::checkCurrent();
             std::stringstream ss;
             ss << filePath << "/" << fileName << "_" << sceneCounter << "." << fileType;
             auto exportResult = exporter.Export(scene.second.get(), assimpFileType, ss.str());
@@ -112,6 +115,7 @@ class ModelExporter {
         }
 
         for(auto &indexOfColor : colorsWithIndices) {
+            CancellationToken::checkCurrent();
             scenes[indexOfColor.first] = std::move(createNewNonPolySurfaceScene(indexOfColor.second));
         }
 
@@ -131,6 +135,7 @@ class ModelExporter {
         }
 
         for(auto &indexOfColor : colorsWithIndices) {
+            CancellationToken::checkCurrent();
             scenes[indexOfColor.first] = std::move(createNewPolySurfaceScene(indexOfColor.second));
         }
 
@@ -150,6 +155,7 @@ class ModelExporter {
         std::map<std::array<std::array<float, 3>, 2>, IndexedEdge> edgeLookup;
 
         for(unsigned int i = 0; i < mGeometry->getTriangleCount(); i++) {
+            CancellationToken::checkCurrent();
             colorIndex color = mGeometry->getTriangle(i).getColor();
             colorsWithIndices[color].emplace_back(static_cast<unsigned int>(i));
 
@@ -177,6 +183,7 @@ class ModelExporter {
         computeBoundaryEdges(edgeLookup);
 
         for(auto &indexOfColor : colorsWithIndices) {
+            CancellationToken::checkCurrent();
             auto soloBoundary = selectBoundaryEdgesByColor(edgeLookup, indexOfColor.first);
 
             scenes[indexOfColor.first] = std::move(createNewNonPolyScene(
@@ -236,6 +243,7 @@ class ModelExporter {
         }
 
         for(PolyhedronData::vertex_descriptor vd : mGeometry->getMeshDetailed()->vertices()) {
+            CancellationToken::checkCurrent();
             int degree = mGeometry->getMeshDetailed()->degree(vd);
             std::vector<glm::vec3> vertexNormals;
 
@@ -294,6 +302,7 @@ class ModelExporter {
         }
 
         for(auto &indexOfColor : colorsWithIndices) {
+            CancellationToken::checkCurrent();
             scenes[indexOfColor.first] =
                 std::move(createNewPolyScene(indexOfColor.second, summedVertexNormals, borderEdges[indexOfColor.first],
                                              vertexSDF, mExtrusionCoef[indexOfColor.first]));
@@ -612,9 +621,9 @@ class ModelExporter {
             face.mIndices = new unsigned int[3];
             face.mNumIndices = 3;
 
-            const auto polyFaceIterator = detailedFaceDescs.find(triangleIndices[i]);
-            P_ASSERT(polyFaceIterator != detailedFaceDescs.cend());
-            const PolyhedronData::face_descriptor polyFace = polyFaceIterator->second;
+            const PolyhedronData::face_descriptor *polyFacePtr = detailedFaceDescs.find(triangleIndices[i]);
+            P_ASSERT(polyFacePtr != nullptr);
+            const PolyhedronData::face_descriptor polyFace = *polyFacePtr;
 
             const auto halfedge = mGeometry->getMeshDetailed()->halfedge(polyFace);
             auto itHalfedge = halfedge;
@@ -9,21 +9,29 @@
 #include <boost/functional/hash.hpp>
 #include <glm/gtc/epsilon.hpp>
 
+#include <array>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "ThreadPool.h"
 
 #include "geometry/AssimpProgress.h"
+#include "geometry/BinaryMeshLoader.h"
 #include "geometry/ColorManager.h"
 #include "geometry/GeometryProgress.h"
+#include "geometry/IndexedTriangles.h"
 #include "geometry/Triangle.h"
+#include "geometry/VertexWelder.h"
 #include "peprassert.h"
 
 namespace pepr3d {
 
-/// Imports triangles and color palette from a model via Assimp
+/// Imports triangles and color palette from a model.
+/// Binary STL and PLY files are read by BinaryMeshLoader, other files via Assimp. The file is parsed once, the vertex
+/// and index buffers are built from the imported triangles by VertexWelder.
 class ModelImporter {
     std::string mPath;
     std::vector<DataTriangle> mTriangles;
@@ -32,22 +40,32 @@ class ModelImporter {
     bool mModelLoaded = false;
 
     std::vector<glm::vec3> mVertexBuffer;
-    std::vector<std::array<size_t, 3>> mIndexBuffer;
+    std::vector<IndexedTriangles::Indices> mIndexBuffer;
 
     GeometryProgress *mProgress;
 
    public:
-    ModelImporter(const std::string p, GeometryProgress *progress, ::ThreadPool &threadPool)
+    /// Imports the model, vertices closer than `weldTolerance` times the bounding box diagonal are joined.
+    /// `useFastLoader` set to false always imports via Assimp.
+    ModelImporter(const std::string p, GeometryProgress *progress, ::ThreadPool &threadPool,
+                  float weldTolerance = VertexWelder::DEFAULT_TOLERANCE, bool useFastLoader = true)
         : mPath(p), mProgress(progress) {
-        auto loadedModel = threadPool.enqueue([this]() { return loadModel(this->mPath); });
-        bool loadedModelWithJoinedVertices = loadModelWithJoinedVertices(this->mPath);
-        this->mModelLoaded = loadedModel.get() & loadedModelWithJoinedVertices;
+        if(useFastLoader && BinaryMeshLoader::load(this->mPath, mTriangles, threadPool, mProgress)) {
+            mPalette = ColorManager();  // the fast loader does not import colors
+            this->mModelLoaded = true;
+        } else {
+            this->mModelLoaded = loadModel(this->mPath);
+        }
+
+        if(this->mModelLoaded) {
+            VertexWelder::weld(mTriangles, weldTolerance, mVertexBuffer, mIndexBuffer, threadPool, mProgress);
+        }
         P_ASSERT(mTriangles.size() == mIndexBuffer.size());
     }
 
-    /// Returns a vector of all DataTriangle of the imported mesh.
-    std::vector<DataTriangle> getTriangles() const {
-        return mTriangles;
+    /// Moves all DataTriangle of the imported mesh out of the importer.
+    std::vector<DataTriangle> takeTriangles() {
+        return std::move(mTriangles);
     }
 
     /// Returns a ColorManager of the imported mesh.
@@ -61,19 +79,20 @@ class ModelImporter {
         return mModelLoaded;
     }
 
-    /// Returns a vertex buffer of the imported mesh.
-    std::vector<glm::vec3> getVertexBuffer() const {
+    /// Moves the vertex buffer of the imported mesh out of the importer.
+    /// Vertices within the weld tolerance are joined, so that the buffer describes a closed mesh.
+    std::vector<glm::vec3> takeVertexBuffer() {
         P_ASSERT(!mVertexBuffer.empty());
-        return mVertexBuffer;
+        return std::move(mVertexBuffer);
     }
 
-    /// Returns an index buffer of the imported mesh.
-    std::vector<std::array<size_t, 3>> getIndexBuffer() const {
+    /// Moves the index buffer of the imported mesh out of the importer.
+    /// The i-th indexed triangle corresponds to the i-th DataTriangle.
+    std::vector<IndexedTriangles::Indices> takeIndexBuffer() {
         P_ASSERT(!mIndexBuffer.empty());
-        return mIndexBuffer;
+        return std::move(mIndexBuffer);
     }
 
-   private:
     /// Returns true if the given triangle has a zero area either due to rounding or vertices
     static bool zeroAreaCheck(const std::array<glm::vec3, 3> &triangle, const double Eps = 0.000001) {
         /// Check for degenerate triangles which we do not want in the representation
@@ -88,90 +107,9 @@ class ModelImporter {
         }
     }
 
-    /// Pull the correct Vertex buffer (correct as in vertices are re-used for multiple triangles) from the mesh
-    static std::vector<glm::vec3> calculateVertexBuffer(aiMesh *mesh) {
-        std::vector<glm::vec3> vertices;
-        vertices.reserve(mesh->mNumVertices);
-        for(size_t i = 0; i < mesh->mNumVertices; i++) {
-            vertices.emplace_back(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
-        }
-        P_ASSERT(vertices.size() == mesh->mNumVertices);
-        return vertices;
-    }
-
-    /// Pull the correct index buffer (correct as in different than 0-N) from the mesh
-    static std::vector<std::array<size_t, 3>> calculateIndexBuffer(aiMesh *mesh) {
-        std::vector<std::array<size_t, 3>> indices;
-        indices.reserve(mesh->mNumFaces);
-
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++) {
-            P_ASSERT(mesh->mFaces[i].mNumIndices == 3);
-
-            std::array<glm::vec3, 3> triangle;
-
-            for(unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++) {
-                triangle[j].x = mesh->mVertices[mesh->mFaces[i].mIndices[j]].x;
-                triangle[j].y = mesh->mVertices[mesh->mFaces[i].mIndices[j]].y;
-                triangle[j].z = mesh->mVertices[mesh->mFaces[i].mIndices[j]].z;
-            }
-
-            /// Check for degenerate triangles which we do not want in the representation
-            const bool isZeroArea = zeroAreaCheck(triangle);
-            if(!isZeroArea) {
-                indices.push_back(
-                    {mesh->mFaces[i].mIndices[0], mesh->mFaces[i].mIndices[1], mesh->mFaces[i].mIndices[2]});
-            } else {
-                CI_LOG_W("Imported a triangle with zero surface area. Ommiting it from index buffer.");
-            }
-        }
-
-        return indices;
-    }
-
-    /// A method which loads the model with ALL vertex information apart from position removed. This is done to
-    /// correctly merge all vertices and receive a closed mesh, which can't be done if more than one vertex per position
-    /// exists.
-    bool loadModelWithJoinedVertices(const std::string &path) {
-        std::vector<aiMesh *> meshes;
-
-        /// Creates an instance of the Importer class
-        Assimp::Importer importer;
-        importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_LINE | aiPrimitiveType_POINT);
-        importer.SetPropertyInteger(AI_CONFIG_PP_FD_REMOVE, 1);
-        importer.SetPropertyInteger(AI_CONFIG_PP_FD_CHECKAREA, 1);
-        importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_NORMALS | aiComponent_TANGENTS_AND_BITANGENTS |
-                                                                aiComponent_COLORS | aiComponent_TEXCOORDS |
-                                                                aiComponent_BONEWEIGHTS);
-
-        // Progress handler
-        if(mProgress != nullptr) {
-            auto assimpProgress =
-                std::make_unique<AssimpProgress<std::atomic<float>>>(&(mProgress->importComputePercentage));
-            importer.SetProgressHandler(assimpProgress.release());  // importer calls delete on assimpProgress
-        }
-
-        /// Scene with some postprocessing
-        const aiScene *scene =
-            importer.ReadFile(path, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_RemoveComponent |
-                                        aiProcess_JoinIdenticalVertices | aiProcess_FindDegenerates);
-
-        // If the import failed, report it
-        if(!scene) {
-            CI_LOG_E(importer.GetErrorString());
-            return false;
-        }
-
-        /// Access the file's contents
-        processNode(scene->mRootNode, scene, meshes);
-
-        mVertexBuffer = calculateVertexBuffer(meshes[0]);
-        mIndexBuffer = calculateIndexBuffer(meshes[0]);
-
-        meshes.clear();
-        return true;
-    }
-
-    /// A method which loads the model we will use for rendering - with duplicated vertices for normals, colors, etc.
+   private:
+    /// Loads the model via Assimp with normals for the rendering and colors for the palette.
+    /// Vertices are not joined by Assimp, VertexWelder joins them by their position instead.
     bool loadModel(const std::string &path) {
         mPalette.clear();
         std::vector<aiMesh *> meshes;
@@ -204,7 +142,7 @@ class ModelImporter {
         /// Access the file's contents
         processNode(scene->mRootNode, scene, meshes);
 
-        mTriangles = processFirstMesh(meshes[0]);
+        processFirstMesh(meshes[0]);
 
         if(mPalette.empty()) {
             mPalette = ColorManager();  // create new palette with default colors
@@ -231,14 +169,15 @@ class ModelImporter {
     }
 
     /// Obtains model information only from first of the meshes.
-    std::vector<DataTriangle> processFirstMesh(aiMesh *mesh) {
-        std::vector<DataTriangle> triangles;
+    void processFirstMesh(aiMesh *mesh) {
+        mTriangles.clear();
+        mTriangles.reserve(mesh->mNumFaces);
 
         /// Obtaining triangle color. Default color is set if there is no color information
         std::unordered_map<std::array<float, 3>, size_t, boost::hash<std::array<float, 3>>> colorLookup;
 
         for(unsigned int i = 0; i < mesh->mNumFaces; i++) {
-            aiFace face = mesh->mFaces[i];
+            const aiFace &face = mesh->mFaces[i];
 
             P_ASSERT(face.mNumIndices == 3);
 
@@ -296,12 +235,11 @@ class ModelImporter {
                     (mPalette.size() == 0 && returnColor == 0) ||
                     (mPalette.size() > 0 && returnColor < mPalette.size() && returnColor < PEPR3D_MAX_PALETTE_COLORS));
                 /// Place the constructed triangle
-                triangles.emplace_back(vertices[0], vertices[1], vertices[2], normal, returnColor);
+                mTriangles.emplace_back(vertices[0], vertices[1], vertices[2], normal, returnColor);
             } else {
                 CI_LOG_W("Imported a triangle with zero surface area. Ommiting it from geometry data.");
             }
         }
-        return triangles;
     }
 
     /// Calculates triangle normal from its vertices with orientation of original vertex normals.
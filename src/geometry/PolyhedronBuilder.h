@@ -12,13 +12,13 @@ typedef Polyhedron::HalfedgeDS HalfedgeDS;
 template <class HDS>
 class PolyhedronBuilder : public CGAL::Modifier_base<HDS> {
    private:
-    const std::vector<std::array<size_t, 3>>& mTriangles;
+    const std::vector<IndexedTriangles::Indices>& mTriangles;
     const std::vector<glm::vec3>& mVertices;
 
     std::vector<typename CGAL::Polyhedron_incremental_builder_3<HDS>::Face_handle> mFacetsCreated;
 
    public:
-    PolyhedronBuilder(const std::vector<std::array<size_t, 3>>& tris, const std::vector<glm::vec3>& verts)
+    PolyhedronBuilder(const std::vector<IndexedTriangles::Indices>& tris, const std::vector<glm::vec3>& verts)
         : mTriangles(tris), mVertices(verts) {}
 
     std::vector<typename CGAL::Polyhedron_incremental_builder_3<HDS>::Face_handle> getFacetArray() {
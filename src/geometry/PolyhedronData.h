@@ -1,19 +1,14 @@
 #pragma once
 
 #include <CGAL/Surface_mesh.h>
+#include "geometry/IndexedTriangles.h"
 #include "geometry/Triangle.h"
 
 namespace pepr3d {
 
-/// CGAL Polyhedron data of the Geometry
+/// CGAL Polyhedron data of the Geometry.
+/// The mesh is built from the shared vertices of the IndexedTriangles, its i-th face is the i-th triangle.
 struct PolyhedronData {
-    /// Vertex positions after joining all identical vertices.
-    /// This is after removing all other componens and as such based only on the position property.
-    std::vector<glm::vec3> vertices;
-
-    /// Indices to triangles of the polyhedron. Indices are stored in a CCW order, as imported from Assimp.
-    std::vector<std::array<size_t, 3>> indices;
-
     using Mesh = CGAL::Surface_mesh<DataTriangle::K::Point_3>;
     using vertex_descriptor = Mesh::Vertex_index;
     using face_descriptor = Mesh::Face_index;
@@ -34,6 +29,10 @@ struct PolyhedronData {
     /// A "map" converting the ID of each triangle (from mTriangles) into a face_descriptor
     std::vector<PolyhedronData::face_descriptor> mFaceDescs;
 
+    /// IDs of the neighbours of each triangle across its three edges, -1 on a border.
+    /// Flat copy of the mesh connectivity, so that BFS does not have to walk the halfedges.
+    std::vector<std::array<int, 3>> adjacency;
+
     /// The data-structure itself
     Mesh mMesh;
 };
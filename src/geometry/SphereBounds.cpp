@@ -0,0 +1,240 @@
+#include "geometry/SphereBounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "peprassert.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PEPR3D_SPHERE_BOUNDS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PEPR3D_SPHERE_BOUNDS_SSE
+#endif
+
+namespace pepr3d {
+
+namespace {
+/// Round a double to the nearest float that is not lower
+float roundUp(const double value) {
+    float result = static_cast<float>(value);
+    if(static_cast<double>(result) < value) {
+        result = std::nextafter(result, std::numeric_limits<float>::max());
+    }
+    return result;
+}
+
+/// Append first + index of each set bit of the comparison mask
+void appendMask(int mask, const size_t first, std::vector<uint32_t>& result) {
+    while(mask != 0) {
+        int bit = 0;
+        while((mask & (1 << bit)) == 0) {
+            ++bit;
+        }
+        result.push_back(static_cast<uint32_t>(first + bit));
+        mask &= mask - 1;
+    }
+}
+
+float squaredLength(const glm::vec3& v) {
+    return v.x * v.x + v.y * v.y + v.z * v.z;
+}
+}  // namespace
+
+void SphereBounds::assign(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii) {
+    P_ASSERT(centers.size() == radii.size());
+    clear();
+    if(centers.empty()) {
+        return;
+    }
+
+    glm::dvec3 boxMin = centers.front();
+    glm::dvec3 boxMax = centers.front();
+    for(const glm::dvec3& center : centers) {
+        boxMin = glm::min(boxMin, center);
+        boxMax = glm::max(boxMax, center);
+    }
+    mOrigin = (boxMin + boxMax) * 0.5;
+
+    mCenterX.reserve(centers.size());
+    mCenterY.reserve(centers.size());
+    mCenterZ.reserve(centers.size());
+    mRadius.reserve(centers.size());
+    for(size_t i = 0; i < centers.size(); ++i) {
+        const glm::dvec3 localCenter = centers[i] - mOrigin;
+        mCenterX.push_back(static_cast<float>(localCenter.x));
+        mCenterY.push_back(static_cast<float>(localCenter.y));
+        mCenterZ.push_back(static_cast<float>(localCenter.z));
+        mRadius.push_back(roundUp(radii[i]));
+        mExtent = std::max(mExtent, glm::length(localCenter) + radii[i]);
+    }
+}
+
+SphereBounds SphereBounds::reordered(const std::vector<uint32_t>& order) const {
+    P_ASSERT(order.size() == size());
+    SphereBounds result;
+    result.mOrigin = mOrigin;
+    result.mExtent = mExtent;
+    result.mCenterX.reserve(order.size());
+    result.mCenterY.reserve(order.size());
+    result.mCenterZ.reserve(order.size());
+    result.mRadius.reserve(order.size());
+    for(const uint32_t oldIdx : order) {
+        result.mCenterX.push_back(mCenterX[oldIdx]);
+        result.mCenterY.push_back(mCenterY[oldIdx]);
+        result.mCenterZ.push_back(mCenterZ[oldIdx]);
+        result.mRadius.push_back(mRadius[oldIdx]);
+    }
+    return result;
+}
+
+void SphereBounds::clear() {
+    mCenterX.clear();
+    mCenterY.clear();
+    mCenterZ.clear();
+    mRadius.clear();
+    mOrigin = glm::dvec3(0.0);
+    mExtent = 0.0;
+}
+
+float SphereBounds::getToleratedRadius(const double radius, const double queryDistance) const {
+    // The float errors grow with the distance of the compared points from the origin
+    return roundUp(radius * (1.0 + FLOAT_TOLERANCE) + (mExtent + queryDistance) * FLOAT_TOLERANCE);
+}
+
+SphereBounds::Query SphereBounds::makePointQuery(const glm::dvec3& point, const double radius) const {
+    const glm::dvec3 localPoint = point - mOrigin;
+    return Query{glm::vec3(localPoint), glm::vec3(0.f), getToleratedRadius(radius, glm::length(localPoint)), false};
+}
+
+SphereBounds::Query SphereBounds::makeLineQuery(const glm::dvec3& linePoint, const glm::dvec3& lineDirection,
+                                                const double radius) const {
+    P_ASSERT(glm::length(lineDirection) > 0.0);
+    const glm::dvec3 localPoint = linePoint - mOrigin;
+    return Query{glm::vec3(localPoint), glm::vec3(glm::normalize(lineDirection)),
+                 getToleratedRadius(radius, glm::length(localPoint)), true};
+}
+
+bool SphereBounds::test(const Query& query, const size_t idx) const {
+    P_ASSERT(idx < size());
+    const glm::vec3 toCenter = getLocalCenter(idx) - query.point;
+    const float limit = query.radius + mRadius[idx];
+    if(query.isLine) {
+        return squaredLength(glm::cross(toCenter, query.direction)) <= limit * limit;
+    } else {
+        return squaredLength(toCenter) <= limit * limit;
+    }
+}
+
+void SphereBounds::collect(const Query& query, const size_t begin, const size_t end,
+                           std::vector<uint32_t>& result) const {
+    P_ASSERT(begin <= end && end <= size());
+    if(query.isLine) {
+        collectNearLine(query, begin, end, result);
+    } else {
+        collectNearPoint(query, begin, end, result);
+    }
+}
+
+void SphereBounds::collectNearPoint(const Query& query, const size_t begin, const size_t end,
+                                    std::vector<uint32_t>& result) const {
+    size_t idx = begin;
+
+#if defined(PEPR3D_SPHERE_BOUNDS_AVX)
+    const __m256 pointX = _mm256_set1_ps(query.point.x);
+    const __m256 pointY = _mm256_set1_ps(query.point.y);
+    const __m256 pointZ = _mm256_set1_ps(query.point.z);
+    const __m256 queryRadius = _mm256_set1_ps(query.radius);
+    for(; idx + 8 <= end; idx += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&mCenterX[idx]), pointX);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&mCenterY[idx]), pointY);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&mCenterZ[idx]), pointZ);
+        const __m256 distSquared =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        const __m256 limit = _mm256_add_ps(_mm256_loadu_ps(&mRadius[idx]), queryRadius);
+        const __m256 isNear = _mm256_cmp_ps(distSquared, _mm256_mul_ps(limit, limit), _CMP_LE_OQ);
+        appendMask(_mm256_movemask_ps(isNear), idx, result);
+    }
+#elif defined(PEPR3D_SPHERE_BOUNDS_SSE)
+    const __m128 pointX = _mm_set1_ps(query.point.x);
+    const __m128 pointY = _mm_set1_ps(query.point.y);
+    const __m128 pointZ = _mm_set1_ps(query.point.z);
+    const __m128 queryRadius = _mm_set1_ps(query.radius);
+    for(; idx + 4 <= end; idx += 4) {
+        const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&mCenterX[idx]), pointX);
+        const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&mCenterY[idx]), pointY);
+        const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&mCenterZ[idx]), pointZ);
+        const __m128 distSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        const __m128 limit = _mm_add_ps(_mm_loadu_ps(&mRadius[idx]), queryRadius);
+        const __m128 isNear = _mm_cmple_ps(distSquared, _mm_mul_ps(limit, limit));
+        appendMask(_mm_movemask_ps(isNear), idx, result);
+    }
+#endif
+
+    // Scalar fallback and the remainder of the vectorized loop
+    for(; idx < end; ++idx) {
+        if(test(query, idx)) {
+            result.push_back(static_cast<uint32_t>(idx));
+        }
+    }
+}
+
+void SphereBounds::collectNearLine(const Query& query, const size_t begin, const size_t end,
+                                   std::vector<uint32_t>& result) const {
+    size_t idx = begin;
+
+    // Distance from the line is the length of the cross product of the center offset and the normalized direction
+#if defined(PEPR3D_SPHERE_BOUNDS_AVX)
+    const __m256 pointX = _mm256_set1_ps(query.point.x);
+    const __m256 pointY = _mm256_set1_ps(query.point.y);
+    const __m256 pointZ = _mm256_set1_ps(query.point.z);
+    const __m256 dirX = _mm256_set1_ps(query.direction.x);
+    const __m256 dirY = _mm256_set1_ps(query.direction.y);
+    const __m256 dirZ = _mm256_set1_ps(query.direction.z);
+    const __m256 queryRadius = _mm256_set1_ps(query.radius);
+    for(; idx + 8 <= end; idx += 8) {
+        const __m256 vx = _mm256_sub_ps(_mm256_loadu_ps(&mCenterX[idx]), pointX);
+        const __m256 vy = _mm256_sub_ps(_mm256_loadu_ps(&mCenterY[idx]), pointY);
+        const __m256 vz = _mm256_sub_ps(_mm256_loadu_ps(&mCenterZ[idx]), pointZ);
+        const __m256 cx = _mm256_sub_ps(_mm256_mul_ps(vy, dirZ), _mm256_mul_ps(vz, dirY));
+        const __m256 cy = _mm256_sub_ps(_mm256_mul_ps(vz, dirX), _mm256_mul_ps(vx, dirZ));
+        const __m256 cz = _mm256_sub_ps(_mm256_mul_ps(vx, dirY), _mm256_mul_ps(vy, dirX));
+        const __m256 distSquared =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+        const __m256 limit = _mm256_add_ps(_mm256_loadu_ps(&mRadius[idx]), queryRadius);
+        const __m256 isNear = _mm256_cmp_ps(distSquared, _mm256_mul_ps(limit, limit), _CMP_LE_OQ);
+        appendMask(_mm256_movemask_ps(isNear), idx, result);
+    }
+#elif defined(PEPR3D_SPHERE_BOUNDS_SSE)
+    const __m128 pointX = _mm_set1_ps(query.point.x);
+    const __m128 pointY = _mm_set1_ps(query.point.y);
+    const __m128 pointZ = _mm_set1_ps(query.point.z);
+    const __m128 dirX = _mm_set1_ps(query.direction.x);
+    const __m128 dirY = _mm_set1_ps(query.direction.y);
+    const __m128 dirZ = _mm_set1_ps(query.direction.z);
+    const __m128 queryRadius = _mm_set1_ps(query.radius);
+    for(; idx + 4 <= end; idx += 4) {
+        const __m128 vx = _mm_sub_ps(_mm_loadu_ps(&mCenterX[idx]), pointX);
+        const __m128 vy = _mm_sub_ps(_mm_loadu_ps(&mCenterY[idx]), pointY);
+        const __m128 vz = _mm_sub_ps(_mm_loadu_ps(&mCenterZ[idx]), pointZ);
+        const __m128 cx = _mm_sub_ps(_mm_mul_ps(vy, dirZ), _mm_mul_ps(vz, dirY));
+        const __m128 cy = _mm_sub_ps(_mm_mul_ps(vz, dirX), _mm_mul_ps(vx, dirZ));
+        const __m128 cz = _mm_sub_ps(_mm_mul_ps(vx, dirY), _mm_mul_ps(vy, dirX));
+        const __m128 distSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+        const __m128 limit = _mm_add_ps(_mm_loadu_ps(&mRadius[idx]), queryRadius);
+        const __m128 isNear = _mm_cmple_ps(distSquared, _mm_mul_ps(limit, limit));
+        appendMask(_mm_movemask_ps(isNear), idx, result);
+    }
+#endif
+
+    // Scalar fallback and the remainder of the vectorized loop
+    for(; idx < end; ++idx) {
+        if(test(query, idx)) {
+            result.push_back(static_cast<uint32_t>(idx));
+        }
+    }
+}
+
+}  // namespace pepr3d
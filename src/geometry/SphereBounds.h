@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace pepr3d {
+
+/// Bounding spheres stored as a structure of float arrays, so that distance tests stream through memory and
+/// vectorize. Centers are stored relative to the center of their bounding box to keep the float precision.
+/// All tests are conservative: a sphere closer than the query radius always passes, while spheres that are only
+/// a rounding error further may pass too.
+class SphereBounds {
+    std::vector<float> mCenterX;
+    std::vector<float> mCenterY;
+    std::vector<float> mCenterZ;
+    std::vector<float> mRadius;
+
+    /// Origin of the local coordinates of the centers
+    glm::dvec3 mOrigin = glm::dvec3(0.0);
+
+    /// Largest distance of a sphere surface from mOrigin
+    double mExtent = 0.0;
+
+   public:
+    /// A point or line query converted into the local float coordinates of the bounds
+    struct Query {
+        glm::vec3 point;
+
+        /// Normalized direction of a line query
+        glm::vec3 direction;
+
+        /// Query radius enlarged by the maximal rounding error of the float computation
+        float radius;
+
+        bool isLine;
+    };
+
+    /// Replace all spheres
+    void assign(const std::vector<glm::dvec3>& centers, const std::vector<double>& radii);
+
+    /// Copy of the bounds with the spheres in the given order, order[newIdx] = oldIdx
+    SphereBounds reordered(const std::vector<uint32_t>& order) const;
+
+    void clear();
+
+    size_t size() const {
+        return mRadius.size();
+    }
+
+    bool empty() const {
+        return mRadius.empty();
+    }
+
+    /// Center in the local float coordinates
+    glm::vec3 getLocalCenter(const size_t idx) const {
+        return glm::vec3(mCenterX[idx], mCenterY[idx], mCenterZ[idx]);
+    }
+
+    float getRadius(const size_t idx) const {
+        return mRadius[idx];
+    }
+
+    /// Query of spheres closer than radius to the point
+    Query makePointQuery(const glm::dvec3& point, double radius) const;
+
+    /// Query of spheres closer than radius to the line
+    Query makeLineQuery(const glm::dvec3& linePoint, const glm::dvec3& lineDirection, double radius) const;
+
+    /// Test one sphere against the query
+    bool test(const Query& query, size_t idx) const;
+
+    /// Append indices of the spheres in [begin, end) that pass the query test
+    void collect(const Query& query, size_t begin, size_t end, std::vector<uint32_t>& result) const;
+
+   private:
+    /// Relative rounding error of the float distance computation, with a generous margin
+    static constexpr double FLOAT_TOLERANCE = 4e-6;
+
+    void collectNearPoint(const Query& query, size_t begin, size_t end, std::vector<uint32_t>& result) const;
+    void collectNearLine(const Query& query, size_t begin, size_t end, std::vector<uint32_t>& result) const;
+
+    /// Enlarge the radius by the rounding errors of a query at the given distance from the origin
+    float getToleratedRadius(double radius, double queryDistance) const;
+};
+
+}  // namespace pepr3d
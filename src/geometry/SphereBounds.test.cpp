@@ -0,0 +1,139 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "geometry/SphereBounds.h"
+
+namespace {
+
+struct RandomSpheres {
+    std::vector<glm::dvec3> centers;
+    std::vector<double> radii;
+};
+
+RandomSpheres getRandomSpheres(std::mt19937& generator, size_t count, const glm::dvec3& offset) {
+    std::uniform_real_distribution<double> positionDistribution(-10.0, 10.0);
+    std::uniform_real_distribution<double> radiusDistribution(0.01, 0.5);
+
+    RandomSpheres spheres;
+    for(size_t i = 0; i < count; ++i) {
+        spheres.centers.push_back(offset + glm::dvec3(positionDistribution(generator), positionDistribution(generator),
+                                                      positionDistribution(generator)));
+        spheres.radii.push_back(radiusDistribution(generator));
+    }
+    return spheres;
+}
+
+/// Indices of the spheres closer than radius to the point or line, computed in double precision
+std::vector<uint32_t> getExpected(const RandomSpheres& spheres, const glm::dvec3& point, const glm::dvec3* direction,
+                                  const double radius) {
+    std::vector<uint32_t> expected;
+    for(size_t i = 0; i < spheres.centers.size(); ++i) {
+        glm::dvec3 diff = spheres.centers[i] - point;
+        if(direction != nullptr) {
+            diff -= glm::dot(diff, *direction) / glm::dot(*direction, *direction) * (*direction);
+        }
+        const double limit = radius + spheres.radii[i];
+        if(glm::dot(diff, diff) <= limit * limit) {
+            expected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    return expected;
+}
+
+/// Check that the vectorized collect agrees with the scalar test, and that both never miss a sphere
+void checkQuery(const pepr3d::SphereBounds& bounds, const pepr3d::SphereBounds::Query& query,
+                const std::vector<uint32_t>& expected) {
+    std::vector<uint32_t> collected;
+    bounds.collect(query, 0, bounds.size(), collected);
+    EXPECT_TRUE(std::is_sorted(collected.begin(), collected.end()));
+    EXPECT_TRUE(std::includes(collected.begin(), collected.end(), expected.begin(), expected.end()));
+    EXPECT_LE(collected.size(), expected.size() + 2);
+
+    std::vector<uint32_t> tested;
+    for(size_t i = 0; i < bounds.size(); ++i) {
+        if(bounds.test(query, i)) {
+            tested.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    EXPECT_TRUE(std::includes(tested.begin(), tested.end(), expected.begin(), expected.end()));
+    EXPECT_LE(tested.size(), expected.size() + 2);
+}
+
+}  // namespace
+
+TEST(SphereBounds, pointQuery) {
+    /**
+     * Test that point queries find all spheres the double precision computation finds, also far from the origin
+     */
+    std::mt19937 generator(21);
+    for(const glm::dvec3 offset : {glm::dvec3(0.0), glm::dvec3(1000.0, -2000.0, 500.0)}) {
+        const RandomSpheres spheres = getRandomSpheres(generator, 1003, offset);
+        pepr3d::SphereBounds bounds;
+        bounds.assign(spheres.centers, spheres.radii);
+        ASSERT_EQ(bounds.size(), spheres.centers.size());
+
+        std::uniform_real_distribution<double> positionDistribution(-10.0, 10.0);
+        for(int query = 0; query < 50; ++query) {
+            const glm::dvec3 point = offset + glm::dvec3(positionDistribution(generator),
+                                                         positionDistribution(generator),
+                                                         positionDistribution(generator));
+            const double radius = 0.1 * query;
+            checkQuery(bounds, bounds.makePointQuery(point, radius), getExpected(spheres, point, nullptr, radius));
+        }
+    }
+}
+
+TEST(SphereBounds, lineQuery) {
+    /**
+     * Test that line queries find all spheres the double precision computation finds, including unnormalized and
+     * axis aligned directions
+     */
+    std::mt19937 generator(22);
+    for(const glm::dvec3 offset : {glm::dvec3(0.0), glm::dvec3(-300.0, 4000.0, 100.0)}) {
+        const RandomSpheres spheres = getRandomSpheres(generator, 1001, offset);
+        pepr3d::SphereBounds bounds;
+        bounds.assign(spheres.centers, spheres.radii);
+
+        std::uniform_real_distribution<double> positionDistribution(-10.0, 10.0);
+        for(int query = 0; query < 50; ++query) {
+            const glm::dvec3 linePoint = offset + glm::dvec3(positionDistribution(generator),
+                                                             positionDistribution(generator),
+                                                             positionDistribution(generator));
+            glm::dvec3 direction(positionDistribution(generator), positionDistribution(generator),
+                                 positionDistribution(generator));
+            if(query % 5 == 0) {
+                direction = glm::dvec3(0, 3, 0);
+            }
+            const double radius = 0.05 * query;
+            checkQuery(bounds, bounds.makeLineQuery(linePoint, direction, radius),
+                       getExpected(spheres, linePoint, &direction, radius));
+        }
+    }
+}
+
+TEST(SphereBounds, reordered) {
+    /**
+     * Test that reordering keeps the spheres and their query results
+     */
+    std::mt19937 generator(23);
+    const RandomSpheres spheres = getRandomSpheres(generator, 100, glm::dvec3(0.0));
+    pepr3d::SphereBounds bounds;
+    bounds.assign(spheres.centers, spheres.radii);
+
+    std::vector<uint32_t> order(bounds.size());
+    for(uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<uint32_t>(order.size()) - 1 - i;
+    }
+    const pepr3d::SphereBounds reversed = bounds.reordered(order);
+    ASSERT_EQ(reversed.size(), bounds.size());
+
+    const pepr3d::SphereBounds::Query query = bounds.makePointQuery(glm::dvec3(1.0, 2.0, 3.0), 4.0);
+    for(uint32_t i = 0; i < order.size(); ++i) {
+        EXPECT_EQ(reversed.getRadius(i), bounds.getRadius(order[i]));
+        EXPECT_EQ(reversed.test(query, i), bounds.test(query, order[i]));
+    }
+}
+
+#endif
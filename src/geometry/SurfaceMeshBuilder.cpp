@@ -0,0 +1,307 @@
+#include "geometry/SurfaceMeshBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace pepr3d {
+
+namespace {
+
+using Mesh = PolyhedronData::Mesh;
+
+/// Index of a vertex, face or halfedge, Surface_mesh uses 32 bit indices as well
+using Index = uint32_t;
+
+constexpr Index NO_INDEX = std::numeric_limits<Index>::max();
+
+/// Number of faces or edges processed by a single task of the thread pool
+constexpr size_t ITEMS_PER_CHUNK = 16 * 1024;
+
+/// Directed edge of a face. Edges are sorted by the key of their undirected edge first, so that the two halfedges of an
+/// edge end up next to each other.
+struct DirectedEdge {
+    /// Smaller vertex in the upper 32 bits, larger vertex in the lower 32 bits
+    uint64_t key;
+
+    /// Corner of the face the edge starts at, 3 * face + corner
+    Index corner;
+
+    bool operator<(const DirectedEdge& other) const {
+        return key < other.key || (key == other.key && corner < other.corner);
+    }
+};
+
+/// Number of elements of the sorted ranges a and b among the first `count` elements of their merge
+template <typename T>
+size_t getMergeSplit(const T* a, const size_t aSize, const T* b, const size_t bSize, const size_t count) {
+    size_t low = count > bSize ? count - bSize : 0;
+    size_t high = std::min(count, aSize);
+    while(low < high) {
+        const size_t fromA = (low + high) / 2;
+        if(b[count - fromA - 1] < a[fromA]) {
+            high = fromA;
+        } else {
+            low = fromA + 1;
+        }
+    }
+    return low;
+}
+
+/// Sorts chunks of the values in parallel, then merges them pairwise. Each merge is split into parts of about the chunk
+/// size, so that the last merges run in parallel as well.
+template <typename T>
+void parallelSort(std::vector<T>& values, ::ThreadPool& threadPool) {
+    threadPool.parallel_for_chunks(values.size(), ITEMS_PER_CHUNK, [&values](size_t, size_t begin, size_t end) {
+        std::sort(values.begin() + begin, values.begin() + end);
+    });
+
+    std::vector<T> merged(values.size());
+    for(size_t width = ITEMS_PER_CHUNK; width < values.size(); width *= 2) {
+        threadPool.parallel_for_chunks(values.size(), ITEMS_PER_CHUNK, [&](size_t, size_t begin, size_t end) {
+            // The output range [begin, end) lies within the merge of the ranges starting at mergeBegin
+            const size_t mergeBegin = begin / (2 * width) * (2 * width);
+            const size_t middle = std::min(values.size(), mergeBegin + width);
+            const size_t mergeEnd = std::min(values.size(), mergeBegin + 2 * width);
+            const T* a = values.data() + mergeBegin;
+            const T* b = values.data() + middle;
+            const size_t aSize = middle - mergeBegin;
+            const size_t bSize = mergeEnd - middle;
+
+            const size_t fromBegin = begin - mergeBegin;
+            const size_t fromEnd = end - mergeBegin;
+            const size_t aBegin = getMergeSplit(a, aSize, b, bSize, fromBegin);
+            const size_t aEnd = getMergeSplit(a, aSize, b, bSize, fromEnd);
+            std::merge(a + aBegin, a + aEnd, b + (fromBegin - aBegin), b + (fromEnd - aEnd), merged.begin() + begin);
+        });
+        values.swap(merged);
+    }
+}
+
+/// Atomically sets the value if it is unset, returns false if it was set already
+bool setOnce(std::atomic<Index>& value, const Index newValue) {
+    Index expected = NO_INDEX;
+    return value.compare_exchange_strong(expected, newValue, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+bool SurfaceMeshBuilder::build(const std::vector<glm::vec3>& vertices,
+                               const std::vector<IndexedTriangles::Indices>& indices, PolyhedronData::Mesh& mesh,
+                               ::ThreadPool& threadPool) {
+    mesh.clear();
+    const size_t vertexCount = vertices.size();
+    const size_t faceCount = indices.size();
+    if(vertexCount >= NO_INDEX || 6 * faceCount >= NO_INDEX) {
+        return false;
+    }
+
+    /// Collect and sort the directed edges of all faces
+    std::vector<DirectedEdge> edges(3 * faceCount);
+    std::atomic<bool> isValid{true};
+    threadPool.parallel_for_chunks(faceCount, ITEMS_PER_CHUNK, [&](size_t, const size_t begin, const size_t end) {
+        for(size_t face = begin; face < end; ++face) {
+            const IndexedTriangles::Indices& tri = indices[face];
+            if(tri[0] >= vertexCount || tri[1] >= vertexCount || tri[2] >= vertexCount || tri[0] == tri[1] ||
+               tri[0] == tri[2] || tri[1] == tri[2]) {
+                isValid = false;
+                return;
+            }
+            for(size_t corner = 0; corner < 3; ++corner) {
+                const uint64_t from = tri[corner];
+                const uint64_t to = tri[(corner + 1) % 3];
+                edges[3 * face + corner] = {std::min(from, to) << 32 | std::max(from, to),
+                                            static_cast<Index>(3 * face + corner)};
+            }
+        }
+    });
+    if(!isValid) {
+        return false;
+    }
+    parallelSort(edges, threadPool);
+
+    /// Number the undirected edges, an edge is shared by at most two faces with opposite orientations
+    const auto isEdgeStart = [&edges](const size_t i) { return i == 0 || edges[i - 1].key != edges[i].key; };
+    std::vector<size_t> chunkEdgeOffsets(::ThreadPool::chunk_count(edges.size(), ITEMS_PER_CHUNK) + 1, 0);
+    threadPool.parallel_for_chunks(edges.size(), ITEMS_PER_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+        size_t edgeCount = 0;
+        for(size_t i = begin; i < end; ++i) {
+            if(!isEdgeStart(i)) {
+                continue;
+            }
+            ++edgeCount;
+            if(i + 2 < edges.size() && edges[i + 2].key == edges[i].key) {
+                isValid = false;  // non-manifold edge
+            }
+            if(i + 1 < edges.size() && edges[i + 1].key == edges[i].key) {
+                const IndexedTriangles::Indices& tri = indices[edges[i].corner / 3];
+                const IndexedTriangles::Indices& otherTri = indices[edges[i + 1].corner / 3];
+                if(tri[edges[i].corner % 3] == otherTri[edges[i + 1].corner % 3]) {
+                    isValid = false;  // the faces are not oriented consistently
+                }
+            }
+        }
+        chunkEdgeOffsets[chunk + 1] = edgeCount;
+    });
+    if(!isValid) {
+        return false;
+    }
+    std::partial_sum(chunkEdgeOffsets.begin(), chunkEdgeOffsets.end(), chunkEdgeOffsets.begin());
+    const size_t edgeCount = chunkEdgeOffsets.back();
+
+    // The first halfedge of an edge goes from its smaller vertex to its larger vertex, the second one goes back
+    std::vector<Index> cornerHalfedges(3 * faceCount);
+    std::vector<uint8_t> isEdgeShared(edgeCount, 0);
+    threadPool.parallel_for_chunks(edges.size(), ITEMS_PER_CHUNK, [&](size_t chunk, size_t begin, size_t end) {
+        size_t edge = chunkEdgeOffsets[chunk];
+        for(size_t i = begin; i < end; ++i) {
+            if(!isEdgeStart(i)) {
+                continue;
+            }
+            const bool isShared = i + 1 < edges.size() && edges[i + 1].key == edges[i].key;
+            for(size_t j = i; j < i + (isShared ? 2 : 1); ++j) {
+                const Index corner = edges[j].corner;
+                const IndexedTriangles::Indices& tri = indices[corner / 3];
+                const bool isForward = tri[corner % 3] < tri[(corner % 3 + 1) % 3];
+                cornerHalfedges[corner] = static_cast<Index>(2 * edge + (isForward ? 0 : 1));
+            }
+            isEdgeShared[edge] = isShared ? 1 : 0;
+            ++edge;
+        }
+    });
+    std::vector<DirectedEdge>().swap(edges);
+
+    mesh.resize(static_cast<Mesh::size_type>(vertexCount), static_cast<Mesh::size_type>(edgeCount),
+                static_cast<Mesh::size_type>(faceCount));
+    for(size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        // Points are assigned on this thread only, as CGAL points may be reference counted
+        const glm::vec3& position = vertices[vertex];
+        mesh.point(Mesh::Vertex_index(static_cast<Index>(vertex))) =
+            DataTriangle::Point(position.x, position.y, position.z);
+    }
+
+    /// Link the halfedges of the faces and the border halfedges opposite to them
+    // Border halfedges leaving and entering each vertex, a manifold vertex has at most one of each
+    std::vector<std::atomic<Index>> outgoingBorders(vertexCount);
+    std::vector<std::atomic<Index>> incomingBorders(vertexCount);
+    // The smallest halfedge entering each vertex, used for vertices without a border
+    std::vector<std::atomic<Index>> incomingHalfedges(vertexCount);
+    std::vector<std::atomic<Index>> faceCounts(vertexCount);
+    threadPool.parallel_for_chunks(vertexCount, ITEMS_PER_CHUNK, [&](size_t, const size_t begin, const size_t end) {
+        for(size_t vertex = begin; vertex < end; ++vertex) {
+            outgoingBorders[vertex].store(NO_INDEX, std::memory_order_relaxed);
+            incomingBorders[vertex].store(NO_INDEX, std::memory_order_relaxed);
+            incomingHalfedges[vertex].store(NO_INDEX, std::memory_order_relaxed);
+            faceCounts[vertex].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    threadPool.parallel_for_chunks(faceCount, ITEMS_PER_CHUNK, [&](size_t, const size_t begin, const size_t end) {
+        for(size_t face = begin; face < end; ++face) {
+            const IndexedTriangles::Indices& tri = indices[face];
+            const Mesh::Face_index faceIdx(static_cast<Index>(face));
+            for(size_t corner = 0; corner < 3; ++corner) {
+                const Index halfedge = cornerHalfedges[3 * face + corner];
+                const Index nextHalfedge = cornerHalfedges[3 * face + (corner + 1) % 3];
+                const size_t from = tri[corner];
+                const size_t to = tri[(corner + 1) % 3];
+
+                const Mesh::Halfedge_index halfedgeIdx(halfedge);
+                mesh.set_target(halfedgeIdx, Mesh::Vertex_index(static_cast<Index>(to)));
+                mesh.set_face(halfedgeIdx, faceIdx);
+                mesh.set_next(halfedgeIdx, Mesh::Halfedge_index(nextHalfedge));
+
+                Index smallest = incomingHalfedges[to].load(std::memory_order_relaxed);
+                while(halfedge < smallest && !incomingHalfedges[to].compare_exchange_weak(
+                                                 smallest, halfedge, std::memory_order_relaxed)) {
+                }
+                faceCounts[to].fetch_add(1, std::memory_order_relaxed);
+
+                if(!isEdgeShared[halfedge / 2]) {
+                    const Index border = halfedge ^ 1;
+                    mesh.set_target(Mesh::Halfedge_index(border), Mesh::Vertex_index(static_cast<Index>(from)));
+                    mesh.set_face(Mesh::Halfedge_index(border), Mesh::null_face());
+                    if(!setOnce(outgoingBorders[to], border) || !setOnce(incomingBorders[from], border)) {
+                        isValid = false;  // more than one border passes through the vertex
+                    }
+                }
+            }
+            // Like add_face, start the face at the halfedge entering its first vertex
+            mesh.set_halfedge(faceIdx, Mesh::Halfedge_index(cornerHalfedges[3 * face + 2]));
+        }
+    });
+    if(!isValid) {
+        mesh.clear();
+        return false;
+    }
+
+    // A border halfedge continues with the border halfedge leaving its target
+    threadPool.parallel_for_chunks(edgeCount, ITEMS_PER_CHUNK, [&](size_t, const size_t begin, const size_t end) {
+        for(size_t edge = begin; edge < end; ++edge) {
+            if(isEdgeShared[edge]) {
+                continue;
+            }
+            // One of the halfedges has a face, the other one is the border
+            const Mesh::Halfedge_index first(static_cast<Index>(2 * edge));
+            const Mesh::Halfedge_index border = mesh.is_border(first) ? first : mesh.opposite(first);
+            const Index next = outgoingBorders[mesh.target(border)].load(std::memory_order_relaxed);
+            if(next == NO_INDEX) {
+                isValid = false;
+                return;
+            }
+            mesh.set_next(border, Mesh::Halfedge_index(next));
+        }
+    });
+    if(!isValid) {
+        mesh.clear();
+        return false;
+    }
+
+    /// Link the vertices, a border vertex has to start at its border halfedge
+    threadPool.parallel_for_chunks(vertexCount, ITEMS_PER_CHUNK, [&](size_t, const size_t begin, const size_t end) {
+        for(size_t vertex = begin; vertex < end; ++vertex) {
+            const Index border = incomingBorders[vertex].load(std::memory_order_relaxed);
+            const Index halfedge =
+                border != NO_INDEX ? border : incomingHalfedges[vertex].load(std::memory_order_relaxed);
+            if(halfedge != NO_INDEX) {
+                mesh.set_halfedge(Mesh::Vertex_index(static_cast<Index>(vertex)), Mesh::Halfedge_index(halfedge));
+            }
+        }
+    });
+
+    /// Every vertex has to reach all of its faces around its halfedge, otherwise it joins several fans of faces
+    threadPool.parallel_for_chunks(vertexCount, ITEMS_PER_CHUNK, [&](size_t, const size_t begin, const size_t end) {
+        for(size_t vertex = begin; vertex < end; ++vertex) {
+            const Index vertexFaceCount = faceCounts[vertex].load(std::memory_order_relaxed);
+            if(vertexFaceCount == 0) {
+                continue;
+            }
+
+            Index reachedFaces = 0;
+            const Mesh::Halfedge_index start = mesh.halfedge(Mesh::Vertex_index(static_cast<Index>(vertex)));
+            Mesh::Halfedge_index halfedge = start;
+            // A manifold vertex has at most one border halfedge besides the halfedges of its faces
+            for(Index step = 0; step <= vertexFaceCount; ++step) {
+                if(!mesh.is_border(halfedge)) {
+                    ++reachedFaces;
+                }
+                halfedge = mesh.opposite(mesh.next(halfedge));
+                if(halfedge == start) {
+                    break;
+                }
+            }
+            if(halfedge != start || reachedFaces != vertexFaceCount) {
+                isValid = false;
+            }
+        }
+    });
+    if(!isValid) {
+        mesh.clear();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace pepr3d
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "ThreadPool.h"
+
+#include "geometry/PolyhedronData.h"
+
+namespace pepr3d {
+
+/// Builds the connectivity of a Surface_mesh from an indexed triangle mesh in bulk.
+/// The halfedges of the faces are paired by a parallel sort of their directed edges, then the connectivity arrays of
+/// the mesh are filled in parallel, instead of adding the faces one by one via Surface_mesh::add_face.
+class SurfaceMeshBuilder {
+   public:
+    /// Builds the mesh with the i-th face created from the i-th triangle, the same face order add_face would give.
+    /// Returns false and leaves the mesh empty if the triangles do not form a consistently oriented mesh with
+    /// manifold edges and vertices. add_face may still be able to build some of these meshes.
+    static bool build(const std::vector<glm::vec3>& vertices, const std::vector<IndexedTriangles::Indices>& indices,
+                      PolyhedronData::Mesh& mesh, ::ThreadPool& threadPool);
+};
+
+}  // namespace pepr3d
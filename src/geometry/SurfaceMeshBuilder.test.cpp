@@ -0,0 +1,123 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+#include "geometry/SurfaceMeshBuilder.h"
+
+namespace {
+
+using pepr3d::PolyhedronData;
+using pepr3d::SurfaceMeshBuilder;
+using Mesh = PolyhedronData::Mesh;
+using Indices = pepr3d::IndexedTriangles::Indices;
+
+/// Triangles of a grid of width x height quads, closed into a torus or left open
+void getGrid(const size_t width, const size_t height, const bool isClosed, std::vector<glm::vec3>& vertices,
+             std::vector<Indices>& indices) {
+    const size_t rowSize = isClosed ? width : width + 1;
+    const size_t rowCount = isClosed ? height : height + 1;
+    vertices.clear();
+    for(size_t y = 0; y < rowCount; ++y) {
+        for(size_t x = 0; x < rowSize; ++x) {
+            vertices.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.f);
+        }
+    }
+    const auto getVertex = [rowSize, rowCount](const size_t x, const size_t y) {
+        return static_cast<uint32_t>((y % rowCount) * rowSize + x % rowSize);
+    };
+    indices.clear();
+    for(size_t y = 0; y < height; ++y) {
+        for(size_t x = 0; x < width; ++x) {
+            indices.push_back({getVertex(x, y), getVertex(x + 1, y), getVertex(x + 1, y + 1)});
+            indices.push_back({getVertex(x, y), getVertex(x + 1, y + 1), getVertex(x, y + 1)});
+        }
+    }
+}
+
+/// Build the mesh via add_face for comparison
+Mesh buildWithAddFace(const std::vector<glm::vec3>& vertices, const std::vector<Indices>& indices) {
+    Mesh mesh;
+    for(const glm::vec3& vertex : vertices) {
+        mesh.add_vertex(pepr3d::DataTriangle::Point(vertex.x, vertex.y, vertex.z));
+    }
+    for(const auto& tri : indices) {
+        const auto face = mesh.add_face(Mesh::Vertex_index(static_cast<Mesh::size_type>(tri[0])),
+                                        Mesh::Vertex_index(static_cast<Mesh::size_type>(tri[1])),
+                                        Mesh::Vertex_index(static_cast<Mesh::size_type>(tri[2])));
+        EXPECT_NE(face, Mesh::null_face());
+    }
+    return mesh;
+}
+
+/// Compares the faces, their halfedges and neighbours, and the border vertices of the meshes
+void expectSameMesh(const Mesh& mesh, const Mesh& expected) {
+    EXPECT_TRUE(mesh.is_valid());
+    ASSERT_EQ(mesh.number_of_vertices(), expected.number_of_vertices());
+    ASSERT_EQ(mesh.number_of_edges(), expected.number_of_edges());
+    ASSERT_EQ(mesh.number_of_faces(), expected.number_of_faces());
+    for(const Mesh::Face_index face : expected.faces()) {
+        Mesh::Halfedge_index halfedge = mesh.halfedge(face);
+        Mesh::Halfedge_index expectedHalfedge = expected.halfedge(face);
+        for(int i = 0; i < 3; ++i) {
+            EXPECT_EQ(mesh.target(halfedge), expected.target(expectedHalfedge));
+            EXPECT_EQ(mesh.face(mesh.opposite(halfedge)), expected.face(expected.opposite(expectedHalfedge)));
+            halfedge = mesh.next(halfedge);
+            expectedHalfedge = expected.next(expectedHalfedge);
+        }
+    }
+    for(const Mesh::Vertex_index vertex : expected.vertices()) {
+        EXPECT_EQ(mesh.is_border(vertex), expected.is_border(vertex));
+        EXPECT_EQ(mesh.degree(vertex), expected.degree(vertex));
+    }
+}
+
+}  // namespace
+
+TEST(SurfaceMeshBuilder, matchesAddFace) {
+    /**
+     * Test that closed and open meshes spanning many chunks are built with the same faces and neighbours as by
+     * add_face, regardless of the order of the triangles
+     */
+    ::ThreadPool threadPool(3);
+    std::vector<glm::vec3> vertices;
+    std::vector<Indices> indices;
+
+    for(const bool isClosed : {true, false}) {
+        getGrid(300, 200, isClosed, vertices, indices);
+        std::shuffle(indices.begin(), indices.end(), std::mt19937(42));
+
+        Mesh mesh;
+        ASSERT_TRUE(SurfaceMeshBuilder::build(vertices, indices, mesh, threadPool));
+        expectSameMesh(mesh, buildWithAddFace(vertices, indices));
+    }
+}
+
+TEST(SurfaceMeshBuilder, rejectsNonManifold) {
+    /**
+     * Test that meshes with non-manifold vertices or edges, inconsistent orientation or invalid triangles are not built
+     */
+    ::ThreadPool threadPool(2);
+    const std::vector<glm::vec3> vertices(7);
+    Mesh mesh;
+
+    // Two triangles touching at a vertex
+    EXPECT_FALSE(SurfaceMeshBuilder::build(vertices, {{0, 1, 2}, {0, 3, 4}}, mesh, threadPool));
+    EXPECT_TRUE(mesh.is_empty());
+    // Two closed tetrahedra touching at a vertex
+    std::vector<Indices> tetrahedra = {{0, 2, 1}, {0, 1, 3}, {1, 2, 3}, {2, 0, 3},
+                                   {0, 5, 4}, {0, 4, 6}, {4, 5, 6}, {5, 0, 6}};
+    EXPECT_FALSE(SurfaceMeshBuilder::build(vertices, tetrahedra, mesh, threadPool));
+    tetrahedra.resize(4);
+    EXPECT_TRUE(SurfaceMeshBuilder::build(vertices, tetrahedra, mesh, threadPool));
+    EXPECT_TRUE(mesh.is_valid());
+
+    // Inconsistent orientation, an edge of three triangles and degenerate triangles
+    EXPECT_FALSE(SurfaceMeshBuilder::build(vertices, {{0, 1, 2}, {0, 1, 3}}, mesh, threadPool));
+    EXPECT_FALSE(SurfaceMeshBuilder::build(vertices, {{0, 1, 2}, {1, 0, 3}, {0, 1, 4}}, mesh, threadPool));
+    EXPECT_FALSE(SurfaceMeshBuilder::build(vertices, {{0, 1, 1}}, mesh, threadPool));
+    EXPECT_FALSE(SurfaceMeshBuilder::build(vertices, {{0, 1, 9}}, mesh, threadPool));
+}
+
+#endif
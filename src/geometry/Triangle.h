@@ -7,9 +7,17 @@
 #include <cereal/cereal.hpp>
 #include <glm/glm.hpp>
 
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "geometry/GlmSerialization.h"
+#include "peprassert.h"
+
 namespace pepr3d {
 
-/// Custom Triangle type holding the CGAL::Triangle_3 and additional data
+/// Custom Triangle type holding the vertices in float coordinates and additional data.
+/// The CGAL::Triangle_3 view of the triangle is only built on demand.
 class DataTriangle {
    public:
     // Use spherical kernel otherwise some CGAL operations on spheres will assert fail
@@ -21,35 +29,42 @@ class DataTriangle {
     using Triangle = K::Triangle_3;
 
    private:
-    /// Geometry data in CGAL format to allow for usage in AABB tree
-    Triangle mTriangleCgal;
-
-    /// Color of the triangle in the final STL file
-    size_t mColor;
+    /// Positions of the vertices
+    std::array<glm::vec3, 3> mVertices;
 
     /// Normal of the triangle
     glm::vec3 mNormal;
 
+    /// Color of the triangle in the final STL file
+    uint8_t mColor;
+
     friend class cereal::access;
 
    public:
     DataTriangle() : mColor(0) {}
 
     DataTriangle(const glm::vec3 x, const glm::vec3 y, const glm::vec3 z, const glm::vec3 n, const size_t col = 0)
-        : mTriangleCgal(Point(x.x, x.y, x.z), Point(y.x, y.y, y.z), Point(z.x, z.y, z.z)), mColor(col), mNormal(n) {}
+        : mVertices{x, y, z}, mNormal(n), mColor(static_cast<uint8_t>(col)) {
+        P_ASSERT(col <= std::numeric_limits<uint8_t>::max());
+    }
 
-    /// Method used by the AABB conversion functor to make DataTriangle searchable in AABB tree
-    const Triangle& getTri() const {
-        return mTriangleCgal;
+    /// Geometry data in CGAL format, built from the vertices on each call
+    Triangle getTri() const {
+        return Triangle(getPoint(0), getPoint(1), getPoint(2));
     }
 
     glm::vec3 getVertex(const size_t i) const {
-        auto v = mTriangleCgal.vertex(static_cast<int>(i));
-        return glm::vec3(v.x(), v.y(), v.z());
+        P_ASSERT(i < 3);
+        return mVertices[i];
+    }
+
+    const std::array<glm::vec3, 3>& getVertices() const {
+        return mVertices;
     }
 
     void setColor(const size_t newColor) {
-        mColor = newColor;
+        P_ASSERT(newColor <= std::numeric_limits<uint8_t>::max());
+        mColor = static_cast<uint8_t>(newColor);
     }
 
     size_t getColor() const {
@@ -61,9 +76,25 @@ class DataTriangle {
     }
 
    private:
+    Point getPoint(const size_t i) const {
+        return Point(mVertices[i].x, mVertices[i].y, mVertices[i].z);
+    }
+
+    // Saved as the CGAL triangle that used to be stored, so that older projects can be loaded
+    template <class Archive>
+    void save(Archive& ar) const {
+        ar(getTri(), static_cast<size_t>(mColor), mNormal);
+    }
+
     template <class Archive>
-    void serialize(Archive& ar) {
-        ar(mTriangleCgal, mColor, mNormal);
+    void load(Archive& ar) {
+        Triangle tri;
+        size_t color;
+        ar(tri, color, mNormal);
+        for(int i = 0; i < 3; ++i) {
+            mVertices[i] = glm::vec3(tri[i].x(), tri[i].y(), tri[i].z());
+        }
+        setColor(color);
     }
 };
 
@@ -0,0 +1,673 @@
+#include "geometry/TriangleBvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+
+#include "peprassert.h"
+
+namespace pepr3d {
+
+namespace {
+
+/// Number of centroid bins along each axis, in which the split planes are evaluated
+constexpr int BIN_COUNT = 16;
+
+/// Cost of visiting an inner node relative to testing one triangle
+constexpr float TRAVERSAL_COST = 1.f;
+
+/// Nodes with at least this many triangles are binned in parallel and their children are built in parallel
+constexpr uint32_t PARALLEL_SIZE = 16 * 1024;
+
+/// Number of triangles processed by one task of a parallel step
+constexpr uint32_t CHUNK_SIZE = 4 * 1024;
+
+/// Axis aligned box, an empty box has its minimum above its maximum
+struct Box {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void extend(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void extend(const Box& box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    /// Surface area, 0 for an empty box
+    float getArea() const {
+        const glm::vec3 size = glm::max(max - min, glm::vec3(0.f));
+        return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+};
+
+/// Triangles whose centroids fall into one bin
+struct Bin {
+    Box box;
+    uint32_t count = 0;
+};
+
+using Bins = std::array<std::array<Bin, BIN_COUNT>, 3>;
+
+/// The best split plane of a node, between the bins bin and bin + 1 along the axis
+struct Split {
+    int axis = -1;
+    int bin = 0;
+    float cost = std::numeric_limits<float>::max();
+};
+
+/// Entry parameter of the segment origin + t * direction, t in [0, maxDistance], into the box enlarged by margin
+bool intersectSegmentBox(const glm::vec3& boxMin, const glm::vec3& boxMax, const float margin, const glm::vec3& origin,
+                         const glm::vec3& direction, const float maxDistance, float& entryDistance) {
+    float tMin = 0.f;
+    float tMax = maxDistance;
+    for(int axis = 0; axis < 3; ++axis) {
+        const float slabMin = boxMin[axis] - margin;
+        const float slabMax = boxMax[axis] + margin;
+        if(direction[axis] == 0.f) {
+            if(origin[axis] < slabMin || origin[axis] > slabMax) {
+                return false;
+            }
+            continue;
+        }
+
+        const float t1 = (slabMin - origin[axis]) / direction[axis];
+        const float t2 = (slabMax - origin[axis]) / direction[axis];
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+        if(tMin > tMax) {
+            return false;
+        }
+    }
+    entryDistance = tMin;
+    return true;
+}
+
+float getBoxDistanceSquared(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& point) {
+    const glm::vec3 diff = point - glm::clamp(point, boxMin, boxMax);
+    return glm::dot(diff, diff);
+}
+
+/// Ray parameter of the intersection of the ray with the triangle (Moller-Trumbore).
+/// Points within tolerance of the edges in barycentric coordinates are hits too.
+std::optional<float> intersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction,
+                                          const TriangleBvh::Triangle& tri, const float tolerance) {
+    const glm::vec3 edge1 = tri[1] - tri[0];
+    const glm::vec3 edge2 = tri[2] - tri[0];
+    const glm::vec3 p = glm::cross(direction, edge2);
+    const float determinant = glm::dot(edge1, p);
+    if(determinant == 0.f) {
+        return {};  // the ray is parallel to the triangle
+    }
+
+    const float inverseDeterminant = 1.f / determinant;
+    const glm::vec3 s = origin - tri[0];
+    const float u = glm::dot(s, p) * inverseDeterminant;
+    if(u < -tolerance || u > 1.f + tolerance) {
+        return {};
+    }
+
+    const glm::vec3 q = glm::cross(s, edge1);
+    const float v = glm::dot(direction, q) * inverseDeterminant;
+    if(v < -tolerance || u + v > 1.f + tolerance) {
+        return {};
+    }
+
+    const float t = glm::dot(edge2, q) * inverseDeterminant;
+    if(t < 0.f) {
+        return {};
+    }
+    return t;
+}
+
+float getSegmentPointDistanceSquared(const glm::vec3& start, const glm::vec3& end, const glm::vec3& point) {
+    const glm::vec3 segment = end - start;
+    const float lengthSquared = glm::dot(segment, segment);
+    const float t = lengthSquared > 0.f ? glm::clamp(glm::dot(point - start, segment) / lengthSquared, 0.f, 1.f) : 0.f;
+    const glm::vec3 diff = start + t * segment - point;
+    return glm::dot(diff, diff);
+}
+
+float getPointTriangleDistanceSquared(const glm::vec3& point, const TriangleBvh::Triangle& tri) {
+    const glm::vec3 normal = glm::cross(tri[1] - tri[0], tri[2] - tri[0]);
+    const float normalLengthSquared = glm::dot(normal, normal);
+    if(normalLengthSquared > 0.f) {
+        // The closest point is inside the triangle if the point projects onto the inner side of all edges
+        const bool isInside = glm::dot(glm::cross(tri[1] - tri[0], point - tri[0]), normal) >= 0.f &&
+                              glm::dot(glm::cross(tri[2] - tri[1], point - tri[1]), normal) >= 0.f &&
+                              glm::dot(glm::cross(tri[0] - tri[2], point - tri[2]), normal) >= 0.f;
+        if(isInside) {
+            const float planeDistance = glm::dot(point - tri[0], normal);
+            return planeDistance * planeDistance / normalLengthSquared;
+        }
+    }
+
+    return std::min({getSegmentPointDistanceSquared(tri[0], tri[1], point),
+                     getSegmentPointDistanceSquared(tri[1], tri[2], point),
+                     getSegmentPointDistanceSquared(tri[2], tri[0], point)});
+}
+
+/// Distance of the closest points of two segments, Real-Time Collision Detection 5.1.9
+float getSegmentSegmentDistanceSquared(const glm::vec3& start1, const glm::vec3& end1, const glm::vec3& start2,
+                                       const glm::vec3& end2) {
+    const glm::vec3 d1 = end1 - start1;
+    const glm::vec3 d2 = end2 - start2;
+    const glm::vec3 r = start1 - start2;
+    const float a = glm::dot(d1, d1);
+    const float e = glm::dot(d2, d2);
+    const float f = glm::dot(d2, r);
+
+    float s = 0.f;
+    float t = 0.f;
+    if(a == 0.f && e == 0.f) {
+        return glm::dot(r, r);
+    } else if(a == 0.f) {
+        t = glm::clamp(f / e, 0.f, 1.f);
+    } else {
+        const float c = glm::dot(d1, r);
+        if(e == 0.f) {
+            s = glm::clamp(-c / a, 0.f, 1.f);
+        } else {
+            const float b = glm::dot(d1, d2);
+            const float denominator = a * e - b * b;
+            s = denominator != 0.f ? glm::clamp((b * f - c * e) / denominator, 0.f, 1.f) : 0.f;
+            t = (b * s + f) / e;
+            if(t < 0.f) {
+                t = 0.f;
+                s = glm::clamp(-c / a, 0.f, 1.f);
+            } else if(t > 1.f) {
+                t = 1.f;
+                s = glm::clamp((b - c) / a, 0.f, 1.f);
+            }
+        }
+    }
+
+    const glm::vec3 diff = (start1 + s * d1) - (start2 + t * d2);
+    return glm::dot(diff, diff);
+}
+
+float getSegmentTriangleDistanceSquared(const glm::vec3& start, const glm::vec3& end,
+                                        const TriangleBvh::Triangle& tri) {
+    const std::optional<float> hit = intersectRayTriangle(start, end - start, tri, 0.f);
+    if(hit && *hit <= 1.f) {
+        return 0.f;
+    }
+
+    // Otherwise the closest points lie on an end of the segment or on an edge of the triangle
+    return std::min({getPointTriangleDistanceSquared(start, tri), getPointTriangleDistanceSquared(end, tri),
+                     getSegmentSegmentDistanceSquared(start, end, tri[0], tri[1]),
+                     getSegmentSegmentDistanceSquared(start, end, tri[1], tri[2]),
+                     getSegmentSegmentDistanceSquared(start, end, tri[2], tri[0])});
+}
+
+}  // namespace
+
+struct TriangleBvh::BuildContext {
+    /// Bounding box of each triangle
+    std::vector<Box> triangleBoxes;
+
+    /// Center of the bounding box of each triangle
+    std::vector<glm::vec3> centroids;
+
+    /// Triangle indices, each node reorders the range of its triangles
+    std::vector<uint32_t>& order;
+
+    /// Preallocated nodes, the children of a node are allocated together by increasing nodeCount
+    std::vector<Node>& nodes;
+    std::atomic<uint32_t> nodeCount{1};
+
+    ::ThreadPool* threadPool;
+
+    BuildContext(std::vector<uint32_t>& order, std::vector<Node>& nodes, ::ThreadPool* threadPool)
+        : order(order), nodes(nodes), threadPool(threadPool) {}
+
+    /// Thread pool for the steps of a node of count triangles, nullptr if the node is too small to split the work
+    ::ThreadPool* getNodeThreadPool(const uint32_t count) const {
+        return count >= PARALLEL_SIZE ? threadPool : nullptr;
+    }
+
+    /// Bounds of the triangles in order[begin, end) and of their centroids
+    void computeBounds(const uint32_t begin, const uint32_t end, Box& box, Box& centroidBox) const {
+        const auto extendBounds = [this](const uint32_t chunkBegin, const uint32_t chunkEnd, Box& chunkBox,
+                                         Box& chunkCentroidBox) {
+            for(uint32_t i = chunkBegin; i < chunkEnd; ++i) {
+                chunkBox.extend(triangleBoxes[order[i]]);
+                chunkCentroidBox.extend(centroids[order[i]]);
+            }
+        };
+
+        ::ThreadPool* nodeThreadPool = getNodeThreadPool(end - begin);
+        if(nodeThreadPool == nullptr) {
+            extendBounds(begin, end, box, centroidBox);
+            return;
+        }
+
+        std::vector<std::pair<Box, Box>> chunkBounds(::ThreadPool::chunk_count(end - begin, CHUNK_SIZE));
+        nodeThreadPool->parallel_for_chunks(
+            end - begin, CHUNK_SIZE, [&, begin](size_t chunkIdx, size_t chunkBegin, size_t chunkEnd) {
+                extendBounds(begin + static_cast<uint32_t>(chunkBegin), begin + static_cast<uint32_t>(chunkEnd),
+                             chunkBounds[chunkIdx].first, chunkBounds[chunkIdx].second);
+            });
+        for(const std::pair<Box, Box>& bounds : chunkBounds) {
+            box.extend(bounds.first);
+            centroidBox.extend(bounds.second);
+        }
+    }
+
+    /// Bin of the triangle along the axis
+    static int getBin(const glm::vec3& centroid, const int axis, const Box& centroidBox, const glm::vec3& binScale) {
+        const int bin = static_cast<int>((centroid[axis] - centroidBox.min[axis]) * binScale[axis]);
+        return std::min(bin, BIN_COUNT - 1);
+    }
+
+    /// Sort the triangles in order[begin, end) into bins along each axis
+    Bins fillBins(const uint32_t begin, const uint32_t end, const Box& centroidBox, const glm::vec3& binScale) const {
+        const auto addToBins = [this, &centroidBox, &binScale](const uint32_t chunkBegin, const uint32_t chunkEnd,
+                                                               Bins& bins) {
+            for(uint32_t i = chunkBegin; i < chunkEnd; ++i) {
+                const uint32_t triIdx = order[i];
+                for(int axis = 0; axis < 3; ++axis) {
+                    Bin& bin = bins[axis][getBin(centroids[triIdx], axis, centroidBox, binScale)];
+                    bin.box.extend(triangleBoxes[triIdx]);
+                    ++bin.count;
+                }
+            }
+        };
+
+        Bins result;
+        ::ThreadPool* nodeThreadPool = getNodeThreadPool(end - begin);
+        if(nodeThreadPool == nullptr) {
+            addToBins(begin, end, result);
+            return result;
+        }
+
+        std::vector<Bins> chunkBins(::ThreadPool::chunk_count(end - begin, CHUNK_SIZE));
+        nodeThreadPool->parallel_for_chunks(
+            end - begin, CHUNK_SIZE, [&, begin](size_t chunkIdx, size_t chunkBegin, size_t chunkEnd) {
+                addToBins(begin + static_cast<uint32_t>(chunkBegin), begin + static_cast<uint32_t>(chunkEnd),
+                          chunkBins[chunkIdx]);
+            });
+        for(const Bins& bins : chunkBins) {
+            for(int axis = 0; axis < 3; ++axis) {
+                for(int binIdx = 0; binIdx < BIN_COUNT; ++binIdx) {
+                    result[axis][binIdx].box.extend(bins[axis][binIdx].box);
+                    result[axis][binIdx].count += bins[axis][binIdx].count;
+                }
+            }
+        }
+        return result;
+    }
+
+    /// The split with the lowest surface area heuristic cost, cost of the leaf is the number of its triangles
+    static Split findBestSplit(const Bins& bins, const glm::vec3& binScale, const float area) {
+        const float inverseArea = area > 0.f ? 1.f / area : 0.f;
+        Split best;
+        for(int axis = 0; axis < 3; ++axis) {
+            if(binScale[axis] == 0.f) {
+                continue;  // all centroids lie in one plane perpendicular to the axis
+            }
+
+            // Weighted areas of the right sides of all split planes
+            std::array<float, BIN_COUNT> rightCosts{};
+            std::array<uint32_t, BIN_COUNT> rightCounts{};
+            Box rightBox;
+            uint32_t rightCount = 0;
+            for(int binIdx = BIN_COUNT - 1; binIdx > 0; --binIdx) {
+                rightBox.extend(bins[axis][binIdx].box);
+                rightCount += bins[axis][binIdx].count;
+                rightCosts[binIdx - 1] = rightBox.getArea() * static_cast<float>(rightCount);
+                rightCounts[binIdx - 1] = rightCount;
+            }
+
+            Box leftBox;
+            uint32_t leftCount = 0;
+            for(int binIdx = 0; binIdx < BIN_COUNT - 1; ++binIdx) {
+                leftBox.extend(bins[axis][binIdx].box);
+                leftCount += bins[axis][binIdx].count;
+                if(leftCount == 0 || rightCounts[binIdx] == 0) {
+                    continue;
+                }
+
+                const float cost =
+                    TRAVERSAL_COST +
+                    (leftBox.getArea() * static_cast<float>(leftCount) + rightCosts[binIdx]) * inverseArea;
+                if(cost < best.cost) {
+                    best.axis = axis;
+                    best.bin = binIdx;
+                    best.cost = cost;
+                }
+            }
+        }
+        return best;
+    }
+};
+
+void TriangleBvh::build(const std::vector<Triangle>& triangles, ::ThreadPool* threadPool) {
+    P_ASSERT(triangles.size() < std::numeric_limits<uint32_t>::max() / 2);
+    clear();
+    if(triangles.empty()) {
+        return;
+    }
+
+    const uint32_t triangleCount = static_cast<uint32_t>(triangles.size());
+    mTriangleOrder.resize(triangleCount);
+    std::iota(mTriangleOrder.begin(), mTriangleOrder.end(), 0);
+
+    // Both children of a split node are not empty, so there are less than two nodes per triangle
+    mNodes.resize(2 * triangleCount - 1);
+    BuildContext context(mTriangleOrder, mNodes, threadPool);
+    context.triangleBoxes.resize(triangleCount);
+    context.centroids.resize(triangleCount);
+
+    // Calls f(chunkIdx, chunkBegin, chunkEnd) for the chunks of all triangles, in parallel if there is a thread pool
+    const auto forEachChunk = [threadPool, triangleCount](const auto& f) {
+        if(threadPool == nullptr) {
+            f(size_t{0}, size_t{0}, size_t{triangleCount});
+        } else {
+            threadPool->parallel_for_chunks(triangleCount, CHUNK_SIZE, f);
+        }
+    };
+
+    forEachChunk([&context, &triangles](size_t, const size_t chunkBegin, const size_t chunkEnd) {
+        for(size_t triIdx = chunkBegin; triIdx < chunkEnd; ++triIdx) {
+            Box& box = context.triangleBoxes[triIdx];
+            for(const glm::vec3& vertex : triangles[triIdx]) {
+                box.extend(vertex);
+            }
+            context.centroids[triIdx] = (box.min + box.max) * 0.5f;
+        }
+    });
+
+    buildNode(context, 0, 0, triangleCount, 0);
+    mNodes.resize(context.nodeCount);
+    mNodes.shrink_to_fit();
+
+    mTriangles.resize(triangleCount);
+    forEachChunk([this, &triangles](size_t, const size_t chunkBegin, const size_t chunkEnd) {
+        for(size_t i = chunkBegin; i < chunkEnd; ++i) {
+            mTriangles[i] = triangles[mTriangleOrder[i]];
+        }
+    });
+
+    const glm::vec3 extent = glm::max(glm::abs(getBoxMin()), glm::abs(getBoxMax()));
+    mExtent = std::max({extent.x, extent.y, extent.z});
+}
+
+void TriangleBvh::clear() {
+    mNodes.clear();
+    mTriangles.clear();
+    mTriangleOrder.clear();
+    mExtent = 0.f;
+}
+
+void TriangleBvh::buildNode(BuildContext& context, const uint32_t nodeIdx, const uint32_t begin, const uint32_t end,
+                            const uint32_t depth) {
+    P_ASSERT(begin < end);
+    const uint32_t count = end - begin;
+    Box box;
+    Box centroidBox;
+    context.computeBounds(begin, end, box, centroidBox);
+
+    Node& node = context.nodes[nodeIdx];
+    node.boxMin = box.min;
+    node.boxMax = box.max;
+    node.offset = begin;
+    node.count = count;
+    if(count == 1 || depth >= MAX_DEPTH) {
+        return;
+    }
+
+    uint32_t middle = begin;
+    const glm::vec3 centroidExtent = centroidBox.max - centroidBox.min;
+    if(centroidExtent.x > 0.f || centroidExtent.y > 0.f || centroidExtent.z > 0.f) {
+        glm::vec3 binScale(0.f);
+        for(int axis = 0; axis < 3; ++axis) {
+            if(centroidExtent[axis] > 0.f) {
+                binScale[axis] = static_cast<float>(BIN_COUNT) / centroidExtent[axis];
+            }
+        }
+
+        const Bins bins = context.fillBins(begin, end, centroidBox, binScale);
+        const Split split = BuildContext::findBestSplit(bins, binScale, box.getArea());
+        P_ASSERT(split.axis >= 0);
+        if(count <= MAX_LEAF_SIZE && split.cost >= static_cast<float>(count)) {
+            return;
+        }
+
+        const auto isLeft = [&context, &centroidBox, &binScale, &split](const uint32_t triIdx) {
+            return BuildContext::getBin(context.centroids[triIdx], split.axis, centroidBox, binScale) <= split.bin;
+        };
+        middle = static_cast<uint32_t>(
+            std::partition(context.order.begin() + begin, context.order.begin() + end, isLeft) - context.order.begin());
+    }
+
+    if(middle == begin || middle == end) {
+        // All centroids coincide, the triangles are split in halves
+        if(count <= MAX_LEAF_SIZE) {
+            return;
+        }
+        middle = begin + count / 2;
+    }
+
+    const uint32_t firstChild = context.nodeCount.fetch_add(2);
+    node.offset = firstChild;
+    node.count = 0;
+
+    ::ThreadPool* threadPool = context.getNodeThreadPool(count);
+    if(threadPool != nullptr) {
+        const std::array<std::array<uint32_t, 3>, 2> children = {
+            {{firstChild, begin, middle}, {firstChild + 1, middle, end}}};
+        threadPool->parallel_for(children.begin(), children.end(),
+                                 [&context, depth](const std::array<uint32_t, 3>& child) {
+                                     buildNode(context, child[0], child[1], child[2], depth + 1);
+                                 });
+    } else {
+        buildNode(context, firstChild, begin, middle, depth + 1);
+        buildNode(context, firstChild + 1, middle, end, depth + 1);
+    }
+}
+
+std::optional<TriangleBvh::Hit> TriangleBvh::firstIntersection(const glm::vec3& origin,
+                                                               const glm::vec3& direction) const {
+    if(mNodes.empty()) {
+        return {};
+    }
+
+    // Hits within the tolerance of the triangles may lie a little outside of the node boxes
+    const float boxMargin = 4.f * FLOAT_TOLERANCE * mExtent;
+    float bestDistance = std::numeric_limits<float>::max();
+    uint32_t bestTriangle = std::numeric_limits<uint32_t>::max();
+
+    NodeStack stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        const Node& node = mNodes[stack[--stackSize]];
+        float entryDistance;
+        if(!intersectSegmentBox(node.boxMin, node.boxMax, boxMargin, origin, direction, bestDistance, entryDistance)) {
+            continue;
+        }
+
+        if(node.count > 0) {
+            for(uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                const std::optional<float> distance =
+                    intersectRayTriangle(origin, direction, mTriangles[i], FLOAT_TOLERANCE);
+                if(distance && (*distance < bestDistance ||
+                                (*distance == bestDistance && mTriangleOrder[i] < bestTriangle))) {
+                    bestDistance = *distance;
+                    bestTriangle = mTriangleOrder[i];
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so that it can cull the farther one
+        const Node& first = mNodes[node.offset];
+        const Node& second = mNodes[node.offset + 1];
+        float firstDistance;
+        float secondDistance;
+        const bool isFirstHit = intersectSegmentBox(first.boxMin, first.boxMax, boxMargin, origin, direction,
+                                                    bestDistance, firstDistance);
+        const bool isSecondHit = intersectSegmentBox(second.boxMin, second.boxMax, boxMargin, origin, direction,
+                                                     bestDistance, secondDistance);
+        if(isFirstHit && isSecondHit) {
+            const bool isFirstNearer = firstDistance <= secondDistance;
+            stack[stackSize++] = isFirstNearer ? node.offset + 1 : node.offset;
+            stack[stackSize++] = isFirstNearer ? node.offset : node.offset + 1;
+        } else if(isFirstHit) {
+            stack[stackSize++] = node.offset;
+        } else if(isSecondHit) {
+            stack[stackSize++] = node.offset + 1;
+        }
+    }
+
+    if(bestTriangle == std::numeric_limits<uint32_t>::max()) {
+        return {};
+    }
+    return Hit{bestTriangle, bestDistance};
+}
+
+size_t TriangleBvh::findClosest(const glm::vec3& point) const {
+    P_ASSERT(!mNodes.empty());
+    float bestDistanceSquared = std::numeric_limits<float>::max();
+    uint32_t bestTriangle = std::numeric_limits<uint32_t>::max();
+
+    NodeStack stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        const Node& node = mNodes[stack[--stackSize]];
+        if(getBoxDistanceSquared(node.boxMin, node.boxMax, point) > bestDistanceSquared) {
+            continue;
+        }
+
+        if(node.count > 0) {
+            for(uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                const float distanceSquared = getPointTriangleDistanceSquared(point, mTriangles[i]);
+                if(distanceSquared < bestDistanceSquared ||
+                   (distanceSquared == bestDistanceSquared && mTriangleOrder[i] < bestTriangle)) {
+                    bestDistanceSquared = distanceSquared;
+                    bestTriangle = mTriangleOrder[i];
+                }
+            }
+            continue;
+        }
+
+        const Node& first = mNodes[node.offset];
+        const Node& second = mNodes[node.offset + 1];
+        const bool isFirstNearer = getBoxDistanceSquared(first.boxMin, first.boxMax, point) <=
+                                   getBoxDistanceSquared(second.boxMin, second.boxMax, point);
+        stack[stackSize++] = isFirstNearer ? node.offset + 1 : node.offset;
+        stack[stackSize++] = isFirstNearer ? node.offset : node.offset + 1;
+    }
+
+    P_ASSERT(bestTriangle < mTriangleOrder.size());
+    return bestTriangle;
+}
+
+float TriangleBvh::getToleratedRadius(const float radius) const {
+    return radius + FLOAT_TOLERANCE * (radius + mExtent);
+}
+
+template <typename NodeTest, typename TriangleTest>
+std::vector<size_t> TriangleBvh::collect(const NodeTest& isNodeNear, const TriangleTest& isTriangleNear) const {
+    std::vector<size_t> result;
+    if(mNodes.empty()) {
+        return result;
+    }
+
+    NodeStack stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        const Node& node = mNodes[stack[--stackSize]];
+        if(!isNodeNear(node)) {
+            continue;
+        }
+
+        if(node.count > 0) {
+            for(uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                if(isTriangleNear(mTriangles[i])) {
+                    result.push_back(mTriangleOrder[i]);
+                }
+            }
+        } else {
+            stack[stackSize++] = node.offset + 1;
+            stack[stackSize++] = node.offset;
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<size_t> TriangleBvh::querySphere(const glm::vec3& center, const float radius) const {
+    const float toleratedRadius = getToleratedRadius(radius);
+    const float radiusSquared = toleratedRadius * toleratedRadius;
+    return collect(
+        [&center, radiusSquared](const Node& node) {
+            return getBoxDistanceSquared(node.boxMin, node.boxMax, center) <= radiusSquared;
+        },
+        [&center, radiusSquared](const Triangle& tri) {
+            return getPointTriangleDistanceSquared(center, tri) <= radiusSquared;
+        });
+}
+
+std::vector<size_t> TriangleBvh::queryCapsule(const glm::vec3& start, const glm::vec3& end, const float radius) const {
+    const float toleratedRadius = getToleratedRadius(radius);
+    const float radiusSquared = toleratedRadius * toleratedRadius;
+    const glm::vec3 direction = end - start;
+    return collect(
+        [&start, &direction, toleratedRadius](const Node& node) {
+            // The segment passes closer than the radius to the box only if it intersects the box enlarged by radius
+            float entryDistance;
+            return intersectSegmentBox(node.boxMin, node.boxMax, toleratedRadius, start, direction, 1.f,
+                                       entryDistance);
+        },
+        [&start, &end, radiusSquared](const Triangle& tri) {
+            return getSegmentTriangleDistanceSquared(start, end, tri) <= radiusSquared;
+        });
+}
+
+std::vector<size_t> TriangleBvh::queryLine(const glm::dvec3& linePoint, const glm::dvec3& lineDirection,
+                                           const float radius) const {
+    if(mNodes.empty()) {
+        return {};
+    }
+
+    // Only the part of the line inside the bounding box enlarged by the radius can be close to a triangle
+    const double margin = getToleratedRadius(radius);
+    double tMin = std::numeric_limits<double>::lowest();
+    double tMax = std::numeric_limits<double>::max();
+    for(int axis = 0; axis < 3; ++axis) {
+        const double slabMin = getBoxMin()[axis] - margin;
+        const double slabMax = getBoxMax()[axis] + margin;
+        if(lineDirection[axis] == 0.0) {
+            if(linePoint[axis] < slabMin || linePoint[axis] > slabMax) {
+                return {};
+            }
+            continue;
+        }
+
+        const double t1 = (slabMin - linePoint[axis]) / lineDirection[axis];
+        const double t2 = (slabMax - linePoint[axis]) / lineDirection[axis];
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+        if(tMin > tMax) {
+            return {};
+        }
+    }
+
+    // A zero direction leaves the parameters unbounded, the line is then a single point
+    if(tMin == std::numeric_limits<double>::lowest()) {
+        tMin = tMax = 0.0;
+    }
+    return queryCapsule(glm::vec3(linePoint + tMin * lineDirection), glm::vec3(linePoint + tMax * lineDirection),
+                        radius);
+}
+
+}  // namespace pepr3d
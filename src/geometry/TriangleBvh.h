@@ -0,0 +1,122 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace pepr3d {
+
+/// Bounding volume hierarchy over triangles in float coordinates, used to pick triangles with rays and to find the
+/// triangles near a brush. Nodes and triangles are stored in flat arrays. The hierarchy is built in parallel, splitting
+/// the nodes by the surface area heuristic evaluated over bins of triangle centroids.
+/// Queries do not modify the hierarchy, any number of threads may query it at once.
+class TriangleBvh {
+   public:
+    using Triangle = std::array<glm::vec3, 3>;
+
+    /// The first triangle hit by a ray
+    struct Hit {
+        /// Index of the triangle in the array the hierarchy was built from
+        size_t triangle;
+
+        /// Ray parameter of the hit, the hit point is origin + distance * direction
+        float distance;
+    };
+
+    /// Build the hierarchy over the triangles, replacing the previous one.
+    /// Large hierarchies are built in parallel if a thread pool is given.
+    void build(const std::vector<Triangle>& triangles, ::ThreadPool* threadPool = nullptr);
+
+    void clear();
+
+    bool empty() const {
+        return mNodes.empty();
+    }
+
+    size_t size() const {
+        return mTriangles.size();
+    }
+
+    /// Bounding box of all triangles, only valid if the hierarchy is not empty
+    glm::vec3 getBoxMin() const {
+        return mNodes.front().boxMin;
+    }
+
+    glm::vec3 getBoxMax() const {
+        return mNodes.front().boxMax;
+    }
+
+    /// The closest triangle hit by the ray, ties are broken by the lower triangle index.
+    /// Triangles are hit with a small tolerance, so that rays do not slip through rounding gaps between neighbours.
+    std::optional<Hit> firstIntersection(const glm::vec3& origin, const glm::vec3& direction) const;
+
+    /// Index of the triangle closest to the point. The hierarchy must not be empty.
+    size_t findClosest(const glm::vec3& point) const;
+
+    /// Indices of all triangles closer than radius to the point, in ascending order.
+    /// Like the other overlap queries it is conservative: triangles closer than radius are always returned, while
+    /// triangles that are only a rounding error further may be returned too.
+    std::vector<size_t> querySphere(const glm::vec3& center, float radius) const;
+
+    /// Indices of all triangles closer than radius to the segment, in ascending order
+    std::vector<size_t> queryCapsule(const glm::vec3& start, const glm::vec3& end, float radius) const;
+
+    /// Indices of all triangles closer than radius to the infinite line, in ascending order
+    std::vector<size_t> queryLine(const glm::dvec3& linePoint, const glm::dvec3& lineDirection, float radius) const;
+
+   private:
+    /// Nodes of at most this many triangles become leaves if splitting them does not pay off
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+    /// Nodes this deep always become leaves, which bounds the size of the traversal stack
+    static constexpr uint32_t MAX_DEPTH = 48;
+
+    /// Relative rounding error of the float computations, with a generous margin
+    static constexpr float FLOAT_TOLERANCE = 1e-5f;
+
+    struct Node {
+        /// Bounding box of all triangles in the subtree
+        glm::vec3 boxMin;
+        glm::vec3 boxMax;
+
+        /// Leaf: index of the first triangle in mTriangles. Inner node: index of the first child,
+        /// the second child directly follows it.
+        uint32_t offset;
+
+        /// Number of triangles in a leaf, 0 for an inner node
+        uint32_t count;
+    };
+
+    /// Nodes of the hierarchy, the root is the first one
+    std::vector<Node> mNodes;
+
+    /// Triangles ordered so that each leaf references a continuous range
+    std::vector<Triangle> mTriangles;
+
+    /// Original index of each triangle in mTriangles
+    std::vector<uint32_t> mTriangleOrder;
+
+    /// Largest absolute coordinate of the bounding box, which scales the rounding errors of the queries
+    float mExtent = 0.f;
+
+    struct BuildContext;
+
+    static void buildNode(BuildContext& context, uint32_t nodeIdx, uint32_t begin, uint32_t end, uint32_t depth);
+
+    /// Enlarge the radius of an overlap query by the rounding errors
+    float getToleratedRadius(float radius) const;
+
+    /// Stack of nodes to visit, large enough for a depth-first traversal of MAX_DEPTH levels
+    using NodeStack = std::array<uint32_t, MAX_DEPTH + 2>;
+
+    /// Collect the triangles of all leaves whose boxes pass isNodeNear and which pass isTriangleNear
+    template <typename NodeTest, typename TriangleTest>
+    std::vector<size_t> collect(const NodeTest& isNodeNear, const TriangleTest& isTriangleNear) const;
+};
+
+}  // namespace pepr3d
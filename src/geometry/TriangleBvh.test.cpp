@@ -0,0 +1,295 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+
+#include "geometry/TriangleBvh.h"
+
+namespace {
+
+using pepr3d::TriangleBvh;
+
+std::vector<TriangleBvh::Triangle> getRandomTriangles(std::mt19937& generator, size_t count) {
+    std::uniform_real_distribution<float> positionDistribution(-10.f, 10.f);
+    std::uniform_real_distribution<float> offsetDistribution(-1.f, 1.f);
+
+    std::vector<TriangleBvh::Triangle> triangles;
+    for(size_t i = 0; i < count; ++i) {
+        const glm::vec3 center(positionDistribution(generator), positionDistribution(generator),
+                               positionDistribution(generator));
+        TriangleBvh::Triangle tri;
+        for(glm::vec3& vertex : tri) {
+            vertex = center + glm::vec3(offsetDistribution(generator), offsetDistribution(generator),
+                                        offsetDistribution(generator));
+        }
+        triangles.push_back(tri);
+    }
+    return triangles;
+}
+
+/// Triangles of a grid of size x size quads in the z = 0 plane
+std::vector<TriangleBvh::Triangle> getGridTriangles(const int size) {
+    std::vector<TriangleBvh::Triangle> triangles;
+    for(int y = 0; y < size; ++y) {
+        for(int x = 0; x < size; ++x) {
+            const auto getVertex = [x, y](const int dx, const int dy) {
+                return glm::vec3(static_cast<float>(x + dx), static_cast<float>(y + dy), 0.f);
+            };
+            triangles.push_back({getVertex(0, 0), getVertex(1, 0), getVertex(1, 1)});
+            triangles.push_back({getVertex(0, 0), getVertex(1, 1), getVertex(0, 1)});
+        }
+    }
+    return triangles;
+}
+
+glm::dvec3 toDouble(const glm::vec3& v) {
+    return glm::dvec3(v.x, v.y, v.z);
+}
+
+/// Ray parameter of the hit computed in double precision, without any tolerance
+std::optional<double> getRayHit(const glm::dvec3& origin, const glm::dvec3& direction,
+                                const TriangleBvh::Triangle& tri) {
+    const glm::dvec3 a = toDouble(tri[0]);
+    const glm::dvec3 edge1 = toDouble(tri[1]) - a;
+    const glm::dvec3 edge2 = toDouble(tri[2]) - a;
+    const glm::dvec3 normal = glm::cross(edge1, edge2);
+    const double denominator = glm::dot(normal, direction);
+    if(denominator == 0.0) {
+        return {};
+    }
+    const double t = glm::dot(normal, a - origin) / denominator;
+    const glm::dvec3 hit = origin + t * direction;
+    const bool isInside = glm::dot(glm::cross(edge1, hit - a), normal) >= 0.0 &&
+                          glm::dot(glm::cross(toDouble(tri[2]) - toDouble(tri[1]), hit - toDouble(tri[1])), normal) >=
+                              0.0 &&
+                          glm::dot(glm::cross(a - toDouble(tri[2]), hit - toDouble(tri[2])), normal) >= 0.0;
+    if(t < 0.0 || !isInside) {
+        return {};
+    }
+    return t;
+}
+
+/// Distance of the point to the triangle in double precision, from the barycentric coordinates of its projection
+double getPointDistance(const glm::dvec3& point, const TriangleBvh::Triangle& tri) {
+    const glm::dvec3 a = toDouble(tri[0]);
+    const glm::dvec3 b = toDouble(tri[1]);
+    const glm::dvec3 c = toDouble(tri[2]);
+    const auto getSegmentDistance = [&point](const glm::dvec3& start, const glm::dvec3& end) {
+        const glm::dvec3 segment = end - start;
+        const double t = glm::clamp(glm::dot(point - start, segment) / glm::dot(segment, segment), 0.0, 1.0);
+        return glm::length(start + t * segment - point);
+    };
+
+    const glm::dvec3 ab = b - a;
+    const glm::dvec3 ac = c - a;
+    const glm::dvec3 ap = point - a;
+    const double d00 = glm::dot(ab, ab);
+    const double d01 = glm::dot(ab, ac);
+    const double d11 = glm::dot(ac, ac);
+    const double denominator = d00 * d11 - d01 * d01;
+    const double v = (d11 * glm::dot(ap, ab) - d01 * glm::dot(ap, ac)) / denominator;
+    const double w = (d00 * glm::dot(ap, ac) - d01 * glm::dot(ap, ab)) / denominator;
+    if(v >= 0.0 && w >= 0.0 && v + w <= 1.0) {
+        return glm::length(a + v * ab + w * ac - point);
+    }
+    return std::min({getSegmentDistance(a, b), getSegmentDistance(b, c), getSegmentDistance(c, a)});
+}
+
+/// Checks that the query returned all triangles closer than the radius and no triangle further than a tolerance
+template <typename DistanceFunc>
+void expectNearTriangles(const std::vector<size_t>& actual, const std::vector<TriangleBvh::Triangle>& triangles,
+                         const double radius, const double distanceError, const DistanceFunc& getDistance) {
+    EXPECT_TRUE(std::is_sorted(actual.begin(), actual.end()));
+    for(size_t i = 0; i < triangles.size(); ++i) {
+        const double distance = getDistance(triangles[i]);
+        const bool isFound = std::binary_search(actual.begin(), actual.end(), i);
+        if(distance <= radius) {
+            EXPECT_TRUE(isFound) << "triangle " << i << " at distance " << distance;
+        } else if(distance - distanceError > radius * 1.001 + 1e-3) {
+            EXPECT_FALSE(isFound) << "triangle " << i << " at distance " << distance;
+        }
+    }
+}
+
+}  // namespace
+
+TEST(TriangleBvh, empty) {
+    /**
+     * Test that an empty hierarchy returns nothing
+     */
+    TriangleBvh bvh;
+    bvh.build({});
+    EXPECT_TRUE(bvh.empty());
+    EXPECT_EQ(bvh.size(), 0);
+    EXPECT_FALSE(bvh.firstIntersection(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f)));
+    EXPECT_TRUE(bvh.querySphere(glm::vec3(0.f), 100.f).empty());
+    EXPECT_TRUE(bvh.queryCapsule(glm::vec3(0.f), glm::vec3(1.f), 100.f).empty());
+    EXPECT_TRUE(bvh.queryLine(glm::dvec3(0.0), glm::dvec3(1.0, 0.0, 0.0), 100.f).empty());
+}
+
+TEST(TriangleBvh, firstIntersection) {
+    /**
+     * Test that rays hit the closest triangle found by a linear scan
+     */
+    std::mt19937 generator(7);
+    const std::vector<TriangleBvh::Triangle> triangles = getRandomTriangles(generator, 2000);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+    ASSERT_EQ(bvh.size(), triangles.size());
+
+    std::uniform_real_distribution<float> distribution(-12.f, 12.f);
+    size_t hitCount = 0;
+    for(int rayIdx = 0; rayIdx < 500; ++rayIdx) {
+        const glm::vec3 origin(distribution(generator), distribution(generator), distribution(generator));
+        const glm::vec3 target(distribution(generator) * 0.5f, distribution(generator) * 0.5f,
+                               distribution(generator) * 0.5f);
+        const glm::vec3 direction = target - origin;
+
+        std::optional<double> expected;
+        for(const TriangleBvh::Triangle& tri : triangles) {
+            const std::optional<double> t = getRayHit(toDouble(origin), toDouble(direction), tri);
+            if(t && (!expected || *t < *expected)) {
+                expected = t;
+            }
+        }
+
+        const std::optional<TriangleBvh::Hit> hit = bvh.firstIntersection(origin, direction);
+        ASSERT_EQ(static_cast<bool>(hit), static_cast<bool>(expected));
+        if(hit) {
+            ++hitCount;
+            EXPECT_NEAR(hit->distance, *expected, 1e-4);
+            const std::optional<double> t = getRayHit(toDouble(origin), toDouble(direction), triangles[hit->triangle]);
+            ASSERT_TRUE(t);
+            EXPECT_NEAR(*t, *expected, 1e-4);
+        }
+    }
+    EXPECT_GT(hitCount, 100);
+}
+
+TEST(TriangleBvh, edgeHits) {
+    /**
+     * Test that rays through the shared edges and vertices of a grid never slip between the triangles
+     */
+    TriangleBvh bvh;
+    bvh.build(getGridTriangles(20));
+    for(float x = 0.5f; x < 20.f; x += 0.25f) {
+        for(float y = 0.5f; y < 20.f; y += 0.25f) {
+            EXPECT_TRUE(bvh.firstIntersection(glm::vec3(x, y, 3.f), glm::vec3(0.01f, -0.02f, -1.f)));
+            EXPECT_TRUE(bvh.firstIntersection(glm::vec3(x, y, -3.f), glm::vec3(0.f, 0.f, 1.f)));
+        }
+    }
+    EXPECT_FALSE(bvh.firstIntersection(glm::vec3(10.f, 10.f, 3.f), glm::vec3(0.f, 0.f, 1.f)));
+    EXPECT_FALSE(bvh.firstIntersection(glm::vec3(-1.f, 10.f, 3.f), glm::vec3(0.f, 0.f, -1.f)));
+}
+
+TEST(TriangleBvh, overlapQueries) {
+    /**
+     * Test that sphere, capsule and line queries return all triangles closer than the radius, and only a few more
+     * that are close to the limit
+     */
+    std::mt19937 generator(11);
+    const std::vector<TriangleBvh::Triangle> triangles = getRandomTriangles(generator, 300);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+
+    std::uniform_real_distribution<float> positionDistribution(-12.f, 12.f);
+    for(const float radius : {0.f, 0.3f, 1.f, 4.f}) {
+        for(int queryIdx = 0; queryIdx < 5; ++queryIdx) {
+            const glm::vec3 start(positionDistribution(generator), positionDistribution(generator),
+                                  positionDistribution(generator));
+            const glm::vec3 end(positionDistribution(generator), positionDistribution(generator),
+                                positionDistribution(generator));
+
+            expectNearTriangles(bvh.querySphere(start, radius), triangles, radius, 0.0,
+                                [&start](const TriangleBvh::Triangle& tri) {
+                                    return getPointDistance(toDouble(start), tri);
+                                });
+
+            // The distance to the segment is approximated by the distances to its samples
+            const int sampleCount = 1000;
+            const double sampleSpacing = glm::length(toDouble(end) - toDouble(start)) / sampleCount;
+            const auto getSampledDistance = [sampleCount](const glm::dvec3& from, const glm::dvec3& to,
+                                                          const TriangleBvh::Triangle& tri) {
+                double distance = std::numeric_limits<double>::max();
+                for(int i = 0; i <= sampleCount; ++i) {
+                    const double t = static_cast<double>(i) / sampleCount;
+                    distance = std::min(distance, getPointDistance(from + t * (to - from), tri));
+                }
+                return distance;
+            };
+            expectNearTriangles(bvh.queryCapsule(start, end, radius), triangles, radius, sampleSpacing,
+                                [&](const TriangleBvh::Triangle& tri) {
+                                    return getSampledDistance(toDouble(start), toDouble(end), tri);
+                                });
+
+            // The line reaches well beyond all triangles when extended 5 times
+            const glm::dvec3 lineDirection = toDouble(end) - toDouble(start);
+            const std::vector<size_t> inLine = bvh.queryLine(toDouble(start), lineDirection, radius);
+            const std::vector<size_t> inLongCapsule = bvh.queryCapsule(
+                glm::vec3(toDouble(start) - 5.0 * lineDirection), glm::vec3(toDouble(start) + 5.0 * lineDirection),
+                radius);
+            EXPECT_EQ(inLine, inLongCapsule);
+        }
+    }
+}
+
+TEST(TriangleBvh, findClosest) {
+    /**
+     * Test that the closest triangle is as close as the closest one found by a linear scan
+     */
+    std::mt19937 generator(3);
+    const std::vector<TriangleBvh::Triangle> triangles = getRandomTriangles(generator, 1000);
+    TriangleBvh bvh;
+    bvh.build(triangles);
+
+    std::uniform_real_distribution<float> distribution(-15.f, 15.f);
+    for(int queryIdx = 0; queryIdx < 200; ++queryIdx) {
+        const glm::vec3 point(distribution(generator), distribution(generator), distribution(generator));
+        double expected = std::numeric_limits<double>::max();
+        for(const TriangleBvh::Triangle& tri : triangles) {
+            expected = std::min(expected, getPointDistance(toDouble(point), tri));
+        }
+        const size_t closest = bvh.findClosest(point);
+        ASSERT_LT(closest, triangles.size());
+        EXPECT_NEAR(getPointDistance(toDouble(point), triangles[closest]), expected, 1e-4);
+    }
+}
+
+TEST(TriangleBvh, parallelBuild) {
+    /**
+     * Test that the hierarchy built in parallel answers all queries like the one built by a single thread
+     */
+    const std::vector<TriangleBvh::Triangle> triangles = getGridTriangles(200);
+    TriangleBvh serialBvh;
+    serialBvh.build(triangles);
+    ::ThreadPool threadPool(4);
+    TriangleBvh parallelBvh;
+    parallelBvh.build(triangles, &threadPool);
+
+    ASSERT_EQ(parallelBvh.size(), triangles.size());
+    EXPECT_EQ(parallelBvh.getBoxMin(), glm::vec3(0.f, 0.f, 0.f));
+    EXPECT_EQ(parallelBvh.getBoxMax(), glm::vec3(200.f, 200.f, 0.f));
+
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> distribution(-10.f, 210.f);
+    for(int queryIdx = 0; queryIdx < 200; ++queryIdx) {
+        const glm::vec3 origin(distribution(generator), distribution(generator), 50.f);
+        const glm::vec3 direction(distribution(generator) * 0.01f, distribution(generator) * 0.01f, -1.f);
+        const std::optional<TriangleBvh::Hit> serialHit = serialBvh.firstIntersection(origin, direction);
+        const std::optional<TriangleBvh::Hit> parallelHit = parallelBvh.firstIntersection(origin, direction);
+        ASSERT_EQ(static_cast<bool>(serialHit), static_cast<bool>(parallelHit));
+        if(serialHit) {
+            EXPECT_EQ(serialHit->triangle, parallelHit->triangle);
+            EXPECT_EQ(serialHit->distance, parallelHit->distance);
+        }
+
+        const glm::vec3 center(origin.x, origin.y, 0.5f);
+        EXPECT_EQ(serialBvh.querySphere(center, 3.f), parallelBvh.querySphere(center, 3.f));
+        EXPECT_EQ(serialBvh.queryCapsule(center, center + direction, 2.f),
+                  parallelBvh.queryCapsule(center, center + direction, 2.f));
+    }
+}
+
+#endif
@@ -9,6 +9,7 @@
 #include <CGAL/Polygon_2.h>
 #include <CGAL/Polygon_set_2.h>
 #include <CGAL/Spherical_kernel_intersections.h>
+#include <CGAL/convex_hull_2.h>
 #include <CGAL/partition_2.h>
 
 #ifdef PEPR3D_COLLECT_DEBUG_DATA
@@ -31,22 +32,71 @@
 namespace pepr3d {
 
 void TriangleDetail::paintSphere(const PeprSphere& peprSphere, int minSegments, size_t color) {
+    addPolygon(polygonFromSphere(peprSphere, minSegments), color);
+}
+
+void TriangleDetail::paintCapsules(const std::vector<Capsule>& capsules, int minSegments, size_t color) {
+    std::vector<Polygon> polygons;
+    polygons.reserve(capsules.size());
+    for(const Capsule& capsule : capsules) {
+        Polygon poly = polygonFromCapsule(capsule, minSegments);
+        if(!poly.is_empty()) {
+            polygons.emplace_back(std::move(poly));
+        }
+    }
+    addPolygons(polygons, color);
+}
+
+TriangleDetail::Polygon TriangleDetail::polygonFromCapsule(const Capsule& capsule, int minSegments) const {
+    const double squaredRadius = capsule.radius * capsule.radius;
+    if(capsule.start == capsule.end) {
+        return polygonFromSphere(PeprSphere(capsule.start, squaredRadius), minSegments);
+    }
+
+    // The plane cuts the capsule in a convex area, which is the hull of the cuts of spheres along the segment.
+    // Sampling the spheres at half of the radius keeps the sides of the hull close to the exact ones.
+    const PeprVector3 segment = capsule.end - capsule.start;
+    const double length = std::sqrt(segment.squared_length());
+    const size_t sectionCount = static_cast<size_t>(std::ceil(2.0 * length / capsule.radius)) + 1;
+
+    std::vector<Point2> points;
+    for(size_t i = 0; i < sectionCount; ++i) {
+        const double t = static_cast<double>(i) / static_cast<double>(sectionCount - 1);
+        const Polygon section = polygonFromSphere(PeprSphere(capsule.start + segment * t, squaredRadius), minSegments);
+        points.insert(points.end(), section.vertices_begin(), section.vertices_end());
+    }
+
+    std::vector<Point2> hull;
+    CGAL::convex_hull_2(points.begin(), points.end(), std::back_inserter(hull));
+    if(hull.size() < 3) {
+        return {};
+    }
+
+    const Polygon pgn(hull.begin(), hull.end());
+
+    P_ASSERT(pgn.is_counterclockwise_oriented());
+    P_ASSERT(CGAL::is_valid_polygon(pgn, Traits()));
+
+    return pgn;
+}
+
+TriangleDetail::Polygon TriangleDetail::polygonFromSphere(const PeprSphere& peprSphere, int minSegments) const {
     // Vertices on the triangle boundaries must be the same across multiple triangle details!
 
     const Sphere sphere(toExactK(peprSphere.center()), peprSphere.squared_radius());
     auto intersection = CGAL::intersection(sphere, mOriginalPlane);
 
     if(!intersection) {
-        return;
+        return {};
     }
 
     std::optional<Circle3> circleIntersection = boost::apply_visitor(SphereIntersectionVisitor{}, *intersection);
 
     // Continue only if the intersection is a circle (not a point or miss)
-    if(circleIntersection) {
-        auto poly = polygonFromCircle(*circleIntersection, minSegments);
-        addPolygon(poly, color);
+    if(!circleIntersection) {
+        return {};
     }
+    return polygonFromCircle(*circleIntersection, minSegments);
 }
 TriangleDetail::Polygon TriangleDetail::projectShapeToPolygon(const std::vector<PeprPoint3>& shape,
                                                               const PeprVector3& direction) {
@@ -87,6 +137,18 @@ void TriangleDetail::paintShape(const std::vector<PeprPoint3>& shape, const Pepr
     addPolygon(projectShapeToPolygon(shape, direction), color);
 }
 
+void TriangleDetail::paintShapes(const std::vector<const ProjectedShape*>& shapes, size_t color) {
+    std::vector<Polygon> polygons;
+    polygons.reserve(shapes.size());
+    for(const ProjectedShape* shape : shapes) {
+        Polygon poly = projectShapeToPolygon(shape->shape, shape->direction);
+        if(!poly.is_empty()) {
+            polygons.emplace_back(std::move(poly));
+        }
+    }
+    addPolygons(polygons, color);
+}
+
 void TriangleDetail::paintShape(const std::vector<PeprTriangle>& triangles, const PeprVector3& direction,
                                 size_t color) {
     std::vector<Polygon> polygons;
@@ -433,6 +495,20 @@ void TriangleDetail::addPolygon(const Polygon& poly, size_t color) {
     addPolygonSet(addedShape, color);
 }
 
+void TriangleDetail::addPolygons(const std::vector<Polygon>& polygons, size_t color) {
+    if(polygons.empty()) {
+        return;
+    }
+
+    // Sequential additions of the same color cover the same area as their union added at once
+    PolygonSet polySet;
+    for(const Polygon& poly : polygons) {
+        P_ASSERT(CGAL::is_valid_polygon(poly, Traits()));
+    }
+    polySet.join(polygons.begin(), polygons.end());
+    addPolygonSet(polySet, color);
+}
+
 void TriangleDetail::addPolygonSet(PolygonSet& polySet, size_t color) {
 #ifdef PEPR3D_COLLECT_DEBUG_DATA
     history.emplace_back(PolygonSetEntry{polySet, color});
@@ -467,10 +543,12 @@ TriangleDetail::Segment3 TriangleDetail::findSharedEdge(const TriangleDetail& ot
     size_t pointsFound = 0;
 
     // Find the two triangle vertices that are the same for both triangles
+    const PeprTriangle myTri = mOriginal.getTri();
+    const PeprTriangle otherTri = other.mOriginal.getTri();
     for(int i = 0; i < 3; i++) {
-        const PeprPoint3 myPoint = mOriginal.getTri().vertex(i);
+        const PeprPoint3 myPoint = myTri.vertex(i);
         for(int j = 0; j < 3; j++) {
-            const PeprPoint3 otherPoint = other.mOriginal.getTri().vertex(j);
+            const PeprPoint3 otherPoint = otherTri.vertex(j);
             if(myPoint == otherPoint) {
                 commonPoints[pointsFound++] = myPoint;
             }
@@ -658,6 +736,27 @@ void TriangleDetail::updateTrianglesFromPolygons() {
     P_ASSERT(mTriangles.size() == mTrianglesToExactIdx.size());
 }
 
+size_t TriangleDetail::getMemoryEstimate() const {
+    // Exact coordinates are reference counted lazy numbers on the heap, roughly this large per point, and each element
+    // of an arrangement takes a few pointers
+    constexpr size_t EXACT_POINT_BYTES = 128;
+    constexpr size_t ARRANGEMENT_ELEMENT_BYTES = 64;
+
+    size_t bytes = sizeof(TriangleDetail);
+    bytes += mTriangles.capacity() * sizeof(DataTriangle);
+    bytes += mTrianglesToExactIdx.capacity() * sizeof(size_t);
+    bytes += mTrianglesExact.capacity() * (sizeof(ExactTriangle) + 3 * EXACT_POINT_BYTES);
+    for(const auto& degenerateTriangles : mPolygonDegenerateTriangles) {
+        bytes += sizeof(degenerateTriangles) + degenerateTriangles.capacity() * sizeof(size_t);
+    }
+    for(const auto& coloredPoly : mColoredPolys) {
+        const auto& arrangement = coloredPoly.second.arrangement();
+        bytes += arrangement.number_of_vertices() * (EXACT_POINT_BYTES + ARRANGEMENT_ELEMENT_BYTES);
+        bytes += (arrangement.number_of_halfedges() + arrangement.number_of_faces()) * ARRANGEMENT_ELEMENT_BYTES;
+    }
+    return bytes;
+}
+
 void TriangleDetail::setColor(size_t detailIdx, size_t color) {
     P_ASSERT(detailIdx < mTriangles.size());
     P_ASSERT(mTriangles.size() == mTrianglesToExactIdx.size());
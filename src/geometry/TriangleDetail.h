@@ -159,15 +159,15 @@ class TriangleDetail {
 #endif
 
     explicit TriangleDetail(const DataTriangle& original) : mOriginal(original) {
-        const PeprTriangle& tri = mOriginal.getTri();
+        const PeprTriangle tri = mOriginal.getTri();
         mOriginalPlane = Plane(toExactK(tri.vertex(0)), toExactK(tri.vertex(1)), toExactK(tri.vertex(2)));
-        mBounds = polygonFromTriangle(mOriginal.getTri());
+        mBounds = polygonFromTriangle(tri);
         mTriangles.push_back(mOriginal);
         mTrianglesToExactIdx.push_back(0);
 
         std::array<Point2, 3> exactPoints;
         for(int i = 0; i < 3; i++) {
-            exactPoints[i] = mOriginalPlane.to_2d(toExactK(mOriginal.getTri().vertex(i)));
+            exactPoints[i] = mOriginalPlane.to_2d(toExactK(tri.vertex(i)));
         }
         mTrianglesExact.emplace_back(Triangle2(exactPoints[0], exactPoints[1], exactPoints[2]), original.getColor(), 0);
         mColoredPolys.emplace(mOriginal.getColor(), PolygonSet(mBounds));
@@ -177,11 +177,32 @@ class TriangleDetail {
     // Cereal requires default constructor
     TriangleDetail() = default;
 
+    /// Shape that is going to be projected onto the TriangleDetail
+    struct ProjectedShape {
+        /// Collection of points that form a polygon
+        std::vector<PeprPoint3> shape;
+
+        /// Direction vector of the projection
+        PeprVector3 direction;
+    };
+
+    /// Sphere swept along a segment, the area painted by a brush moved between two points of a stroke
+    struct Capsule {
+        PeprPoint3 start;
+        PeprPoint3 end;
+        double radius;
+    };
+
     /// Paint sphere onto this detail
     /// @param minSegments Minimum number of segments of each sphere/plane intersection. Additional points may be added
     /// on boundaries.
     void paintSphere(const PeprSphere& sphere, int minSegments, size_t color);
 
+    /// Paint several capsules onto this detail, e.g. all parts of a brush stroke over this triangle.
+    /// The polygons are cut and triangulated only once, a capsule with the same start and end is painted the same
+    /// as paintSphere.
+    void paintCapsules(const std::vector<Capsule>& capsules, int minSegments, size_t color);
+
     /// Paint a shape to triangle detail
     /// @param shape Collection of points that form a polygon, that is going to be projected onto the TriangleDetail
     /// @param direction Direction vector of the projection
@@ -193,6 +214,10 @@ class TriangleDetail {
     /// @param direction Direction vector of the projection
     void paintShape(const std::vector<PeprTriangle>& triangles, const PeprVector3& direction, size_t color);
 
+    /// Paint several shapes onto this detail, the same as paintShape for each of them, but the polygons are cut and
+    /// triangulated only once
+    void paintShapes(const std::vector<const ProjectedShape*>& shapes, size_t color);
+
     /// Makes sure all vertices on the common edge between these two triangles are matched
     /// Creates new vertices for both triangles if there are missing
     /// You will need to updateTrianglesFromPolygons() after calling this method!
@@ -207,6 +232,9 @@ class TriangleDetail {
         return mOriginal;
     }
 
+    /// Approximate memory taken by the detail in bytes, including its exact polygons
+    size_t getMemoryEstimate() const;
+
     /// Create new triangles from a set of colored polygons
     /// Tries to simplify the polygons in the process
     void updateTrianglesFromPolygons();
@@ -239,9 +267,9 @@ class TriangleDetail {
     template <class Archive>
     void load(Archive& archive) {
         archive(mOriginal, mColoredPolys);
-        const PeprTriangle& tri = mOriginal.getTri();
+        const PeprTriangle tri = mOriginal.getTri();
         mOriginalPlane = Plane(toExactK(tri.vertex(0)), toExactK(tri.vertex(1)), toExactK(tri.vertex(2)));
-        mBounds = polygonFromTriangle(mOriginal.getTri());
+        mBounds = polygonFromTriangle(tri);
 
         updateTrianglesFromPolygons();
     }
@@ -372,6 +400,16 @@ class TriangleDetail {
 
     Polygon projectShapeToPolygon(const std::vector<PeprPoint3>& shape, const PeprVector3& direction);
 
+    /// Polygon of the intersection of the sphere with the plane of this detail, empty if they do not intersect
+    Polygon polygonFromSphere(const PeprSphere& peprSphere, int minSegments) const;
+
+    /// Polygon of the intersection of the capsule with the plane of this detail, empty if they do not intersect
+    Polygon polygonFromCapsule(const Capsule& capsule, int minSegments) const;
+
+    /// Add the union of the polygons to the detail with a single cut and triangulation
+    /// @param polygons Non-empty polygons in the plane-space of this detail
+    void addPolygons(const std::vector<Polygon>& polygons, size_t color);
+
     /// Do two polygons that are triangles intersect
     /// This is faster than checking an intersection between polygons of any size
     static bool trianglePolygonsDoIntersect(const Polygon& first, const Polygon& second) {
@@ -1,70 +1,56 @@
 #pragma once
 
+#include <cstdint>
 #include <limits>
 #include <optional>
 #include "geometry/Triangle.h"
+#include "peprassert.h"
 
 namespace pepr3d {
 /// Triangle ID in all detailed triangles
 /// Face index in mMeshDetailed faces;
+/// The base triangle ID and the optional detail triangle index are packed into a single 64-bit integer, base ID in the
+/// upper 32 bits.
 struct DetailedTriangleId {
-    DetailedTriangleId() : mBaseId(std::numeric_limits<size_t>::max()), mDetailId() {}
+    DetailedTriangleId() : mPacked(std::numeric_limits<uint64_t>::max()) {}
 
     explicit DetailedTriangleId(size_t baseId, std::optional<size_t> detailId = {})
-        : mBaseId(baseId), mDetailId(detailId) {}
+        : mPacked(static_cast<uint64_t>(baseId) << 32 | (detailId ? static_cast<uint64_t>(*detailId) : NO_DETAIL)) {
+        // The largest base ID is reserved for the default constructed ID
+        P_ASSERT(baseId < std::numeric_limits<uint32_t>::max());
+        P_ASSERT(!detailId || *detailId < NO_DETAIL);
+    }
 
     size_t getBaseId() const {
-        return mBaseId;
+        return static_cast<size_t>(mPacked >> 32);
     }
 
     std::optional<size_t> getDetailId() const {
-        return mDetailId;
+        const uint32_t detailId = static_cast<uint32_t>(mPacked);
+        if(detailId == NO_DETAIL) {
+            return {};
+        }
+        return detailId;
     }
 
-    bool operator==(const DetailedTriangleId& other) const {
-        return mBaseId == other.mBaseId && mDetailId == other.mDetailId;
+    /// Both IDs packed into a single integer
+    uint64_t getPacked() const {
+        return mPacked;
     }
 
-   private:
-    size_t mBaseId;
-    std::optional<size_t> mDetailId;
-};
-
-/// Provides the conversion facilities between the custom triangle DataTriangle and the CGAL
-/// Triangle_3 class. Taken from CGAL/examples/AABB_tree/custom_example.cpp, modified.
-struct DataTriangleAABBPrimitive {
-   public:
-    using Id = std::pair<const class Geometry*, DetailedTriangleId>;
-
-    // CGAL types returned
-    using Point = DataTriangle::K::Point_3;     // CGAL 3D point type
-    using Datum = DataTriangle::K::Triangle_3;  // CGAL 3D triangle type
-    using Datum_reference = const DataTriangle::K::Triangle_3&;
-
-   private:
-    Id idPair;
-
-   public:
-    DataTriangleAABBPrimitive() = default;  // default constructor needed
-
-    DataTriangleAABBPrimitive(const class Geometry* geometry, DetailedTriangleId triangleId)
-        : idPair(geometry, triangleId) {}
-    explicit DataTriangleAABBPrimitive(Id id) : idPair(id) {}
-
-    // the following constructor is the one that receives the iterators from the
-    // iterator range given as input to the AABB_tree
-    /*explicit DataTriangleAABBPrimitive(Iterator it)
-        : tri(std::move(it)) {}*/
+    bool operator==(const DetailedTriangleId& other) const {
+        return mPacked == other.mPacked;
+    }
 
-    const Id& id() const {
-        return idPair;
+    bool operator!=(const DetailedTriangleId& other) const {
+        return mPacked != other.mPacked;
     }
 
-    // on the fly conversion from the internal data to the CGAL types
-    Datum_reference datum() const;
+   private:
+    /// Detail part of the IDs of base triangles without a detail index
+    static constexpr uint32_t NO_DETAIL = std::numeric_limits<uint32_t>::max();
 
-    // returns a reference point which must be on the primitive
-    Point reference_point() const;
+    uint64_t mPacked;
 };
 
 }  // namespace pepr3d
@@ -75,7 +61,11 @@ namespace std {
 template <>
 struct hash<pepr3d::DetailedTriangleId> {
     size_t operator()(const pepr3d::DetailedTriangleId& id) const {
-        return std::hash<size_t>{}(id.getBaseId()) ^ std::hash<std::optional<size_t>>{}(id.getDetailId());
-    };
+        // Finalizer of SplitMix64, every bit of the packed ID affects every bit of the hash
+        uint64_t x = id.getPacked();
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<size_t>(x ^ (x >> 31));
+    }
 };
 }  // namespace std
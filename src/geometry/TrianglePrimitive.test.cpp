@@ -0,0 +1,54 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+
+#include <unordered_set>
+
+#include "geometry/TrianglePrimitive.h"
+
+using pepr3d::DetailedTriangleId;
+
+TEST(DetailedTriangleId, packing) {
+    /**
+     * Test that the base and detail IDs are packed and unpacked without loss, including the largest allowed values
+     */
+    const DetailedTriangleId base(17);
+    EXPECT_EQ(base.getBaseId(), 17);
+    EXPECT_FALSE(base.getDetailId().has_value());
+
+    const DetailedTriangleId detail(17, 0);
+    EXPECT_EQ(detail.getBaseId(), 17);
+    ASSERT_TRUE(detail.getDetailId().has_value());
+    EXPECT_EQ(*detail.getDetailId(), 0);
+    EXPECT_NE(base, detail);
+
+    const size_t largest = std::numeric_limits<uint32_t>::max() - 1;
+    const DetailedTriangleId large(largest, largest);
+    EXPECT_EQ(large.getBaseId(), largest);
+    EXPECT_EQ(*large.getDetailId(), largest);
+
+    EXPECT_EQ(DetailedTriangleId(5, 3), DetailedTriangleId(5, 3));
+    EXPECT_NE(DetailedTriangleId(), DetailedTriangleId(0));
+    EXPECT_NE(DetailedTriangleId(), large);
+}
+
+TEST(DetailedTriangleId, hash) {
+    /**
+     * Test that swapped base and detail IDs hash differently and that the hashes of a grid of IDs do not collide
+     */
+    const std::hash<DetailedTriangleId> hash;
+    EXPECT_NE(hash(DetailedTriangleId(1, 2)), hash(DetailedTriangleId(2, 1)));
+    EXPECT_NE(hash(DetailedTriangleId(3)), hash(DetailedTriangleId(3, 0)));
+    EXPECT_EQ(hash(DetailedTriangleId(4, 7)), hash(DetailedTriangleId(4, 7)));
+
+    std::unordered_set<size_t> hashes;
+    for(size_t baseId = 0; baseId < 100; ++baseId) {
+        hashes.insert(hash(DetailedTriangleId(baseId)));
+        for(size_t detailId = 0; detailId < 100; ++detailId) {
+            hashes.insert(hash(DetailedTriangleId(baseId, detailId)));
+        }
+    }
+    EXPECT_EQ(hashes.size(), 100 * 101);
+}
+
+#endif
@@ -0,0 +1,520 @@
+#include "geometry/VertexWelder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string>
+
+#include <cinder/Log.h>
+
+#include "peprassert.h"
+
+namespace pepr3d {
+
+namespace {
+
+/// Number of triangles processed by a single task of the thread pool
+constexpr size_t TRIANGLES_PER_CHUNK = 16 * 1024;
+
+/// Number of hash tables the grid cells are split into, so that the tables can be built in parallel
+constexpr size_t SHARD_COUNT = 64;
+
+/// Index of a vertex of the triangle soup, the j-th vertex of the i-th triangle is 3 * i + j
+using PointIdx = uint32_t;
+
+constexpr PointIdx NO_POINT = std::numeric_limits<PointIdx>::max();
+
+/// Cell of the spatial hash grid
+struct Cell {
+    std::array<int64_t, 3> coords;
+
+    bool operator==(const Cell& other) const {
+        return coords == other.coords;
+    }
+};
+
+struct CellHash {
+    size_t operator()(const Cell& cell) const {
+        uint64_t hash = 0;
+        for(const int64_t coord : cell.coords) {
+            hash = (hash ^ static_cast<uint64_t>(coord)) * 0x9E3779B97F4A7C15ull;
+        }
+        // Finalizer of MurmurHash3, so that all bits of the coordinates affect both the low and the high bits
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return static_cast<size_t>(hash);
+    }
+};
+
+/// Selects the shard by the highest bits of the hash, the tables use the lower bits for their slots
+size_t getShard(const Cell& cell) {
+    return static_cast<size_t>(static_cast<uint64_t>(CellHash()(cell)) >> 58) % SHARD_COUNT;
+}
+
+/// Cells of the grid are this many times larger than the tolerance, so that most vertices are farther than the
+/// tolerance from the cell boundaries and only their own cell has to be searched
+constexpr double CELL_SIZE_PER_TOLERANCE = 8.0;
+
+/// Maps positions to the cells of the grid. Without a tolerance, every distinct position has its own cell.
+class Grid {
+    bool mIsExact;
+    double mInverseCellSize;
+
+    /// Part of the cell size within the tolerance from a cell boundary
+    double mBoundaryFraction;
+
+   public:
+    explicit Grid(const double tolerance)
+        : mIsExact(!(tolerance > 0.0) || !std::isfinite(tolerance)),
+          mInverseCellSize(mIsExact ? 0.0 : 1.0 / (CELL_SIZE_PER_TOLERANCE * tolerance)),
+          mBoundaryFraction(1.0001 / CELL_SIZE_PER_TOLERANCE) {}
+
+    bool isExact() const {
+        return mIsExact;
+    }
+
+    Cell getCell(const glm::vec3& position) const {
+        Cell cell;
+        for(int i = 0; i < 3; ++i) {
+            if(mIsExact) {
+                // -0.0f and 0.0f are equal positions, adding 0.0f turns the former into the latter
+                const float value = position[i] + 0.0f;
+                int32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                cell.coords[i] = bits;
+            } else {
+                cell.coords[i] = getCellCoord(position[i]);
+            }
+        }
+        return cell;
+    }
+
+    /// Range of cell offsets along each axis, in which vertices within the tolerance from the position may lie
+    void getNeighbourRange(const glm::vec3& position, std::array<int, 3>& from, std::array<int, 3>& to) const {
+        for(int i = 0; i < 3; ++i) {
+            const double scaled = getScaledCoord(position[i]);
+            const double fraction = scaled - std::floor(scaled);
+            from[i] = fraction <= mBoundaryFraction ? -1 : 0;
+            to[i] = fraction >= 1.0 - mBoundaryFraction ? 1 : 0;
+        }
+    }
+
+   private:
+    /// Coordinate in cell sizes. Cells are centered at 0, as modeled surfaces often lie on planes of round coordinates.
+    double getScaledCoord(const float value) const {
+        return static_cast<double>(value) * mInverseCellSize + 0.5;
+    }
+
+    int64_t getCellCoord(const float value) const {
+        // Also clamps NaN, the coordinates are far from overflowing when adding the neighbour offsets
+        const double limit = static_cast<double>(int64_t(1) << 62);
+        const double coord = std::floor(getScaledCoord(value));
+        return static_cast<int64_t>(coord >= -limit ? std::min(coord, limit) : -limit);
+    }
+};
+
+/// First and last vertex of a cell, the vertices of the cell form a list through nextInCell in ascending order
+struct CellPoints {
+    Cell cell;
+    PointIdx first = NO_POINT;
+    PointIdx last = NO_POINT;
+};
+
+/// Vertex sorted into a shard by its cell
+struct ShardPoint {
+    Cell cell;
+    PointIdx point;
+};
+
+/// Open addressing hash table of the cells of a single shard
+class CellTable {
+    std::vector<CellPoints> mEntries;
+    size_t mSize = 0;
+
+   public:
+    explicit CellTable(const size_t expectedSize) {
+        size_t capacity = 16;
+        while(capacity < 2 * expectedSize) {
+            capacity *= 2;
+        }
+        mEntries.resize(capacity);
+    }
+
+    /// Entry of the cell, a new entry with no vertices is added if the cell is not in the table yet
+    CellPoints& getOrAdd(const Cell& cell) {
+        if(2 * (mSize + 1) > mEntries.size()) {
+            grow();
+        }
+        CellPoints& entry = mEntries[findSlot(cell)];
+        if(entry.first == NO_POINT) {
+            entry.cell = cell;
+            ++mSize;
+        }
+        return entry;
+    }
+
+    /// Entry of the cell, or nullptr if the cell has no vertices
+    const CellPoints* find(const Cell& cell) const {
+        const CellPoints& entry = mEntries[findSlot(cell)];
+        return entry.first == NO_POINT ? nullptr : &entry;
+    }
+
+   private:
+    /// Slot of the cell, or the empty slot where it belongs
+    size_t findSlot(const Cell& cell) const {
+        const size_t mask = mEntries.size() - 1;
+        size_t slot = CellHash()(cell) & mask;
+        while(mEntries[slot].first != NO_POINT && !(mEntries[slot].cell == cell)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void grow() {
+        std::vector<CellPoints> entries(2 * mEntries.size());
+        entries.swap(mEntries);
+        for(const CellPoints& entry : entries) {
+            if(entry.first != NO_POINT) {
+                mEntries[findSlot(entry.cell)] = entry;
+            }
+        }
+    }
+};
+
+/// Concurrent union-find of the vertices. A root is only ever linked under a smaller root, so the root of every group
+/// is its smallest vertex once all unions finished, regardless of their order.
+class PointGroups {
+    std::vector<std::atomic<PointIdx>> mParents;
+
+   public:
+    explicit PointGroups(const size_t pointCount) : mParents(pointCount) {}
+
+    void reset(const PointIdx point) {
+        mParents[point].store(point, std::memory_order_relaxed);
+    }
+
+    /// The parents are the only shared data, so relaxed accesses are enough. A stale parent is still an ancestor.
+    PointIdx findRoot(PointIdx point) {
+        PointIdx parent = mParents[point].load(std::memory_order_relaxed);
+        while(parent != point) {
+            // Path halving, any ancestor of a vertex is a valid parent as parents only ever point to smaller vertices
+            const PointIdx grandparent = mParents[parent].load(std::memory_order_relaxed);
+            if(grandparent != parent) {
+                mParents[point].store(grandparent, std::memory_order_relaxed);
+            }
+            point = parent;
+            parent = mParents[point].load(std::memory_order_relaxed);
+        }
+        return point;
+    }
+
+    void unite(PointIdx a, PointIdx b) {
+        while(true) {
+            a = findRoot(a);
+            b = findRoot(b);
+            if(a == b) {
+                return;
+            }
+            if(a < b) {
+                std::swap(a, b);
+            }
+            // Fails if another thread linked the root meanwhile, retry with the new roots then
+            PointIdx expected = a;
+            if(mParents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+};
+
+/// Removes the triangles that lost their area and the vertices that only they used
+size_t removeCollapsedTriangles(std::vector<DataTriangle>& triangles, std::vector<glm::vec3>& vertices,
+                                std::vector<IndexedTriangles::Indices>& indices) {
+    const auto isCollapsed = [](const IndexedTriangles::Indices& tri) {
+        return tri[0] == tri[1] || tri[0] == tri[2] || tri[1] == tri[2];
+    };
+
+    size_t keptCount = 0;
+    for(size_t triIdx = 0; triIdx < triangles.size(); ++triIdx) {
+        if(!isCollapsed(indices[triIdx])) {
+            if(keptCount != triIdx) {
+                triangles[keptCount] = std::move(triangles[triIdx]);
+                indices[keptCount] = indices[triIdx];
+            }
+            ++keptCount;
+        }
+    }
+    const size_t removedCount = triangles.size() - keptCount;
+    triangles.resize(keptCount);
+    indices.resize(keptCount);
+
+    // Renumber the used vertices, keeping their order
+    std::vector<uint32_t> newIds(vertices.size(), std::numeric_limits<uint32_t>::max());
+    for(const auto& tri : indices) {
+        for(const uint32_t vertexIdx : tri) {
+            newIds[vertexIdx] = 0;
+        }
+    }
+    uint32_t usedCount = 0;
+    for(size_t vertexIdx = 0; vertexIdx < vertices.size(); ++vertexIdx) {
+        if(newIds[vertexIdx] == 0) {
+            newIds[vertexIdx] = usedCount;
+            vertices[usedCount++] = vertices[vertexIdx];
+        }
+    }
+    vertices.resize(usedCount);
+    for(auto& tri : indices) {
+        for(uint32_t& vertexIdx : tri) {
+            vertexIdx = newIds[vertexIdx];
+        }
+    }
+    return removedCount;
+}
+
+}  // namespace
+
+void VertexWelder::weld(std::vector<DataTriangle>& triangles, const float relativeTolerance,
+                        std::vector<glm::vec3>& vertices, std::vector<IndexedTriangles::Indices>& indices,
+                        ::ThreadPool& threadPool, GeometryProgress* progress) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const auto setProgress = [progress](const float percentage) {
+        if(progress != nullptr) {
+            progress->importComputePercentage = percentage;
+        }
+    };
+    setProgress(0.0f);
+
+    const size_t pointCount = 3 * triangles.size();
+    P_ASSERT(pointCount < NO_POINT);
+    const size_t chunkCount = ::ThreadPool::chunk_count(triangles.size(), TRIANGLES_PER_CHUNK);
+
+    /// Calls func(chunk, beginTriangle, endTriangle) for each chunk of the triangles in parallel
+    const auto forEachChunk = [&](const auto& func) {
+        threadPool.parallel_for_chunks(triangles.size(), TRIANGLES_PER_CHUNK, func);
+    };
+
+    /// Gather the vertex positions and their bounding box
+    std::vector<glm::vec3> positions(pointCount);
+    std::vector<std::array<glm::vec3, 2>> chunkBounds(chunkCount);
+    forEachChunk([&](const size_t chunk, const size_t begin, const size_t end) {
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
+        for(size_t triIdx = begin; triIdx < end; ++triIdx) {
+            for(size_t j = 0; j < 3; ++j) {
+                const glm::vec3 position = triangles[triIdx].getVertex(j);
+                positions[3 * triIdx + j] = position;
+                min = glm::min(min, position);
+                max = glm::max(max, position);
+            }
+        }
+        chunkBounds[chunk] = {min, max};
+    });
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for(const auto& bounds : chunkBounds) {
+        min = glm::min(min, bounds[0]);
+        max = glm::max(max, bounds[1]);
+    }
+    const double tolerance =
+        triangles.empty() ? 0.0 : static_cast<double>(relativeTolerance) * static_cast<double>(glm::length(max - min));
+    const Grid grid(tolerance);
+    setProgress(0.2f);
+
+    /// Sort the vertices into shards by their cells. Each chunk places its vertices after the vertices of the previous
+    /// chunks, so that the vertices of every shard stay in ascending order.
+    std::vector<uint8_t> pointShards(pointCount);
+    std::vector<std::array<size_t, SHARD_COUNT>> chunkShardOffsets(chunkCount);
+    forEachChunk([&](const size_t chunk, const size_t begin, const size_t end) {
+        std::array<size_t, SHARD_COUNT>& counts = chunkShardOffsets[chunk];
+        counts.fill(0);
+        for(size_t point = 3 * begin; point < 3 * end; ++point) {
+            const size_t shard = getShard(grid.getCell(positions[point]));
+            pointShards[point] = static_cast<uint8_t>(shard);
+            ++counts[shard];
+        }
+    });
+    std::array<size_t, SHARD_COUNT + 1> shardBegins;
+    size_t offset = 0;
+    for(size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+        shardBegins[shard] = offset;
+        for(auto& shardOffsets : chunkShardOffsets) {
+            const size_t count = shardOffsets[shard];
+            shardOffsets[shard] = offset;
+            offset += count;
+        }
+    }
+    shardBegins[SHARD_COUNT] = offset;
+    P_ASSERT(offset == pointCount);
+
+    // The cells are stored with the vertices, so that the tables are built without gathering the positions
+    std::vector<ShardPoint> shardPoints(pointCount);
+    forEachChunk([&](const size_t chunk, const size_t begin, const size_t end) {
+        std::array<size_t, SHARD_COUNT>& offsets = chunkShardOffsets[chunk];
+        for(size_t point = 3 * begin; point < 3 * end; ++point) {
+            shardPoints[offsets[pointShards[point]]++] = {grid.getCell(positions[point]), static_cast<PointIdx>(point)};
+        }
+    });
+
+    /// Build a table of the cells of each shard
+    std::vector<PointIdx> nextInCell(pointCount, NO_POINT);
+    std::vector<PointIdx> cellFirsts(pointCount);
+    std::vector<CellTable> cellTables;
+    cellTables.reserve(SHARD_COUNT);
+    for(size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+        // A closed triangle mesh uses each vertex about six times
+        cellTables.emplace_back((shardBegins[shard + 1] - shardBegins[shard]) / 6);
+    }
+    std::vector<size_t> shards(SHARD_COUNT);
+    std::iota(shards.begin(), shards.end(), 0);
+    threadPool.parallel_for(shards.begin(), shards.end(), [&](const size_t shard) {
+        CellTable& cellTable = cellTables[shard];
+        for(size_t i = shardBegins[shard]; i < shardBegins[shard + 1]; ++i) {
+            const PointIdx point = shardPoints[i].point;
+            CellPoints& entry = cellTable.getOrAdd(shardPoints[i].cell);
+            if(entry.first == NO_POINT) {
+                entry.first = point;
+            } else {
+                nextInCell[entry.last] = point;
+            }
+            entry.last = point;
+            cellFirsts[point] = entry.first;
+        }
+    });
+    std::vector<ShardPoint>().swap(shardPoints);
+    std::vector<uint8_t>().swap(pointShards);
+    setProgress(0.4f);
+
+    /// Find the first vertex of the group of each vertex
+    std::vector<PointIdx> roots;
+    if(grid.isExact()) {
+        // All vertices of a cell have the same position, the group is the cell
+        roots = std::move(cellFirsts);
+    } else {
+        /// Join each vertex with the preceding vertices within the tolerance
+        PointGroups groups(pointCount);
+        forEachChunk([&](size_t, const size_t begin, const size_t end) {
+            for(size_t point = 3 * begin; point < 3 * end; ++point) {
+                groups.reset(static_cast<PointIdx>(point));
+            }
+        });
+        const double squaredTolerance = tolerance * tolerance;
+        const auto uniteWithCell = [&](const PointIdx point, PointIdx other) {
+            const glm::dvec3 position(positions[point]);
+            for(; other < point; other = nextInCell[other]) {
+                const glm::dvec3 difference = glm::dvec3(positions[other]) - position;
+                if(glm::dot(difference, difference) <= squaredTolerance) {
+                    groups.unite(point, other);
+                }
+            }
+        };
+        forEachChunk([&](size_t, const size_t begin, const size_t end) {
+            std::array<int, 3> from, to;
+            for(size_t pointIdx = 3 * begin; pointIdx < 3 * end; ++pointIdx) {
+                const PointIdx point = static_cast<PointIdx>(pointIdx);
+                uniteWithCell(point, cellFirsts[point]);
+
+                grid.getNeighbourRange(positions[point], from, to);
+                if(from == to) {
+                    continue;
+                }
+                const Cell cell = grid.getCell(positions[point]);
+                for(int dx = from[0]; dx <= to[0]; ++dx) {
+                    for(int dy = from[1]; dy <= to[1]; ++dy) {
+                        for(int dz = from[2]; dz <= to[2]; ++dz) {
+                            if(dx == 0 && dy == 0 && dz == 0) {
+                                continue;
+                            }
+                            const Cell neighbour{{cell.coords[0] + dx, cell.coords[1] + dy, cell.coords[2] + dz}};
+                            const CellPoints* neighbourPoints = cellTables[getShard(neighbour)].find(neighbour);
+                            if(neighbourPoints != nullptr) {
+                                uniteWithCell(point, neighbourPoints->first);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+        std::vector<PointIdx>().swap(cellFirsts);
+
+        roots.resize(pointCount);
+        forEachChunk([&](size_t, const size_t begin, const size_t end) {
+            for(size_t point = 3 * begin; point < 3 * end; ++point) {
+                roots[point] = groups.findRoot(static_cast<PointIdx>(point));
+            }
+        });
+    }
+    std::vector<CellTable>().swap(cellTables);
+    std::vector<PointIdx>().swap(nextInCell);
+    setProgress(0.7f);
+
+    /// Number the groups by their first vertex, the roots of the groups
+    std::vector<size_t> chunkVertexOffsets(chunkCount + 1, 0);
+    forEachChunk([&](const size_t chunk, const size_t begin, const size_t end) {
+        size_t rootCount = 0;
+        for(size_t point = 3 * begin; point < 3 * end; ++point) {
+            if(roots[point] == point) {
+                ++rootCount;
+            }
+        }
+        chunkVertexOffsets[chunk + 1] = rootCount;
+    });
+    std::partial_sum(chunkVertexOffsets.begin(), chunkVertexOffsets.end(), chunkVertexOffsets.begin());
+
+    vertices.resize(chunkVertexOffsets.back());
+    std::vector<PointIdx> vertexIds(pointCount);
+    forEachChunk([&](const size_t chunk, const size_t begin, const size_t end) {
+        size_t vertexIdx = chunkVertexOffsets[chunk];
+        for(size_t point = 3 * begin; point < 3 * end; ++point) {
+            if(roots[point] == point) {
+                vertexIds[point] = static_cast<PointIdx>(vertexIdx);
+                vertices[vertexIdx++] = positions[point];
+            }
+        }
+    });
+
+    /// Index the triangles and move their vertices to the joined positions
+    indices.resize(triangles.size());
+    std::atomic<bool> hasCollapsedTriangles{false};
+    forEachChunk([&](size_t, const size_t begin, const size_t end) {
+        for(size_t triIdx = begin; triIdx < end; ++triIdx) {
+            IndexedTriangles::Indices& tri = indices[triIdx];
+            bool isMoved = false;
+            for(size_t j = 0; j < 3; ++j) {
+                tri[j] = vertexIds[roots[3 * triIdx + j]];
+                isMoved = isMoved || roots[3 * triIdx + j] != 3 * triIdx + j;
+            }
+            if(tri[0] == tri[1] || tri[0] == tri[2] || tri[1] == tri[2]) {
+                hasCollapsedTriangles = true;
+            } else if(isMoved && !grid.isExact()) {
+                DataTriangle& triangle = triangles[triIdx];
+                triangle = DataTriangle(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]], triangle.getNormal(),
+                                        triangle.getColor());
+            }
+        }
+    });
+    setProgress(0.9f);
+
+    if(hasCollapsedTriangles) {
+        const size_t removedCount = removeCollapsedTriangles(triangles, vertices, indices);
+        CI_LOG_W("Removed " + std::to_string(removedCount) + " triangles that lost their area by joining vertices.");
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> timeMs = end - start;
+    if(progress != nullptr) {
+        progress->weldTimeMs = static_cast<float>(timeMs.count());
+    }
+    CI_LOG_I("Joining " + std::to_string(pointCount) + " vertices into " + std::to_string(vertices.size()) + " took " +
+             std::to_string(timeMs.count()) + " ms");
+    setProgress(1.0f);
+}
+
+}  // namespace pepr3d
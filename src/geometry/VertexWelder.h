@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "ThreadPool.h"
+
+#include "geometry/GeometryProgress.h"
+#include "geometry/IndexedTriangles.h"
+#include "geometry/Triangle.h"
+
+namespace pepr3d {
+
+/// Joins the vertices of a triangle soup into a vertex and index buffer describing a connected mesh.
+/// Vertices are grouped by a spatial hash grid with cells as large as the tolerance, so that only vertices in
+/// neighbouring cells are compared. All steps run in parallel chunks on the thread pool.
+/// The result does not depend on the number of threads: every group of joined vertices is placed at the position of its
+/// first vertex in the soup, and the vertices are ordered by their first use.
+class VertexWelder {
+   public:
+    /// Default tolerance, relative to the bounding box diagonal of the mesh
+    static constexpr float DEFAULT_TOLERANCE = 1e-6f;
+
+    /// Joins the vertices of the triangles closer than relativeTolerance times the bounding box diagonal, 0 joins only
+    /// vertices with equal positions. Vertices joined transitively, through other vertices, form a single vertex.
+    /// Vertices of the triangles are moved to the positions of their joined vertices. Triangles that lose their area
+    /// because two of their vertices were joined are removed, the i-th indexed triangle corresponds to the i-th
+    /// remaining triangle.
+    static void weld(std::vector<DataTriangle>& triangles, float relativeTolerance, std::vector<glm::vec3>& vertices,
+                     std::vector<IndexedTriangles::Indices>& indices, ::ThreadPool& threadPool,
+                     GeometryProgress* progress = nullptr);
+};
+
+}  // namespace pepr3d
@@ -0,0 +1,110 @@
+#ifdef _TEST_
+
+#include <gtest/gtest.h>
+#include <array>
+#include <vector>
+
+#include "geometry/VertexWelder.h"
+
+namespace {
+
+using pepr3d::DataTriangle;
+using Indices = pepr3d::IndexedTriangles::Indices;
+using pepr3d::VertexWelder;
+
+/// Triangle soup of a grid of size x size quads in the z = 0 plane, each vertex moved by offset(x, y)
+template <typename OffsetFunc>
+std::vector<DataTriangle> getGridSoup(const int size, const OffsetFunc& offset) {
+    const auto getVertex = [&offset](const int x, const int y) {
+        return glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.f) + offset(x, y);
+    };
+    std::vector<DataTriangle> triangles;
+    for(int y = 0; y < size; ++y) {
+        for(int x = 0; x < size; ++x) {
+            const glm::vec3 normal(0.f, 0.f, 1.f);
+            triangles.emplace_back(getVertex(x, y), getVertex(x + 1, y), getVertex(x + 1, y + 1), normal, x % 3);
+            triangles.emplace_back(getVertex(x, y), getVertex(x + 1, y + 1), getVertex(x, y + 1), normal, y % 3);
+        }
+    }
+    return triangles;
+}
+
+}  // namespace
+
+TEST(VertexWelder, exact) {
+    /**
+     * Test that only equal positions are joined without a tolerance, including -0.0f and 0.0f, and that the vertices
+     * are ordered by their first use regardless of the number of threads
+     */
+    const int size = 200;
+    const auto soup = getGridSoup(size, [](int, int) {
+        // Vertices alternate between negative and positive zero coordinates
+        static int counter = 0;
+        return glm::vec3(0.f, 0.f, ++counter % 2 == 0 ? -0.f : 0.f);
+    });
+
+    std::vector<Indices> reference;
+    for(const size_t threadCount : {1, 4}) {
+        ::ThreadPool threadPool(threadCount);
+        std::vector<DataTriangle> triangles = soup;
+        std::vector<glm::vec3> vertices;
+        std::vector<Indices> indices;
+        VertexWelder::weld(triangles, 0.f, vertices, indices, threadPool);
+
+        ASSERT_EQ(triangles.size(), soup.size());
+        ASSERT_EQ(indices.size(), soup.size());
+        EXPECT_EQ(vertices.size(), static_cast<size_t>((size + 1) * (size + 1)));
+        for(size_t triIdx = 0; triIdx < triangles.size(); ++triIdx) {
+            for(size_t j = 0; j < 3; ++j) {
+                EXPECT_EQ(vertices[indices[triIdx][j]], soup[triIdx].getVertex(j));
+            }
+        }
+
+        // First use order
+        EXPECT_EQ(indices[0], (Indices{0, 1, 2}));
+        EXPECT_EQ(indices[1], (Indices{0, 2, 3}));
+        EXPECT_EQ(indices[2], (Indices{1, 4, 5}));
+
+        if(reference.empty()) {
+            reference = indices;
+        }
+        EXPECT_EQ(indices, reference);
+    }
+}
+
+TEST(VertexWelder, tolerance) {
+    /**
+     * Test that vertices within the tolerance are joined at the position of their first use and that triangles which
+     * lose their area are removed
+     */
+    ::ThreadPool threadPool(4);
+    const int size = 100;
+    std::vector<DataTriangle> triangles = getGridSoup(size, [](int, int) {
+        // Each triangle moves its vertices a little differently
+        static int counter = 0;
+        const float noise = 1e-5f * static_cast<float>(++counter % 7);
+        return glm::vec3(noise, -noise, noise);
+    });
+    const std::vector<DataTriangle> soup = triangles;
+    // Triangle with an edge shorter than the tolerance
+    triangles.emplace_back(glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 0.f, 1e-5f), glm::vec3(0.f, 0.f, 5.f),
+                           glm::vec3(1.f, 0.f, 0.f));
+
+    std::vector<glm::vec3> vertices;
+    std::vector<Indices> indices;
+    VertexWelder::weld(triangles, 1e-5f, vertices, indices, threadPool);
+
+    ASSERT_EQ(triangles.size(), soup.size());
+    ASSERT_EQ(indices.size(), soup.size());
+    EXPECT_EQ(vertices.size(), static_cast<size_t>((size + 1) * (size + 1)));
+    for(size_t triIdx = 0; triIdx < triangles.size(); ++triIdx) {
+        EXPECT_EQ(triangles[triIdx].getColor(), soup[triIdx].getColor());
+        for(size_t j = 0; j < 3; ++j) {
+            EXPECT_EQ(triangles[triIdx].getVertex(j), vertices[indices[triIdx][j]]);
+            EXPECT_LT(glm::length(vertices[indices[triIdx][j]] - soup[triIdx].getVertex(j)), 2e-4f);
+        }
+    }
+    EXPECT_EQ(vertices[0], soup[0].getVertex(0));
+}
+
+#endif
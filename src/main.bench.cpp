@@ -0,0 +1,110 @@
+#ifdef _BENCH_
+
+#include <fstream>
+#include <iostream>
+
+#include "peprbench.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: pepr3d-bench [options] <model file>\n"
+                 "  --iterations <n>   repetitions of each measured operation (default 20)\n"
+                 "  --dabs <n>         dabs per scripted brush stroke (default 16)\n"
+                 "  --brush-size <f>   brush size relative to the model diagonal (default 0.02)\n"
+                 "  --seed <n>         seed of the scripted strokes (default 42)\n"
+                 "  --sdf              also compute SDF and run the SDF extrusion export\n"
+                 "  --filter <str>     run only benchmarks whose name contains str\n"
+                 "  --output <file>    write the JSON report into a file instead of stdout\n"
+                 "  --list             list all benchmarks and exit\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    pepr3d::bench::BenchmarkOptions options;
+    std::string outputPath;
+
+    try {
+        for(int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const auto nextArg = [&]() -> std::string {
+                if(i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value of " + arg);
+                }
+                return argv[++i];
+            };
+
+            if(arg == "--iterations") {
+                options.iterations = std::stoul(nextArg());
+            } else if(arg == "--dabs") {
+                options.dabsPerStroke = std::stoul(nextArg());
+            } else if(arg == "--brush-size") {
+                options.relativeBrushSize = std::stof(nextArg());
+            } else if(arg == "--seed") {
+                options.seed = static_cast<unsigned>(std::stoul(nextArg()));
+            } else if(arg == "--sdf") {
+                options.runSdf = true;
+            } else if(arg == "--filter") {
+                options.filter = nextArg();
+            } else if(arg == "--output") {
+                outputPath = nextArg();
+            } else if(arg == "--list") {
+                for(const auto& benchmark : pepr3d::bench::getBenchmarks()) {
+                    std::cout << benchmark.first << "\n";
+                }
+                return 0;
+            } else if(arg == "--help" || arg == "-h") {
+                printUsage();
+                return 0;
+            } else {
+                options.modelPath = arg;
+            }
+        }
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        printUsage();
+        return 2;
+    }
+
+    if(options.iterations == 0) {
+        options.iterations = 1;
+    }
+
+    pepr3d::bench::BenchmarkReport report;
+    report.setInfo("model", options.modelPath);
+    report.setInfo("seed", std::to_string(options.seed));
+    report.setInfo("iterations", std::to_string(options.iterations));
+
+    int exitCode = 0;
+    for(const auto& benchmark : pepr3d::bench::getBenchmarks()) {
+        if(!options.filter.empty() && benchmark.first.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        std::cerr << "Running " << benchmark.first << "\n";
+        try {
+            benchmark.second(options, report);
+        } catch(const std::exception& e) {
+            std::cerr << "Benchmark " << benchmark.first << " failed: " << e.what() << "\n";
+            report.setInfo(benchmark.first + ".error", e.what());
+            exitCode = 1;
+        }
+    }
+
+    const std::string json = report.toJson(pepr3d::bench::getPeakRssBytes());
+    if(outputPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream outputFile(outputPath);
+        outputFile << json;
+        if(!outputFile) {
+            std::cerr << "Could not write the report into " << outputPath << "\n";
+            return 1;
+        }
+    }
+
+    return exitCode;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+// windows.h has to be included before psapi.h
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace pepr3d::bench {
+
+/// Options shared by all benchmarks, parsed from the command line of pepr3d-bench
+struct BenchmarkOptions {
+    /// Model to load, benchmarks that need a model are skipped when empty
+    std::string modelPath;
+
+    /// Number of repetitions of each measured operation
+    size_t iterations = 20;
+
+    /// Number of dabs of each scripted brush stroke
+    size_t dabsPerStroke = 16;
+
+    /// Brush size relative to the bounding box diagonal of the model
+    float relativeBrushSize = 0.02f;
+
+    /// Seed of the generator of scripted strokes and bucket starting triangles
+    unsigned seed = 42;
+
+    /// Compute SDF values and run the SDF based extrusion export
+    bool runSdf = false;
+
+    /// Only benchmarks whose name contains this string are run
+    std::string filter;
+};
+
+/// Collects latency samples of named stages and formats them as JSON
+class BenchmarkReport {
+    std::map<std::string, std::vector<double>> mSamplesMs;
+    std::map<std::string, std::string> mInfo;
+
+   public:
+    /// Run the function once and record its duration under the stage name
+    template <typename Func>
+    auto measure(const std::string& stage, Func&& func) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        if constexpr(std::is_void_v<decltype(func())>) {
+            func();
+            addSample(stage, start);
+        } else {
+            auto result = func();
+            addSample(stage, start);
+            return result;
+        }
+    }
+
+    void addSample(const std::string& stage, double timeMs) {
+        mSamplesMs[stage].push_back(timeMs);
+    }
+
+    /// Set a descriptive value (model name, triangle count, ...) that is printed along with the results
+    void setInfo(const std::string& key, const std::string& value) {
+        mInfo[key] = value;
+    }
+
+    std::string toJson(size_t peakRssBytes) const {
+        std::stringstream ss;
+        ss << "{\n  \"info\": {";
+        bool first = true;
+        for(const auto& info : mInfo) {
+            ss << (first ? "\n" : ",\n") << "    \"" << escape(info.first) << "\": \"" << escape(info.second) << "\"";
+            first = false;
+        }
+        ss << "\n  },\n  \"peakRssBytes\": " << peakRssBytes << ",\n  \"stages\": {";
+
+        first = true;
+        for(const auto& stage : mSamplesMs) {
+            std::vector<double> sorted = stage.second;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for(const double sample : sorted) {
+                sum += sample;
+            }
+
+            ss << (first ? "\n" : ",\n") << "    \"" << escape(stage.first) << "\": {"
+               << "\"count\": " << sorted.size() << ", \"meanMs\": " << sum / sorted.size()
+               << ", \"minMs\": " << sorted.front() << ", \"p50Ms\": " << percentile(sorted, 0.50)
+               << ", \"p90Ms\": " << percentile(sorted, 0.90) << ", \"p99Ms\": " << percentile(sorted, 0.99)
+               << ", \"maxMs\": " << sorted.back() << "}";
+            first = false;
+        }
+        ss << "\n  }\n}\n";
+        return ss.str();
+    }
+
+   private:
+    void addSample(const std::string& stage, const std::chrono::high_resolution_clock::time_point start) {
+        const auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> timeMs = end - start;
+        addSample(stage, timeMs.count());
+    }
+
+    /// Nearest-rank percentile of a sorted non-empty vector
+    static double percentile(const std::vector<double>& sorted, double p) {
+        const size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    static std::string escape(const std::string& str) {
+        std::string result;
+        for(const char c : str) {
+            if(c == '"' || c == '\\') {
+                result.push_back('\\');
+            }
+            result.push_back(c);
+        }
+        return result;
+    }
+};
+
+/// Peak resident set size of this process in bytes, 0 if unknown
+inline size_t getPeakRssBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<size_t>(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    rusage usage{};
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);  // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;  // kilobytes on Linux
+#endif
+#endif
+}
+
+using BenchmarkFunction = std::function<void(const BenchmarkOptions&, BenchmarkReport&)>;
+
+/// All benchmarks registered by PEPR3D_BENCHMARK, in registration order
+inline std::vector<std::pair<std::string, BenchmarkFunction>>& getBenchmarks() {
+    static std::vector<std::pair<std::string, BenchmarkFunction>> benchmarks;
+    return benchmarks;
+}
+
+inline bool registerBenchmark(const std::string& name, BenchmarkFunction func) {
+    getBenchmarks().emplace_back(name, std::move(func));
+    return true;
+}
+
+}  // namespace pepr3d::bench
+
+/// Define a benchmark that is run by pepr3d-bench, similarly to gtest's TEST macro
+#define PEPR3D_BENCHMARK(name)                                                                                  \
+    static void pepr3dBenchmark_##name(const pepr3d::bench::BenchmarkOptions&, pepr3d::bench::BenchmarkReport&); \
+    static const bool pepr3dBenchmarkRegistered_##name =                                                        \
+        pepr3d::bench::registerBenchmark(#name, &pepr3dBenchmark_##name);                                       \
+    static void pepr3dBenchmark_##name([[maybe_unused]] const pepr3d::bench::BenchmarkOptions& options,        \
+                                       [[maybe_unused]] pepr3d::bench::BenchmarkReport& report)
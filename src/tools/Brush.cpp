@@ -8,7 +8,8 @@ void Brush::onModelViewMouseDown(ModelView& modelView, ci::app::MouseEvent event
     if(!event.isLeft()) {
         return;
     }
-    mLastRay = modelView.getRayFromWindowCoordinates(event.getPos());
+    stopPaint();
+    updateRay(modelView, event);
     paint();
 }
 
@@ -43,25 +44,43 @@ void Brush::onToolDeselect(ModelView& modelView) {
 }
 
 void Brush::paint() {
-    // Prevents blocking the rendering if painting takes too long
+    // Prevents blocking the rendering if painting takes too long, the next paint sweeps over the skipped part
     if(mPaintsSinceDraw >= MAX_PAINTS_WITHOUT_DRAW) {
         return;
     }
 
+    if(mLastIntersection) {
+        // Wait until the brush moves far enough from the last painted point
+        if(mStrokeIntersection &&
+           glm::distance(*mLastIntersection, *mStrokeIntersection) < mBrushSettings.size * STROKE_SPACING_IN_SIZES) {
+            return;
+        }
+    } else if(mBrushSettings.spherical) {
+        // Spherical brush paints only around a hit, the stroke starts again on the next one
+        mStrokeRay.reset();
+        mStrokeIntersection.reset();
+        return;
+    }
+
     mPaintsSinceDraw++;
 
     mBrushSettings.color = mApplication.getCurrentGeometry()->getColorManager().getActiveColorIndex();
     auto* commandManager = mApplication.getCommandManager();
     if(commandManager) {
-        commandManager->execute(std::make_unique<CmdPaintBrush>(mLastRay, mBrushSettings), mGroupCommands);
+        commandManager->execute(std::make_unique<CmdPaintBrush>(BrushSweep{mStrokeRay, mLastRay}, mBrushSettings),
+                                mGroupCommands);
     }
 
+    mStrokeRay = mLastRay;
+    mStrokeIntersection = mLastIntersection;
     mGroupCommands = true;
     mPaintedAnything = true;
 }
 
 void Brush::stopPaint() {
     mGroupCommands = false;
+    mStrokeRay.reset();
+    mStrokeIntersection.reset();
 }
 
 void Brush::updateHighlight(ModelView& modelView, ci::app::MouseEvent event) const {
@@ -73,7 +92,12 @@ void Brush::updateHighlight(ModelView& modelView, ci::app::MouseEvent event) con
 
 void Brush::updateRay(ModelView& modelView, ci::app::MouseEvent event) {
     mLastRay = modelView.getRayFromWindowCoordinates(event.getPos());
-    auto intersection = mApplication.getCurrentGeometry()->intersectMesh(mLastRay, mLastIntersection);
+    glm::vec3 intersection{};
+    if(mApplication.getCurrentGeometry()->intersectMesh(mLastRay, intersection)) {
+        mLastIntersection = intersection;
+    } else {
+        mLastIntersection.reset();
+    }
 }
 
 bool Brush::isEnabled() const {
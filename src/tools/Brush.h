@@ -1,5 +1,6 @@
 #pragma once
 #include <cinder/Ray.h>
+#include <optional>
 #include "tools/Tool.h"
 #include "ui/IconsMaterialDesign.h"
 #include "ui/SidePane.h"
@@ -47,6 +48,18 @@ struct BrushSettings {
     }
 };
 
+/// Part of a brush stroke, the brush is swept from the previous ray to the current one
+struct BrushSweep {
+    /// Sweeps longer than this number of brush sizes are painted as a dab, the ends are likely not on one surface
+    static constexpr float MAX_LENGTH_IN_SIZES = 8.f;
+
+    /// Ray of the previous paint of the stroke, none for a single dab
+    std::optional<ci::Ray> from;
+
+    /// Ray of the current paint
+    ci::Ray to;
+};
+
 /// Tool used for painting a model while not being limited by the original triangles
 class Brush : public Tool {
    public:
@@ -90,7 +103,15 @@ class Brush : public Tool {
     /// Update ray and intersection data
     void updateRay(ModelView& modelView, ci::app::MouseEvent event);
     ci::Ray mLastRay;
-    glm::vec3 mLastIntersection;
+
+    /// Intersection of the last ray with the model, none if it missed
+    std::optional<glm::vec3> mLastIntersection;
+
+    /// Last painted ray of the current stroke, the next paint sweeps the brush from it
+    std::optional<ci::Ray> mStrokeRay;
+
+    /// Intersection of the last painted ray, none if it missed
+    std::optional<glm::vec3> mStrokeIntersection;
 
     MainApplication& mApplication;
 
@@ -107,6 +128,9 @@ class Brush : public Tool {
     /// How many times can we run this tool without updating the screen
     int mPaintsSinceDraw = 0;
     const int MAX_PAINTS_WITHOUT_DRAW = 1;
+
+    /// Paint again only after the brush moved by this part of its size, so that slow drags do not pile up dabs
+    const float STROKE_SPACING_IN_SIZES = 0.25f;
 };
 
 }  // namespace pepr3d
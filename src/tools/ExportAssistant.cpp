@@ -2,6 +2,7 @@
 #include <random>
 #include <vector>
 #include "commands/CmdPaintSingleColor.h"
+#include "geometry/CancellationToken.h"
 #include "geometry/ModelExporter.h"
 #include "geometry/SdfValuesException.h"
 #include "ui/MainApplication.h"
@@ -350,12 +351,14 @@ void ExportAssistant::exportFiles() {
                     try {
                         prepareExport();
                         mExporter->saveModel(filePath, fileName, fileType, mExportType);
+                    } catch(const OperationCancelledException&) {
+                        throw;
                     } catch(std::exception& e) {
                         pushErrorDialog(e.what());
                         updateSettings();
                     }
                 },
-                [this]() {}, true);
+                [this]() {}, true, SlowOperationPriority::Background);
         }
     });
 }
@@ -366,6 +369,8 @@ void ExportAssistant::updateExtrusionPreview() {
             try {
                 prepareExport();
                 mScenes = mExporter->createScenes(mExportType);
+            } catch(const OperationCancelledException&) {
+                throw;
             } catch(std::exception& e) {
                 pushErrorDialog(e.what());
                 updateSettings();
@@ -380,7 +385,7 @@ void ExportAssistant::updateExtrusionPreview() {
                               // geometry, but that is not thread-safe as we modify it during prepareExport()
             setOverride();
         },
-        true);
+        true, SlowOperationPriority::Background, "Update extrusion preview");
 }
 
 void ExportAssistant::prepareExport() {
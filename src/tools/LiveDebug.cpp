@@ -29,6 +29,17 @@ void LiveDebug::drawToSidePane(SidePane& sidePane) {
 
     sidePane.drawSeparator();
 
+    const SnapshotStats undoStats = mApplication.getCommandManager()->getSnapshotStats();
+    sidePane.drawText("Undo commands: " + to_string(undoStats.commandCount) +
+                      " (dropped: " + to_string(undoStats.droppedCommandCount) + ")\n");
+    sidePane.drawText("Undo snapshots: " + to_string(undoStats.snapshotCount) +
+                      " (thinned: " + to_string(undoStats.thinnedSnapshotCount) + ")\n");
+    sidePane.drawText("Snapshot memory: " + to_string(undoStats.snapshotBytes / (1024 * 1024)) + " MB\n");
+    sidePane.drawText("Last command: " + to_string(undoStats.lastCommandMs) + " ms\n");
+    sidePane.drawText("Longest undo replay: " + to_string(undoStats.maxReplayMs) + " ms\n");
+
+    sidePane.drawSeparator();
+
     static int addedValue = 1;
     ImGui::Text("Current value: %i", mIntegerState.mInnerValue);
     if(mIntegerManager.canUndo()) {
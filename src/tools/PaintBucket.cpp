@@ -101,31 +101,40 @@ void PaintBucket::onModelViewMouseDown(ModelView &modelView, ci::app::MouseEvent
         return;
     }
 
-    const double angleRads = mStopOnNormalDegrees * glm::pi<double>() / 180.0;
-    const NormalStopping normalFtor(geometry, glm::cos(angleRads),
-                                    geometry->getTriangle(*hoveredTriangleId).getNormal(), mNormalCompare);
-
-    const ColorStopping colorFtor(geometry);
+    const size_t currentColorIndex = geometry->getColorManager().getActiveColorIndex();
+    const bool hoverOverSameTriangle = geometry->getTriangleColor(*hoveredTriangleId) == currentColorIndex;
 
-    auto combinedCriterion = [&normalFtor, &colorFtor, this](const DetailedTriangleId a,
-                                                             const DetailedTriangleId b) -> bool {
-        if(mDoNotStop) {
-            return true;
-        }
-        bool result = true;
-        if(mStopOnNormal) {
-            result &= normalFtor(a, b);
-        }
-        if(mStopOnColor) {
-            result &= colorFtor(a, b);
-        }
-        return result;
-    };
+    // We only want to re-draw if we are not dragging, or if you are dragging and reached a new region
+    if(mDragging && hoverOverSameTriangle) {
+        return;
+    }
 
+    const double angleRads = mStopOnNormalDegrees * glm::pi<double>() / 180.0;
     std::vector<DetailedTriangleId> trianglesToPaint;
 
     try {
-        trianglesToPaint = geometry->bucket(*hoveredTriangleId, combinedCriterion);
+        // Criteria between neighbours give whole components, which the geometry caches between the clicks
+        if(mDoNotStop || !mStopOnNormal || mNormalCompare == NormalAngleCompare::NEIGHBOURS) {
+            BucketCriterion criterion;
+            criterion.stopOnColor = !mDoNotStop && mStopOnColor;
+            criterion.stopOnNormal = !mDoNotStop && mStopOnNormal;
+            criterion.minNormalCos = glm::cos(angleRads);
+            trianglesToPaint = geometry->bucketComponent(*hoveredTriangleId, criterion);
+        } else {
+            const NormalStopping normalFtor(geometry, glm::cos(angleRads),
+                                            geometry->getTriangle(*hoveredTriangleId).getNormal(), mNormalCompare);
+            const ColorStopping colorFtor(geometry);
+
+            auto combinedCriterion = [&normalFtor, &colorFtor, this](const DetailedTriangleId a,
+                                                                     const DetailedTriangleId b) -> bool {
+                bool result = normalFtor(a, b);
+                if(mStopOnColor) {
+                    result &= colorFtor(a, b);
+                }
+                return result;
+            };
+            trianglesToPaint = geometry->bucket(*hoveredTriangleId, combinedCriterion);
+        }
     } catch(std::exception &e) {
         const std::string errorCaption = "Error: Failed to bucket paint";
         const std::string errorDescription =
@@ -139,15 +148,9 @@ void PaintBucket::onModelViewMouseDown(ModelView &modelView, ci::app::MouseEvent
         return;
     }
 
-    const size_t currentColorIndex = geometry->getColorManager().getActiveColorIndex();
-    const bool hoverOverSameTriangle = geometry->getTriangleColor(*hoveredTriangleId) == currentColorIndex;
-
-    // We only want to re-draw if we are not dragging, or if you are dragging and reached a new region
-    if(!mDragging || (mDragging && !hoverOverSameTriangle)) {
-        CommandManager<Geometry> *const commandManager = mApplication.getCommandManager();
-        commandManager->execute(std::make_unique<CmdPaintSingleColor>(std::move(trianglesToPaint), currentColorIndex),
-                                mDragging);
-    }
+    CommandManager<Geometry> *const commandManager = mApplication.getCommandManager();
+    commandManager->execute(std::make_unique<CmdPaintSingleColor>(std::move(trianglesToPaint), currentColorIndex),
+                            mDragging);
 }
 
 void PaintBucket::onModelViewMouseDrag(class ModelView &modelView, ci::app::MouseEvent event) {
@@ -16,7 +16,8 @@ void Segmentation::drawToSidePane(SidePane& sidePane) {
     if(!isSdfComputed) {
         sidePane.drawText("Warning: This computation may take a long time to perform.");
         if(sidePane.drawButton("Compute SDF")) {
-            mApplication.enqueueSlowOperation([this]() { safeComputeSdf(mApplication); }, []() {}, true);
+            mApplication.enqueueSlowOperation([this]() { safeComputeSdf(mApplication); }, []() {}, true,
+                                              SlowOperationPriority::Background, "Compute SDF");
         }
         sidePane.drawTooltipOnHover("Compute the shape diameter function of the model to enable the segmentation.");
     } else {
@@ -1,4 +1,5 @@
 #include "tools/Tool.h"
+#include "geometry/CancellationToken.h"
 #include "geometry/SdfValuesException.h"
 #include "ui/MainApplication.h"
 
@@ -45,6 +46,8 @@ std::optional<DetailedTriangleId> Tool::safeIntersectDetailedMesh(MainApplicatio
 bool Tool::safeComputeSdf(MainApplication& mainApplication) {
     try {
         mainApplication.getCurrentGeometry()->computeSdfValues();
+    } catch(const OperationCancelledException&) {
+        throw;  // not a failure, the operation computing the SDF stops
     } catch(SdfValuesException& e) {
         const std::string errorCaption = "Error: Failed to compute SDF";
         const std::string errorDescription =
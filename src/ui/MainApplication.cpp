@@ -41,9 +41,9 @@ using namespace ci::app;
 using namespace std;
 
 namespace pepr3d {
-// At least 2 threads in thread pool must be created!
-// There are several occasions in which we enqueue a new task from inside a thread pool.
-// If there was only 1 thread in the pool, the tasks would never finish causing a deadlock.
+// At least 2 threads in thread pool are created.
+// Tasks waiting for other tasks of the pool execute pending tasks meanwhile, so nested tasks do not deadlock.
+// The second thread keeps short tasks running while a slow operation occupies the first one.
 // Note: std::thread::hardware_concurrency() may return 0
 ::ThreadPool MainApplication::sThreadPool(std::max<size_t>(3, std::thread::hardware_concurrency()) - 1);
 
@@ -250,8 +250,8 @@ bool MainApplication::showLoadingErrorDialog() {
     if(progress.aabbTreePercentage < 1.0f) {
         const std::string errorCaption = "Error: Failed to build an AABB tree";
         const std::string errorDescription =
-            "Problems were found in the imported geometry. An AABB tree could not be built using the data "
-            "using the CGAL library.\n\nThe provided file could not be imported.";
+            "Problems were found in the imported geometry. An AABB tree could not be built using the "
+            "data.\n\nThe provided file could not be imported.";
         pushDialog(Dialog(DialogType::Error, errorCaption, errorDescription, "Cancel import"));
         mGeometryInProgress = nullptr;
         mProgressIndicator.setGeometryInProgress(nullptr);
@@ -5,8 +5,13 @@
 //#endif
 
 #include <algorithm>
+#include <future>
+#include <memory>
 #include <queue>
+#include <string>
+#include <unordered_map>
 
+#include "cinder/Log.h"
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/TextureFont.h"
@@ -25,6 +30,7 @@
 #include "SidePane.h"
 #include "Toolbar.h"
 #include "commands/CommandManager.h"
+#include "geometry/CancellationToken.h"
 #include "geometry/ExportType.h"
 
 namespace pepr3d {
@@ -34,6 +40,12 @@ using cinder::app::FileDropEvent;
 using cinder::app::KeyEvent;
 using cinder::app::MouseEvent;
 
+/// Thread pool lane of a slow operation
+enum class SlowOperationPriority {
+    Interactive,  ///< Starts as soon as a worker is free, e.g. undo, redo, or painting
+    Background    ///< Starts only when no interactive work is waiting, e.g. SDF or extrusion preview
+};
+
 /// The main Cinder-based application, represents a window, handles events, thread pool, active tools, geometry, etc.
 class MainApplication : public cinder::app::App {
    public:
@@ -253,21 +265,75 @@ class MainApplication : public cinder::app::App {
     /// Schedules `operation` to be executed in a separate thread in a thread pool.
     /// If `showIndicator` is true, displays a progress indicator, which disables user interaction with the application.
     /// After the `operation` is finished, `postOperation` is executed in the main thread of the application.
-    /// Finally, the progress indicator is hidden.
+    /// Finally, the progress indicator is hidden once no other operation showing it is running.
+    /// Background operations start only when no interactive work is waiting in the thread pool.
+    /// If `kind` is not empty, an unfinished operation of the same kind is cancelled and the new one starts after it
+    /// stops. A cancelled operation skips its `postOperation`.
+    /// Returns the token of the operation, which the caller may use to cancel it.
     template <typename OperationFunc, typename PostOperationFunc>
-    void enqueueSlowOperation(OperationFunc operation, PostOperationFunc postOperation, bool showIndicator = true) {
+    std::shared_ptr<CancellationToken> enqueueSlowOperation(
+        OperationFunc operation, PostOperationFunc postOperation, bool showIndicator = true,
+        SlowOperationPriority priority = SlowOperationPriority::Interactive, const std::string& kind = "") {
+        auto token = std::make_shared<CancellationToken>();
+        auto finished = std::make_shared<std::promise<void>>();
+        std::shared_future<void> previous;
+        if(!kind.empty()) {
+            SlowOperation& last = mLastSlowOperations[kind];
+            if(last.token != nullptr) {
+                last.token->cancel();
+                previous = last.finished;
+            }
+            last = SlowOperation{token, finished->get_future().share()};
+        }
+
         if(showIndicator) {
+            ++mIndicatorOperationCount;
             mProgressIndicator.setGeometryInProgress(mGeometry);
         }
-        dispatchAsync([operation, postOperation, this]() {
-            sThreadPool.enqueue([operation, postOperation, this]() {
-                operation();
-                dispatchAsync([postOperation, this]() {
-                    postOperation();
+        auto task = [operation, postOperation, showIndicator, token, finished, previous, this]() {
+            if(previous.valid()) {
+                sThreadPool.wait(previous);
+            }
+
+            // Called in the main thread on every path, so that a failed operation does not keep the indicator shown
+            const auto releaseIndicator = [showIndicator, this]() {
+                if(showIndicator && --mIndicatorOperationCount == 0) {
                     mProgressIndicator.setGeometryInProgress(nullptr);
-                });
+                }
+            };
+            try {
+                CancellationToken::Scope scope(token.get());
+                token->throwIfCancelled();
+                operation();
+            } catch(const OperationCancelledException&) {
+                CI_LOG_I("Slow operation cancelled.");
+            } catch(...) {
+                finished->set_value();
+                dispatchAsync(releaseIndicator);
+                throw;
+            }
+            finished->set_value();
+
+            dispatchAsync([postOperation, token, releaseIndicator]() {
+                try {
+                    if(!token->isCancelled()) {
+                        postOperation();
+                    }
+                } catch(...) {
+                    releaseIndicator();
+                    throw;
+                }
+                releaseIndicator();
             });
+        };
+        dispatchAsync([task, priority]() {
+            if(priority == SlowOperationPriority::Background) {
+                sThreadPool.enqueue_background(task);
+            } else {
+                sThreadPool.enqueue(task);
+            }
         });
+        return token;
     }
 
     /// Returns the path to the current Geometry file.
@@ -341,6 +407,16 @@ class MainApplication : public cinder::app::App {
     std::size_t mLastVersionSaved = std::numeric_limits<std::size_t>::max();
     bool mIsGeometryDirty = false;
 
+    /// Token and completion of the last slow operation of each kind, see enqueueSlowOperation()
+    struct SlowOperation {
+        std::shared_ptr<CancellationToken> token;
+        std::shared_future<void> finished;
+    };
+    std::unordered_map<std::string, SlowOperation> mLastSlowOperations;
+
+    /// Number of unfinished slow operations which show the progress indicator
+    std::size_t mIndicatorOperationCount = 0;
+
     static ::ThreadPool sThreadPool;
 };
 
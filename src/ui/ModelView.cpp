@@ -238,6 +238,20 @@ void ModelView::updateVboAndBatch() {
     mVboMesh->bufferAttrib<GLint>(Attributes::HIGHLIGHT_MASK, glData.highlightMask);
 
     mBatch = ci::gl::Batch::create(mVboMesh, mModelShader);
+
+    // Everything was uploaded
+    glData.info.unsetUpdatedRanges();
+}
+
+template <typename T>
+void ModelView::bufferAttribRange(cinder::geom::Attrib attrib, const std::vector<T>& data, size_t begin, size_t end) {
+    assert(mVboMesh);
+    assert(begin < end && end <= data.size());
+    auto* attribVbo = mVboMesh->findAttrib(attrib);
+    assert(attribVbo != nullptr);
+
+    // Each attribute has its own buffer in the layout, so the vertices are tightly packed
+    attribVbo->second->bufferSubData(begin * sizeof(T), (end - begin) * sizeof(T), &data[begin]);
 }
 
 void ModelView::updateModelMatrix() {
@@ -299,15 +313,25 @@ void ModelView::drawGeometry() {
     }
 
     const Geometry::OpenGlData& glData = mApplication.getCurrentGeometry()->getOpenGlData();
-    if(glData.isDirty || !mBatch || isMeshOverriden()) {
-        if(glData.isDirty && !isMeshOverriden()) {
-            // attention! do not update geometry buffers if isMeshOverriden() is true,
-            // because ExportAssistant could be modifying the geometry in a background thread
-            // and the operations are not thread-safe!
-            mApplication.getCurrentGeometry()->updateOpenGlBuffers();
-            CI_LOG_I("Geometry buffers updated");
-        }
+    // attention! do not update geometry buffers if isMeshOverriden() is true,
+    // because ExportAssistant could be modifying the geometry in a background thread
+    // and the operations are not thread-safe!
+    if(glData.needsUpdate() && !isMeshOverriden()) {
+        mApplication.getCurrentGeometry()->updateOpenGlBuffers();
+        CI_LOG_I("Geometry buffers updated");
+    }
+
+    if(glData.info.didResize || !mBatch || isMeshOverriden()) {
         updateVboAndBatch();
+    } else if(!glData.info.updatedRanges.empty()) {
+        // Upload only the parts of the buffers that changed
+        for(const Geometry::OpenGlData::VertexRange& range : glData.info.updatedRanges) {
+            bufferAttribRange(ci::geom::Attrib::POSITION, glData.vertexBuffer, range.begin, range.end);
+            bufferAttribRange(ci::geom::Attrib::NORMAL, glData.normalBuffer, range.begin, range.end);
+            bufferAttribRange(Attributes::COLOR_IDX, glData.colorBuffer, range.begin, range.end);
+            bufferAttribRange(Attributes::HIGHLIGHT_MASK, glData.highlightMask, range.begin, range.end);
+        }
+        glData.info.unsetUpdatedRanges();
     }
 
     // Pass new highlight data if required
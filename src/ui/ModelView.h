@@ -237,6 +237,10 @@ class ModelView {
     /// Recalculates the OpenGL vertex buffer object and the Cinder batch.
     void updateVboAndBatch();
 
+    /// Uploads vertices [begin, end) of a single attribute into the existing vertex buffer object.
+    template <typename T>
+    void bufferAttribRange(cinder::geom::Attrib attrib, const std::vector<T>& data, size_t begin, size_t end);
+
     /// Custom OpenGL attributes
     struct Attributes {
         static const cinder::geom::Attrib COLOR_IDX = cinder::geom::Attrib::CUSTOM_0;
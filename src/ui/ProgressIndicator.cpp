@@ -36,8 +36,8 @@ void ProgressIndicator::draw() {
 
         const auto& progress = mGeometry->getProgress();
 
-        drawStatus("Importing render geometry...", progress.importRenderPercentage, false);
-        drawStatus("Importing compute geometry...", progress.importComputePercentage, false);
+        drawStatus("Importing geometry...", progress.importRenderPercentage, false);
+        drawStatus("Joining vertices...", progress.importComputePercentage, false);
         drawStatus("Generating buffers...", progress.buffersPercentage, false);
         drawStatus("Building AABB tree...", progress.aabbTreePercentage, true);
         drawStatus("Building polyhedron...", progress.polyhedronPercentage, true);